@@ -0,0 +1,50 @@
+# Copyright (C) 2001-2016  David Capello
+# Find benchmarks and add rules to compile them
+
+find_library(BENCHMARK_LIBRARY NAMES benchmark)
+find_path(BENCHMARK_INCLUDE_DIR NAMES benchmark/benchmark.h)
+
+if(NOT BENCHMARK_LIBRARY OR NOT BENCHMARK_INCLUDE_DIR)
+  message(FATAL_ERROR "Google Benchmark library is missing (it's required by ENABLE_BENCHMARKS)")
+endif()
+
+# All benchmarks are compiled with the "benchmarks" target, and
+# "run_benchmarks" runs them saving the results as JSON files in
+# BENCHMARKS_OUTPUT_DIR (so they can be compared between versions).
+set(BENCHMARKS_OUTPUT_DIR ${CMAKE_BINARY_DIR}/benchmarks
+  CACHE PATH "Directory where run_benchmarks saves the results")
+file(MAKE_DIRECTORY ${BENCHMARKS_OUTPUT_DIR})
+
+add_custom_target(benchmarks)
+add_custom_target(run_benchmarks)
+
+function(find_benchmarks dir dependencies)
+  file(GLOB benchmarks ${CMAKE_CURRENT_SOURCE_DIR}/${dir}/*_benchmark.cpp)
+  list(REMOVE_AT ARGV 0)
+
+  # Add benchmark include directory so we can #include <benchmark/benchmark.h>
+  include_directories(${BENCHMARK_INCLUDE_DIR})
+
+  foreach(benchmarksourcefile ${benchmarks})
+    get_filename_component(benchmarkname ${benchmarksourcefile} NAME_WE)
+
+    add_executable(${benchmarkname} ${benchmarksourcefile})
+
+    if(MSVC)
+      # Fix problem compiling gen from a Visual Studio solution
+      set_target_properties(${benchmarkname}
+        PROPERTIES LINK_FLAGS -ENTRY:"mainCRTStartup")
+    endif()
+
+    target_link_libraries(${benchmarkname} ${BENCHMARK_LIBRARY} ${ARGV} ${PLATFORM_LIBS})
+    add_dependencies(benchmarks ${benchmarkname})
+
+    add_custom_target(run_${benchmarkname}
+      COMMAND ${benchmarkname}
+        --benchmark_out=${BENCHMARKS_OUTPUT_DIR}/${benchmarkname}.json
+        --benchmark_out_format=json
+      WORKING_DIRECTORY ${BENCHMARKS_OUTPUT_DIR}
+      DEPENDS ${benchmarkname})
+    add_dependencies(run_benchmarks run_${benchmarkname})
+  endforeach()
+endfunction()
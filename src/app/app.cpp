@@ -12,20 +12,15 @@
 #include "app/app.h"
 
 #include "app/app_options.h"
+#include "app/batch_server.h"
 #include "app/check_update.h"
+#include "app/cli_processor.h"
 #include "app/color_utils.h"
-#include "app/commands/cmd_save_file.h"
-#include "app/commands/cmd_sprite_size.h"
 #include "app/commands/commands.h"
-#include "app/commands/params.h"
-#include "app/console.h"
 #include "app/crash/data_recovery.h"
-#include "app/document_exporter.h"
-#include "app/document_undo.h"
 #include "app/file/file.h"
 #include "app/file/file_formats_manager.h"
 #include "app/file_system.h"
-#include "app/filename_formatter.h"
 #include "app/gui_xml.h"
 #include "app/ini_file.h"
 #include "app/log.h"
@@ -54,17 +49,15 @@
 #include "app/ui_context.h"
 #include "app/util/clipboard.h"
 #include "app/webserver.h"
-#include "base/convert_to.h"
+#include "base/chrono.h"
 #include "base/exception.h"
 #include "base/fs.h"
 #include "base/path.h"
-#include "base/split_string.h"
+#include "base/profiler.h"
 #include "base/unique_ptr.h"
 #include "doc/document_observer.h"
-#include "doc/frame_tag.h"
 #include "doc/image.h"
 #include "doc/layer.h"
-#include "doc/layers_range.h"
 #include "doc/palette.h"
 #include "doc/site.h"
 #include "doc/sprite.h"
@@ -76,6 +69,7 @@
 #include "ui/intern.h"
 #include "ui/ui.h"
 
+#include <cstdio>
 #include <iostream>
 
 #ifdef ENABLE_STEAM
@@ -96,8 +90,8 @@ class App::Modules {
 public:
   LoggerModule m_loggerModule;
   FileSystemModule m_file_system_module;
-  tools::ToolBox m_toolbox;
-  tools::ActiveToolManager m_activeToolManager;
+  base::UniquePtr<tools::ToolBox> m_toolbox;
+  base::UniquePtr<tools::ActiveToolManager> m_activeToolManager;
   CommandsModule m_commands_modules;
   UIContext m_ui_context;
   RecentFiles m_recent_files;
@@ -108,10 +102,23 @@ public:
 
   Modules(bool createLogInDesktop)
     : m_loggerModule(createLogInDesktop)
-    , m_activeToolManager(&m_toolbox)
     , m_recovery(nullptr) {
   }
 
+  // Tools are loaded from gui.xml the first time they are needed
+  // (commands in --batch mode don't use them).
+  tools::ToolBox* toolBox() {
+    if (!m_toolbox.get())
+      m_toolbox.reset(new tools::ToolBox);
+    return m_toolbox.get();
+  }
+
+  tools::ActiveToolManager* activeToolManager() {
+    if (!m_activeToolManager.get())
+      m_activeToolManager.reset(new tools::ActiveToolManager(toolBox()));
+    return m_activeToolManager.get();
+  }
+
   app::crash::DataRecovery* recovery() {
     return m_recovery;
   }
@@ -134,6 +141,45 @@ public:
 
 };
 
+// Prints in stderr the time spent in each stage of
+// App::initialize() (--startup-profile option). Stages are recorded
+// in the --profile timeline too.
+class StartupProfile {
+public:
+  StartupProfile(bool enabled)
+    : m_enabled(enabled)
+    , m_stage(nullptr)
+    , m_stageStart(0) {
+  }
+
+  ~StartupProfile() {
+    stage(nullptr);
+    if (m_enabled)
+      std::fprintf(stderr, "%-20s %8.2f ms\n", "total", m_total.elapsed()*1000.0);
+  }
+
+  // Starts a new stage ("name" must be a string literal).
+  void stage(const char* name) {
+    if (m_stage) {
+      if (m_enabled)
+        std::fprintf(stderr, "%-20s %8.2f ms\n", m_stage, m_chrono.elapsed()*1000.0);
+      if (base::profiler::is_enabled() && m_stageStart >= 0)
+        base::profiler::add_event("app", m_stage, m_stageStart,
+                                  base::profiler::now() - m_stageStart);
+    }
+    m_stage = name;
+    m_stageStart = (base::profiler::is_enabled() ? base::profiler::now(): -1);
+    m_chrono.reset();
+  }
+
+private:
+  bool m_enabled;
+  const char* m_stage;
+  int64_t m_stageStart;
+  base::Chrono m_chrono;
+  base::Chrono m_total;
+};
+
 class StdoutEngineDelegate : public script::EngineDelegate {
 public:
   void onConsolePrint(const char* text) override {
@@ -149,7 +195,7 @@ App::App()
   , m_legacy(NULL)
   , m_isGui(false)
   , m_isShell(false)
-  , m_exporter(NULL)
+  , m_isServer(false)
 {
   ASSERT(m_instance == NULL);
   m_instance = this;
@@ -157,11 +203,24 @@ App::App()
 
 void App::initialize(const AppOptions& options)
 {
+  // Start recording the timeline as soon as possible to include the
+  // initialization (it's saved when the App is destroyed).
+  m_profileFileName = options.profileFileName();
+  if (!m_profileFileName.empty())
+    base::profiler::start();
+
+  base::profiler::ScopedTimer timer("app", "App::initialize");
+  StartupProfile startup(options.startupProfile());
+
   m_isGui = options.startUI();
   m_isShell = options.startShell();
-  if (m_isGui)
+  m_isServer = options.startServer();
+  if (m_isGui) {
+    startup.stage("ui system");
     m_uiSystem.reset(new ui::UISystem);
+  }
 
+  startup.stage("preferences");
   m_coreModules = new CoreModules;
 
   bool createLogInDesktop = false;
@@ -178,31 +237,37 @@ void App::initialize(const AppOptions& options)
       break;
   }
 
+  startup.stage("modules");
   m_modules = new Modules(createLogInDesktop);
   m_legacy = new LegacyModules(isGui() ? REQUIRE_INTERFACE: 0);
-  m_brushes.reset(new AppBrushes);
-
-  if (options.hasExporterParams())
-    m_exporter.reset(new DocumentExporter);
 
   // Data recovery is enabled only in GUI mode
-  if (isGui() && preferences().general.dataRecovery())
+  if (isGui() && preferences().general.dataRecovery()) {
+    startup.stage("data recovery");
     m_modules->createDataRecovery();
+  }
 
   // Register well-known image file types.
+  startup.stage("file formats");
   FileFormatsManager::instance()->registerAllFormats();
 
   if (isPortable())
     LOG("Running in portable mode\n");
 
   // Load or create the default palette, or migrate the default
-  // palette from an old format palette to the new one, etc.
-  load_default_palette(options.paletteFileName());
+  // palette from an old format palette to the new one, etc. In
+  // --batch mode the palette is loaded only if some command needs it.
+  startup.stage("default palette");
+  if (isGui() || m_isShell || m_isServer)
+    load_default_palette(options.paletteFileName());
+  else
+    load_default_palette_on_demand(options.paletteFileName());
 
   // Initialize GUI interface
   UIContext* ctx = UIContext::instance();
   if (isGui()) {
     LOG("GUI mode\n");
+    startup.stage("main window");
 
     // Setup the GUI cursor and redraw screen
 
@@ -232,427 +297,10 @@ void App::initialize(const AppOptions& options)
 
   // Procress options
   LOG("Processing options...\n");
-
-  bool ignoreEmpty = false;
-  bool trim = false;
-  Params cropParams;
-  SpriteSheetType sheetType = SpriteSheetType::None;
-
-  // Open file specified in the command line
-  if (!options.values().empty()) {
-    Console console;
-    bool splitLayers = false;
-    bool splitLayersSaveAs = false;
-    bool allLayers = false;
-    bool listLayers = false;
-    bool listTags = false;
-    std::string importLayer;
-    std::string importLayerSaveAs;
-    std::string filenameFormat;
-    std::string frameTagName;
-    std::string frameRange;
-
-    for (const auto& value : options.values()) {
-      const AppOptions::Option* opt = value.option();
-
-      // Special options/commands
-      if (opt) {
-        // --data <file.json>
-        if (opt == &options.data()) {
-          if (m_exporter)
-            m_exporter->setDataFilename(value.value());
-        }
-        // --format <format>
-        else if (opt == &options.format()) {
-          if (m_exporter) {
-            DocumentExporter::DataFormat format = DocumentExporter::DefaultDataFormat;
-
-            if (value.value() == "json-hash")
-              format = DocumentExporter::JsonHashDataFormat;
-            else if (value.value() == "json-array")
-              format = DocumentExporter::JsonArrayDataFormat;
-
-            m_exporter->setDataFormat(format);
-          }
-        }
-        // --sheet <file.png>
-        else if (opt == &options.sheet()) {
-          if (m_exporter)
-            m_exporter->setTextureFilename(value.value());
-        }
-        // --sheet-width <width>
-        else if (opt == &options.sheetWidth()) {
-          if (m_exporter)
-            m_exporter->setTextureWidth(strtol(value.value().c_str(), NULL, 0));
-        }
-        // --sheet-height <height>
-        else if (opt == &options.sheetHeight()) {
-          if (m_exporter)
-            m_exporter->setTextureHeight(strtol(value.value().c_str(), NULL, 0));
-        }
-        // --sheet-pack
-        else if (opt == &options.sheetType()) {
-          if (value.value() == "horizontal")
-            sheetType = SpriteSheetType::Horizontal;
-          else if (value.value() == "vertical")
-            sheetType = SpriteSheetType::Vertical;
-          else if (value.value() == "rows")
-            sheetType = SpriteSheetType::Rows;
-          else if (value.value() == "columns")
-            sheetType = SpriteSheetType::Columns;
-          else if (value.value() == "packed")
-            sheetType = SpriteSheetType::Packed;
-        }
-        // --sheet-pack
-        else if (opt == &options.sheetPack()) {
-          sheetType = SpriteSheetType::Packed;
-        }
-        // --split-layers
-        else if (opt == &options.splitLayers()) {
-          splitLayers = true;
-          splitLayersSaveAs = true;
-        }
-        // --layer <layer-name>
-        else if (opt == &options.layer()) {
-          importLayer = value.value();
-          importLayerSaveAs = value.value();
-        }
-        // --all-layers
-        else if (opt == &options.allLayers()) {
-          allLayers = true;
-        }
-        // --frame-tag <tag-name>
-        else if (opt == &options.frameTag()) {
-          frameTagName = value.value();
-        }
-        // --frame-range from,to
-        else if (opt == &options.frameRange()) {
-          frameRange = value.value();
-        }
-        // --ignore-empty
-        else if (opt == &options.ignoreEmpty()) {
-          ignoreEmpty = true;
-        }
-        // --border-padding
-        else if (opt == &options.borderPadding()) {
-          if (m_exporter)
-            m_exporter->setBorderPadding(strtol(value.value().c_str(), NULL, 0));
-        }
-        // --shape-padding
-        else if (opt == &options.shapePadding()) {
-          if (m_exporter)
-            m_exporter->setShapePadding(strtol(value.value().c_str(), NULL, 0));
-        }
-        // --inner-padding
-        else if (opt == &options.innerPadding()) {
-          if (m_exporter)
-            m_exporter->setInnerPadding(strtol(value.value().c_str(), NULL, 0));
-        }
-        // --trim
-        else if (opt == &options.trim()) {
-          trim = true;
-        }
-        // --crop x,y,width,height
-        else if (opt == &options.crop()) {
-          std::vector<std::string> parts;
-          base::split_string(value.value(), parts, ",");
-          if (parts.size() < 4)
-            throw std::runtime_error("--crop needs four parameters separated by comma (,)\n"
-                                     "Usage: --crop x,y,width,height\n"
-                                     "E.g. --crop 0,0,32,32");
-
-          cropParams.set("x", parts[0].c_str());
-          cropParams.set("y", parts[1].c_str());
-          cropParams.set("width", parts[2].c_str());
-          cropParams.set("height", parts[3].c_str());
-        }
-        // --filename-format
-        else if (opt == &options.filenameFormat()) {
-          filenameFormat = value.value();
-        }
-        // --save-as <filename>
-        else if (opt == &options.saveAs()) {
-          Document* doc = NULL;
-          if (!ctx->documents().empty())
-            doc = dynamic_cast<Document*>(ctx->documents().lastAdded());
-
-          if (!doc) {
-            console.printf("A document is needed before --save-as argument\n");
-          }
-          else {
-            ctx->setActiveDocument(doc);
-
-            std::string format = filenameFormat;
-
-            Command* saveAsCommand = CommandsModule::instance()->getCommandByName(CommandId::SaveFileCopyAs);
-            Command* trimCommand = CommandsModule::instance()->getCommandByName(CommandId::AutocropSprite);
-            Command* cropCommand = CommandsModule::instance()->getCommandByName(CommandId::CropSprite);
-            Command* undoCommand = CommandsModule::instance()->getCommandByName(CommandId::Undo);
-
-            // --save-as with --split-layers
-            if (splitLayersSaveAs) {
-              std::string fn, fmt;
-              if (format.empty()) {
-                if (doc->sprite()->totalFrames() > frame_t(1))
-                  format = "{path}/{title} ({layer}) {frame}.{extension}";
-                else
-                  format = "{path}/{title} ({layer}).{extension}";
-              }
-
-              // Store in "visibility" the original "visible" state of every layer.
-              std::vector<bool> visibility(doc->sprite()->countLayers());
-              int i = 0;
-              for (Layer* layer : doc->sprite()->layers())
-                visibility[i++] = layer->isVisible();
-
-              // For each layer, hide other ones and save the sprite.
-              i = 0;
-              for (Layer* show : doc->sprite()->layers()) {
-                // If the user doesn't want all layers and this one is hidden.
-                if (!visibility[i++])
-                  continue;     // Just ignore this layer.
-
-                // Make this layer ("show") the only one visible.
-                for (Layer* hide : doc->sprite()->layers())
-                  hide->setVisible(hide == show);
-
-                FilenameInfo fnInfo;
-                fnInfo
-                  .filename(value.value())
-                  .layerName(show->name());
-
-                fn = filename_formatter(format, fnInfo);
-                fmt = filename_formatter(format, fnInfo, false);
-
-                if (!cropParams.empty())
-                  ctx->executeCommand(cropCommand, cropParams);
-
-                // TODO --trim command with --save-as doesn't make too
-                // much sense as we lost the trim rectangle
-                // information (e.g. we don't have sheet .json) Also,
-                // we should trim each frame individually (a process
-                // that can be done only in fop_operate()).
-                if (trim)
-                  ctx->executeCommand(trimCommand);
-
-                Params params;
-                params.set("filename", fn.c_str());
-                params.set("filename-format", fmt.c_str());
-                ctx->executeCommand(saveAsCommand, params);
-
-                if (trim) {     // Undo trim command
-                  ctx->executeCommand(undoCommand);
-
-                  // Just in case allow non-linear history is enabled
-                  // we clear redo information
-                  doc->undoHistory()->clearRedo();
-                }
-              }
-
-              // Restore layer visibility
-              i = 0;
-              for (Layer* layer : doc->sprite()->layers())
-                layer->setVisible(visibility[i++]);
-            }
-            else {
-              // Show only one layer
-              if (!importLayerSaveAs.empty()) {
-                for (Layer* layer : doc->sprite()->layers())
-                  layer->setVisible(layer->name() == importLayerSaveAs);
-              }
-
-              if (!cropParams.empty())
-                ctx->executeCommand(cropCommand, cropParams);
-
-              if (trim)
-                ctx->executeCommand(trimCommand);
-
-              Params params;
-              params.set("filename", value.value().c_str());
-              params.set("filename-format", format.c_str());
-              ctx->executeCommand(saveAsCommand, params);
-
-              if (trim) {       // Undo trim command
-                ctx->executeCommand(undoCommand);
-
-                // Just in case allow non-linear history is enabled
-                // we clear redo information
-                doc->undoHistory()->clearRedo();
-              }
-            }
-          }
-        }
-        // --scale <factor>
-        else if (opt == &options.scale()) {
-          Command* command = CommandsModule::instance()->getCommandByName(CommandId::SpriteSize);
-          double scale = strtod(value.value().c_str(), NULL);
-          static_cast<SpriteSizeCommand*>(command)->setScale(scale, scale);
-
-          // Scale all sprites
-          for (auto doc : ctx->documents()) {
-            ctx->setActiveDocument(static_cast<app::Document*>(doc));
-            ctx->executeCommand(command);
-          }
-        }
-        // --shrink-to <width,height>
-        else if (opt == &options.shrinkTo()) {
-          std::vector<std::string> dimensions;
-          base::split_string(value.value(), dimensions, ",");
-          if (dimensions.size() < 2)
-            throw std::runtime_error("--shrink-to needs two parameters separated by comma (,)\n"
-                                     "Usage: --shrink-to width,height\n"
-                                     "E.g. --shrink-to 128,64");
-
-          double maxWidth = base::convert_to<double>(dimensions[0]);
-          double maxHeight = base::convert_to<double>(dimensions[1]);
-          double scaleWidth, scaleHeight, scale;
-
-          // Shrink all sprites if needed
-          for (auto doc : ctx->documents()) {
-            ctx->setActiveDocument(static_cast<app::Document*>(doc));
-            scaleWidth = (doc->width() > maxWidth ? maxWidth / doc->width() : 1.0);
-            scaleHeight = (doc->height() > maxHeight ? maxHeight / doc->height() : 1.0);
-            if (scaleWidth < 1.0 || scaleHeight < 1.0) {
-              scale = MIN(scaleWidth, scaleHeight);
-              Command* command = CommandsModule::instance()->getCommandByName(CommandId::SpriteSize);
-              static_cast<SpriteSizeCommand*>(command)->setScale(scale, scale);
-              ctx->executeCommand(command);
-            }
-          }
-        }
-        // --script <filename>
-        else if (opt == &options.script()) {
-          std::string script = value.value();
-
-          StdoutEngineDelegate delegate;
-          AppScripting engine(&delegate);
-          engine.evalFile(script);
-        }
-        // --list-layers
-        else if (opt == &options.listLayers()) {
-          listLayers = true;
-          if (m_exporter)
-            m_exporter->setListLayers(true);
-        }
-        // --list-tags
-        else if (opt == &options.listTags()) {
-          listTags = true;
-          if (m_exporter)
-            m_exporter->setListFrameTags(true);
-        }
-      }
-      // File names aren't associated to any option
-      else {
-        const std::string& filename = base::normalize_path(value.value());
-
-        app::Document* oldDoc = ctx->activeDocument();
-
-        Command* openCommand = CommandsModule::instance()->getCommandByName(CommandId::OpenFile);
-        Params params;
-        params.set("filename", filename.c_str());
-        ctx->executeCommand(openCommand, params);
-
-        app::Document* doc = ctx->activeDocument();
-
-        // If the active document is equal to the previous one, it
-        // means that we couldn't open this specific document.
-        if (doc == oldDoc)
-          doc = nullptr;
-
-        // List layers and/or tags
-        if (doc) {
-          // Show all layers
-          if (allLayers) {
-            for (Layer* layer : doc->sprite()->layers())
-              layer->setVisible(true);
-          }
-
-          if (listLayers) {
-            listLayers = false;
-            for (Layer* layer : doc->sprite()->layers()) {
-              if (layer->isVisible())
-                std::cout << layer->name() << "\n";
-            }
-          }
-
-          if (listTags) {
-            listTags = false;
-            for (FrameTag* tag : doc->sprite()->frameTags())
-              std::cout << tag->name() << "\n";
-          }
-          if (m_exporter) {
-            FrameTag* frameTag = nullptr;
-            if (!frameTagName.empty()) {
-              frameTag = doc->sprite()->frameTags().getByName(frameTagName);
-            }
-            else if (!frameRange.empty()) {
-                std::vector<std::string> splitRange;
-                base::split_string(frameRange, splitRange, ",");
-                if (splitRange.size() < 2)
-                  throw std::runtime_error("--frame-range needs two parameters separated by comma (,)\n"
-                                           "Usage: --frame-range from,to\n"
-                                           "E.g. --frame-range 0,99");
-
-                frameTag = new FrameTag(base::convert_to<frame_t>(splitRange[0]),
-                                        base::convert_to<frame_t>(splitRange[1]));
-            }
-
-            if (!importLayer.empty()) {
-              Layer* foundLayer = NULL;
-              for (Layer* layer : doc->sprite()->layers()) {
-                if (layer->name() == importLayer) {
-                  foundLayer = layer;
-                  break;
-                }
-              }
-              if (foundLayer)
-                m_exporter->addDocument(doc, foundLayer, frameTag);
-            }
-            else if (splitLayers) {
-              for (auto layer : doc->sprite()->layers()) {
-                if (layer->isVisible())
-                  m_exporter->addDocument(doc, layer, frameTag);
-              }
-            }
-            else {
-              m_exporter->addDocument(doc, nullptr, frameTag);
-            }
-          }
-        }
-
-        if (!importLayer.empty())
-          importLayer.clear();
-
-        if (splitLayers)
-          splitLayers = false;
-        if (listLayers)
-          listLayers = false;
-        if (listTags)
-          listTags = false;
-      }
-    }
-
-    if (m_exporter && !filenameFormat.empty())
-      m_exporter->setFilenameFormat(filenameFormat);
-  }
-
-  // Export
-  if (m_exporter) {
-    LOG("Exporting sheet...\n");
-
-    if (sheetType != SpriteSheetType::None)
-      m_exporter->setSpriteSheetType(sheetType);
-
-    if (ignoreEmpty)
-      m_exporter->setIgnoreEmptyCels(true);
-
-    if (trim)
-      m_exporter->setTrimCels(true);
-
-    base::UniquePtr<Document> spriteSheet(m_exporter->exportSheet());
-    m_exporter.reset(NULL);
-
-    LOG("Export sprite sheet: Done\n");
+  startup.stage("command line");
+  {
+    CliProcessor cli(ctx, options, std::cout);
+    cli.process();
   }
 
   she::instance()->finishLaunching();
@@ -704,6 +352,12 @@ void App::run()
     shell.run(engine);
   }
 
+  // Process batch jobs from stdin until it's closed.
+  if (m_isServer) {
+    BatchServer server(std::cin, std::cout);
+    server.run();
+  }
+
   // Destroy all documents in the UIContext.
   const doc::Documents& docs = m_modules->m_ui_context.documents();
   while (!docs.empty()) {
@@ -759,9 +413,16 @@ App::~App()
     delete m_modules;
     delete m_coreModules;
 
+    // Save the timeline of the whole execution (--profile option)
+    if (!m_profileFileName.empty()) {
+      base::profiler::stop();
+      if (!base::profiler::save_chrome_trace(m_profileFileName))
+        std::cerr << "Error saving profile data in " << m_profileFileName << "\n";
+    }
+
     // Destroy the loaded gui.xml data.
     delete KeyboardShortcuts::instance();
-    delete GuiXml::instance();
+    GuiXml::destroyInstance();
 
     m_instance = NULL;
   }
@@ -793,17 +454,25 @@ bool App::isPortable()
 tools::ToolBox* App::toolBox() const
 {
   ASSERT(m_modules != NULL);
-  return &m_modules->m_toolbox;
+  return m_modules->toolBox();
 }
 
 tools::Tool* App::activeTool() const
 {
-  return m_modules->m_activeToolManager.activeTool();
+  return m_modules->activeToolManager()->activeTool();
 }
 
 tools::ActiveToolManager* App::activeToolManager() const
 {
-  return &m_modules->m_activeToolManager;
+  return m_modules->activeToolManager();
+}
+
+AppBrushes& App::brushes()
+{
+  // User brushes are loaded the first time they are needed
+  if (!m_brushes.get())
+    m_brushes.reset(new AppBrushes);
+  return *m_brushes;
 }
 
 RecentFiles* App::recentFiles() const
@@ -30,7 +30,6 @@ namespace app {
   class AppOptions;
   class ContextBar;
   class Document;
-  class DocumentExporter;
   class INotificationDelegate;
   class InputChain;
   class LegacyModules;
@@ -78,10 +77,7 @@ namespace app {
     Timeline* timeline() const;
     Preferences& preferences() const;
 
-    AppBrushes& brushes() {
-      ASSERT(m_brushes.get());
-      return *m_brushes;
-    }
+    AppBrushes& brushes();
 
     void showNotification(INotificationDelegate* del);
     void updateDisplayTitleBar();
@@ -105,10 +101,11 @@ namespace app {
     LegacyModules* m_legacy;
     bool m_isGui;
     bool m_isShell;
+    bool m_isServer;
     base::UniquePtr<MainWindow> m_mainWindow;
     FileList m_files;
-    base::UniquePtr<DocumentExporter> m_exporter;
     base::UniquePtr<AppBrushes> m_brushes;
+    std::string m_profileFileName;
   };
 
   void app_refresh_screen();
@@ -24,10 +24,14 @@ AppOptions::AppOptions(int argc, const char* argv[])
   : m_exeName(base::get_file_name(argv[0]))
   , m_startUI(true)
   , m_startShell(false)
+  , m_startServer(false)
+  , m_valid(true)
   , m_verboseLevel(kNoVerbose)
+  , m_showStartupProfile(false)
   , m_palette(m_po.add("palette").requiresValue("<filename>").description("Use a specific palette by default"))
   , m_shell(m_po.add("shell").description("Start an interactive console to execute scripts"))
   , m_batch(m_po.add("batch").mnemonic('b').description("Do not start the UI"))
+  , m_server(m_po.add("server").description("Read command lines from stdin and process them\nas batch jobs (one JSON response per job)"))
   , m_saveAs(m_po.add("save-as").requiresValue("<filename>").description("Save the last given document with other format"))
   , m_scale(m_po.add("scale").requiresValue("<factor>").description("Resize all previous opened documents"))
   , m_shrinkTo(m_po.add("shrink-to").requiresValue("width,height").description("Shrink each sprite if it is\nlarger than width or height"))
@@ -55,6 +59,8 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_listTags(m_po.add("list-tags").description("List tags of the next given sprite sprite\nor include frame tags in JSON data"))
   , m_verbose(m_po.add("verbose").mnemonic('v').description("Explain what is being done"))
   , m_debug(m_po.add("debug").description("Extreme verbose mode and\ncopy log to desktop"))
+  , m_profile(m_po.add("profile").requiresValue("<filename.json>").description("Save a timeline of rendering/file operations\n(Chrome trace format)"))
+  , m_startupProfile(m_po.add("startup-profile").description("Print the time spent in each initialization stage"))
   , m_help(m_po.add("help").mnemonic('?').description("Display this help and exits"))
   , m_version(m_po.add("version").description("Output version information and exit"))
 {
@@ -67,7 +73,10 @@ AppOptions::AppOptions(int argc, const char* argv[])
       m_verboseLevel = kVerbose;
 
     m_paletteFileName = m_po.value_of(m_palette);
+    m_profileFileName = m_po.value_of(m_profile);
+    m_showStartupProfile = m_po.enabled(m_startupProfile);
     m_startShell = m_po.enabled(m_shell);
+    m_startServer = m_po.enabled(m_server);
 
     if (m_po.enabled(m_help)) {
       showHelp();
@@ -78,7 +87,7 @@ AppOptions::AppOptions(int argc, const char* argv[])
       m_startUI = false;
     }
 
-    if (m_po.enabled(m_shell) || m_po.enabled(m_batch)) {
+    if (m_po.enabled(m_shell) || m_po.enabled(m_batch) || m_po.enabled(m_server)) {
       m_startUI = false;
     }
   }
@@ -86,6 +95,7 @@ AppOptions::AppOptions(int argc, const char* argv[])
     std::cerr << m_exeName << ": " << parseError.what() << '\n'
               << "Try \"" << m_exeName << " --help\" for more information.\n";
     m_startUI = false;
+    m_valid = false;
   }
 }
 
@@ -33,9 +33,13 @@ public:
 
   bool startUI() const { return m_startUI; }
   bool startShell() const { return m_startShell; }
+  bool startServer() const { return m_startServer; }
+  bool isValid() const { return m_valid; }
   VerboseLevel verboseLevel() const { return m_verboseLevel; }
 
   const std::string& paletteFileName() const { return m_paletteFileName; }
+  const std::string& profileFileName() const { return m_profileFileName; }
+  bool startupProfile() const { return m_showStartupProfile; }
 
   const ValueList& values() const {
     return m_po.values();
@@ -78,12 +82,17 @@ private:
   base::ProgramOptions m_po;
   bool m_startUI;
   bool m_startShell;
+  bool m_startServer;
+  bool m_valid;
   VerboseLevel m_verboseLevel;
   std::string m_paletteFileName;
+  std::string m_profileFileName;
+  bool m_showStartupProfile;
 
   Option& m_palette;
   Option& m_shell;
   Option& m_batch;
+  Option& m_server;
   Option& m_saveAs;
   Option& m_scale;
   Option& m_shrinkTo;
@@ -112,6 +121,8 @@ private:
 
   Option& m_verbose;
   Option& m_debug;
+  Option& m_profile;
+  Option& m_startupProfile;
   Option& m_help;
   Option& m_version;
 
@@ -0,0 +1,409 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/batch_server.h"
+
+#include "app/app_options.h"
+#include "app/cli_processor.h"
+#include "app/commands/command.h"
+#include "app/context.h"
+#include "app/document.h"
+#include "app/file/file.h"
+#include "base/bind.h"
+#include "base/fs.h"
+#include "base/profiler.h"
+#include "base/scoped_lock.h"
+#include "base/thread.h"
+#include "base/unique_ptr.h"
+#include "doc/layer.h"
+#include "doc/site.h"
+#include "doc/sprite.h"
+
+#include <cctype>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace app {
+
+namespace {
+
+// Splits a command line in arguments. Arguments with spaces must be
+// quoted, and \" or \\ can be used inside quotes.
+void split_command_line(const std::string& line, std::vector<std::string>& args)
+{
+  std::string arg;
+  bool inArg = false;
+  bool quoted = false;
+
+  for (std::size_t i=0; i<line.size(); ++i) {
+    char chr = line[i];
+    if (quoted) {
+      if (chr == '\\' && i+1 < line.size() &&
+          (line[i+1] == '"' || line[i+1] == '\\'))
+        arg.push_back(line[++i]);
+      else if (chr == '"')
+        quoted = false;
+      else
+        arg.push_back(chr);
+    }
+    else if (chr == '"') {
+      quoted = true;
+      inArg = true;
+    }
+    else if (std::isspace((unsigned char)chr)) {
+      if (inArg) {
+        args.push_back(arg);
+        arg.clear();
+        inArg = false;
+      }
+    }
+    else {
+      arg.push_back(chr);
+      inArg = true;
+    }
+  }
+
+  if (inArg)
+    args.push_back(arg);
+}
+
+std::string escape_for_json(const std::string& str)
+{
+  std::string res;
+  res.reserve(str.size());
+  for (char chr : str) {
+    switch (chr) {
+      case '"': res += "\\\""; break;
+      case '\\': res += "\\\\"; break;
+      case '\n': res += "\\n"; break;
+      case '\r': res += "\\r"; break;
+      case '\t': res += "\\t"; break;
+      default:
+        if (chr >= 0 && chr < 32)
+          res.push_back(' ');
+        else
+          res.push_back(chr);
+        break;
+    }
+  }
+  return res;
+}
+
+// Options that cannot be used in a job (they print information in
+// stdout, start an interactive session, or use the UIContext).
+bool is_forbidden_job_option(const std::string& arg)
+{
+  return (arg == "--help" ||
+          arg == "-?" ||
+          arg == "--version" ||
+          arg == "--shell" ||
+          arg == "--server" ||
+          arg == "--script");
+}
+
+// Like load_document() but errors are thrown instead of being
+// displayed in the console (stdout is used for the responses).
+Document* load_document_for_cache(const std::string& filename)
+{
+  base::UniquePtr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      nullptr, filename.c_str(), FILE_LOAD_SEQUENCE_NONE));
+  if (!fop)
+    throw std::runtime_error("Cannot open file " + filename);
+
+  fop->operate();
+  fop->done();
+  fop->postLoad();
+
+  Document* document = fop->releaseDocument();
+  if (!document) {
+    throw std::runtime_error(fop->hasError() ? fop->error():
+                             "Cannot load file " + filename);
+  }
+  return document;
+}
+
+} // anonymous namespace
+
+// Context where the documents of one job are opened. Each job
+// executes its own copies of the commands.
+class BatchServer::JobContext : public Context {
+public:
+  JobContext(BatchServer* server)
+    : m_server(server)
+    , m_activeDoc(nullptr) {
+  }
+
+  ~JobContext() {
+    while (!documents().empty()) {
+      doc::Document* doc = documents().back();
+      doc->close();
+      delete doc;
+    }
+  }
+
+  void setActiveDocument(Document* document) override {
+    m_activeDoc = document;
+    notifyActiveSiteChanged();
+  }
+
+  // Command instances from the CommandsModule keep the loaded
+  // params, so they cannot be executed from several threads.
+  void executeCommand(Command* command, const Params& params) override {
+    base::UniquePtr<Command> copy;
+    {
+      base::scoped_lock lock(m_server->m_commandsMutex);
+      copy.reset(command->clone());
+    }
+    Context::executeCommand(copy, params);
+  }
+
+  // Errors of the job (stdout is used for the responses)
+  void onConsolePrint(const char* text) override {
+    m_consoleText += text;
+  }
+
+  const std::string& consoleText() const { return m_consoleText; }
+
+protected:
+  void onGetActiveSite(doc::Site* site) const override {
+    if (Document* doc = m_activeDoc) {
+      site->document(doc);
+      site->sprite(doc->sprite());
+      site->layer(doc->sprite()->folder()->getFirstLayer());
+      site->frame(0);
+    }
+  }
+
+  void onRemoveDocument(doc::Document* doc) override {
+    if (doc == m_activeDoc)
+      m_activeDoc = nullptr;
+  }
+
+private:
+  BatchServer* m_server;
+  Document* m_activeDoc;
+  std::string m_consoleText;
+};
+
+// Opens files from the BatchServer cache.
+class BatchServer::JobProcessor : public CliProcessor {
+public:
+  JobProcessor(BatchServer* server, Context* ctx,
+               const AppOptions& options, std::ostream& out)
+    : CliProcessor(ctx, options, out)
+    , m_server(server) {
+  }
+
+protected:
+  Document* openFile(const std::string& filename) override {
+    Document* doc = m_server->openDocument(context(), filename);
+    context()->setActiveDocument(doc);
+    return doc;
+  }
+
+private:
+  BatchServer* m_server;
+};
+
+BatchServer::BatchServer(std::istream& in, std::ostream& out, int threads)
+  : m_in(in)
+  , m_out(out)
+  , m_nthreads(threads > 0 ? threads: base::thread::hardware_concurrency())
+  , m_done(false)
+{
+  if (m_nthreads < 1)
+    m_nthreads = 1;
+}
+
+BatchServer::~BatchServer()
+{
+}
+
+void BatchServer::run()
+{
+  m_done = false;
+
+  std::vector<base::thread*> threads;
+  for (int i=0; i<m_nthreads; ++i)
+    threads.push_back(new base::thread(
+        base::Bind<void>(&BatchServer::workerThread, this)));
+
+  int jobId = 0;
+  std::string line;
+  while (std::getline(m_in, line)) {
+    ++jobId;
+
+    // Empty lines are ignored (but counted)
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    {
+      base::scoped_lock lock(m_jobsMutex);
+      m_jobs.push_back(Job{ jobId, line });
+    }
+    m_newJob.notify_one();
+  }
+
+  {
+    base::scoped_lock lock(m_jobsMutex);
+    m_done = true;
+  }
+  m_newJob.notify_all();
+
+  for (base::thread* thread : threads) {
+    thread->join();
+    delete thread;
+  }
+}
+
+void BatchServer::workerThread()
+{
+  while (true) {
+    Job job;
+    {
+      base::scoped_lock lock(m_jobsMutex);
+      while (m_jobs.empty() && !m_done)
+        m_newJob.wait(m_jobsMutex);
+
+      if (m_jobs.empty())
+        break;
+
+      job = m_jobs.front();
+      m_jobs.pop_front();
+    }
+
+    processJob(job);
+  }
+}
+
+void BatchServer::processJob(const Job& job)
+{
+  base::profiler::ScopedTimer timer("server", "BatchServer::processJob", job.commandLine);
+
+  std::ostringstream output;
+  std::string error;
+  bool success = false;
+
+  // The context must be destroyed after the processor (it contains
+  // the opened documents).
+  JobContext ctx(this);
+
+  try {
+    std::vector<std::string> args;
+    split_command_line(job.commandLine, args);
+
+    std::vector<const char*> argv;
+    argv.push_back(PACKAGE);
+    for (const auto& arg : args) {
+      if (is_forbidden_job_option(arg))
+        throw std::runtime_error("The " + arg + " option cannot be used in a job");
+      argv.push_back(arg.c_str());
+    }
+
+    AppOptions options(int(argv.size()), &argv[0]);
+    if (!options.isValid())
+      throw std::runtime_error("Invalid command line");
+
+    JobProcessor processor(this, &ctx, options, output);
+    processor.process();
+    success = true;
+  }
+  catch (const std::exception& e) {
+    error = e.what();
+  }
+
+  // Errors printed in the console (e.g. a file that cannot be
+  // saved) make the job fail too.
+  if (!ctx.consoleText().empty()) {
+    error = ctx.consoleText() + error;
+    success = false;
+  }
+
+  writeResponse(job, success, output.str(), error);
+}
+
+void BatchServer::writeResponse(const Job& job, bool success,
+                                const std::string& output,
+                                const std::string& error)
+{
+  base::scoped_lock lock(m_outputMutex);
+  m_out << "{\"job\":" << job.id
+        << ",\"success\":" << (success ? "true": "false")
+        << ",\"output\":\"" << escape_for_json(output) << "\""
+        << ",\"error\":\"" << escape_for_json(error) << "\"}"
+        << std::endl;
+}
+
+Document* BatchServer::openDocument(Context* ctx, const std::string& filename)
+{
+  if (!base::is_file(filename))
+    throw std::runtime_error("File not found " + filename);
+
+  base::Time modificationTime = base::get_modification_time(filename);
+  std::size_t size = base::file_size(filename);
+  std::shared_ptr<Document> original;
+
+  {
+    base::scoped_lock lock(m_cacheMutex);
+    for (auto it=m_cache.begin(); it!=m_cache.end(); ++it) {
+      if (it->filename == filename) {
+        if (it->modificationTime == modificationTime && it->size == size) {
+          original = it->document;
+          m_cache.splice(m_cache.begin(), m_cache, it);
+        }
+        // The file was modified
+        else
+          m_cache.erase(it);
+        break;
+      }
+    }
+  }
+
+  // Load the file outside the lock (so other jobs can load other
+  // files at the same time).
+  if (!original) {
+    original.reset(load_document_for_cache(filename));
+
+    base::scoped_lock lock(m_cacheMutex);
+
+    // Other job could have loaded the same file
+    for (auto it=m_cache.begin(); it!=m_cache.end(); ++it) {
+      if (it->filename == filename) {
+        m_cache.erase(it);
+        break;
+      }
+    }
+
+    m_cache.push_front(CachedDocument{ filename, modificationTime, size, original });
+    if (m_cache.size() > kMaxCachedDocuments)
+      m_cache.pop_back();
+  }
+
+  // Each job modifies its own copy of the document (images share
+  // the pixels with the original until they are modified, the
+  // buffer reference counter is atomic). The original document is
+  // read with the cache locked because object IDs are assigned
+  // lazily (the original cannot be accessed from two threads at
+  // the same time).
+  base::UniquePtr<Document> doc;
+  {
+    base::scoped_lock lock(m_cacheMutex);
+    doc.reset(original->duplicate(DuplicateExactCopy));
+  }
+  doc->setFilename(filename);
+  doc->setContext(ctx);
+  return doc.release();
+}
+
+} // namespace app
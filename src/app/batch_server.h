@@ -0,0 +1,112 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_BATCH_SERVER_H_INCLUDED
+#define APP_BATCH_SERVER_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/mutex.h"
+#include "base/time.h"
+
+#include <condition_variable>
+#include <deque>
+#include <iosfwd>
+#include <list>
+#include <memory>
+#include <string>
+
+namespace app {
+  class Context;
+  class Document;
+
+  // Processes batch jobs without restarting the program. Each line
+  // of the input stream is a job with the same arguments that can be
+  // given in the command line in batch mode, e.g.
+  //
+  //   sprite.ase --sheet sprite.png --data sprite.json
+  //
+  // For each job a JSON object is written in one line of the output
+  // stream (in the order the jobs are finished):
+  //
+  //   {"job":1,"success":true,"output":"...","error":""}
+  //
+  // where "job" is the line number of the job in the input stream
+  // and "output" is what the job would print in stdout (e.g. the
+  // --list-layers result or the --data JSON if no file was given).
+  //
+  // Jobs are processed in several threads. Loaded documents are
+  // cached (while the file isn't modified) so the same sprite can be
+  // exported several times without loading it again.
+  class BatchServer {
+  public:
+    // Maximum number of documents kept in the cache.
+    enum { kMaxCachedDocuments = 32 };
+
+    // If "threads" is 0, one thread per CPU core is used.
+    BatchServer(std::istream& in, std::ostream& out, int threads = 0);
+    ~BatchServer();
+
+    // Reads and processes jobs until the end of the input stream.
+    // Returns when all the jobs are finished.
+    void run();
+
+  private:
+    class JobContext;
+    class JobProcessor;
+
+    struct Job {
+      int id;
+      std::string commandLine;
+    };
+
+    struct CachedDocument {
+      std::string filename;
+      base::Time modificationTime;
+      std::size_t size;
+      std::shared_ptr<Document> document;
+    };
+
+    void workerThread();
+    void processJob(const Job& job);
+    void writeResponse(const Job& job, bool success,
+                       const std::string& output,
+                       const std::string& error);
+
+    // Returns a copy of the given file (from the cache if it's
+    // possible) added to the given context. Throws std::runtime_error
+    // if the file cannot be loaded.
+    Document* openDocument(Context* ctx, const std::string& filename);
+
+    std::istream& m_in;
+    std::ostream& m_out;
+    int m_nthreads;
+
+    // Jobs to be processed (m_newJob is notified when a job is
+    // added or when there are no more jobs)
+    base::mutex m_jobsMutex;
+    std::condition_variable_any m_newJob;
+    std::deque<Job> m_jobs;
+    bool m_done;
+
+    // Responses are written from several threads
+    base::mutex m_outputMutex;
+
+    // Commands from the CommandsModule are cloned by one thread at
+    // the same time.
+    base::mutex m_commandsMutex;
+
+    // Most recently used documents first.
+    base::mutex m_cacheMutex;
+    std::list<CachedDocument> m_cache;
+
+    DISABLE_COPYING(BatchServer);
+  };
+
+} // namespace app
+
+#endif
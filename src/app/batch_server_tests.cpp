@@ -0,0 +1,143 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#include "tests/test.h"
+
+#include "app/batch_server.h"
+#include "app/context.h"
+#include "app/document.h"
+#include "app/file/file.h"
+#include "app/file/file_formats_manager.h"
+#include "base/fs.h"
+#include "doc/doc.h"
+
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace app;
+
+static const char* kFilename = "batch_server_tests.ase";
+static const char* kSheetFilename = "batch_server_tests.png";
+
+static void create_test_file()
+{
+  FileFormatsManager::instance()->registerAllFormats();
+  app::Context ctx;
+
+  doc::Document* doc = ctx.documents().add(16, 8, doc::ColorMode::RGB);
+  doc->setFilename(kFilename);
+
+  Sprite* sprite = doc->sprite();
+  sprite->folder()->getFirstLayer()->setName("Bottom");
+  LayerImage* top = new LayerImage(sprite);
+  top->setName("Top");
+  sprite->folder()->addLayer(top);
+  sprite->setTotalFrames(frame_t(2));
+  sprite->frameTags().add(new FrameTag(0, 1));
+  (*sprite->frameTags().begin())->setName("Walk");
+
+  save_document(&ctx, doc);
+  doc->close();
+  delete doc;
+}
+
+// Runs the given jobs and returns the responses by job number.
+static std::map<int, std::string> run_jobs(const std::string& jobs, int threads)
+{
+  std::istringstream in(jobs);
+  std::ostringstream out;
+  BatchServer server(in, out, threads);
+  server.run();
+
+  std::map<int, std::string> responses;
+  std::istringstream lines(out.str());
+  std::string line;
+  while (std::getline(lines, line)) {
+    int job = std::atoi(line.c_str() + line.find(':') + 1);
+    EXPECT_EQ(0, responses.count(job));
+    responses[job] = line;
+  }
+  return responses;
+}
+
+static bool contains(const std::string& str, const std::string& part)
+{
+  return (str.find(part) != std::string::npos);
+}
+
+TEST(BatchServer, ListLayersAndTags)
+{
+  create_test_file();
+
+  std::string jobs;
+  for (int i=0; i<8; ++i) {
+    jobs += "--list-layers " + std::string(kFilename) + "\n";
+    jobs += "--list-tags \"" + std::string(kFilename) + "\"\n";
+  }
+
+  std::map<int, std::string> responses = run_jobs(jobs, 4);
+  ASSERT_EQ(16, int(responses.size()));
+  for (int i=1; i<=16; i+=2) {
+    EXPECT_TRUE(contains(responses[i], "\"success\":true"));
+    EXPECT_TRUE(contains(responses[i], "\"output\":\"Bottom\\nTop\\n\""));
+    EXPECT_TRUE(contains(responses[i+1], "\"success\":true"));
+    EXPECT_TRUE(contains(responses[i+1], "\"output\":\"Walk\\n\""));
+  }
+
+  base::delete_file(kFilename);
+}
+
+TEST(BatchServer, ExportSheet)
+{
+  create_test_file();
+
+  std::map<int, std::string> responses = run_jobs(
+    std::string(kFilename) + " --sheet " + kSheetFilename + "\n", 1);
+  ASSERT_EQ(1, int(responses.size()));
+  EXPECT_TRUE(contains(responses[1], "\"success\":true"));
+  EXPECT_TRUE(contains(responses[1], "\\\"frames\\\""));
+  EXPECT_TRUE(base::is_file(kSheetFilename));
+
+  base::delete_file(kSheetFilename);
+  base::delete_file(kFilename);
+}
+
+// Errors saving files are reported in the response (and not in the
+// output stream of the server).
+TEST(BatchServer, SaveErrors)
+{
+  create_test_file();
+
+  std::map<int, std::string> responses = run_jobs(
+    std::string(kFilename) + " --sheet batch_server_tests.unknown\n" +
+    "--save-as batch_server_tests.png\n", 2);
+  ASSERT_EQ(2, int(responses.size()));
+  for (int i=1; i<=2; ++i) {
+    EXPECT_TRUE(contains(responses[i], "\"success\":false"));
+    EXPECT_FALSE(contains(responses[i], "\"error\":\"\""));
+  }
+
+  base::delete_file(kFilename);
+}
+
+TEST(BatchServer, InvalidJobs)
+{
+  std::map<int, std::string> responses = run_jobs(
+    "--help\n"
+    "\n"
+    "--list-layers batch_server_tests_missing.ase\n"
+    "--unknown-option\n", 2);
+
+  // Empty lines are not jobs
+  ASSERT_EQ(3, int(responses.size()));
+  EXPECT_TRUE(contains(responses[1], "\"success\":false"));
+  EXPECT_EQ(0, responses.count(2));
+  EXPECT_TRUE(contains(responses[3], "\"success\":false"));
+  EXPECT_TRUE(contains(responses[4], "\"success\":false"));
+}
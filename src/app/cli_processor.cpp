@@ -0,0 +1,519 @@
+// Aseprite
+// Copyright (C) 2001-2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cli_processor.h"
+
+#include "app/app_options.h"
+#include "app/commands/commands.h"
+#include "app/commands/params.h"
+#include "app/console.h"
+#include "app/context.h"
+#include "app/document.h"
+#include "app/document_exporter.h"
+#include "app/document_undo.h"
+#include "app/filename_formatter.h"
+#include "app/log.h"
+#include "app/script/app_scripting.h"
+#include "base/convert_to.h"
+#include "base/path.h"
+#include "base/split_string.h"
+#include "doc/frame_tag.h"
+#include "doc/layer.h"
+#include "doc/layers_range.h"
+#include "doc/sprite.h"
+#include "script/engine_delegate.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace app {
+
+namespace {
+
+class OutputEngineDelegate : public script::EngineDelegate {
+public:
+  OutputEngineDelegate(std::ostream& out) : m_out(out) { }
+  void onConsolePrint(const char* text) override {
+    m_out << text << "\n";
+  }
+private:
+  std::ostream& m_out;
+};
+
+} // anonymous namespace
+
+CliProcessor::CliProcessor(Context* ctx, const AppOptions& options, std::ostream& out)
+  : m_ctx(ctx)
+  , m_options(options)
+  , m_out(out)
+{
+  if (options.hasExporterParams())
+    m_exporter.reset(new DocumentExporter);
+}
+
+CliProcessor::~CliProcessor()
+{
+}
+
+void CliProcessor::process()
+{
+  bool ignoreEmpty = false;
+  bool trim = false;
+  Params cropParams;
+  SpriteSheetType sheetType = SpriteSheetType::None;
+
+  // Open file specified in the command line
+  if (!m_options.values().empty()) {
+    Console console(m_ctx);
+    bool splitLayers = false;
+    bool splitLayersSaveAs = false;
+    bool allLayers = false;
+    bool listLayers = false;
+    bool listTags = false;
+    std::string importLayer;
+    std::string importLayerSaveAs;
+    std::string filenameFormat;
+    std::string frameTagName;
+    std::string frameRange;
+
+    for (const auto& value : m_options.values()) {
+      const AppOptions::Option* opt = value.option();
+
+      // Special options/commands
+      if (opt) {
+        // --data <file.json>
+        if (opt == &m_options.data()) {
+          if (m_exporter)
+            m_exporter->setDataFilename(value.value());
+        }
+        // --format <format>
+        else if (opt == &m_options.format()) {
+          if (m_exporter) {
+            DocumentExporter::DataFormat format = DocumentExporter::DefaultDataFormat;
+
+            if (value.value() == "json-hash")
+              format = DocumentExporter::JsonHashDataFormat;
+            else if (value.value() == "json-array")
+              format = DocumentExporter::JsonArrayDataFormat;
+
+            m_exporter->setDataFormat(format);
+          }
+        }
+        // --sheet <file.png>
+        else if (opt == &m_options.sheet()) {
+          if (m_exporter)
+            m_exporter->setTextureFilename(value.value());
+        }
+        // --sheet-width <width>
+        else if (opt == &m_options.sheetWidth()) {
+          if (m_exporter)
+            m_exporter->setTextureWidth(strtol(value.value().c_str(), NULL, 0));
+        }
+        // --sheet-height <height>
+        else if (opt == &m_options.sheetHeight()) {
+          if (m_exporter)
+            m_exporter->setTextureHeight(strtol(value.value().c_str(), NULL, 0));
+        }
+        // --sheet-pack
+        else if (opt == &m_options.sheetType()) {
+          if (value.value() == "horizontal")
+            sheetType = SpriteSheetType::Horizontal;
+          else if (value.value() == "vertical")
+            sheetType = SpriteSheetType::Vertical;
+          else if (value.value() == "rows")
+            sheetType = SpriteSheetType::Rows;
+          else if (value.value() == "columns")
+            sheetType = SpriteSheetType::Columns;
+          else if (value.value() == "packed")
+            sheetType = SpriteSheetType::Packed;
+        }
+        // --sheet-pack
+        else if (opt == &m_options.sheetPack()) {
+          sheetType = SpriteSheetType::Packed;
+        }
+        // --split-layers
+        else if (opt == &m_options.splitLayers()) {
+          splitLayers = true;
+          splitLayersSaveAs = true;
+        }
+        // --layer <layer-name>
+        else if (opt == &m_options.layer()) {
+          importLayer = value.value();
+          importLayerSaveAs = value.value();
+        }
+        // --all-layers
+        else if (opt == &m_options.allLayers()) {
+          allLayers = true;
+        }
+        // --frame-tag <tag-name>
+        else if (opt == &m_options.frameTag()) {
+          frameTagName = value.value();
+        }
+        // --frame-range from,to
+        else if (opt == &m_options.frameRange()) {
+          frameRange = value.value();
+        }
+        // --ignore-empty
+        else if (opt == &m_options.ignoreEmpty()) {
+          ignoreEmpty = true;
+        }
+        // --border-padding
+        else if (opt == &m_options.borderPadding()) {
+          if (m_exporter)
+            m_exporter->setBorderPadding(strtol(value.value().c_str(), NULL, 0));
+        }
+        // --shape-padding
+        else if (opt == &m_options.shapePadding()) {
+          if (m_exporter)
+            m_exporter->setShapePadding(strtol(value.value().c_str(), NULL, 0));
+        }
+        // --inner-padding
+        else if (opt == &m_options.innerPadding()) {
+          if (m_exporter)
+            m_exporter->setInnerPadding(strtol(value.value().c_str(), NULL, 0));
+        }
+        // --trim
+        else if (opt == &m_options.trim()) {
+          trim = true;
+        }
+        // --crop x,y,width,height
+        else if (opt == &m_options.crop()) {
+          std::vector<std::string> parts;
+          base::split_string(value.value(), parts, ",");
+          if (parts.size() < 4)
+            throw std::runtime_error("--crop needs four parameters separated by comma (,)\n"
+                                     "Usage: --crop x,y,width,height\n"
+                                     "E.g. --crop 0,0,32,32");
+
+          cropParams.set("x", parts[0].c_str());
+          cropParams.set("y", parts[1].c_str());
+          cropParams.set("width", parts[2].c_str());
+          cropParams.set("height", parts[3].c_str());
+        }
+        // --filename-format
+        else if (opt == &m_options.filenameFormat()) {
+          filenameFormat = value.value();
+        }
+        // --save-as <filename>
+        else if (opt == &m_options.saveAs()) {
+          Document* doc = NULL;
+          if (!m_ctx->documents().empty())
+            doc = dynamic_cast<Document*>(m_ctx->documents().lastAdded());
+
+          if (!doc) {
+            console.printf("A document is needed before --save-as argument\n");
+          }
+          else {
+            m_ctx->setActiveDocument(doc);
+
+            std::string format = filenameFormat;
+
+            Command* saveAsCommand = CommandsModule::instance()->getCommandByName(CommandId::SaveFileCopyAs);
+            Command* trimCommand = CommandsModule::instance()->getCommandByName(CommandId::AutocropSprite);
+            Command* cropCommand = CommandsModule::instance()->getCommandByName(CommandId::CropSprite);
+            Command* undoCommand = CommandsModule::instance()->getCommandByName(CommandId::Undo);
+
+            // --save-as with --split-layers
+            if (splitLayersSaveAs) {
+              std::string fn, fmt;
+              if (format.empty()) {
+                if (doc->sprite()->totalFrames() > frame_t(1))
+                  format = "{path}/{title} ({layer}) {frame}.{extension}";
+                else
+                  format = "{path}/{title} ({layer}).{extension}";
+              }
+
+              // Store in "visibility" the original "visible" state of every layer.
+              std::vector<bool> visibility(doc->sprite()->countLayers());
+              int i = 0;
+              for (Layer* layer : doc->sprite()->layers())
+                visibility[i++] = layer->isVisible();
+
+              // For each layer, hide other ones and save the sprite.
+              i = 0;
+              for (Layer* show : doc->sprite()->layers()) {
+                // If the user doesn't want all layers and this one is hidden.
+                if (!visibility[i++])
+                  continue;     // Just ignore this layer.
+
+                // Make this layer ("show") the only one visible.
+                for (Layer* hide : doc->sprite()->layers())
+                  hide->setVisible(hide == show);
+
+                FilenameInfo fnInfo;
+                fnInfo
+                  .filename(value.value())
+                  .layerName(show->name());
+
+                fn = filename_formatter(format, fnInfo);
+                fmt = filename_formatter(format, fnInfo, false);
+
+                if (!cropParams.empty())
+                  m_ctx->executeCommand(cropCommand, cropParams);
+
+                // TODO --trim command with --save-as doesn't make too
+                // much sense as we lost the trim rectangle
+                // information (e.g. we don't have sheet .json) Also,
+                // we should trim each frame individually (a process
+                // that can be done only in fop_operate()).
+                if (trim)
+                  m_ctx->executeCommand(trimCommand);
+
+                Params params;
+                params.set("filename", fn.c_str());
+                params.set("filename-format", fmt.c_str());
+                m_ctx->executeCommand(saveAsCommand, params);
+
+                if (trim) {     // Undo trim command
+                  m_ctx->executeCommand(undoCommand);
+
+                  // Just in case allow non-linear history is enabled
+                  // we clear redo information
+                  doc->undoHistory()->clearRedo();
+                }
+              }
+
+              // Restore layer visibility
+              i = 0;
+              for (Layer* layer : doc->sprite()->layers())
+                layer->setVisible(visibility[i++]);
+            }
+            else {
+              // Show only one layer
+              if (!importLayerSaveAs.empty()) {
+                for (Layer* layer : doc->sprite()->layers())
+                  layer->setVisible(layer->name() == importLayerSaveAs);
+              }
+
+              if (!cropParams.empty())
+                m_ctx->executeCommand(cropCommand, cropParams);
+
+              if (trim)
+                m_ctx->executeCommand(trimCommand);
+
+              Params params;
+              params.set("filename", value.value().c_str());
+              params.set("filename-format", format.c_str());
+              m_ctx->executeCommand(saveAsCommand, params);
+
+              if (trim) {       // Undo trim command
+                m_ctx->executeCommand(undoCommand);
+
+                // Just in case allow non-linear history is enabled
+                // we clear redo information
+                doc->undoHistory()->clearRedo();
+              }
+            }
+          }
+        }
+        // --scale <factor>
+        else if (opt == &m_options.scale()) {
+          double scale = strtod(value.value().c_str(), NULL);
+
+          // Scale all sprites
+          for (auto doc : m_ctx->documents()) {
+            m_ctx->setActiveDocument(static_cast<app::Document*>(doc));
+            resizeActiveSprite(int(doc->width()*scale),
+                               int(doc->height()*scale));
+          }
+        }
+        // --shrink-to <width,height>
+        else if (opt == &m_options.shrinkTo()) {
+          std::vector<std::string> dimensions;
+          base::split_string(value.value(), dimensions, ",");
+          if (dimensions.size() < 2)
+            throw std::runtime_error("--shrink-to needs two parameters separated by comma (,)\n"
+                                     "Usage: --shrink-to width,height\n"
+                                     "E.g. --shrink-to 128,64");
+
+          double maxWidth = base::convert_to<double>(dimensions[0]);
+          double maxHeight = base::convert_to<double>(dimensions[1]);
+          double scaleWidth, scaleHeight, scale;
+
+          // Shrink all sprites if needed
+          for (auto doc : m_ctx->documents()) {
+            m_ctx->setActiveDocument(static_cast<app::Document*>(doc));
+            scaleWidth = (doc->width() > maxWidth ? maxWidth / doc->width() : 1.0);
+            scaleHeight = (doc->height() > maxHeight ? maxHeight / doc->height() : 1.0);
+            if (scaleWidth < 1.0 || scaleHeight < 1.0) {
+              scale = MIN(scaleWidth, scaleHeight);
+              resizeActiveSprite(int(doc->width()*scale),
+                                 int(doc->height()*scale));
+            }
+          }
+        }
+        // --script <filename>
+        else if (opt == &m_options.script()) {
+          runScript(value.value());
+        }
+        // --list-layers
+        else if (opt == &m_options.listLayers()) {
+          listLayers = true;
+          if (m_exporter)
+            m_exporter->setListLayers(true);
+        }
+        // --list-tags
+        else if (opt == &m_options.listTags()) {
+          listTags = true;
+          if (m_exporter)
+            m_exporter->setListFrameTags(true);
+        }
+      }
+      // File names aren't associated to any option
+      else {
+        const std::string& filename = base::normalize_path(value.value());
+
+        app::Document* doc = openFile(filename);
+
+        // List layers and/or tags
+        if (doc) {
+          // Show all layers
+          if (allLayers) {
+            for (Layer* layer : doc->sprite()->layers())
+              layer->setVisible(true);
+          }
+
+          if (listLayers) {
+            listLayers = false;
+            for (Layer* layer : doc->sprite()->layers()) {
+              if (layer->isVisible())
+                m_out << layer->name() << "\n";
+            }
+          }
+
+          if (listTags) {
+            listTags = false;
+            for (FrameTag* tag : doc->sprite()->frameTags())
+              m_out << tag->name() << "\n";
+          }
+          if (m_exporter) {
+            FrameTag* frameTag = nullptr;
+            if (!frameTagName.empty()) {
+              frameTag = doc->sprite()->frameTags().getByName(frameTagName);
+            }
+            else if (!frameRange.empty()) {
+                std::vector<std::string> splitRange;
+                base::split_string(frameRange, splitRange, ",");
+                if (splitRange.size() < 2)
+                  throw std::runtime_error("--frame-range needs two parameters separated by comma (,)\n"
+                                           "Usage: --frame-range from,to\n"
+                                           "E.g. --frame-range 0,99");
+
+                frameTag = new FrameTag(base::convert_to<frame_t>(splitRange[0]),
+                                        base::convert_to<frame_t>(splitRange[1]));
+            }
+
+            if (!importLayer.empty()) {
+              Layer* foundLayer = NULL;
+              for (Layer* layer : doc->sprite()->layers()) {
+                if (layer->name() == importLayer) {
+                  foundLayer = layer;
+                  break;
+                }
+              }
+              if (foundLayer)
+                m_exporter->addDocument(doc, foundLayer, frameTag);
+            }
+            else if (splitLayers) {
+              for (auto layer : doc->sprite()->layers()) {
+                if (layer->isVisible())
+                  m_exporter->addDocument(doc, layer, frameTag);
+              }
+            }
+            else {
+              m_exporter->addDocument(doc, nullptr, frameTag);
+            }
+          }
+        }
+
+        if (!importLayer.empty())
+          importLayer.clear();
+
+        if (splitLayers)
+          splitLayers = false;
+        if (listLayers)
+          listLayers = false;
+        if (listTags)
+          listTags = false;
+      }
+    }
+
+    if (m_exporter && !filenameFormat.empty())
+      m_exporter->setFilenameFormat(filenameFormat);
+  }
+
+  // Export
+  if (m_exporter) {
+    LOG("Exporting sheet...\n");
+
+    if (sheetType != SpriteSheetType::None)
+      m_exporter->setSpriteSheetType(sheetType);
+
+    if (ignoreEmpty)
+      m_exporter->setIgnoreEmptyCels(true);
+
+    if (trim)
+      m_exporter->setTrimCels(true);
+
+    // In batch mode the data is written in the output stream if
+    // --data wasn't specified.
+    m_exporter->setContext(m_ctx);
+    if (!m_ctx->isUIAvailable())
+      m_exporter->setDataOutput(&m_out);
+
+    base::UniquePtr<Document> spriteSheet(m_exporter->exportSheet());
+    m_exporter.reset(NULL);
+
+    LOG("Export sprite sheet: Done\n");
+  }
+}
+
+Document* CliProcessor::openFile(const std::string& filename)
+{
+  app::Document* oldDoc = m_ctx->activeDocument();
+
+  Command* openCommand = CommandsModule::instance()->getCommandByName(CommandId::OpenFile);
+  Params params;
+  params.set("filename", filename.c_str());
+  m_ctx->executeCommand(openCommand, params);
+
+  app::Document* doc = m_ctx->activeDocument();
+
+  // If the active document is equal to the previous one, it
+  // means that we couldn't open this specific document.
+  if (doc == oldDoc)
+    doc = nullptr;
+
+  return doc;
+}
+
+void CliProcessor::runScript(const std::string& filename)
+{
+  OutputEngineDelegate delegate(m_out);
+  AppScripting engine(&delegate);
+  engine.evalFile(filename);
+}
+
+void CliProcessor::resizeActiveSprite(int width, int height)
+{
+  Command* command = CommandsModule::instance()->getCommandByName(CommandId::SpriteSize);
+
+  // We use params instead of SpriteSizeCommand::setScale() so the
+  // command can be executed from several contexts (see BatchServer)
+  Params params;
+  params.set("width", base::convert_to<std::string>(width).c_str());
+  params.set("height", base::convert_to<std::string>(height).c_str());
+  m_ctx->executeCommand(command, params);
+}
+
+} // namespace app
@@ -0,0 +1,61 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_CLI_PROCESSOR_H_INCLUDED
+#define APP_CLI_PROCESSOR_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/unique_ptr.h"
+
+#include <iosfwd>
+#include <string>
+
+namespace app {
+
+  class AppOptions;
+  class Context;
+  class Document;
+  class DocumentExporter;
+
+  // Processes the files and options given in the command line (open
+  // files, --save-as, --sheet, --list-layers, etc.) in the given
+  // context. It's used by the App at startup, and by the BatchServer
+  // for each job it receives.
+  class CliProcessor {
+  public:
+    // Text generated by the options (e.g. --list-layers, or the JSON
+    // data of --sheet without --data in batch mode) is written in
+    // "out".
+    CliProcessor(Context* ctx, const AppOptions& options, std::ostream& out);
+    virtual ~CliProcessor();
+
+    // Throws an std::runtime_error if some option has invalid values.
+    void process();
+
+  protected:
+    // Opens the given file and makes it the active document. Returns
+    // nullptr if the file cannot be opened.
+    virtual Document* openFile(const std::string& filename);
+
+    Context* context() const { return m_ctx; }
+
+  private:
+    void runScript(const std::string& filename);
+    void resizeActiveSprite(int width, int height);
+
+    Context* m_ctx;
+    const AppOptions& m_options;
+    std::ostream& m_out;
+    base::UniquePtr<DocumentExporter> m_exporter;
+
+    DISABLE_COPYING(CliProcessor);
+  };
+
+} // namespace app
+
+#endif
@@ -13,6 +13,7 @@
 
 #include "app/cmd/clear_cel.h"
 #include "app/document.h"
+#include "doc/bitmap_ops.h"
 #include "doc/cel.h"
 #include "doc/image_impl.h"
 #include "doc/layer.h"
@@ -93,28 +94,25 @@ void ClearMask::clear()
   if (!mask->bitmap())
     return;
 
-  const LockImageBits<BitmapTraits> maskBits(mask->bitmap());
-  LockImageBits<BitmapTraits>::const_iterator it = maskBits.begin();
-
   // Clear the masked zones
-  int u, v;
-  for (v=0; v<mask->bounds().h; ++v) {
-    for (u=0; u<mask->bounds().w; ++u, ++it) {
-      ASSERT(it != maskBits.end());
-      if (*it) {
-        put_pixel(image,
-          u + m_offsetX,
-          v + m_offsetY, m_bgcolor);
-      }
-    }
+  for (int v=0; v<mask->bounds().h; ++v) {
+    for_each_bitmap_run(
+      mask->bitmap(), v,
+      [=](int u1, int u2) {
+        draw_hline(image,
+                   u1 + m_offsetX,
+                   v + m_offsetY,
+                   u2-1 + m_offsetX, m_bgcolor);
+      });
   }
 
-  ASSERT(it == maskBits.end());
+  image->incrementVersion();
 }
 
 void ClearMask::restore()
 {
   copy_image(m_dstImage->image(), m_copy.get(), m_boundsX, m_boundsY);
+  m_dstImage->image()->incrementVersion();
 }
 
 } // namespace cmd
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -34,7 +34,7 @@ CopyRect::CopyRect(Image* dst, const Image* src, const gfx::Clip& clip)
 
   auto it = m_data.begin();
   for (int v=0; v<m_clip.size.h; ++v) {
-    uint8_t* addr = src->getPixelAddress(
+    const uint8_t* addr = src->getPixelAddress(
       m_clip.dst.x, m_clip.dst.y+v);
 
     std::copy(addr, addr+lineSize, it);
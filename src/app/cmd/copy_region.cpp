@@ -11,22 +11,77 @@
 
 #include "app/cmd/copy_region.h"
 
+#include "base/exception.h"
 #include "doc/image.h"
 
+#include "zlib.h"
+
 #include <algorithm>
+#include <cstring>
+#include <utility>
 
 namespace app {
 namespace cmd {
 
+// Size of the grid cells used to split the region in tiles
+static const int kTileSize = 32;
+
+// zlib level used to compress tiles (we prefer speed because
+// undo/redo must be fast)
+static const int kCompressionLevel = 1;
+
+namespace {
+
+// Copies the pixels of the given rectangles (in image coordinates
+// minus "pos") in one buffer, one row after the other.
+void read_pixels(const Image* image,
+                 const std::vector<gfx::Rect>& rects,
+                 const gfx::Point& pos,
+                 std::vector<uint8_t>& buf)
+{
+  buf.clear();
+  for (const auto& rc : rects) {
+    int rowSize = image->getRowStrideSize(rc.w);
+    for (int y=0; y<rc.h; ++y) {
+      const uint8_t* p = image->getPixelAddress(rc.x-pos.x, rc.y-pos.y+y);
+      buf.insert(buf.end(), p, p+rowSize);
+    }
+  }
+}
+
+void write_pixels(Image* image,
+                  const std::vector<gfx::Rect>& rects,
+                  const uint8_t* buf)
+{
+  for (const auto& rc : rects) {
+    int rowSize = image->getRowStrideSize(rc.w);
+    for (int y=0; y<rc.h; ++y, buf+=rowSize)
+      std::copy(buf, buf+rowSize, image->getPixelAddress(rc.x, rc.y+y));
+  }
+}
+
+std::size_t pixels_size(const Image* image,
+                        const std::vector<gfx::Rect>& rects)
+{
+  std::size_t size = 0;
+  for (const auto& rc : rects)
+    size += image->getRowStrideSize(rc.w) * rc.h;
+  return size;
+}
+
+} // anonymous namespace
+
 CopyRegion::CopyRegion(Image* dst, const Image* src,
                        const gfx::Region& region,
                        const gfx::Point& dstPos,
                        bool alreadyCopied)
   : WithImage(dst)
-  , m_size(0)
   , m_alreadyCopied(alreadyCopied)
 {
-  // Create region to save/swap later
+  // Split the region (clipped to dst/src images) in tiles
+  std::vector<std::pair<int, gfx::Rect> > pieces;
+  const int cols = (dst->width() + kTileSize - 1) / kTileSize;
+
   for (const auto& rc : region) {
     gfx::Clip clip(
       rc.x+dstPos.x, rc.y+dstPos.y,
@@ -36,19 +91,44 @@ CopyRegion::CopyRegion(Image* dst, const Image* src,
           src->width(), src->height()))
       continue;
 
-    m_region.createUnion(m_region, gfx::Region(clip.dstBounds()));
+    gfx::Rect bounds = clip.dstBounds();
+    for (int v=bounds.y/kTileSize; v<=(bounds.y2()-1)/kTileSize; ++v) {
+      for (int u=bounds.x/kTileSize; u<=(bounds.x2()-1)/kTileSize; ++u) {
+        gfx::Rect piece = bounds.createIntersection(
+          gfx::Rect(u*kTileSize, v*kTileSize, kTileSize, kTileSize));
+        pieces.push_back(std::make_pair(v*cols+u, piece));
+      }
+    }
+  }
+
+  std::stable_sort(pieces.begin(), pieces.end(),
+                   [](const std::pair<int, gfx::Rect>& a,
+                      const std::pair<int, gfx::Rect>& b) {
+                     return a.first < b.first;
+                   });
+
+  for (std::size_t i=0; i<pieces.size(); ) {
+    m_tiles.push_back(Tile());
+    Tile& tile = m_tiles.back();
+    int cell = pieces[i].first;
+    for (; i<pieces.size() && pieces[i].first == cell; ++i)
+      tile.rects.push_back(pieces[i].second);
   }
 
   // Save region pixels
-  for (const auto& rc : m_region) {
-    for (int y=0; y<rc.h; ++y) {
-      m_stream.write(
-        (const char*)src->getPixelAddress(rc.x-dstPos.x,
-                                          rc.y-dstPos.y+y),
-        src->getRowStrideSize(rc.w));
-    }
-  }
-  m_size = size_t(m_stream.tellp());
+  std::vector<uint8_t> raw, buf;
+  for (auto& tile : m_tiles)
+    saveTile(tile, src, dstPos, raw, buf);
+}
+
+size_t CopyRegion::onMemSize() const
+{
+  size_t size = sizeof(*this);
+  for (const auto& tile : m_tiles)
+    size += sizeof(Tile)
+      + tile.rects.size()*sizeof(gfx::Rect)
+      + tile.data.size();
+  return size;
 }
 
 void CopyRegion::onExecute()
@@ -67,31 +147,55 @@ void CopyRegion::onRedo()
   swap();
 }
 
+// Compresses the pixels of the tile rectangles in tile.data ("raw"
+// and "buf" are temporary buffers shared between all tiles to avoid
+// re-allocations).
+void CopyRegion::saveTile(Tile& tile, const Image* image, const gfx::Point& pos,
+                          std::vector<uint8_t>& raw,
+                          std::vector<uint8_t>& buf)
+{
+  read_pixels(image, tile.rects, pos, raw);
+
+  uLongf len = compressBound(raw.size());
+  if (buf.size() < len)
+    buf.resize(len);
+
+  int err = compress2(&buf[0], &len, &raw[0], raw.size(), kCompressionLevel);
+  if (err != Z_OK)
+    throw base::Exception("ZLib error %d in compress2().", err);
+
+  if (len < raw.size()) {
+    tile.data.assign(buf.begin(), buf.begin()+len);
+    tile.compressed = true;
+  }
+  else {
+    tile.data.swap(raw);
+    tile.compressed = false;
+  }
+}
+
 void CopyRegion::swap()
 {
   Image* image = this->image();
+  std::vector<uint8_t> pixels, raw, buf;
 
-  // Save current image region in "tmp" stream
-  std::stringstream tmp;
-  for (const auto& rc : m_region)
-    for (int y=0; y<rc.h; ++y)
-      tmp.write(
-        (const char*)image->getPixelAddress(rc.x, rc.y+y),
-        image->getRowStrideSize(rc.w));
-
-  // Restore m_stream into the image
-  m_stream.seekg(0, std::ios_base::beg);
-  for (const auto& rc : m_region) {
-    for (int y=0; y<rc.h; ++y) {
-      m_stream.read(
-        (char*)image->getPixelAddress(rc.x, rc.y+y),
-        image->getRowStrideSize(rc.w));
+  for (auto& tile : m_tiles) {
+    // Uncompress the saved pixels
+    if (tile.compressed) {
+      uLongf len = pixels_size(image, tile.rects);
+      pixels.resize(len);
+
+      int err = uncompress(&pixels[0], &len, &tile.data[0], tile.data.size());
+      if (err != Z_OK)
+        throw base::Exception("ZLib error %d in uncompress().", err);
     }
-  }
+    else
+      pixels.swap(tile.data);
 
-  // TODO use m_stream.swap(tmp) when clang and gcc support it
-  m_stream.str(tmp.str());
-  m_stream.clear();
+    // Save current image pixels in the tile, and restore the old ones
+    saveTile(tile, image, gfx::Point(0, 0), raw, buf);
+    write_pixels(image, tile.rects, &pixels[0]);
+  }
 
   image->incrementVersion();
 }
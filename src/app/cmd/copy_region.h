@@ -11,10 +11,12 @@
 
 #include "app/cmd.h"
 #include "app/cmd/with_image.h"
+#include "base/ints.h"
 #include "gfx/point.h"
+#include "gfx/rect.h"
 #include "gfx/region.h"
 
-#include <sstream>
+#include <vector>
 
 namespace app {
 namespace cmd {
@@ -36,17 +38,25 @@ namespace cmd {
     void onExecute() override;
     void onUndo() override;
     void onRedo() override;
-    size_t onMemSize() const override {
-      return sizeof(*this) + m_size;
-    }
+    size_t onMemSize() const override;
 
   private:
+    // Pixels of the region inside one cell of a fixed grid (the
+    // region is split in these tiles, and the pixels of each tile are
+    // compressed independently).
+    struct Tile {
+      std::vector<gfx::Rect> rects;
+      std::vector<uint8_t> data;  // Compressed pixels of all rects
+      bool compressed;
+    };
+
     void swap();
+    void saveTile(Tile& tile, const Image* image, const gfx::Point& pos,
+                  std::vector<uint8_t>& raw,
+                  std::vector<uint8_t>& buf);
 
-    size_t m_size;
     bool m_alreadyCopied;
-    gfx::Region m_region;
-    std::stringstream m_stream;
+    std::vector<Tile> m_tiles;
   };
 
 } // namespace cmd
@@ -0,0 +1,70 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#include "tests/test.h"
+
+#include "app/cmd/copy_region.h"
+#include "base/unique_ptr.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "gfx/region.h"
+
+#include <cstdlib>
+
+using namespace app;
+using namespace doc;
+
+typedef base::UniquePtr<Image> ImagePtr;
+
+// The region covers several tiles of 32x32 pixels. One of them is
+// filled with random pixels (so it cannot be compressed).
+TEST(CopyRegion, ExecuteUndoRedo)
+{
+  ImagePtr dst(Image::create(IMAGE_RGB, 80, 70));
+  ImagePtr src(Image::create(IMAGE_RGB, 80, 70));
+  for (int y=0; y<70; ++y) {
+    for (int x=0; x<80; ++x) {
+      put_pixel(dst, x, y, rgba(x, y, 0, 255));
+      put_pixel(src, x, y, rgba(0, x, y, 255));
+    }
+  }
+
+  std::srand(1);
+  for (int y=0; y<32; ++y)
+    for (int x=32; x<64; ++x)
+      put_pixel(src, x, y, rgba(std::rand() % 256, std::rand() % 256,
+                                std::rand() % 256, std::rand() % 256));
+
+  gfx::Region region(gfx::Rect(10, 5, 60, 50));
+  region.createUnion(region, gfx::Region(gfx::Rect(0, 60, 80, 10)));
+
+  ImagePtr original(Image::createCopy(dst));
+  ImagePtr expected(Image::createCopy(dst));
+  for (const gfx::Rect& rc : region)
+    for (int y=rc.y; y<rc.y2(); ++y)
+      for (int x=rc.x; x<rc.x2(); ++x)
+        put_pixel(expected, x, y, get_pixel(src, x, y));
+
+  cmd::CopyRegion* cmd = new cmd::CopyRegion(dst, src, region, gfx::Point(0, 0));
+
+  // The random tile is saved without compression
+  EXPECT_LE(32*32*4, int(cmd->memSize()));
+
+  cmd->execute(nullptr);
+  EXPECT_EQ(0, count_diff_between_images(expected, dst));
+
+  cmd->undo();
+  EXPECT_EQ(0, count_diff_between_images(original, dst));
+
+  cmd->redo();
+  EXPECT_EQ(0, count_diff_between_images(expected, dst));
+
+  cmd->undo();
+  EXPECT_EQ(0, count_diff_between_images(original, dst));
+
+  cmd->dispose();
+}
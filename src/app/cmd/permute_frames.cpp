@@ -0,0 +1,65 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/permute_frames.h"
+
+#include "doc/cel.h"
+#include "doc/cels_range.h"
+#include "doc/sprite.h"
+
+namespace app {
+namespace cmd {
+
+PermuteFrames::PermuteFrames(Sprite* sprite, frame_t first,
+                             const std::vector<frame_t>& newFrames)
+  : WithSprite(sprite)
+  , m_first(first)
+  , m_newFrames(newFrames)
+{
+}
+
+void PermuteFrames::onExecute()
+{
+  permute(m_newFrames);
+}
+
+void PermuteFrames::onUndo()
+{
+  // Inverse permutation
+  std::vector<frame_t> oldFrames(m_newFrames.size());
+  for (std::size_t i=0; i<m_newFrames.size(); ++i)
+    oldFrames[m_newFrames[i]-m_first] = m_first+frame_t(i);
+
+  permute(oldFrames);
+}
+
+void PermuteFrames::permute(const std::vector<frame_t>& newFrames)
+{
+  Sprite* sprite = this->sprite();
+
+  // Cels that change their frame
+  std::vector<Cel*> cels;
+  for (std::size_t i=0; i<newFrames.size(); ++i) {
+    if (newFrames[i] != m_first+frame_t(i)) {
+      for (Cel* cel : sprite->cels(m_first+frame_t(i)))
+        cels.push_back(cel);
+    }
+  }
+
+  sprite->permuteFrames(m_first, newFrames);
+
+  for (Cel* cel : cels)
+    cel->incrementVersion();
+  sprite->incrementVersion();
+}
+
+} // namespace cmd
+} // namespace app
@@ -0,0 +1,49 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_CMD_PERMUTE_FRAMES_H_INCLUDED
+#define APP_CMD_PERMUTE_FRAMES_H_INCLUDED
+#pragma once
+
+#include "app/cmd.h"
+#include "app/cmd/with_sprite.h"
+#include "doc/frame.h"
+
+#include <vector>
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Moves frames (durations and cels of all layers) in just one step,
+  // e.g. to move or reverse a range of frames. Frame "first+i" is
+  // moved to "newFrames[i]". Only the permutation is kept for undo.
+  class PermuteFrames : public Cmd
+                      , public WithSprite {
+  public:
+    PermuteFrames(Sprite* sprite, frame_t first,
+                  const std::vector<frame_t>& newFrames);
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    size_t onMemSize() const override {
+      return sizeof(*this) +
+        sizeof(frame_t) * m_newFrames.size();
+    }
+
+  private:
+    void permute(const std::vector<frame_t>& newFrames);
+
+    frame_t m_first;
+    std::vector<frame_t> m_newFrames;
+  };
+
+} // namespace cmd
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -16,6 +16,10 @@
 #include "app/cmd/set_cel_opacity.h"
 #include "app/cmd/set_palette.h"
 #include "app/document.h"
+#include "base/mutex.h"
+#include "base/scoped_lock.h"
+#include "base/shared_ptr.h"
+#include "base/thread.h"
 #include "base/unique_ptr.h"
 #include "doc/cel.h"
 #include "doc/cels_range.h"
@@ -23,16 +27,109 @@
 #include "doc/document_event.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
+#include "doc/rgbmap.h"
 #include "doc/sprite.h"
 #include "render/quantization.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <vector>
+
 namespace app {
 namespace cmd {
 
 using namespace doc;
 
+namespace {
+
+// Minimum number of pixels to convert to Indexed in several threads.
+// Each thread needs a complete RgbMap (it cannot be calculated lazily
+// from several threads), so it's not worth for small sprites.
+const std::size_t kMinPixelsForSharedRgbMap = 4*32*32*32*8;
+
+// Number of parts in which each RgbMap is divided to be calculated
+// by several threads.
+const int kRgbMapParts = 64;
+
+// Calls f(i) for each i in [0, n) from "nthreads" threads (the
+// current thread included). Only the current thread calls "progress"
+// (with the number of finished items), and if it returns false, the
+// remaining items are skipped.
+template<typename Func, typename Progress>
+bool for_each_index_in_threads(int n, int nthreads, Func f, Progress progress)
+{
+  std::atomic<int> next(0);
+  std::atomic<bool> canceled(false);
+
+  // Number of finished items (modified with the mutex locked, so
+  // the current thread can wait for it without missing a change)
+  int done = 0;
+  base::mutex mutex;
+  std::condition_variable_any itemDone;
+
+  auto worker =
+    [&]() {
+      int i;
+      while (!canceled && (i = next++) < n) {
+        f(i);
+        {
+          base::scoped_lock lock(mutex);
+          ++done;
+        }
+        itemDone.notify_one();
+      }
+    };
+
+  std::vector<base::thread*> threads;
+  for (int t=1; t<nthreads; ++t)
+    threads.push_back(new base::thread(worker));
+
+  int i;
+  while (!canceled && (i = next++) < n) {
+    f(i);
+
+    int current;
+    {
+      base::scoped_lock lock(mutex);
+      current = ++done;
+    }
+    if (!progress(current))
+      canceled = true;
+  }
+
+  // Report the progress of items from other threads (each time an
+  // item is finished)
+  int reported = -1;
+  while (!canceled) {
+    int current;
+    {
+      base::scoped_lock lock(mutex);
+      while (done == reported)
+        itemDone.wait(mutex);
+      current = done;
+    }
+    if (current >= n)
+      break;
+
+    if (!progress(current))
+      canceled = true;
+    reported = current;
+  }
+
+  for (base::thread* thread : threads) {
+    thread->join();
+    delete thread;
+  }
+
+  return !canceled;
+}
+
+} // anonymous namespace
+
 SetPixelFormat::SetPixelFormat(Sprite* sprite,
-  PixelFormat newFormat, DitheringMethod dithering)
+  PixelFormat newFormat, DitheringMethod dithering,
+  SetPixelFormatDelegate* delegate)
   : WithSprite(sprite)
   , m_oldFormat(sprite->pixelFormat())
   , m_newFormat(newFormat)
@@ -41,19 +138,90 @@ SetPixelFormat::SetPixelFormat(Sprite* sprite,
   if (sprite->pixelFormat() == newFormat)
     return;
 
+  std::vector<Cel*> cels;
+  std::size_t totalPixels = 0;
   for (Cel* cel : sprite->uniqueCels()) {
-    ImageRef old_image = cel->imageRef();
-    ImageRef new_image(
-      render::convert_pixel_format
-      (old_image.get(), NULL, newFormat, m_dithering,
-       sprite->rgbMap(cel->frame()),
-       sprite->palette(cel->frame()),
-       cel->layer()->isBackground(),
-       old_image->maskColor()));
-
-    m_seq.add(new cmd::ReplaceImage(sprite, old_image, new_image));
+    cels.push_back(cel);
+    totalPixels += std::size_t(cel->image()->width()) * cel->image()->height();
   }
 
+  const int nthreads = MID(1, base::thread::hardware_concurrency(), int(cels.size()));
+
+  // To convert images to Indexed from several threads, we need an
+  // RgbMap with all its entries calculated for each palette (the
+  // same RgbMap is shared by all threads as read-only).
+  std::map<const Palette*, base::SharedPtr<RgbMap> > sharedRgbMaps;
+  if (nthreads > 1 &&
+      newFormat == IMAGE_INDEXED &&
+      totalPixels >= kMinPixelsForSharedRgbMap) {
+    int maskIndex = (sprite->backgroundLayer() ? -1: sprite->transparentColor());
+    for (Cel* cel : cels) {
+      const Palette* palette = sprite->palette(cel->frame());
+      base::SharedPtr<RgbMap>& rgbmap = sharedRgbMaps[palette];
+      if (!rgbmap) {
+        rgbmap.reset(new RgbMap);
+        rgbmap->regenerate(palette, maskIndex);
+      }
+    }
+
+    std::vector<RgbMap*> rgbmaps;
+    for (auto& item : sharedRgbMaps)
+      rgbmaps.push_back(item.second.get());
+
+    for_each_index_in_threads(
+      int(rgbmaps.size()) * kRgbMapParts, nthreads,
+      [&rgbmaps](int i) {
+        RgbMap* rgbmap = rgbmaps[i / kRgbMapParts];
+        int part = rgbmap->size() / kRgbMapParts;
+        int begin = (i % kRgbMapParts) * part;
+        rgbmap->generateEntries(begin, begin+part);
+      },
+      [](int) { return true; });
+  }
+
+  std::vector<ImageRef> newImages(cels.size());
+  auto convertCel =
+    [&](int i) {
+      Cel* cel = cels[i];
+      const Palette* palette = sprite->palette(cel->frame());
+      const RgbMap* rgbmap;
+      if (sharedRgbMaps.empty())
+        rgbmap = sprite->rgbMap(cel->frame());
+      else
+        rgbmap = sharedRgbMaps.find(palette)->second.get();
+
+      const Image* old_image = cel->image();
+      newImages[i].reset(
+        render::convert_pixel_format
+        (old_image, NULL, newFormat, m_dithering,
+         rgbmap, palette,
+         cel->layer()->isBackground(),
+         old_image->maskColor()));
+    };
+
+  // Sprite::rgbMap() cannot be used from several threads, so if we
+  // don't have shared RgbMaps, we can use more threads only when we
+  // are not converting to Indexed.
+  const bool canConvertInThreads =
+    (!sharedRgbMaps.empty() || newFormat != IMAGE_INDEXED);
+
+  const int ncels = int(cels.size());
+  bool completed = for_each_index_in_threads(
+    ncels, (canConvertInThreads ? nthreads: 1),
+    convertCel,
+    [delegate, ncels](int done) -> bool {
+      if (delegate) {
+        delegate->onSetPixelFormatProgress(double(done) / double(ncels));
+        return delegate->onSetPixelFormatContinue();
+      }
+      return true;
+    });
+  if (!completed)
+    return;
+
+  for (int i=0; i<ncels; ++i)
+    m_seq.add(new cmd::ReplaceImage(sprite, cels[i]->imageRef(), newImages[i]));
+
   // Set all cels opacity to 100% if we are converting to indexed.
   // TODO remove this
   if (newFormat == IMAGE_INDEXED) {
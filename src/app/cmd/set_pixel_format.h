@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -22,12 +22,25 @@ namespace app {
 namespace cmd {
   using namespace doc;
 
+  // Used to report the progress of the cels conversion (it's done
+  // in the SetPixelFormat constructor) and to cancel it. Functions
+  // are called from the same thread that creates the SetPixelFormat.
+  class SetPixelFormatDelegate {
+  public:
+    virtual ~SetPixelFormatDelegate() { }
+    virtual void onSetPixelFormatProgress(double progress) = 0;
+    virtual bool onSetPixelFormatContinue() = 0;
+  };
+
   class SetPixelFormat : public Cmd
                        , public WithSprite {
   public:
+    // If the conversion is canceled by the delegate, the Cmd will not
+    // replace any image (so it must not be committed).
     SetPixelFormat(Sprite* sprite,
       PixelFormat newFormat,
-      DitheringMethod dithering);
+      DitheringMethod dithering,
+      SetPixelFormatDelegate* delegate = nullptr);
 
   protected:
     void onExecute() override;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -10,10 +10,11 @@
 #endif
 
 #include "app/app.h"
+#include "app/cmd/set_pixel_format.h"
 #include "app/commands/command.h"
 #include "app/commands/params.h"
 #include "app/context_access.h"
-#include "app/document_api.h"
+#include "app/job.h"
 #include "app/modules/gui.h"
 #include "app/modules/palettes.h"
 #include "app/transaction.h"
@@ -23,6 +24,55 @@
 
 namespace app {
 
+class ChangePixelFormatJob : public Job
+                           , public cmd::SetPixelFormatDelegate {
+  ContextWriter m_writer;
+  Sprite* m_sprite;
+  PixelFormat m_format;
+  DitheringMethod m_dithering;
+
+public:
+  ChangePixelFormatJob(const ContextReader& reader,
+                       PixelFormat format,
+                       DitheringMethod dithering)
+    : Job("Converting Color Mode")
+    , m_writer(reader)
+    , m_sprite(m_writer.sprite())
+    , m_format(format)
+    , m_dithering(dithering) {
+  }
+
+protected:
+
+  // [working thread]
+  void onJob() override {
+    // Cels are converted in the SetPixelFormat constructor
+    cmd::SetPixelFormat* cmd =
+      new cmd::SetPixelFormat(m_sprite, m_format, m_dithering, this);
+
+    // Discard the partially converted cels (the command is not
+    // executed, so the sprite isn't modified at all)
+    if (isCanceled()) {
+      cmd->dispose();
+      return;
+    }
+
+    Transaction transaction(m_writer.context(), "Color Mode Change");
+    transaction.execute(cmd);
+    transaction.commit();
+  }
+
+  // cmd::SetPixelFormatDelegate impl
+  void onSetPixelFormatProgress(double progress) override {
+    jobProgress(progress);
+  }
+
+  bool onSetPixelFormatContinue() override {
+    return !isCanceled();
+  }
+
+};
+
 class ChangePixelFormatCommand : public Command {
   PixelFormat m_format;
   DitheringMethod m_dithering;
@@ -93,13 +143,13 @@ bool ChangePixelFormatCommand::onChecked(Context* context)
 void ChangePixelFormatCommand::onExecute(Context* context)
 {
   {
-    ContextWriter writer(context);
-    Transaction transaction(writer.context(), "Color Mode Change");
-    Document* document(writer.document());
-    Sprite* sprite(writer.sprite());
+    ContextReader reader(context);
+    if (reader.sprite()->pixelFormat() == m_format)
+      return;
 
-    document->getApi(transaction).setPixelFormat(sprite, m_format, m_dithering);
-    transaction.commit();
+    ChangePixelFormatJob job(reader, m_format, m_dithering);
+    job.startJob();
+    job.waitJob();
   }
   app_refresh_screen();
 }
@@ -18,9 +18,9 @@
 #include "app/pref/preferences.h"
 #include "app/transaction.h"
 #include "base/convert_to.h"
+#include "doc/algorithm/modify_selection.h"
 #include "doc/brush_type.h"
 #include "doc/mask.h"
-#include "filters/neighboring_pixels.h"
 
 #include "modify_selection.xml.h"
 
@@ -179,72 +179,26 @@ std::string ModifySelectionCommand::getActionName() const
   }
 }
 
-// TODO create morphological operators/functions in "doc" namespace
-// TODO the impl is not optimal, but is good enough as a first version
 void ModifySelectionCommand::applyModifier(const Mask* srcMask, Mask* dstMask,
                                            const int radius,
                                            const doc::BrushType brush) const
 {
-  const doc::Image* srcImage = srcMask->bitmap();
-  doc::Image* dstImage = dstMask->bitmap();
-
-  // Image bounds to clip get/put pixels
-  const gfx::Rect srcBounds = srcImage->bounds();
-
-  // Create a kernel
-  const int size = 2*radius+1;
-  base::UniquePtr<doc::Image> kernel(doc::Image::create(IMAGE_BITMAP, size, size));
-  doc::clear_image(kernel, 0);
-  if (brush == doc::kCircleBrushType)
-    doc::fill_ellipse(kernel, 0, 0, size-1, size-1, 1);
-  else
-    doc::fill_rect(kernel, 0, 0, size-1, size-1, 1);
-  doc::put_pixel(kernel, radius, radius, 0);
-
-  int total = 0;                // Number of 1s in the kernel image
-  for (int v=0; v<size; ++v)
-    for (int u=0; u<size; ++u)
-      total += kernel->getPixel(u, v);
-
-  for (int y=-radius; y<srcBounds.h+radius; ++y) {
-    for (int x=-radius; x<srcBounds.w+radius; ++x) {
-      doc::color_t c;
-      if (srcBounds.contains(x, y))
-        c = srcImage->getPixel(x, y);
-      else
-        c = 0;
-
-      int accum = 0;
-      for (int v=0; v<size; ++v) {
-        for (int u=0; u<size; ++u) {
-          if (kernel->getPixel(u, v)) {
-            if (srcBounds.contains(x+u-radius, y+v-radius))
-              accum += srcImage->getPixel(x-radius+u, y-radius+v);
-          }
-        }
-      }
-
-      switch (m_modifier) {
-        case Border: {
-          c = (c && accum < total) ? 1: 0;
-          break;
-        }
-        case Expand: {
-          c = (c || accum > 0) ? 1: 0;
-          break;
-        }
-        case Contract: {
-          c = (c && accum == total) ? 1: 0;
-          break;
-        }
-      }
-
-      if (c)
-        doc::put_pixel(dstImage,
-                       srcMask->bounds().x+x,
-                       srcMask->bounds().y+y, 1);
-    }
+  doc::algorithm::SelectionModifier modifier;
+  switch (m_modifier) {
+    case Border: modifier = doc::algorithm::SelectionModifier::Border; break;
+    case Expand: modifier = doc::algorithm::SelectionModifier::Expand; break;
+    case Contract: modifier = doc::algorithm::SelectionModifier::Contract; break;
+    default:
+      ASSERT(false);
+      return;
   }
+
+  doc::algorithm::modify_selection(
+    modifier,
+    srcMask->bitmap(),
+    dstMask->bitmap(),
+    srcMask->bounds().origin() - dstMask->bounds().origin(),
+    radius, brush);
 }
 
 Command* CommandFactory::createModifySelectionCommand()
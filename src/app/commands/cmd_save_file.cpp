@@ -94,7 +94,7 @@ private:
   FileOp* m_fop;
 };
 
-static void save_document_in_background(const Context* context,
+static void save_document_in_background(Context* context,
                                         const Document* document, bool mark_as_saved,
                                         const std::string& fn_format)
 {
@@ -109,7 +109,7 @@ static void save_document_in_background(const Context* context,
   job.showProgressWindow();
 
   if (fop->hasError()) {
-    Console console;
+    Console console(context);
     console.printf(fop->error().c_str());
 
     // We don't know if the file was saved correctly or not. So mark
@@ -20,6 +20,7 @@
 #include "app/modules/editors.h"
 #include "app/transaction.h"
 #include "app/ui/editor/editor.h"
+#include "base/profiler.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
@@ -173,6 +174,8 @@ bool FilterManagerImpl::applyStep()
 
 void FilterManagerImpl::apply(Transaction& transaction)
 {
+  base::profiler::ScopedTimer timer("filters", "FilterManagerImpl::apply");
+
   bool cancelled = false;
 
   begin();
@@ -202,6 +205,8 @@ void FilterManagerImpl::apply(Transaction& transaction)
 
 void FilterManagerImpl::applyToTarget()
 {
+  base::profiler::ScopedTimer timer("filters", "FilterManagerImpl::applyToTarget");
+
   bool cancelled = false;
 
   ImagesCollector images((m_target & TARGET_ALL_LAYERS ?
@@ -35,7 +35,8 @@ static bool console_locked;
 static bool want_close_flag = false;
 
 Console::Console(Context* ctx)
-  : m_withUI(false)
+  : m_ctx(ctx)
+  , m_withUI(false)
 {
   if (ctx)
     m_withUI = (ctx->isUIAvailable());
@@ -115,8 +116,14 @@ void Console::printf(const char* format, ...)
   va_end(ap);
 
   if (!m_withUI || !wid_console) {
-    fputs(buf, stdout);
-    fflush(stdout);
+    // The context can collect the errors (e.g. BatchServer jobs,
+    // where stdout is used for the responses)
+    if (m_ctx)
+      m_ctx->onConsolePrint(buf);
+    else {
+      fputs(buf, stdout);
+      fflush(stdout);
+    }
     return;
   }
 
@@ -149,9 +156,9 @@ void Console::printf(const char* format, ...)
 }
 
 // static
-void Console::showException(const std::exception& e)
+void Console::showException(const std::exception& e, Context* ctx)
 {
-  Console console;
+  Console console(ctx);
   if (typeid(e) == typeid(std::bad_alloc))
     console.printf("There is not enough memory to complete the action.");
   else
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -21,9 +21,10 @@ namespace app {
 
     void printf(const char *format, ...);
 
-    static void showException(const std::exception& e);
+    static void showException(const std::exception& e, Context* ctx = nullptr);
 
   private:
+    Context* m_ctx;
     bool m_withUI;
   };
 
@@ -18,6 +18,7 @@
 #include "app/document.h"
 
 #include <algorithm>
+#include <cstdio>
 #include <stdexcept>
 
 namespace app {
@@ -57,7 +58,7 @@ void Context::executeCommand(const char* commandName)
 
 void Context::executeCommand(Command* command, const Params& params)
 {
-  Console console;
+  Console console(this);
 
   ASSERT(command != NULL);
 
@@ -91,7 +92,7 @@ void Context::executeCommand(Command* command, const Params& params)
     LOG("Context: Exception caught executing '%s' command\n%s\n",
         command->id().c_str(), e.what());
 
-    Console::showException(e);
+    Console::showException(e, this);
   }
   catch (std::exception& e) {
     LOG("Context: std::exception caught executing '%s' command\n%s\n",
@@ -113,6 +114,12 @@ void Context::executeCommand(Command* command, const Params& params)
 #endif
 }
 
+void Context::onConsolePrint(const char* text)
+{
+  fputs(text, stdout);
+  fflush(stdout);
+}
+
 void Context::onCreateDocument(doc::CreateDocumentArgs* args)
 {
   args->setDocument(new app::Document(NULL));
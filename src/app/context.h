@@ -65,9 +65,17 @@ namespace app {
     app::Document* activeDocument() const;
     bool hasModifiedDocuments() const;
 
+    // Changes the active document. Contexts that don't keep track of
+    // an active document (e.g. tests) ignore this call.
+    virtual void setActiveDocument(Document* document) { }
+
     void executeCommand(const char* commandName);
     virtual void executeCommand(Command* command, const Params& params = Params());
 
+    // Called by Console::printf() to show errors when the UI isn't
+    // available. By default the text is written in stdout.
+    virtual void onConsolePrint(const char* text);
+
     base::Signal1<void, CommandExecutionEvent&> BeforeCommandExecution;
     base::Signal1<void, CommandExecutionEvent&> AfterCommandExecution;
 
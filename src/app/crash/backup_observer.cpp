@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -17,6 +17,7 @@
 #include "app/pref/preferences.h"
 #include "base/bind.h"
 #include "base/chrono.h"
+#include "base/profiler.h"
 #include "base/remove_from_container.h"
 #include "base/scoped_lock.h"
 #include "doc/context.h"
@@ -81,13 +82,16 @@ void BackupObserver::backgroundThread()
       TRACE("DataRecovery: Start backup process for %d documents\n", m_documents.size());
 
       base::scoped_lock hold(m_mutex);
+      base::profiler::ScopedTimer timer("backup", "BackupObserver::backup");
       base::Chrono chrono;
       bool somethingLocked = false;
 
       for (app::Document* doc : m_documents) {
         try {
-          if (doc->needsBackup())
+          if (doc->needsBackup()) {
+            base::profiler::ScopedTimer docTimer("backup", "Session::saveDocumentChanges", doc->filename());
             m_session->saveDocumentChanges(doc);
+          }
         }
         catch (const std::exception&) {
           TRACE("DataRecovery: Document '%d' is locked\n", doc->id());
@@ -24,6 +24,7 @@
 #include "app/cmd/layer_from_background.h"
 #include "app/cmd/move_cel.h"
 #include "app/cmd/move_layer.h"
+#include "app/cmd/permute_frames.h"
 #include "app/cmd/remove_cel.h"
 #include "app/cmd/remove_frame.h"
 #include "app/cmd/remove_frame_tag.h"
@@ -213,92 +214,100 @@ void DocumentApi::setFrameRangeDuration(Sprite* sprite, frame_t from, frame_t to
 
 void DocumentApi::moveFrame(Sprite* sprite, frame_t frame, frame_t beforeFrame)
 {
-  if (frame != beforeFrame &&
-      frame >= 0 &&
-      frame <= sprite->lastFrame() &&
-      beforeFrame >= 0 &&
-      beforeFrame <= sprite->lastFrame()+1) {
-    // Change the frame-lengths.
-    int frlen_aux = sprite->frameDuration(frame);
-
-    // Moving the frame to the future.
-    if (frame < beforeFrame) {
-      for (frame_t c=frame; c<beforeFrame-1; ++c)
-        setFrameDuration(sprite, c, sprite->frameDuration(c+1));
-      setFrameDuration(sprite, beforeFrame-1, frlen_aux);
-    }
-    // Moving the frame to the past.
-    else if (beforeFrame < frame) {
-      for (frame_t c=frame; c>beforeFrame; --c)
-        setFrameDuration(sprite, c, sprite->frameDuration(c-1));
-      setFrameDuration(sprite, beforeFrame, frlen_aux);
-    }
+  moveFrames(sprite, frame, frame, beforeFrame);
+}
+
+void DocumentApi::moveFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd, frame_t beforeFrame)
+{
+  ASSERT(fromBegin <= fromEnd);
 
-    adjustFrameTags(sprite, frame, -1, true);
-    adjustFrameTags(sprite, beforeFrame, +1, true);
+  // Moving the range before one of its frames (or before the next
+  // frame) is a no-op.
+  if (fromBegin < 0 ||
+      fromEnd > sprite->lastFrame() ||
+      beforeFrame < 0 ||
+      beforeFrame > sprite->lastFrame()+1 ||
+      (beforeFrame >= fromBegin && beforeFrame <= fromEnd+1))
+    return;
 
-    // Change cel positions.
-    moveFrameLayer(sprite->folder(), frame, beforeFrame);
+  const frame_t n = fromEnd - fromBegin + 1;
+  frame_t first;
+  std::vector<frame_t> newFrames;
+  FrameDeltas deltas;
+
+  // Moving the frames to the past, the range [beforeFrame, fromEnd]
+  // is permuted.
+  if (beforeFrame < fromBegin) {
+    first = beforeFrame;
+    newFrames.resize(fromEnd - beforeFrame + 1);
+    for (frame_t fr=beforeFrame; fr<=fromEnd; ++fr)
+      newFrames[fr-first] = (fr >= fromBegin ? beforeFrame + fr - fromBegin: fr + n);
+
+    for (frame_t i=0; i<n; ++i) {
+      deltas.push_back(std::make_pair(fromBegin+i, frame_t(-1)));
+      deltas.push_back(std::make_pair(beforeFrame+i, frame_t(+1)));
+    }
+  }
+  // Moving the frames to the future, the range [fromBegin, beforeFrame)
+  // is permuted.
+  else {
+    first = fromBegin;
+    newFrames.resize(beforeFrame - fromBegin);
+    for (frame_t fr=fromBegin; fr<beforeFrame; ++fr)
+      newFrames[fr-first] = (fr <= fromEnd ? beforeFrame - n + fr - fromBegin: fr - n);
+
+    for (frame_t i=0; i<n; ++i) {
+      deltas.push_back(std::make_pair(fromEnd-i, frame_t(-1)));
+      deltas.push_back(std::make_pair(beforeFrame-i, frame_t(+1)));
+    }
   }
+
+  m_transaction.execute(new cmd::PermuteFrames(sprite, first, newFrames));
+  adjustFrameTags(sprite, deltas);
 }
 
-void DocumentApi::moveFrameLayer(Layer* layer, frame_t frame, frame_t beforeFrame)
+void DocumentApi::copyFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd, frame_t beforeFrame)
 {
-  ASSERT(layer);
-
-  switch (layer->type()) {
+  ASSERT(fromBegin <= fromEnd);
+  ASSERT(fromBegin >= 0 && fromEnd <= sprite->lastFrame());
+  ASSERT(beforeFrame >= 0 && beforeFrame <= sprite->lastFrame()+1);
 
-    case ObjectType::LayerImage: {
-      LayerImage* imglayer = static_cast<LayerImage*>(layer);
+  const frame_t n = fromEnd - fromBegin + 1;
+  const frame_t total = sprite->totalFrames();
 
-      CelList cels;
-      imglayer->getCels(cels);
+  // Copies are added at the end of the sprite (so we don't have to
+  // displace the cels of the following frames for each copy)...
+  for (frame_t i=0; i<n; ++i)
+    m_transaction.execute(new cmd::CopyFrame(sprite, fromBegin+i, total+i));
 
-      CelIterator it = cels.begin();
-      CelIterator end = cels.end();
+  // ...and then they are moved in just one step before "beforeFrame".
+  if (beforeFrame < total) {
+    std::vector<frame_t> newFrames(total + n - beforeFrame);
+    for (frame_t fr=beforeFrame; fr<total+n; ++fr)
+      newFrames[fr-beforeFrame] = (fr < total ? fr + n: beforeFrame + fr - total);
 
-      for (; it != end; ++it) {
-        Cel* cel = *it;
-        frame_t celFrame = cel->frame();
-        frame_t newFrame = celFrame;
+    m_transaction.execute(new cmd::PermuteFrames(sprite, beforeFrame, newFrames));
+  }
 
-        // moving the frame to the future
-        if (frame < beforeFrame) {
-          if (celFrame == frame) {
-            newFrame = beforeFrame-1;
-          }
-          else if (celFrame > frame &&
-                   celFrame < beforeFrame) {
-            --newFrame;
-          }
-        }
-        // moving the frame to the past
-        else if (beforeFrame < frame) {
-          if (celFrame == frame) {
-            newFrame = beforeFrame;
-          }
-          else if (celFrame >= beforeFrame &&
-                   celFrame < frame) {
-            ++newFrame;
-          }
-        }
+  FrameDeltas deltas;
+  for (frame_t i=0; i<n; ++i)
+    deltas.push_back(std::make_pair(beforeFrame+i, frame_t(+1)));
+  adjustFrameTags(sprite, deltas);
+}
 
-        if (celFrame != newFrame)
-          setCelFramePosition(cel, newFrame);
-      }
-      break;
-    }
+void DocumentApi::reverseFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd)
+{
+  ASSERT(fromBegin >= 0 && fromEnd <= sprite->lastFrame());
 
-    case ObjectType::LayerFolder: {
-      LayerIterator it = static_cast<LayerFolder*>(layer)->getLayerBegin();
-      LayerIterator end = static_cast<LayerFolder*>(layer)->getLayerEnd();
+  if (fromBegin >= fromEnd)
+    return;
 
-      for (; it != end; ++it)
-        moveFrameLayer(*it, frame, beforeFrame);
-      break;
-    }
+  // Frame tags are not modified as all frames stay inside the range.
+  std::vector<frame_t> newFrames(fromEnd - fromBegin + 1);
+  for (frame_t fr=fromBegin; fr<=fromEnd; ++fr)
+    newFrames[fr-fromBegin] = fromEnd - (fr - fromBegin);
 
-  }
+  m_transaction.execute(new cmd::PermuteFrames(sprite, fromBegin, newFrames));
 }
 
 void DocumentApi::addCel(LayerImage* layer, Cel* cel)
@@ -538,6 +547,11 @@ void DocumentApi::setPalette(Sprite* sprite, frame_t frame, const Palette* newPa
 }
 
 void DocumentApi::adjustFrameTags(Sprite* sprite, frame_t frame, frame_t delta, bool between)
+{
+  adjustFrameTags(sprite, FrameDeltas(1, std::make_pair(frame, delta)));
+}
+
+void DocumentApi::adjustFrameTags(Sprite* sprite, const FrameDeltas& deltas)
 {
   // As FrameTag::setFrameRange() changes m_frameTags, we need to use
   // a copy of this collection
@@ -547,13 +561,23 @@ void DocumentApi::adjustFrameTags(Sprite* sprite, frame_t frame, frame_t delta,
     frame_t from = tag->fromFrame();
     frame_t to = tag->toFrame();
 
-    if (delta == +1) {
-      if (frame <= from) { ++from; }
-      if (frame <= to+1) { ++to; }
-    }
-    else if (delta == -1) {
-      if (frame < from) { --from; }
-      if (frame <= to) { --to; }
+    // All deltas are applied to calculate the final range, so we add
+    // just one undoable command for each modified tag.
+    for (const auto& d : deltas) {
+      const frame_t frame = d.first;
+      const frame_t delta = d.second;
+
+      if (delta == +1) {
+        if (frame <= from) { ++from; }
+        if (frame <= to+1) { ++to; }
+      }
+      else if (delta == -1) {
+        if (frame < from) { --from; }
+        if (frame <= to) { --to; }
+      }
+
+      if (from > to)
+        break;
     }
 
     if (from != tag->fromFrame() ||
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -17,6 +17,9 @@
 #include "doc/pixel_format.h"
 #include "gfx/rect.h"
 
+#include <utility>
+#include <vector>
+
 namespace doc {
   class Cel;
   class Image;
@@ -59,6 +62,9 @@ namespace app {
     void setFrameDuration(Sprite* sprite, frame_t frame, int msecs);
     void setFrameRangeDuration(Sprite* sprite, frame_t from, frame_t to, int msecs);
     void moveFrame(Sprite* sprite, frame_t frame, frame_t beforeFrame);
+    void moveFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd, frame_t beforeFrame);
+    void copyFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd, frame_t beforeFrame);
+    void reverseFrames(Sprite* sprite, frame_t fromBegin, frame_t fromEnd);
 
     // Cels API
     void addCel(LayerImage* layer, Cel* cel);
@@ -107,9 +113,12 @@ namespace app {
     void setPalette(Sprite* sprite, frame_t frame, const Palette* newPalette);
 
   private:
+    // List of frames inserted (+1) or removed (-1) in order
+    typedef std::vector<std::pair<frame_t, frame_t> > FrameDeltas;
+
     void setCelFramePosition(Cel* cel, frame_t frame);
-    void moveFrameLayer(Layer* layer, frame_t frame, frame_t beforeFrame);
     void adjustFrameTags(Sprite* sprite, frame_t frame, frame_t delta, bool between);
+    void adjustFrameTags(Sprite* sprite, const FrameDeltas& deltas);
 
     Document* m_document;
     Transaction& m_transaction;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -20,6 +20,7 @@
 #include "base/convert_to.h"
 #include "base/fstream_path.h"
 #include "base/path.h"
+#include "base/profiler.h"
 #include "base/replace_string.h"
 #include "base/shared_ptr.h"
 #include "base/string.h"
@@ -198,6 +199,7 @@ public:
   typedef List::const_iterator const_iterator;
 
   bool empty() const { return m_samples.empty(); }
+  int size() const { return int(m_samples.size()); }
 
   void addSample(const Sample& sample) {
     m_samples.push_back(sample);
@@ -226,6 +228,8 @@ public:
   }
 
   void layoutSamples(Samples& samples, int borderPadding, int shapePadding, int& width, int& height) override {
+    base::profiler::ScopedTimer timer("exporter", "SimpleLayoutSamples::layoutSamples");
+
     const Sprite* oldSprite = NULL;
     const Layer* oldLayer = NULL;
 
@@ -308,6 +312,8 @@ class DocumentExporter::BestFitLayoutSamples :
     public DocumentExporter::LayoutSamples {
 public:
   void layoutSamples(Samples& samples, int borderPadding, int shapePadding, int& width, int& height) override {
+    base::profiler::ScopedTimer timer("exporter", "BestFitLayoutSamples::layoutSamples");
+
     gfx::PackingRects pr;
 
     // TODO Add support for shape paddings
@@ -354,17 +360,23 @@ DocumentExporter::DocumentExporter()
  , m_trimCels(false)
  , m_listFrameTags(false)
  , m_listLayers(false)
+ , m_ctx(nullptr)
+ , m_dataOutput(nullptr)
 {
 }
 
 Document* DocumentExporter::exportSheet()
 {
+  base::profiler::ScopedTimer timer("exporter", "DocumentExporter::exportSheet");
+
   // We output the metadata to std::cout if the user didn't specify a file.
   std::ofstream fos;
   std::streambuf* osbuf = nullptr;
   if (m_dataFilename.empty()) {
+    if (m_dataOutput)
+      osbuf = m_dataOutput->rdbuf();
     // Redirect to stdout if we are running in batch mode
-    if (!UIContext::instance()->isUIAvailable())
+    else if (!context()->isUIAvailable())
       osbuf = std::cout.rdbuf();
   }
   else {
@@ -378,10 +390,11 @@ Document* DocumentExporter::exportSheet()
   Samples samples;
   captureSamples(samples);
   if (samples.empty()) {
-    Console console;
+    Console console(context());
     console.printf("No documents to export");
     return nullptr;
   }
+  base::profiler::add_counter("exporter", "samples", samples.size());
 
   // 2) Layout those samples in a texture field.
   switch (m_sheetType) {
@@ -418,9 +431,10 @@ Document* DocumentExporter::exportSheet()
   // Save the image files.
   if (!m_textureFilename.empty()) {
     textureDocument->setFilename(m_textureFilename.c_str());
-    int ret = save_document(UIContext::instance(), textureDocument.get());
-    if (ret == 0)
-      textureDocument->markAsSaved();
+    if (save_document(context(), textureDocument.get()) != 0)
+      return nullptr;
+
+    textureDocument->markAsSaved();
   }
 
   return textureDocument.release();
@@ -428,6 +442,8 @@ Document* DocumentExporter::exportSheet()
 
 void DocumentExporter::captureSamples(Samples& samples)
 {
+  base::profiler::ScopedTimer timer("exporter", "DocumentExporter::captureSamples");
+
   for (auto& item : m_documents) {
     Document* doc = item.doc;
     Sprite* sprite = doc->sprite();
@@ -545,6 +561,8 @@ void DocumentExporter::captureSamples(Samples& samples)
 
 Document* DocumentExporter::createEmptyTexture(const Samples& samples)
 {
+  base::profiler::ScopedTimer timer("exporter", "DocumentExporter::createEmptyTexture");
+
   Palette* palette = NULL;
   PixelFormat pixelFormat = IMAGE_INDEXED;
   gfx::Rect fullTextureBounds(0, 0, m_textureWidth, m_textureHeight);
@@ -606,6 +624,8 @@ Document* DocumentExporter::createEmptyTexture(const Samples& samples)
 
 void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage)
 {
+  base::profiler::ScopedTimer timer("exporter", "DocumentExporter::renderTexture");
+
   textureImage->clear(0);
 
   for (const auto& sample : samples) {
@@ -618,7 +638,7 @@ void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage
       cmd::SetPixelFormat(
         sample.sprite(),
         textureImage->pixelFormat(),
-        DitheringMethod::NONE).execute(UIContext::instance());
+        DitheringMethod::NONE).execute(context());
     }
 
     renderSample(sample, textureImage,
@@ -629,6 +649,8 @@ void DocumentExporter::renderTexture(const Samples& samples, Image* textureImage
 
 void DocumentExporter::createDataFile(const Samples& samples, std::ostream& os, Image* textureImage)
 {
+  base::profiler::ScopedTimer timer("exporter", "DocumentExporter::createDataFile");
+
   std::string frames_begin;
   std::string frames_end;
   bool filename_as_key = false;
@@ -808,4 +830,9 @@ void DocumentExporter::renderSample(const Sample& sample, doc::Image* dst, int x
   }
 }
 
+Context* DocumentExporter::context() const
+{
+  return (m_ctx ? m_ctx: UIContext::instance());
+}
+
 } // namespace app
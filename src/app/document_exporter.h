@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -25,6 +25,7 @@ namespace doc {
 }
 
 namespace app {
+  class Context;
   class Document;
 
   class DocumentExporter {
@@ -64,6 +65,14 @@ namespace app {
     void setListFrameTags(bool value) { m_listFrameTags = value; }
     void setListLayers(bool value) { m_listLayers = value; }
 
+    // Context used to save the texture and show errors (by default
+    // it's the UIContext).
+    void setContext(Context* ctx) { m_ctx = ctx; }
+
+    // Stream where the metadata is written when there is no data
+    // filename (by default it's std::cout in batch mode).
+    void setDataOutput(std::ostream* os) { m_dataOutput = os; }
+
     void addDocument(Document* document,
                      doc::Layer* layer = nullptr,
                      doc::FrameTag* tag = nullptr,
@@ -71,6 +80,9 @@ namespace app {
       m_documents.push_back(Item(document, layer, tag, temporalTag));
     }
 
+    // Returns the texture document, or nullptr if there is nothing
+    // to export or the texture cannot be saved (the error is
+    // reported in the console of the context).
     Document* exportSheet();
 
   private:
@@ -85,6 +97,7 @@ namespace app {
     void renderTexture(const Samples& samples, doc::Image* textureImage);
     void createDataFile(const Samples& samples, std::ostream& os, doc::Image* textureImage);
     void renderSample(const Sample& sample, doc::Image* dst, int x, int y);
+    Context* context() const;
 
     class Item {
     public:
@@ -126,6 +139,8 @@ namespace app {
     doc::ImageBufferPtr m_sampleRenderBuf;
     bool m_listFrameTags;
     bool m_listLayers;
+    Context* m_ctx;
+    std::ostream* m_dataOutput;
 
     DISABLE_COPYING(DocumentExporter);
   };
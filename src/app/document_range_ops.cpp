@@ -46,9 +46,11 @@ static DocumentRange drop_range_op(
       break;
     case DocumentRange::kFrames:
       if (op == Move) {
-        if ((to.frameBegin() >= from.frameBegin() && to.frameEnd() <= from.frameEnd()) ||
-            (place == kDocumentRangeBefore && to.frameBegin() == from.frameEnd()+1) ||
-            (place == kDocumentRangeAfter && to.frameEnd() == from.frameBegin()-1))
+        // Moving the frames before one of them (or before the next
+        // frame) doesn't change anything.
+        frame_t beforeFrame = (place == kDocumentRangeBefore ? to.frameBegin(): to.frameEnd()+1);
+        if (beforeFrame >= from.frameBegin() &&
+            beforeFrame <= from.frameEnd()+1)
           return from;
       }
       break;
@@ -166,92 +168,20 @@ static DocumentRange drop_range_op(
 
       case DocumentRange::kFrames:
         {
-          frame_t srcFrameBegin = 0, srcFrameStep, srcFrameEnd = 0;
-          frame_t dstFrameBegin = 0, dstFrameStep;
+          frame_t beforeFrame = (place == kDocumentRangeBefore ?
+                                 to.frameBegin(): to.frameEnd()+1);
 
+          // The whole range is moved/copied at once (only the frames
+          // permutation is stored in the undo history).
           switch (op) {
-
             case Move:
-              if (place == kDocumentRangeBefore) {
-                if (to.frameBegin() <= from.frameBegin()) {
-                  srcFrameBegin = from.frameBegin();
-                  srcFrameStep = frame_t(1);
-                  srcFrameEnd = from.frameEnd()+1;
-                  dstFrameBegin = to.frameBegin();
-                  dstFrameStep = frame_t(1);
-                }
-                else {
-                  srcFrameBegin = from.frameEnd();
-                  srcFrameStep = frame_t(-1);
-                  srcFrameEnd = from.frameBegin()-1;
-                  dstFrameBegin = to.frameBegin();
-                  dstFrameStep = frame_t(-1);
-                }
-              }
-              else if (place == kDocumentRangeAfter) {
-                if (to.frameEnd() <= from.frameBegin()) {
-                  srcFrameBegin = from.frameBegin();
-                  srcFrameStep = frame_t(1);
-                  srcFrameEnd = from.frameEnd()+1;
-                  dstFrameBegin = to.frameEnd()+1;
-                  dstFrameStep = frame_t(1);
-                }
-                else {
-                  srcFrameBegin = from.frameEnd();
-                  srcFrameStep = frame_t(-1);
-                  srcFrameEnd = from.frameBegin()-1;
-                  dstFrameBegin = to.frameEnd()+1;
-                  dstFrameStep = frame_t(-1);
-                }
-              }
+              api.moveFrames(sprite, from.frameBegin(), from.frameEnd(), beforeFrame);
               break;
-
             case Copy:
-              if (place == kDocumentRangeBefore) {
-                if (to.frameBegin() <= from.frameBegin()) {
-                  srcFrameBegin = from.frameBegin();
-                  srcFrameStep = frame_t(2);
-                  srcFrameEnd = from.frameBegin() + 2*from.frames();
-                  dstFrameBegin = to.frameBegin();
-                  dstFrameStep = frame_t(1);
-                }
-                else {
-                  srcFrameBegin = from.frameEnd();
-                  srcFrameStep = frame_t(-1);
-                  srcFrameEnd = from.frameBegin()-1;
-                  dstFrameBegin = to.frameBegin();
-                  dstFrameStep = frame_t(0);
-                }
-              }
-              else if (place == kDocumentRangeAfter) {
-                if (to.frameEnd() <= from.frameBegin()) {
-                  srcFrameBegin = from.frameBegin();
-                  srcFrameStep = frame_t(2);
-                  srcFrameEnd = from.frameBegin() + 2*from.frames();
-                  dstFrameBegin = to.frameEnd()+1;
-                  dstFrameStep = frame_t(1);
-                }
-                else {
-                  srcFrameBegin = from.frameEnd();
-                  srcFrameStep = frame_t(-1);
-                  srcFrameEnd = from.frameBegin()-1;
-                  dstFrameBegin = to.frameEnd()+1;
-                  dstFrameStep = frame_t(0);
-                }
-              }
+              api.copyFrames(sprite, from.frameBegin(), from.frameEnd(), beforeFrame);
               break;
           }
 
-          for (frame_t srcFrame = srcFrameBegin,
-                 dstFrame = dstFrameBegin; srcFrame != srcFrameEnd; ) {
-            switch (op) {
-              case Move: api.moveFrame(sprite, srcFrame, dstFrame); break;
-              case Copy: api.copyFrame(sprite, srcFrame, dstFrame); break;
-            }
-            srcFrame += srcFrameStep;
-            dstFrame += dstFrameStep;
-          }
-
           if (place == kDocumentRangeBefore) {
             resultRange.startRange(LayerIndex::NoLayer, frame_t(to.frameBegin()), from.type());
             resultRange.endRange(LayerIndex::NoLayer, frame_t(to.frameBegin()+from.frames()-1));
@@ -378,11 +308,7 @@ void reverse_frames(Document* doc, const DocumentRange& range)
   }
 
   if (moveFrames) {
-    for (frame_t frameRev = frameEnd+1;
-         frameRev > frameBegin;
-         --frameRev) {
-      api.moveFrame(sprite, frameBegin, frameRev);
-    }
+    api.reverseFrames(sprite, frameBegin, frameEnd);
   }
   else if (swapCels) {
     std::vector<Layer*> layers;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -839,6 +839,45 @@ TEST_F(DocRangeOps, ReverseFrames) {
   EXPECT_FRAME_ORDER(0, 1, 2, 3);
 }
 
+TEST_F(DocRangeOps, FrameTags) {
+  FrameTag* tag = new FrameTag(1, 2);
+  sprite->frameTags().add(tag);
+
+  // Move one frame after the tag
+  move_range(doc,
+    frames_range(0),
+    frames_range(2), kDocumentRangeAfter);
+  EXPECT_FRAME_ORDER(1, 2, 0, 3);
+  EXPECT_EQ(0, tag->fromFrame());
+  EXPECT_EQ(1, tag->toFrame());
+
+  doc->undoHistory()->undo();
+  EXPECT_FRAME_ORDER(0, 1, 2, 3);
+  EXPECT_EQ(1, tag->fromFrame());
+  EXPECT_EQ(2, tag->toFrame());
+
+  // Reversing frames doesn't change tags
+  reverse_frames(doc, frames_range(0, 3));
+  EXPECT_FRAME_ORDER(3, 2, 1, 0);
+  EXPECT_EQ(1, tag->fromFrame());
+  EXPECT_EQ(2, tag->toFrame());
+
+  doc->undoHistory()->undo();
+  EXPECT_FRAME_ORDER(0, 1, 2, 3);
+
+  copy_range(doc,
+    frames_range(0),
+    frames_range(1), kDocumentRangeBefore);
+  EXPECT_FRAME_COPY1(0, 0, 1, 2, 3);
+  EXPECT_EQ(2, tag->fromFrame());
+  EXPECT_EQ(3, tag->toFrame());
+
+  doc->undoHistory()->undo();
+  EXPECT_FRAME_ORDER(0, 1, 2, 3);
+  EXPECT_EQ(1, tag->fromFrame());
+  EXPECT_EQ(2, tag->toFrame());
+}
+
 TEST_F(DocRangeOps, ReverseCels) {
   // TODO
 }
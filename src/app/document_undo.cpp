@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -16,6 +16,7 @@
 #include "app/cmd_transaction.h"
 #include "app/document_undo_observer.h"
 #include "app/pref/preferences.h"
+#include "base/profiler.h"
 #include "doc/context.h"
 #include "undo/undo_history.h"
 #include "undo/undo_state.h"
@@ -47,6 +48,10 @@ void DocumentUndo::add(CmdTransaction* cmd)
     clearRedo();
   }
 
+  // memSize() iterates all the commands of the transaction
+  if (base::profiler::is_enabled())
+    base::profiler::add_counter("undo", "DocumentUndo::add (bytes)", cmd->memSize());
+
   m_undoHistory.add(cmd);
   notifyObservers(&DocumentUndoObserver::onAddUndoState, this);
 }
@@ -63,12 +68,16 @@ bool DocumentUndo::canRedo() const
 
 void DocumentUndo::undo()
 {
+  base::profiler::ScopedTimer timer("undo", "DocumentUndo::undo");
+
   m_undoHistory.undo();
   notifyObservers(&DocumentUndoObserver::onAfterUndo, this);
 }
 
 void DocumentUndo::redo()
 {
+  base::profiler::ScopedTimer timer("undo", "DocumentUndo::redo");
+
   m_undoHistory.redo();
   notifyObservers(&DocumentUndoObserver::onAfterRedo, this);
 }
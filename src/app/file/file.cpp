@@ -25,6 +25,7 @@
 #include "base/fs.h"
 #include "base/mutex.h"
 #include "base/path.h"
+#include "base/profiler.h"
 #include "base/scoped_lock.h"
 #include "base/shared_ptr.h"
 #include "base/string.h"
@@ -489,6 +490,8 @@ void FileOp::operate(IFileOpProgress* progress)
 {
   ASSERT(!isDone());
 
+  base::profiler::ScopedTimer timer("file", "FileOp::operate", m_filename);
+
   m_progressInterface = progress;
 
   // Load //////////////////////////////////////////////////////////////////////
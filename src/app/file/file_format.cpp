@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -10,7 +10,10 @@
 #endif
 
 #include "app/file/file_format.h"
+
+#include "app/file/file.h"
 #include "app/file/format_options.h"
+#include "base/profiler.h"
 
 #include <algorithm>
 
@@ -37,6 +40,7 @@ const char* FileFormat::extensions() const
 bool FileFormat::load(FileOp* fop)
 {
   ASSERT(support(FILE_SUPPORT_LOAD));
+  base::profiler::ScopedTimer timer("file", "FileFormat::load", fop->filename());
   return onLoad(fop);
 }
 
@@ -44,6 +48,7 @@ bool FileFormat::load(FileOp* fop)
 bool FileFormat::save(FileOp* fop)
 {
   ASSERT(support(FILE_SUPPORT_SAVE));
+  base::profiler::ScopedTimer timer("file", "FileFormat::save", fop->filename());
   return onSave(fop);
 }
 #endif
@@ -0,0 +1,154 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "app/context.h"
+#include "app/document.h"
+#include "app/file/file.h"
+#include "app/file/file_formats_manager.h"
+#include "base/fs.h"
+#include "base/path.h"
+#include "doc/doc.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+// Formats to compare (PNG files are saved with one frame only, as
+// more frames would generate a sequence of files).
+static const char* kFilenames[] = {
+  "file_formats_benchmark.ase",
+  "file_formats_benchmark.png",
+  "file_formats_benchmark.gif",
+};
+
+// Fills the image with flat color areas and some noise (similar to
+// the content of a sprite frame).
+static void fill_image(Image* image, frame_t frame)
+{
+  const int w = image->width();
+  const int h = image->height();
+  std::srand(w*h + frame);
+  for (int y=0; y<h; y+=16) {
+    for (int x=0; x<w; x+=16) {
+      color_t c = rgba(std::rand()%256, std::rand()%256, std::rand()%256,
+                       (std::rand()%4) ? 255: 0);
+      fill_rect(image, x, y, x+15, y+15, c);
+    }
+  }
+  for (int i=0; i<w*h/32; ++i)
+    put_pixel(image, std::rand()%w, std::rand()%h, rgba(0, 0, 0, 255));
+}
+
+static doc::Document* create_document(app::Context* ctx,
+                                      const char* filename,
+                                      int w, int h, frame_t nframes)
+{
+  doc::Document* doc = ctx->documents().add(w, h, doc::ColorMode::RGB);
+  doc->setFilename(filename);
+
+  Sprite* sprite = doc->sprite();
+  LayerImage* layer = static_cast<LayerImage*>(sprite->folder()->getFirstLayer());
+  fill_image(layer->cel(0)->image(), 0);
+
+  sprite->setTotalFrames(nframes);
+  for (frame_t frame=1; frame<nframes; ++frame) {
+    ImageRef image(Image::create(IMAGE_RGB, w, h));
+    fill_image(image.get(), frame);
+    layer->addCel(new Cel(frame, image));
+  }
+  return doc;
+}
+
+static void destroy_document(doc::Document* doc)
+{
+  doc->close();
+  delete doc;
+}
+
+static std::string file_size_label(const char* filename)
+{
+  char buf[256];
+  std::sprintf(buf, "%s %d KB",
+               base::get_file_extension(filename).c_str(),
+               int(base::file_size(filename) / 1024));
+  return buf;
+}
+
+// Args: format (index in kFilenames), sprite size, number of frames
+static void BM_SaveDocument(benchmark::State& state)
+{
+  const char* filename = kFilenames[state.range(0)];
+  const int w = state.range(1);
+  const int h = state.range(1);
+  const frame_t nframes = state.range(2);
+
+  FileFormatsManager::instance()->registerAllFormats();
+  app::Context ctx;
+  doc::Document* doc = create_document(&ctx, filename, w, h, nframes);
+
+  while (state.KeepRunning())
+    save_document(&ctx, doc);
+
+  state.SetBytesProcessed(state.iterations() * w * h * 4 * nframes);
+  state.SetLabel(file_size_label(filename).c_str());
+
+  destroy_document(doc);
+  base::delete_file(filename);
+}
+
+static void BM_LoadDocument(benchmark::State& state)
+{
+  const char* filename = kFilenames[state.range(0)];
+  const int w = state.range(1);
+  const int h = state.range(1);
+  const frame_t nframes = state.range(2);
+
+  FileFormatsManager::instance()->registerAllFormats();
+  app::Context ctx;
+  {
+    doc::Document* doc = create_document(&ctx, filename, w, h, nframes);
+    save_document(&ctx, doc);
+    destroy_document(doc);
+  }
+
+  while (state.KeepRunning()) {
+    app::Document* doc = load_document(&ctx, filename);
+    destroy_document(doc);
+  }
+
+  state.SetBytesProcessed(state.iterations() * w * h * 4 * nframes);
+  state.SetLabel(file_size_label(filename).c_str());
+
+  base::delete_file(filename);
+}
+
+BENCHMARK(BM_SaveDocument)
+  ->Args({ 0, 256, 16 })
+  ->Args({ 0, 1024, 1 })
+  ->Args({ 1, 1024, 1 })
+  ->Args({ 2, 256, 16 })
+  ->Args({ 2, 1024, 1 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_LoadDocument)
+  ->Args({ 0, 256, 16 })
+  ->Args({ 0, 1024, 1 })
+  ->Args({ 1, 1024, 1 })
+  ->Args({ 2, 256, 16 })
+  ->Args({ 2, 1024, 1 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
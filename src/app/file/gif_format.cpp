@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -18,10 +18,14 @@
 #include "app/file/gif_options.h"
 #include "app/ini_file.h"
 #include "app/modules/gui.h"
-#include "app/util/autocrop.h"
+#include "base/bind.h"
 #include "base/file_handle.h"
 #include "base/fs.h"
+#include "base/mutex.h"
+#include "base/scoped_lock.h"
+#include "base/thread.h"
 #include "base/unique_ptr.h"
+#include "doc/algorithm/shrink_bounds.h"
 #include "doc/doc.h"
 #include "render/quantization.h"
 #include "render/render.h"
@@ -32,6 +36,11 @@
 
 #include <gif_lib.h>
 
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <vector>
+
 #ifdef _WIN32
   #include <io.h>
   #define posix_lseek  _lseek
@@ -813,6 +822,10 @@ bool GifFormat::onLoad(FileOp* fop)
 
 #ifdef ENABLE_SAVE
 
+// Maximum number of frames that are rendered (or quantized) in
+// advance by the worker threads.
+static const int kMaxFramesAhead = 16;
+
 class GifEncoder {
 public:
   GifEncoder(FileOp* fop, GifFileType* gifFile)
@@ -823,7 +836,10 @@ public:
     , m_hasBackground(m_sprite->backgroundLayer() ? true: false)
     , m_bitsPerPixel(1)
     , m_globalColormap(nullptr)
-    , m_quantizeColormaps(false) {
+    , m_quantizeColormaps(false)
+    , m_nextFrameToWrite(0)
+    , m_done(false)
+    , m_failed(false) {
     if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
       for (Palette* palette : m_sprite->getPalettes()) {
         int bpp = GifBitSizeLimited(palette->size());
@@ -873,40 +889,56 @@ public:
     const base::SharedPtr<GifOptions> gifOptions = fop->sequenceGetFormatOptions();
     m_interlaced = gifOptions->interlaced();
     m_loop = (gifOptions->loop() ? 0: -1);
-
-    for (int i=0; i<3; ++i)
-      m_images[i].reset(Image::create(IMAGE_RGB,
-                                      m_spriteBounds.w,
-                                      m_spriteBounds.h));
   }
 
   ~GifEncoder() {
+    stopWorkers();
+
+    for (Frame* frame : m_frames)
+      delete frame;
+
     if (m_globalColormap)
       GifFreeMapObject(m_globalColormap);
   }
 
+  // Frames are rendered and quantized in worker threads (and in this
+  // same thread while it waits for them) some frames ahead. The
+  // frame bounds/disposal method (which depend on the previous
+  // disposed frame) and the LZW compression of each frame are
+  // processed in order in this thread.
   bool encode() {
     writeHeader();
     if (m_loop >= 0)
       writeLoopExtension();
 
-    // Previous and next images are used to decide the best disposal
-    // method (e.g. if it's more convenient to restore the background
-    // color or to restore the previous frame to reach the next one).
-    m_previousImage = m_images[0].get();
-    m_currentImage = m_images[1].get();
-    m_nextImage = m_images[2].get();
+    const int nframes = m_sprite->totalFrames();
+    const int nthreads = MID(1, base::thread::hardware_concurrency(), 8);
+    const int framesAhead = MID(2, 2*nthreads, kMaxFramesAhead);
+    startWorkers(nthreads-1);
+
+    // The previous frame (after its disposal method) is used to
+    // calculate the bounds of the current frame.
+    m_previousImageRef.reset(Image::create(IMAGE_RGB,
+                                           m_spriteBounds.w,
+                                           m_spriteBounds.h));
+    clear_image(m_previousImageRef.get(), m_clearColor);
 
-    int nframes = m_sprite->totalFrames();
+    int nextFrameToRender = 0;
     for (int frameNum=0; frameNum<nframes; ++frameNum) {
-      if (frameNum == 0)
-        renderFrame(0, m_nextImage);
-      else if (frameNum > 0)
-        std::swap(m_previousImage, m_currentImage);
+      for (; nextFrameToRender < nframes &&
+             nextFrameToRender <= frameNum+framesAhead; ++nextFrameToRender) {
+        addFrame(nextFrameToRender);
+      }
 
-      std::swap(m_currentImage, m_nextImage);
-      if (frameNum+1 < nframes)
-        renderFrame(frameNum+1, m_nextImage);
+      // Previous and next images are used to decide the best disposal
+      // method (e.g. if it's more convenient to restore the background
+      // color or to restore the previous frame to reach the next one).
+      Frame* current = waitFrame(frameNum, FrameState::Rendered);
+      Frame* next = (frameNum+1 < nframes ?
+                     waitFrame(frameNum+1, FrameState::Rendered): nullptr);
+      m_previousImage = m_previousImageRef.get();
+      m_currentImage = current->image.get();
+      m_nextImage = (next ? next->image.get(): nullptr);
 
       gfx::Rect frameBounds;
       DisposalMethod disposal;
@@ -917,7 +949,8 @@ public:
       if (frameBounds.isEmpty())
         frameBounds = gfx::Rect(0, 0, 1, 1);
 
-      writeImage(frameNum, frameBounds, disposal);
+      // Only the frameBounds pixels are quantized (in background)
+      UniquePtr<Image> framePixels(crop_image(m_currentImage, frameBounds, 0));
 
       // Dispose/clear frame content
       process_disposal_method(m_previousImage,
@@ -926,13 +959,53 @@ public:
                               frameBounds,
                               m_clearColor);
 
-      m_fop->setProgress(double(frameNum+1) / double(nframes));
+      {
+        base::scoped_lock lock(m_mutex);
+        m_previousImageRef.reset(current->image.release());
+        current->image.reset(framePixels.release());
+        current->bounds = frameBounds;
+        current->disposal = disposal;
+        current->state = FrameState::ToQuantize;
+      }
+      m_frameStateChanged.notify_all();
+
+      // Write the frames that are ready (or wait the oldest one if
+      // there are too many frames waiting to be written)
+      writeFrames(frameNum-framesAhead);
     }
+    writeFrames(nframes-1);
     return true;
   }
 
 private:
 
+  enum class FrameState {
+    ToRender,
+    Rendering,
+    Rendered,
+    ToQuantize,
+    Quantizing,
+    Quantized,
+  };
+
+  struct Frame {
+    frame_t frame;
+    FrameState state;
+    // Rendered frame, or pixels inside "bounds" after that.
+    UniquePtr<Image> image;
+    gfx::Rect bounds;
+    DisposalMethod disposal;
+    // Local palette of the frame (nullptr to use the global one)
+    UniquePtr<Palette> palette;
+    int transparentIndex;
+
+    Frame(frame_t frame)
+      : frame(frame)
+      , state(FrameState::ToRender)
+      , transparentIndex(-1) {
+    }
+  };
+
   void writeHeader() {
     if (EGifPutScreenDesc(m_gifFile,
                           m_spriteBounds.w,
@@ -995,17 +1068,10 @@ private:
       throw Exception("Error writing GIF graphics extension record for frame %d.\n", (int)frameNum);
   }
 
-  static gfx::Rect calculateFrameBounds(Image* a, Image* b) {
+  static gfx::Rect calculateFrameBounds(const Image* a, const Image* b) {
     gfx::Rect frameBounds;
-    int x1, y1, x2, y2;
-
-    if (get_shrink_rect2(&x1, &y1, &x2, &y2, a, b)) {
-      frameBounds.x = x1;
-      frameBounds.y = y1;
-      frameBounds.w = x2 - x1 + 1;
-      frameBounds.h = y2 - y1 + 1;
-    }
-
+    if (!doc::algorithm::shrink_bounds2(a, b, a->bounds(), frameBounds))
+      frameBounds = gfx::Rect();
     return frameBounds;
   }
 
@@ -1037,7 +1103,7 @@ private:
       // Special case were it's better to restore the previous frame
       // when we dispose the current one than clearing with the bg
       // color.
-      if (m_hasBackground && !prev.isEmpty()) {
+      if (m_hasBackground && !prev.isEmpty() && m_nextImage) {
         gfx::Rect prevNext = calculateFrameBounds(m_previousImage, m_nextImage);
         if (!prevNext.isEmpty() &&
             frameBounds.contains(prevNext) &&
@@ -1053,35 +1119,191 @@ private:
     }
   }
 
-  void writeImage(int frameNum, const gfx::Rect& frameBounds, DisposalMethod disposal) {
+  void startWorkers(int n) {
+    for (int i=0; i<n; ++i)
+      m_workers.push_back(
+        new base::thread(base::Bind<void>(&GifEncoder::workerThread, this)));
+  }
+
+  void stopWorkers() {
+    {
+      base::scoped_lock lock(m_mutex);
+      m_done = true;
+    }
+    m_frameStateChanged.notify_all();
+
+    for (base::thread* worker : m_workers) {
+      worker->join();
+      delete worker;
+    }
+    m_workers.clear();
+  }
+
+  void workerThread() {
+    while (true) {
+      Frame* frame = nullptr;
+      {
+        base::scoped_lock lock(m_mutex);
+        while (!m_done && !m_failed && !(frame = nextFrameToProcess()))
+          m_frameStateChanged.wait(m_mutex);
+        if (!frame)
+          return;
+      }
+
+      try {
+        processFrame(frame);
+      }
+      catch (const std::exception& ex) {
+        setFailed(ex.what());
+        return;
+      }
+      catch (...) {
+        setFailed("Error encoding GIF frame.\n");
+        return;
+      }
+    }
+  }
+
+  // The error is thrown again in the main thread by waitFrame().
+  void setFailed(const std::string& error) {
+    {
+      base::scoped_lock lock(m_mutex);
+      if (!m_failed) {
+        m_failed = true;
+        m_error = error;
+      }
+    }
+    m_frameStateChanged.notify_all();
+  }
+
+  void addFrame(frame_t frameNum) {
+    {
+      base::scoped_lock lock(m_mutex);
+      m_frames.push_back(new Frame(frameNum));
+    }
+    m_frameStateChanged.notify_all();
+  }
+
+  Frame* findFrame(frame_t frameNum) {
+    ASSERT(!m_frames.empty());
+    return m_frames[frameNum - m_frames.front()->frame];
+  }
+
+  // Returns the next frame that must be rendered or quantized (from
+  // the oldest one) changing its state, or nullptr if there is
+  // nothing to do. m_mutex must be locked.
+  Frame* nextFrameToProcess() {
+    for (Frame* f : m_frames) {
+      if (f->state == FrameState::ToRender) {
+        f->state = FrameState::Rendering;
+        return f;
+      }
+      else if (f->state == FrameState::ToQuantize) {
+        f->state = FrameState::Quantizing;
+        return f;
+      }
+    }
+    return nullptr;
+  }
+
+  void processFrame(Frame* frame) {
+    if (frame->state == FrameState::Rendering) {
+      Image* image = Image::create(IMAGE_RGB,
+                                   m_spriteBounds.w,
+                                   m_spriteBounds.h);
+      frame->image.reset(image);
+      renderFrame(frame->frame, image);
+
+      base::scoped_lock lock(m_mutex);
+      frame->state = FrameState::Rendered;
+    }
+    else {
+      quantizeFrame(frame);
+
+      base::scoped_lock lock(m_mutex);
+      frame->state = FrameState::Quantized;
+    }
+    m_frameStateChanged.notify_all();
+  }
+
+  // Waits until the given frame reaches the given state processing
+  // other frames in the meantime.
+  Frame* waitFrame(frame_t frameNum, FrameState state) {
+    while (true) {
+      Frame* other;
+      {
+        base::scoped_lock lock(m_mutex);
+        while (true) {
+          if (m_failed)
+            throw Exception(m_error);
+
+          Frame* frame = findFrame(frameNum);
+          if (frame->state == state)
+            return frame;
+
+          other = nextFrameToProcess();
+          if (other)
+            break;
+
+          m_frameStateChanged.wait(m_mutex);
+        }
+      }
+      processFrame(other);
+    }
+  }
+
+  // Writes the frames that are already quantized, and waits for all
+  // frames until "untilFrame" (inclusive).
+  void writeFrames(frame_t untilFrame) {
+    const int nframes = m_sprite->totalFrames();
+
+    while (m_nextFrameToWrite < nframes) {
+      Frame* frame;
+      if (m_nextFrameToWrite <= untilFrame)
+        frame = waitFrame(m_nextFrameToWrite, FrameState::Quantized);
+      else {
+        base::scoped_lock lock(m_mutex);
+        if (m_frames.empty() ||
+            m_frames.front()->state != FrameState::Quantized)
+          break;
+        frame = m_frames.front();
+      }
+
+      ASSERT(frame == m_frames.front());
+      writeImage(frame);
+      ++m_nextFrameToWrite;
+
+      {
+        base::scoped_lock lock(m_mutex);
+        m_frames.pop_front();
+      }
+      delete frame;
+
+      m_fop->setProgress(double(m_nextFrameToWrite) / double(nframes));
+    }
+  }
+
+  // Converts the pixels of frame->image (RGB) to the indexes that
+  // must be stored in the GIF file for this specific frame. It's
+  // called from worker threads.
+  void quantizeFrame(Frame* frame) {
     UniquePtr<Palette> framePaletteRef;
-    UniquePtr<RgbMap> rgbmapRef;
-    Palette* framePalette = m_sprite->palette(frameNum);
-    RgbMap* rgbmap = m_sprite->rgbMap(frameNum);
+    const Palette* framePalette = m_sprite->palette(frame->frame);
+    const Image* rgbImage = frame->image.get();
 
     // Create optimized palette for RGB/Grayscale images
     if (m_quantizeColormaps) {
-      framePaletteRef.reset(createOptimizedPalette(frameBounds));
+      framePaletteRef.reset(createOptimizedPalette(rgbImage));
       framePalette = framePaletteRef.get();
-
-      rgbmapRef.reset(new RgbMap);
-      rgbmap = rgbmapRef.get();
-      rgbmap->regenerate(framePalette, m_transparentIndex);
     }
 
-    // We will store the frameBounds pixels in frameImage, with the
-    // indexes that must be stored in the GIF file for this specific
-    // frame.
-    if (!m_frameImageBuf)
-      m_frameImageBuf.reset(new ImageBuffer);
+    RgbMap rgbmap;
+    rgbmap.regenerate(framePalette, m_transparentIndex);
 
-    ImageRef frameImage(Image::create(IMAGE_INDEXED,
-                                      frameBounds.w,
-                                      frameBounds.h,
-                                      m_frameImageBuf));
+    UniquePtr<Image> frameImage(Image::create(IMAGE_INDEXED,
+                                              rgbImage->width(),
+                                              rgbImage->height()));
 
-    // Convert the frameBounds area of m_currentImage (RGB) to frameImage (Indexed)
-    // bool needsTransparent = false;
     PalettePicks usedColors(framePalette->size());
 
     // If the sprite needs a transparent color we mark it as used so
@@ -1095,48 +1317,47 @@ private:
       usedColors[i] = true;
     }
 
-    {
-      LockImageBits<RgbTraits> bits(m_currentImage, frameBounds);
-      auto it = bits.begin();
-      for (int y=0; y<frameBounds.h; ++y) {
-        for (int x=0; x<frameBounds.w; ++x, ++it) {
-          ASSERT(it != bits.end());
-
-          color_t color = *it;
-          int i;
-
-          if (rgba_geta(color) >= 128) {
-            i = framePalette->findExactMatch(
-              rgba_getr(color),
-              rgba_getg(color),
-              rgba_getb(color),
-              255,
-              m_transparentIndex);
-            if (i < 0)
-              i = rgbmap->mapColor(rgba_getr(color),
-                                   rgba_getg(color),
-                                   rgba_getb(color),
-                                   255);
-          }
-          else {
-            ASSERT(m_transparentIndex >= 0);
-            if (m_transparentIndex >= 0)
-              i = m_transparentIndex;
-            else
-              i = m_bgIndex;
-          }
+    for (int y=0; y<rgbImage->height(); ++y) {
+      const RgbTraits::pixel_t* src =
+        (const RgbTraits::pixel_t*)rgbImage->getPixelAddress(0, y);
+      IndexedTraits::address_t dst =
+        (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
+
+      for (int x=0; x<rgbImage->width(); ++x, ++src, ++dst) {
+        color_t color = *src;
+        int i;
+
+        if (rgba_geta(color) >= 128) {
+          i = framePalette->findExactMatch(
+            rgba_getr(color),
+            rgba_getg(color),
+            rgba_getb(color),
+            255,
+            m_transparentIndex);
+          if (i < 0)
+            i = rgbmap.mapColor(rgba_getr(color),
+                                rgba_getg(color),
+                                rgba_getb(color),
+                                255);
+        }
+        else {
+          ASSERT(m_transparentIndex >= 0);
+          if (m_transparentIndex >= 0)
+            i = m_transparentIndex;
+          else
+            i = m_bgIndex;
+        }
 
-          ASSERT(i >= 0);
+        ASSERT(i >= 0);
 
-          // This can happen when transparent color is outside the
-          // palette range (TODO something that shouldn't be possible
-          // from the program).
-          if (i >= usedColors.size())
-            usedColors.resize(i+1);
-          usedColors[i] = true;
+        // This can happen when transparent color is outside the
+        // palette range (TODO something that shouldn't be possible
+        // from the program).
+        if (i >= usedColors.size())
+          usedColors.resize(i+1);
+        usedColors[i] = true;
 
-          put_pixel_fast<IndexedTraits>(frameImage.get(), x, y, i);
-        }
+        *dst = i;
       }
     }
 
@@ -1147,19 +1368,18 @@ private:
       remap.map(i, i);
 
     int localTransparent = m_transparentIndex;
-    ColorMapObject* colormap = m_globalColormap;
-    if (!colormap) {
-      Palette reducedPalette(frameNum, usedNColors);
+    if (!m_globalColormap) {
+      Palette* reducedPalette = new Palette(frame->frame, usedNColors);
+      frame->palette.reset(reducedPalette);
 
       for (int i=0, j=0; i<framePalette->size(); ++i) {
         if (usedColors[i]) {
-          reducedPalette.setEntry(j, framePalette->getEntry(i));
+          reducedPalette->setEntry(j, framePalette->getEntry(i));
           remap.map(i, j);
           ++j;
         }
       }
 
-      colormap = createColorMap(&reducedPalette);
       if (localTransparent >= 0)
         localTransparent = remap[localTransparent];
     }
@@ -1167,8 +1387,29 @@ private:
     if (localTransparent >= 0 && m_transparentIndex != localTransparent)
       remap.map(m_transparentIndex, localTransparent);
 
+    for (int y=0; y<frameImage->height(); ++y) {
+      IndexedTraits::address_t addr =
+        (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
+
+      for (int x=0; x<frameImage->width(); ++x, ++addr)
+        *addr = remap[*addr];
+    }
+
+    frame->image.reset(frameImage.release());
+    frame->transparentIndex = localTransparent;
+  }
+
+  void writeImage(const Frame* frame) {
+    const frame_t frameNum = frame->frame;
+    const gfx::Rect& frameBounds = frame->bounds;
+    const Image* frameImage = frame->image.get();
+
+    ColorMapObject* colormap = m_globalColormap;
+    if (frame->palette)
+      colormap = createColorMap(frame->palette.get());
+
     // Write extension record.
-    writeExtension(frameNum, localTransparent, disposal);
+    writeExtension(frameNum, frame->transparentIndex, frame->disposal);
 
     // Write the image record.
     if (EGifPutImageDesc(m_gifFile,
@@ -1176,49 +1417,39 @@ private:
                          frameBounds.w, frameBounds.h,
                          m_interlaced ? 1: 0,
                          (colormap != m_globalColormap ? colormap: nullptr)) == GIF_ERROR) {
+      if (colormap != m_globalColormap)
+        GifFreeMapObject(colormap);
       throw Exception("Error writing GIF frame %d.\n", (int)frameNum);
     }
 
-    std::vector<uint8_t> scanline(frameBounds.w);
+    if (colormap != m_globalColormap)
+      GifFreeMapObject(colormap);
 
     // Write the image data (pixels).
     if (m_interlaced) {
       // Need to perform 4 passes on the images.
       for (int i=0; i<4; ++i)
         for (int y=interlaced_offset[i]; y<frameBounds.h; y+=interlaced_jumps[i]) {
-          IndexedTraits::address_t addr =
-            (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
-
-          for (int i=0; i<frameBounds.w; ++i, ++addr)
-            scanline[i] = remap[*addr];
-
-          if (EGifPutLine(m_gifFile, &scanline[0], frameBounds.w) == GIF_ERROR)
+          GifPixelType* addr = (GifPixelType*)frameImage->getPixelAddress(0, y);
+          if (EGifPutLine(m_gifFile, addr, frameBounds.w) == GIF_ERROR)
             throw Exception("Error writing GIF image scanlines for frame %d.\n", (int)frameNum);
         }
     }
     else {
       // Write all image scanlines (not interlaced in this case).
       for (int y=0; y<frameBounds.h; ++y) {
-        IndexedTraits::address_t addr =
-          (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
-
-        for (int i=0; i<frameBounds.w; ++i, ++addr)
-          scanline[i] = remap[*addr];
-
-        if (EGifPutLine(m_gifFile, &scanline[0], frameBounds.w) == GIF_ERROR)
+        GifPixelType* addr = (GifPixelType*)frameImage->getPixelAddress(0, y);
+        if (EGifPutLine(m_gifFile, addr, frameBounds.w) == GIF_ERROR)
           throw Exception("Error writing GIF image scanlines for frame %d.\n", (int)frameNum);
       }
     }
-
-    if (colormap && colormap != m_globalColormap)
-      GifFreeMapObject(colormap);
   }
 
-  Palette* createOptimizedPalette(const gfx::Rect& frameBounds) {
+  Palette* createOptimizedPalette(const Image* image) {
     render::PaletteOptimizer optimizer;
 
-    // Feed the palette optimizer with pixels inside frameBounds
-    for (const auto& color : LockImageBits<RgbTraits>(m_currentImage, frameBounds)) {
+    // Feed the palette optimizer with pixels of the frame
+    for (const auto& color : LockImageBits<RgbTraits>(image)) {
       if (rgba_geta(color) >= 128)
         optimizer.feedWithRgbaColor(
           rgba(rgba_getr(color),
@@ -1272,11 +1503,25 @@ private:
   bool m_quantizeColormaps;
   bool m_interlaced;
   int m_loop;
-  ImageBufferPtr m_frameImageBuf;
-  ImageRef m_images[3];
+  UniquePtr<Image> m_previousImageRef;
   Image* m_previousImage;
   Image* m_currentImage;
   Image* m_nextImage;
+
+  // Frames that aren't written yet (the first one is the next frame
+  // to be written).
+  std::deque<Frame*> m_frames;
+  frame_t m_nextFrameToWrite;
+  std::vector<base::thread*> m_workers;
+
+  // Protects m_frames (and the state of each frame), m_done, m_failed
+  // and m_error. m_frameStateChanged is notified each time a frame is
+  // added or its state changes (and when the workers must stop).
+  base::mutex m_mutex;
+  std::condition_variable_any m_frameStateChanged;
+  bool m_done;
+  bool m_failed;
+  std::string m_error;
 };
 
 bool GifFormat::onSave(FileOp* fop)
@@ -1302,7 +1547,7 @@ bool GifFormat::onSave(FileOp* fop)
 base::SharedPtr<FormatOptions> GifFormat::onGetFormatOptions(FileOp* fop)
 {
   base::SharedPtr<GifOptions> gif_options;
-  if (fop->document()->getFormatOptions())
+  if (dynamic_cast<GifOptions*>(fop->document()->getFormatOptions().get()))
     gif_options = base::SharedPtr<GifOptions>(fop->document()->getFormatOptions());
 
   if (!gif_options)
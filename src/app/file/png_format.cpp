@@ -14,10 +14,12 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/png_options.h"
 #include "app/ini_file.h"
 #include "base/file_handle.h"
 #include "doc/doc.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -40,13 +42,15 @@ class PngFormat : public FileFormat {
       FILE_SUPPORT_GRAYA |
       FILE_SUPPORT_INDEXED |
       FILE_SUPPORT_SEQUENCES |
-      FILE_SUPPORT_PALETTE_WITH_ALPHA;
+      FILE_SUPPORT_PALETTE_WITH_ALPHA |
+      FILE_SUPPORT_GET_FORMAT_OPTIONS;
   }
 
   bool onLoad(FileOp* fop) override;
 #ifdef ENABLE_SAVE
   bool onSave(FileOp* fop) override;
 #endif
+  base::SharedPtr<FormatOptions> onGetFormatOptions(FileOp* fop) override;
 };
 
 FileFormat* CreatePngFormat()
@@ -59,6 +63,72 @@ static void report_png_error(png_structp png_ptr, png_const_charp error)
   ((FileOp*)png_get_error_ptr(png_ptr))->setError("libpng: %s\n", error);
 }
 
+// Rows are read/written directly from/to the image rows: PNG pixels
+// are stored as R,G,B,A (or V,A) bytes, which is the memory layout
+// of doc::rgba() (or doc::graya()) values in little-endian machines.
+static bool is_little_endian()
+{
+  const uint16_t value = 1;
+  return (*((const uint8_t*)&value) == 1);
+}
+
+// Converts the R,G,B,A (or V,A) bytes read from the PNG file to
+// native doc::rgba() (or doc::graya()) values in big-endian machines.
+static void swap_row_bytes(Image* image, int y)
+{
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB: {
+      uint32_t* p = (uint32_t*)image->getPixelAddress(0, y);
+      for (int x=0; x<image->width(); ++x, ++p) {
+        const uint8_t* b = (const uint8_t*)p;
+        *p = rgba(b[0], b[1], b[2], b[3]);
+      }
+      break;
+    }
+    case IMAGE_GRAYSCALE: {
+      uint16_t* p = (uint16_t*)image->getPixelAddress(0, y);
+      for (int x=0; x<image->width(); ++x, ++p) {
+        const uint8_t* b = (const uint8_t*)p;
+        *p = graya(b[0], b[1]);
+      }
+      break;
+    }
+  }
+}
+
+// Makes transparent the pixels of the "y" row that match the tRNS
+// color. Returns true if some pixel was modified.
+static bool apply_transparent_color(Image* image, int y,
+                                    const png_color_16p trans)
+{
+  bool found = false;
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB: {
+      const color_t color = rgba(trans->red, trans->green, trans->blue, 255);
+      uint32_t* p = (uint32_t*)image->getPixelAddress(0, y);
+      for (int x=0; x<image->width(); ++x, ++p) {
+        if (*p == color) {
+          *p &= rgba_rgb_mask;
+          found = true;
+        }
+      }
+      break;
+    }
+    case IMAGE_GRAYSCALE: {
+      const color_t color = graya(trans->gray, 255);
+      uint16_t* p = (uint16_t*)image->getPixelAddress(0, y);
+      for (int x=0; x<image->width(); ++x, ++p) {
+        if (*p == color) {
+          *p &= graya_v_mask;
+          found = true;
+        }
+      }
+      break;
+    }
+  }
+  return found;
+}
+
 bool PngFormat::onLoad(FileOp* fop)
 {
   png_uint_32 width, height, y;
@@ -69,7 +139,6 @@ bool PngFormat::onLoad(FileOp* fop)
   int pass, number_passes;
   int num_palette;
   png_colorp palette;
-  png_bytepp rows_pointer;
   PixelFormat pixelFormat;
 
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
@@ -140,6 +209,13 @@ bool PngFormat::onLoad(FileOp* fop)
   if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
     png_set_expand_gray_1_2_4_to_8(png_ptr);
 
+  /* Add an opaque alpha byte to RGB and gray pixels so they have the
+   * same size as doc::rgba() and doc::graya() pixels.
+   */
+  if (color_type == PNG_COLOR_TYPE_RGB ||
+      color_type == PNG_COLOR_TYPE_GRAY)
+    png_set_filler(png_ptr, 0xff, PNG_FILLER_AFTER);
+
   /* Turn on interlace handling.  REQUIRED if you are not using
    * png_read_image().  To see how to handle interlacing passes,
    * see the png_read_row() method below:
@@ -226,112 +302,53 @@ bool PngFormat::onLoad(FileOp* fop)
     png_get_tRNS(png_ptr, info_ptr, nullptr, nullptr, &png_trans_color);
   }
 
-  // Allocate the memory to hold the image using the fields of info_ptr.
-  rows_pointer = (png_bytepp)png_malloc(png_ptr, sizeof(png_bytep) * height);
+  // The image rows must have the same size as the PNG rows (with
+  // the RGB/GRAY filler byte)
+  if (png_get_rowbytes(png_ptr, info_ptr) != (png_size_t)image->getRowStrideSize()) {
+    fop->setError("Unexpected PNG row size\n");
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    return false;
+  }
+
+  // Read the rows directly into the image (each pass of interlaced
+  // images completes the pixels read in previous passes)
+  png_bytepp rows_pointer =
+    (png_bytepp)png_malloc(png_ptr, sizeof(png_bytep) * height);
   for (y = 0; y < height; y++)
-    rows_pointer[y] = (png_bytep)png_malloc(png_ptr, png_get_rowbytes(png_ptr, info_ptr));
+    rows_pointer[y] = (png_bytep)image->getPixelAddress(0, y);
 
-  for (pass = 0; pass < number_passes; pass++) {
-    for (y = 0; y < height; y++) {
-      png_read_rows(png_ptr, rows_pointer+y, nullptr, 1);
+  // Update the progress each ~1% of the rows
+  const png_uint_32 progress_step = std::max<png_uint_32>(1, height / 100);
+
+  for (pass = 0; pass < number_passes && !fop->isStop(); pass++) {
+    for (y = 0; y < height; y += progress_step) {
+      png_uint_32 rows = std::min(progress_step, height - y);
+      png_read_rows(png_ptr, rows_pointer+y, nullptr, rows);
 
       fop->setProgress(
-        (double)((double)pass + (double)(y+1) / (double)(height))
+        (double)((double)pass + (double)(y+rows) / (double)(height))
         / (double)number_passes);
 
       if (fop->isStop())
         break;
     }
   }
+  png_free(png_ptr, rows_pointer);
 
-  // Convert rows_pointer into the doc::Image
-  for (y = 0; y < height; y++) {
-    // RGB_ALPHA
-    if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGB_ALPHA) {
-      uint8_t* src_address = rows_pointer[y];
-      uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
-      unsigned int x, r, g, b, a;
-
-      for (x=0; x<width; x++) {
-        r = *(src_address++);
-        g = *(src_address++);
-        b = *(src_address++);
-        a = *(src_address++);
-        *(dst_address++) = rgba(r, g, b, a);
-      }
-    }
-    // RGB
-    else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGB) {
-      uint8_t* src_address = rows_pointer[y];
-      uint32_t* dst_address = (uint32_t*)image->getPixelAddress(0, y);
-      unsigned int x, r, g, b, a;
-
-      for (x=0; x<width; x++) {
-        r = *(src_address++);
-        g = *(src_address++);
-        b = *(src_address++);
-
-        // Transparent color
-        if (png_trans_color &&
-            r == png_trans_color->red &&
-            g == png_trans_color->green &&
-            b == png_trans_color->blue) {
-          a = 0;
-          if (!fop->sequenceGetHasAlpha())
-            fop->sequenceSetHasAlpha(true);
-        }
-        else
-          a = 255;
-
-        *(dst_address++) = rgba(r, g, b, a);
-      }
-    }
-    // GRAY_ALPHA
-    else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY_ALPHA) {
-      uint8_t* src_address = rows_pointer[y];
-      uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
-      unsigned int x, k, a;
-
-      for (x=0; x<width; x++) {
-        k = *(src_address++);
-        a = *(src_address++);
-        *(dst_address++) = graya(k, a);
-      }
-    }
-    // GRAY
-    else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY) {
-      uint8_t* src_address = rows_pointer[y];
-      uint16_t* dst_address = (uint16_t*)image->getPixelAddress(0, y);
-      unsigned int x, k, a;
-
-      for (x=0; x<width; x++) {
-        k = *(src_address++);
-
-        // Transparent color
-        if (png_trans_color &&
-            k == png_trans_color->gray) {
-          a = 0;
-          if (!fop->sequenceGetHasAlpha())
-            fop->sequenceSetHasAlpha(true);
-        }
-        else
-          a = 255;
+  // Convert the PNG bytes into image pixels (only needed in
+  // big-endian machines and for the tRNS color)
+  if (pixelFormat != IMAGE_INDEXED) {
+    const bool swap = !is_little_endian();
+    for (y = 0; y < height; y++) {
+      if (swap)
+        swap_row_bytes(image, y);
 
-        *(dst_address++) = graya(k, a);
-      }
+      if (png_trans_color &&
+          apply_transparent_color(image, y, png_trans_color) &&
+          !fop->sequenceGetHasAlpha())
+        fop->sequenceSetHasAlpha(true);
     }
-    // PALETTE
-    else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_PALETTE) {
-      uint8_t* src_address = rows_pointer[y];
-      uint8_t* dst_address = (uint8_t*)image->getPixelAddress(0, y);
-      unsigned int x;
-
-      for (x=0; x<width; x++)
-        *(dst_address++) = *(src_address++);
-    }
-    png_free(png_ptr, rows_pointer[y]);
   }
-  png_free(png_ptr, rows_pointer);
 
   // Clean up after the read, and free any memory allocated
   png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
@@ -339,6 +356,25 @@ bool PngFormat::onLoad(FileOp* fop)
 }
 
 #ifdef ENABLE_SAVE
+static void set_compression_options(png_structp png_ptr,
+                                    const PngOptions& options)
+{
+  if (options.compressionLevel() >= 0)
+    png_set_compression_level(png_ptr, MID(0, options.compressionLevel(), 9));
+
+  int filters = 0;
+  switch (options.filter()) {
+    case PngOptions::Filter::Default:  return;
+    case PngOptions::Filter::None:     filters = PNG_FILTER_NONE; break;
+    case PngOptions::Filter::Sub:      filters = PNG_FILTER_SUB; break;
+    case PngOptions::Filter::Up:       filters = PNG_FILTER_UP; break;
+    case PngOptions::Filter::Average:  filters = PNG_FILTER_AVG; break;
+    case PngOptions::Filter::Paeth:    filters = PNG_FILTER_PAETH; break;
+    case PngOptions::Filter::Adaptive: filters = PNG_ALL_FILTERS; break;
+  }
+  png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters);
+}
+
 bool PngFormat::onSave(FileOp* fop)
 {
   const Image* image = fop->sequenceImage();
@@ -350,6 +386,12 @@ bool PngFormat::onSave(FileOp* fop)
   int color_type = 0;
   int pass, number_passes;
 
+  /* compression options */
+  PngOptions png_options;
+  base::SharedPtr<FormatOptions> format_options = fop->sequenceGetFormatOptions();
+  if (PngOptions* options = dynamic_cast<PngOptions*>(format_options.get()))
+    png_options = *options;
+
   /* open the file */
   FileHandle handle(open_file_with_exception(fop->filename(), "wb"));
   FILE* fp = handle.get();
@@ -415,6 +457,8 @@ bool PngFormat::onSave(FileOp* fop)
   png_set_IHDR(png_ptr, info_ptr, width, height, 8, color_type,
                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+  set_compression_options(png_ptr, png_options);
+
   if (image->pixelFormat() == IMAGE_INDEXED) {
     int c, r, g, b;
     int pal_size = fop->sequenceGetNColors();
@@ -462,88 +506,47 @@ bool PngFormat::onSave(FileOp* fop)
   /* pack pixels into bytes */
   png_set_packing(png_ptr);
 
+  /* The image rows are written directly, libpng removes the alpha
+   * byte of doc::rgba()/graya() pixels when it isn't needed and
+   * reorders the bytes in big-endian machines.
+   */
+  if (color_type == PNG_COLOR_TYPE_RGB ||
+      color_type == PNG_COLOR_TYPE_GRAY) {
+    png_set_filler(png_ptr, 0, (is_little_endian() ? PNG_FILLER_AFTER:
+                                                     PNG_FILLER_BEFORE));
+  }
+  if (!is_little_endian()) {
+    if (color_type == PNG_COLOR_TYPE_RGB ||
+        color_type == PNG_COLOR_TYPE_RGB_ALPHA)
+      png_set_bgr(png_ptr);
+    if (color_type == PNG_COLOR_TYPE_RGB_ALPHA ||
+        color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
+      png_set_swap_alpha(png_ptr);
+  }
+
   /* non-interlaced */
   number_passes = 1;
 
-  row_pointer = (png_bytep)png_malloc(png_ptr, png_get_rowbytes(png_ptr, info_ptr));
+  /* Update the progress each ~1% of the rows */
+  const png_uint_32 progress_step = std::max<png_uint_32>(1, height / 100);
 
   /* The number of passes is either 1 for non-interlaced images,
    * or 7 for interlaced images.
    */
   for (pass = 0; pass < number_passes; pass++) {
-    /* If you are only writing one row at a time, this works */
     for (y = 0; y < height; y++) {
-      /* RGB_ALPHA */
-      if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGB_ALPHA) {
-        uint32_t* src_address = (uint32_t*)image->getPixelAddress(0, y);
-        uint8_t* dst_address = row_pointer;
-        unsigned int x, c;
-
-        for (x=0; x<width; x++) {
-          c = *(src_address++);
-          *(dst_address++) = rgba_getr(c);
-          *(dst_address++) = rgba_getg(c);
-          *(dst_address++) = rgba_getb(c);
-          *(dst_address++) = rgba_geta(c);
-        }
-      }
-      /* RGB */
-      else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGB) {
-        uint32_t* src_address = (uint32_t*)image->getPixelAddress(0, y);
-        uint8_t* dst_address = row_pointer;
-        unsigned int x, c;
-
-        for (x=0; x<width; x++) {
-          c = *(src_address++);
-          *(dst_address++) = rgba_getr(c);
-          *(dst_address++) = rgba_getg(c);
-          *(dst_address++) = rgba_getb(c);
-        }
-      }
-      /* GRAY_ALPHA */
-      else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY_ALPHA) {
-        uint16_t* src_address = (uint16_t*)image->getPixelAddress(0, y);
-        uint8_t* dst_address = row_pointer;
-        unsigned int x, c;
-
-        for (x=0; x<width; x++) {
-          c = *(src_address++);
-          *(dst_address++) = graya_getv(c);
-          *(dst_address++) = graya_geta(c);
-        }
-      }
-      /* GRAY */
-      else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_GRAY) {
-        uint16_t* src_address = (uint16_t*)image->getPixelAddress(0, y);
-        uint8_t* dst_address = row_pointer;
-        unsigned int x, c;
-
-        for (x=0; x<width; x++) {
-          c = *(src_address++);
-          *(dst_address++) = graya_getv(c);
-        }
-      }
-      /* PALETTE */
-      else if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_PALETTE) {
-        uint8_t* src_address = (uint8_t*)image->getPixelAddress(0, y);
-        uint8_t* dst_address = row_pointer;
-        unsigned int x;
-
-        for (x=0; x<width; x++)
-          *(dst_address++) = *(src_address++);
-      }
-
-      /* write the line */
+      /* write the line (libpng doesn't modify the given row) */
+      row_pointer = (png_bytep)image->getPixelAddress(0, y);
       png_write_rows(png_ptr, &row_pointer, 1);
 
-      fop->setProgress(
-        (double)((double)pass + (double)(y+1) / (double)(height))
-        / (double)number_passes);
+      if (((y+1) % progress_step) == 0 || y+1 == height) {
+        fop->setProgress(
+          (double)((double)pass + (double)(y+1) / (double)(height))
+          / (double)number_passes);
+      }
     }
   }
 
-  png_free(png_ptr, row_pointer);
-
   /* It is REQUIRED to call this to finish writing the rest of the file */
   png_write_end(png_ptr, info_ptr);
 
@@ -565,4 +568,33 @@ bool PngFormat::onSave(FileOp* fop)
 }
 #endif
 
+base::SharedPtr<FormatOptions> PngFormat::onGetFormatOptions(FileOp* fop)
+{
+  base::SharedPtr<PngOptions> png_options;
+  if (dynamic_cast<PngOptions*>(fop->document()->getFormatOptions().get()))
+    png_options = base::SharedPtr<PngOptions>(fop->document()->getFormatOptions());
+
+  if (!png_options) {
+    png_options.reset(new PngOptions);
+
+    // Configuration parameters (there is no dialog to ask for PNG
+    // options, so they are read in batch mode too, e.g. to use the
+    // "fast" preset for intermediate files).
+    if (App::instance()) {
+      int preset = get_config_int("PNG", "Preset", 0);
+      png_options->setPreset(
+        (PngOptions::Preset)MID(0, preset, (int)PngOptions::Preset::Smallest));
+
+      int level = get_config_int("PNG", "CompressionLevel", png_options->compressionLevel());
+      png_options->setCompressionLevel(MID(-1, level, 9));
+
+      int filter = get_config_int("PNG", "Filter", (int)png_options->filter());
+      png_options->setFilter(
+        (PngOptions::Filter)MID(0, filter, (int)PngOptions::Filter::Adaptive));
+    }
+  }
+
+  return png_options;
+}
+
 } // namespace app
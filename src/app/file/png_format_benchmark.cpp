@@ -0,0 +1,129 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "app/context.h"
+#include "app/document.h"
+#include "app/file/file.h"
+#include "app/file/file_formats_manager.h"
+#include "app/file/png_options.h"
+#include "base/fs.h"
+#include "doc/doc.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+static const char* kFilename = "png_format_benchmark.png";
+
+// Creates a sprite with flat color areas and some noise (similar to
+// the content of a sprite frame).
+static doc::Document* create_document(app::Context* ctx, int w, int h,
+                                      PngOptions::Preset preset)
+{
+  doc::Document* doc = ctx->documents().add(w, h, doc::ColorMode::RGB);
+  doc->setFilename(kFilename);
+  static_cast<app::Document*>(doc)->setFormatOptions(
+    base::SharedPtr<FormatOptions>(new PngOptions(preset)));
+
+  Image* image = doc->sprite()->folder()->getFirstLayer()->cel(0)->image();
+  std::srand(w*h);
+  for (int y=0; y<h; y+=16) {
+    for (int x=0; x<w; x+=16) {
+      color_t c = rgba(std::rand()%256, std::rand()%256, std::rand()%256,
+                       (std::rand()%4) ? 255: 0);
+      fill_rect(image, x, y, x+15, y+15, c);
+    }
+  }
+  for (int i=0; i<w*h/32; ++i)
+    put_pixel(image, std::rand()%w, std::rand()%h, rgba(0, 0, 0, 255));
+  return doc;
+}
+
+static void destroy_document(doc::Document* doc)
+{
+  doc->close();
+  delete doc;
+}
+
+static std::string file_size_label()
+{
+  char buf[256];
+  std::sprintf(buf, "%d KB", int(base::file_size(kFilename) / 1024));
+  return buf;
+}
+
+static void BM_PngEncode(benchmark::State& state)
+{
+  const PngOptions::Preset preset = (PngOptions::Preset)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+
+  FileFormatsManager::instance()->registerAllFormats();
+  app::Context ctx;
+  doc::Document* doc = create_document(&ctx, w, h, preset);
+
+  while (state.KeepRunning())
+    save_document(&ctx, doc);
+
+  state.SetBytesProcessed(state.iterations() * w * h * 4);
+  state.SetLabel(file_size_label());
+
+  destroy_document(doc);
+  base::delete_file(kFilename);
+}
+
+static void BM_PngDecode(benchmark::State& state)
+{
+  const PngOptions::Preset preset = (PngOptions::Preset)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+
+  FileFormatsManager::instance()->registerAllFormats();
+  app::Context ctx;
+  {
+    doc::Document* doc = create_document(&ctx, w, h, preset);
+    save_document(&ctx, doc);
+    destroy_document(doc);
+  }
+
+  while (state.KeepRunning()) {
+    app::Document* doc = load_document(&ctx, kFilename);
+    destroy_document(doc);
+  }
+
+  state.SetBytesProcessed(state.iterations() * w * h * 4);
+  state.SetLabel(file_size_label());
+
+  base::delete_file(kFilename);
+}
+
+BENCHMARK(BM_PngEncode)
+  ->Args({ int(PngOptions::Preset::Default), 256 })
+  ->Args({ int(PngOptions::Preset::Default), 2048 })
+  ->Args({ int(PngOptions::Preset::Fast), 256 })
+  ->Args({ int(PngOptions::Preset::Fast), 2048 })
+  ->Args({ int(PngOptions::Preset::Smallest), 256 })
+  ->Args({ int(PngOptions::Preset::Smallest), 2048 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_PngDecode)
+  ->Args({ int(PngOptions::Preset::Default), 256 })
+  ->Args({ int(PngOptions::Preset::Default), 2048 })
+  ->Args({ int(PngOptions::Preset::Fast), 2048 })
+  ->Args({ int(PngOptions::Preset::Smallest), 2048 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
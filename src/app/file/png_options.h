@@ -0,0 +1,74 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_FILE_PNG_OPTIONS_H_INCLUDED
+#define APP_FILE_PNG_OPTIONS_H_INCLUDED
+#pragma once
+
+#include "app/file/format_options.h"
+
+namespace app {
+
+  // Data for PNG files
+  class PngOptions : public FormatOptions {
+  public:
+    // Filters applied to each row before the compression.
+    enum class Filter {
+      Default,                  // Let libpng choose the filter
+      None,
+      Sub,
+      Up,
+      Average,
+      Paeth,
+      Adaptive,                 // Best filter for each row (slower)
+    };
+
+    enum class Preset {
+      Default,                  // Default libpng/zlib settings
+      Fast,                     // Fast encoding, bigger files (useful for temporary files)
+      Smallest,                 // Slower encoding, smaller files
+    };
+
+    // Compression levels go from 0 (no compression) to 9 (best
+    // compression), -1 is the default zlib level.
+    static const int kDefaultCompressionLevel = -1;
+
+    PngOptions(Preset preset = Preset::Default) {
+      setPreset(preset);
+    }
+
+    int compressionLevel() const { return m_compressionLevel; }
+    Filter filter() const { return m_filter; }
+
+    void setCompressionLevel(int level) { m_compressionLevel = level; }
+    void setFilter(Filter filter) { m_filter = filter; }
+
+    void setPreset(Preset preset) {
+      switch (preset) {
+        case Preset::Default:
+          m_compressionLevel = kDefaultCompressionLevel;
+          m_filter = Filter::Default;
+          break;
+        case Preset::Fast:
+          m_compressionLevel = 1;
+          m_filter = Filter::Sub;
+          break;
+        case Preset::Smallest:
+          m_compressionLevel = 9;
+          m_filter = Filter::Adaptive;
+          break;
+      }
+    }
+
+  private:
+    int m_compressionLevel;
+    Filter m_filter;
+  };
+
+} // namespace app
+
+#endif
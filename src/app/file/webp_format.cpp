@@ -319,7 +319,7 @@ bool WebPFormat::onSave(FileOp* fop)
 base::SharedPtr<FormatOptions> WebPFormat::onGetFormatOptions(FileOp* fop)
 {
   base::SharedPtr<WebPOptions> webp_options;
-  if (fop->document()->getFormatOptions())
+  if (dynamic_cast<WebPOptions*>(fop->document()->getFormatOptions().get()))
     webp_options = base::SharedPtr<WebPOptions>(fop->document()->getFormatOptions());
 
   if (!webp_options)
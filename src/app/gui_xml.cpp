@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -19,14 +19,21 @@
 namespace app {
 
 // static
+static GuiXml* singleton = 0;
+
 GuiXml* GuiXml::instance()
 {
-  static GuiXml* singleton = 0;
   if (!singleton)
     singleton = new GuiXml();
   return singleton;
 }
 
+void GuiXml::destroyInstance()
+{
+  delete singleton;
+  singleton = 0;
+}
+
 GuiXml::GuiXml()
 {
   LOG("Loading gui.xml file...\n");
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -23,6 +23,9 @@ namespace app {
     // generated an exception if there are errors in the XML file.
     static GuiXml* instance();
 
+    // Destroys the singleton (if it was created).
+    static void destroyInstance();
+
     // Returns the tinyxml document instance.
     XmlDocumentRef doc() {
       return m_doc;
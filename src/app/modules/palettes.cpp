@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -30,6 +30,19 @@ static Palette* ase_default_palette = NULL;
 // Palette in current sprite frame.
 static Palette* ase_current_palette = NULL;
 
+// True if the default palette must be loaded when it's needed (see
+// load_default_palette_on_demand()).
+static bool ase_default_palette_on_demand = false;
+static std::string ase_default_palette_file;
+
+static void load_default_palette_if_needed()
+{
+  if (ase_default_palette_on_demand) {
+    ase_default_palette_on_demand = false;
+    load_default_palette(ase_default_palette_file);
+  }
+}
+
 int init_module_palette()
 {
   ase_default_palette = new Palette(frame_t(0), 256);
@@ -128,18 +141,28 @@ void load_default_palette(const std::string& userDefined)
   set_current_palette(nullptr, true);
 }
 
+void load_default_palette_on_demand(const std::string& userDefined)
+{
+  ase_default_palette_on_demand = true;
+  ase_default_palette_file = userDefined;
+}
+
 Palette* get_current_palette()
 {
+  load_default_palette_if_needed();
   return ase_current_palette;
 }
 
 Palette* get_default_palette()
 {
+  load_default_palette_if_needed();
   return ase_default_palette;
 }
 
 void set_default_palette(const Palette* palette)
 {
+  // The palette given explicitly replaces the one to be loaded
+  ase_default_palette_on_demand = false;
   palette->copyColorsTo(ase_default_palette);
 }
 
@@ -149,7 +172,7 @@ void set_default_palette(const Palette* palette)
 // If "_palette" is nullptr the default palette is set.
 bool set_current_palette(const Palette *_palette, bool forced)
 {
-  const Palette* palette = (_palette ? _palette: ase_default_palette);
+  const Palette* palette = (_palette ? _palette: get_default_palette());
   bool ret = false;
 
   // Have changes
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -27,6 +27,11 @@ namespace app {
   // line.
   void load_default_palette(const std::string& userDefined);
 
+  // Same as load_default_palette() but the palette is loaded the
+  // first time get_default_palette() or get_current_palette() is
+  // called (used in --batch mode where the palette is rarely needed).
+  void load_default_palette_on_demand(const std::string& userDefined);
+
   Palette* get_default_palette();
   Palette* get_current_palette();
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -15,6 +15,7 @@
 #include "app/resource_finder.h"
 #include "app/tools/ink.h"
 #include "app/tools/tool.h"
+#include "base/scoped_lock.h"
 #include "doc/sprite.h"
 
 namespace app {
@@ -94,6 +95,12 @@ ToolPreferences& Preferences::tool(tools::Tool* tool)
 }
 
 DocumentPreferences& Preferences::document(const app::Document* doc)
+{
+  base::scoped_lock lock(m_docsMutex);
+  return getDocPref(doc);
+}
+
+DocumentPreferences& Preferences::getDocPref(const app::Document* doc)
 {
   auto it = m_docs.find(doc);
   if (it != m_docs.end()) {
@@ -106,7 +113,7 @@ DocumentPreferences& Preferences::document(const app::Document* doc)
 
       // The default preferences for this document are the current
       // defaults for (document=nullptr).
-      DocumentPreferences& defPref = this->document(nullptr);
+      DocumentPreferences& defPref = getDocPref(nullptr);
       *docPref = defPref;
 
       // Default values for symmetry
@@ -129,6 +136,7 @@ void Preferences::removeDocument(doc::Document* doc)
 {
   ASSERT(dynamic_cast<app::Document*>(doc));
 
+  base::scoped_lock lock(m_docsMutex);
   auto it = m_docs.find(static_cast<app::Document*>(doc));
   if (it != m_docs.end()) {
     serializeDocPref(it->first, it->second, true);
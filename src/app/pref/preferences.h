@@ -17,6 +17,7 @@
 #include "app/tools/ink_type.h"
 #include "app/tools/rotation_algorithm.h"
 #include "app/ui/color_bar.h"
+#include "base/mutex.h"
 #include "doc/anidir.h"
 #include "doc/brush_pattern.h"
 #include "doc/documents_observer.h"
@@ -55,6 +56,9 @@ namespace app {
     void save();
 
     ToolPreferences& tool(tools::Tool* tool);
+
+    // Can be called from several threads (e.g. BatchServer jobs
+    // execute commands that use the preferences of their documents).
     DocumentPreferences& document(const app::Document* doc);
 
     // Remove one document explicitly (this can be used if the
@@ -66,12 +70,14 @@ namespace app {
     void onRemoveDocument(doc::Document* doc) override;
 
   private:
+    DocumentPreferences& getDocPref(const app::Document* doc);
     std::string docConfigFileName(const app::Document* doc);
 
     void serializeDocPref(const app::Document* doc, app::DocumentPreferences* docPref, bool save);
 
     std::map<std::string, app::ToolPreferences*> m_tools;
     std::map<const app::Document*, app::DocumentPreferences*> m_docs;
+    base::mutex m_docsMutex;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -71,6 +71,12 @@ namespace app {
       // ToolLoop::getCelOrigin()).
       virtual bool needsCelCoordinates() const { return true; }
 
+      // Returns true if inking the same pixel several times gives the
+      // same result as inking it once (i.e. the ink reads only from
+      // the source image). Point shapes can merge overlapped
+      // scanlines of these inks to paint each pixel just one time.
+      virtual bool isIdempotent() const { return false; }
+
       // Returns true if this ink needs a special source area.  For
       // example, blur tool needs one extra pixel to all sides of the
       // modified area, so it can use a 3x3 convolution matrix.
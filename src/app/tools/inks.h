@@ -35,6 +35,7 @@ public:
   Ink* clone() override { return new PaintInk(*this); }
 
   bool isPaint() const override { return true; }
+  bool isIdempotent() const override { return true; }
 
   void prepareInk(ToolLoop* loop) override {
     switch (m_type) {
@@ -199,6 +200,7 @@ public:
   bool isPaint() const override { return true; }
   bool isEffect() const override { return true; }
   bool isEraser() const override { return true; }
+  bool isIdempotent() const override { return true; }
 
   void prepareInk(ToolLoop* loop) override {
     switch (m_type) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -22,6 +22,12 @@ namespace tools {
 using namespace doc;
 using namespace filters;
 
+static inline void ink_hline(int x1, int y, int x2, ToolLoop* loop)
+{
+  loop->onInkHline(x1, y, x2);
+  loop->getInk()->inkHline(x1, y, x2, loop);
+}
+
 void PointShape::doInkHline(int x1, int y, int x2, ToolLoop* loop)
 {
   TiledMode tiledMode = loop->getTiledMode();
@@ -52,16 +58,16 @@ void PointShape::doInkHline(int x1, int y, int x2, ToolLoop* loop)
     size = loop->getDstImage()->width();      // size = image width
     w = x2-x1+1;
     if (w >= size)
-      loop->getInk()->inkHline(0, y, size-1, loop);
+      ink_hline(0, y, size-1, loop);
     else {
       x = x1;
       x = wrap_value(x, size);
 
       if (x+w-1 <= size-1)
-        loop->getInk()->inkHline(x, y, x+w-1, loop);
+        ink_hline(x, y, x+w-1, loop);
       else {
-        loop->getInk()->inkHline(x, y, size-1, loop);
-        loop->getInk()->inkHline(0, y, w-(size-x)-1, loop);
+        ink_hline(x, y, size-1, loop);
+        ink_hline(0, y, w-(size-x)-1, loop);
       }
     }
   }
@@ -76,7 +82,7 @@ void PointShape::doInkHline(int x1, int y, int x2, ToolLoop* loop)
     if (x2-x1+1 < 1)
       return;
 
-    loop->getInk()->inkHline(x1, y, x2, loop);
+    ink_hline(x1, y, x2, loop);
   }
 }
 
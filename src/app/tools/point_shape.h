@@ -28,6 +28,10 @@ namespace app {
       virtual void transformPoint(ToolLoop* loop, int x, int y) = 0;
       virtual void getModifiedArea(ToolLoop* loop, int x, int y, gfx::Rect& area) = 0;
 
+      // Called after each joinStroke()/fillStroke() so point shapes
+      // that accumulate scanlines can ink them.
+      virtual void flushPointShape(ToolLoop* loop) { }
+
     protected:
       // Calls loop->getInk()->inkHline() function for each horizontal-scanline
       // that should be drawn (applying the "tiled" mode loop->getTiledMode())
@@ -5,6 +5,9 @@
 // it under the terms of the GNU General Public License version 2 as
 // published by the Free Software Foundation.
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 namespace tools {
 
@@ -33,9 +36,20 @@ public:
 };
 
 class BrushPointShape : public PointShape {
+  // Scanline of the brush stamped in a specific position (it's
+  // inked later, merged with other overlapped scanlines).
+  struct Scanline {
+    int y, x1, x2;
+  };
+
+  // Max number of accumulated scanlines before we ink them
+  static const std::size_t kMaxScanlines = 64*1024;
+
   Brush* m_brush;
   base::SharedPtr<CompressedImage> m_compressedImage;
   bool m_firstPoint;
+  bool m_sweep;
+  std::vector<Scanline> m_scanlines;
 
 public:
 
@@ -43,6 +57,16 @@ public:
     m_brush = loop->getBrush();
     m_compressedImage.reset(new CompressedImage(m_brush->image(), false));
     m_firstPoint = true;
+
+    // If the ink is idempotent we can accumulate all the scanlines
+    // of the stroke and ink the union of them, so each pixel is
+    // painted just one time (instead of once per stamp). The only
+    // exception is the PAINT_BRUSH pattern, because the pattern
+    // origin changes with each stamp.
+    m_sweep = (loop->getInk()->isIdempotent() &&
+               (m_brush->type() != kImageBrushType ||
+                m_brush->pattern() != BrushPattern::PAINT_BRUSH));
+    m_scanlines.clear();
   }
 
   void transformPoint(ToolLoop* loop, int x, int y) override {
@@ -65,10 +89,45 @@ public:
       }
     }
 
-    for (auto scanline : *m_compressedImage) {
-      int u = x+scanline.x;
-      doInkHline(u, y+scanline.y, u+scanline.w-1, loop);
+    if (m_sweep) {
+      for (auto scanline : *m_compressedImage) {
+        int u = x+scanline.x;
+        m_scanlines.push_back(Scanline{ y+scanline.y, u, u+scanline.w-1 });
+      }
+      if (m_scanlines.size() >= kMaxScanlines)
+        flushPointShape(loop);
+    }
+    else {
+      for (auto scanline : *m_compressedImage) {
+        int u = x+scanline.x;
+        doInkHline(u, y+scanline.y, u+scanline.w-1, loop);
+      }
+    }
+  }
+
+  // Inks the union of all accumulated scanlines.
+  void flushPointShape(ToolLoop* loop) override {
+    if (m_scanlines.empty())
+      return;
+
+    std::sort(m_scanlines.begin(), m_scanlines.end(),
+              [](const Scanline& a, const Scanline& b) {
+                return (a.y < b.y || (a.y == b.y && a.x1 < b.x1));
+              });
+
+    Scanline span = m_scanlines.front();
+    for (auto it=m_scanlines.begin()+1, end=m_scanlines.end(); it!=end; ++it) {
+      if (it->y == span.y && it->x1 <= span.x2+1) {
+        span.x2 = std::max(span.x2, it->x2);
+      }
+      else {
+        doInkHline(span.x1, span.y, span.x2, loop);
+        span = *it;
+      }
     }
+    doInkHline(span.x1, span.y, span.x2, loop);
+
+    m_scanlines.clear();
   }
 
   void getModifiedArea(ToolLoop* loop, int x, int y, Rect& area) override {
@@ -141,6 +200,10 @@ public:
     m_subPointShape.preparePointShape(loop);
   }
 
+  void flushPointShape(ToolLoop* loop) override {
+    m_subPointShape.flushPointShape(loop);
+  }
+
   void transformPoint(ToolLoop* loop, int x, int y) override {
     int spray_width = loop->getSprayWidth();
     int spray_speed = loop->getSpraySpeed();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -31,6 +31,7 @@
 #include "fixmath/fixmath.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "app/tools/controllers.h"
 #include "app/tools/inks.h"
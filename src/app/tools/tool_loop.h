@@ -101,10 +101,11 @@ namespace app {
       // matches the original cel when we make that composition.
       virtual void validateDstImage(const gfx::Region& rgn) = 0;
 
-      // Invalidates the whole destination image. It's used for tools
-      // like line or rectangle which don't accumulate the effect so
-      // they need to start with a fresh destination image on each
-      // loop step/cycle.
+      // Restores the destination image from the source image (at
+      // least the pixels painted by the last trace, see
+      // onInkHline()). It's used for tools like line or rectangle
+      // which don't accumulate the effect so they need to start with
+      // a fresh destination image on each loop step/cycle.
       virtual void invalidateDstImage() = 0;
       virtual void invalidateDstImage(const gfx::Region& rgn) = 0;
 
@@ -112,6 +113,12 @@ namespace app {
       // image, used by "overlap" tools like jumble or spray.
       virtual void copyValidDstToSrcImage(const gfx::Region& rgn) = 0;
 
+      // Called by PointShape::doInkHline() for each scanline (in
+      // destination image coordinates) that is going to be inked, so
+      // the implementation can track the pixels modified by the
+      // current trace.
+      virtual void onInkHline(int x1, int y, int x2) = 0;
+
       // Returns the RGB map used to convert RGB values to palette index.
       virtual RgbMap* getRgbMap() = 0;
 
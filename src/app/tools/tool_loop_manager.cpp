@@ -193,6 +193,7 @@ void ToolLoopManager::doLoopStep(bool last_step)
     m_toolLoop->getIntertwine()->joinStroke(m_toolLoop, main_stroke);
   else
     m_toolLoop->getIntertwine()->fillStroke(m_toolLoop, main_stroke);
+  m_toolLoop->getPointShape()->flushPointShape(m_toolLoop);
 
   if (m_toolLoop->getTracePolicy() == TracePolicy::Overlap) {
     // Copy destination to source (yes, destination to source). In
@@ -31,9 +31,9 @@ namespace app {
       AccumulateUpdateLast,
 
       // Only the last trace is used. It means that on each ToolLoop
-      // step, the destination image is completely invalidated and
-      // restored from the source image. Used by
-      // line/rectangle/ellipse-like tools.
+      // step, the pixels painted by the previous trace are restored
+      // from the source image. Used by line/rectangle/ellipse-like
+      // tools.
       Last,
 
       // Like accumulate, but the destination is copied to the source
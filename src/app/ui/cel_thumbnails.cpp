@@ -0,0 +1,323 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/cel_thumbnails.h"
+
+#include "app/document.h"
+#include "base/bind.h"
+#include "base/scoped_lock.h"
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/conversion_she.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "she/surface.h"
+#include "she/system.h"
+
+#include <algorithm>
+
+namespace app {
+
+bool CelThumbnails::Key::operator==(const Key& other) const
+{
+  return (imageId == other.imageId &&
+          imageVersion == other.imageVersion &&
+          paletteId == other.paletteId &&
+          paletteVersion == other.paletteVersion &&
+          position == other.position &&
+          spriteSize == other.spriteSize &&
+          size == other.size &&
+          background == other.background);
+}
+
+CelThumbnails::CelThumbnails(Document* document)
+  : m_document(document)
+  , m_memory(0)
+  , m_threadDone(true)
+  , m_stop(false)
+{
+}
+
+CelThumbnails::~CelThumbnails()
+{
+  if (m_thread) {
+    {
+      base::scoped_lock lock(m_mutex);
+      m_stop = true;
+    }
+    m_thread->join();
+  }
+
+  for (Rendered& rendered : m_rendered)
+    delete rendered.image;
+
+  for (auto& it : m_entries)
+    it.second.surface->dispose();
+}
+
+she::Surface* CelThumbnails::thumbnail(const doc::Cel* cel, const gfx::Size& size)
+{
+  auto it = m_entries.find(cel->data()->id());
+  if (it == m_entries.end() || it->second.key.size != size)
+    return nullptr;
+
+  Entry& entry = it->second;
+  m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+  return entry.surface;
+}
+
+void CelThumbnails::setVisibleCels(const std::vector<doc::Cel*>& cels, const gfx::Size& size)
+{
+  std::deque<Request> requests;
+  for (const doc::Cel* cel : cels) {
+    Request request;
+    request.celDataId = cel->data()->id();
+    request.key = makeKey(cel, size);
+
+    // Linked cels share the same thumbnail
+    if (std::find_if(requests.begin(), requests.end(),
+                     [&request](const Request& other) {
+                       return (other.celDataId == request.celDataId);
+                     }) != requests.end())
+      continue;
+
+    auto it = m_entries.find(request.celDataId);
+    if (it == m_entries.end() || it->second.key != request.key)
+      requests.push_back(request);
+  }
+
+  bool restart;
+  {
+    base::scoped_lock lock(m_mutex);
+    m_requests.swap(requests);
+    restart = (!m_requests.empty() && m_threadDone);
+  }
+
+  // The background thread finishes when there is nothing to render
+  if (restart)
+    startThread();
+}
+
+void CelThumbnails::checkRenderedThumbnails(std::vector<doc::ObjectId>& celDataIds)
+{
+  std::vector<Rendered> rendered;
+  {
+    base::scoped_lock lock(m_mutex);
+    rendered.swap(m_rendered);
+  }
+
+  for (Rendered& r : rendered) {
+    she::Surface* surface = she::instance()->createRgbaSurface(
+      r.image->width(), r.image->height());
+    convert_image_to_surface(r.image, nullptr, surface,
+                             0, 0, 0, 0, r.image->width(), r.image->height());
+    delete r.image;
+
+    auto it = m_entries.find(r.celDataId);
+    if (it != m_entries.end()) {
+      Entry& entry = it->second;
+      m_memory -= 4 * entry.key.size.w * entry.key.size.h;
+      entry.surface->dispose();
+      entry.key = r.key;
+      entry.surface = surface;
+      m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+    }
+    else {
+      m_lru.push_front(r.celDataId);
+      m_entries[r.celDataId] = Entry{ r.key, surface, m_lru.begin() };
+    }
+    m_memory += 4 * r.key.size.w * r.key.size.h;
+
+    celDataIds.push_back(r.celDataId);
+  }
+
+  // Discard the least recently used thumbnails
+  while (m_memory > kMaxMemory && m_lru.size() > 1) {
+    auto it = m_entries.find(m_lru.back());
+    m_memory -= 4 * it->second.key.size.w * it->second.key.size.h;
+    it->second.surface->dispose();
+    m_entries.erase(it);
+    m_lru.pop_back();
+  }
+
+  bool join;
+  {
+    base::scoped_lock lock(m_mutex);
+    join = (m_thread && m_threadDone);
+  }
+  if (join) {
+    m_thread->join();
+    m_thread.reset();
+  }
+}
+
+bool CelThumbnails::isRendering() const
+{
+  base::scoped_lock lock(m_mutex);
+  return (!m_requests.empty() || !m_rendered.empty() || !m_threadDone);
+}
+
+CelThumbnails::Key CelThumbnails::makeKey(const doc::Cel* cel, const gfx::Size& size) const
+{
+  const doc::Sprite* sprite = m_document->sprite();
+  const doc::Image* image = cel->image();
+  const doc::Palette* palette =
+    (sprite->pixelFormat() == doc::IMAGE_INDEXED ? sprite->palette(cel->frame()): nullptr);
+
+  Key key;
+  key.imageId = image->id();
+  key.imageVersion = image->version();
+  key.paletteId = (palette ? palette->id(): doc::NullId);
+  key.paletteVersion = (palette ? palette->version(): 0);
+  key.position = cel->position();
+  key.spriteSize = gfx::Size(sprite->width(), sprite->height());
+  key.size = size;
+  key.background = cel->layer()->isBackground();
+  return key;
+}
+
+void CelThumbnails::startThread()
+{
+  // Join the previous thread (it has already finished)
+  if (m_thread) {
+    m_thread->join();
+    m_thread.reset();
+  }
+
+  {
+    base::scoped_lock lock(m_mutex);
+    m_threadDone = false;
+  }
+
+  m_thread.reset(new base::thread(
+      base::Bind<void>(&CelThumbnails::renderThread, this)));
+}
+
+void CelThumbnails::renderThread()
+{
+  while (true) {
+    Request request;
+    {
+      base::scoped_lock lock(m_mutex);
+      if (m_stop || m_requests.empty()) {
+        m_threadDone = true;
+        break;
+      }
+      request = m_requests.front();
+    }
+
+    if (!m_document->lock(Document::ReadLock, 0)) {
+      // The document is locked, try again later
+      base::this_thread::sleep_for(0.005);
+      continue;
+    }
+
+    doc::Image* image = nullptr;
+    try {
+      image = renderThumbnail(request);
+    }
+    catch (const std::exception&) {
+      // Do nothing, the thumbnail is not rendered
+    }
+    m_document->unlock();
+
+    base::scoped_lock lock(m_mutex);
+
+    // The list of requests could be replaced by setVisibleCels()
+    // while we were rendering this thumbnail.
+    auto it = std::find_if(m_requests.begin(), m_requests.end(),
+                           [&request](const Request& other) {
+                             return (other.celDataId == request.celDataId &&
+                                     other.key == request.key);
+                           });
+    if (it != m_requests.end())
+      m_requests.erase(it);
+
+    if (image)
+      m_rendered.push_back(Rendered{ request.celDataId, request.key, image });
+  }
+}
+
+// The document must be locked to read it. Returns nullptr if the cel
+// was modified or removed after the request was made (a new request
+// will be made when the Timeline is repainted).
+doc::Image* CelThumbnails::renderThumbnail(const Request& request)
+{
+  const Key& key = request.key;
+  const doc::CelData* celData = doc::get<doc::CelData>(request.celDataId);
+  const doc::Image* image = (celData ? celData->image(): nullptr);
+  if (!image ||
+      image->id() != key.imageId ||
+      image->version() != key.imageVersion ||
+      celData->position() != key.position ||
+      key.spriteSize.w < 1 || key.spriteSize.h < 1)
+    return nullptr;
+
+  const doc::Palette* palette = nullptr;
+  if (image->pixelFormat() == doc::IMAGE_INDEXED) {
+    palette = doc::get<doc::Palette>(key.paletteId);
+    if (!palette || palette->version() != key.paletteVersion)
+      return nullptr;
+  }
+  else if (image->pixelFormat() == doc::IMAGE_BITMAP)
+    return nullptr;
+
+  // Area of the thumbnail where the sprite canvas is scaled (keeping
+  // its aspect ratio).
+  double scale = std::min(double(key.size.w) / key.spriteSize.w,
+                          double(key.size.h) / key.spriteSize.h);
+  gfx::Size canvas(std::max(1, int(key.spriteSize.w * scale)),
+                   std::max(1, int(key.spriteSize.h * scale)));
+  gfx::Point origin((key.size.w - canvas.w) / 2,
+                    (key.size.h - canvas.h) / 2);
+
+  base::UniquePtr<doc::Image> thumbnail(
+    doc::Image::create(doc::IMAGE_RGB, key.size.w, key.size.h));
+  doc::clear_image(thumbnail, 0);
+
+  // Only one pixel of the cel is read for each pixel of the
+  // thumbnail, so the cost doesn't depend on the cel size.
+  const doc::color_t mask = image->maskColor();
+  for (int y=0; y<canvas.h; ++y) {
+    int v = y * key.spriteSize.h / canvas.h - key.position.y;
+    if (v < 0 || v >= image->height())
+      continue;
+
+    for (int x=0; x<canvas.w; ++x) {
+      int u = x * key.spriteSize.w / canvas.w - key.position.x;
+      if (u < 0 || u >= image->width())
+        continue;
+
+      doc::color_t c = doc::get_pixel(image, u, v);
+      switch (image->pixelFormat()) {
+        case doc::IMAGE_GRAYSCALE: {
+          int g = doc::graya_getv(c);
+          c = doc::rgba(g, g, g, doc::graya_geta(c));
+          break;
+        }
+        case doc::IMAGE_INDEXED:
+          if ((c == mask && !key.background) || int(c) >= palette->size())
+            c = 0;
+          else
+            c = palette->getEntry(c);
+          break;
+      }
+      doc::put_pixel(thumbnail, origin.x+x, origin.y+y, c);
+    }
+  }
+
+  return thumbnail.release();
+}
+
+} // namespace app
@@ -0,0 +1,132 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_UI_CEL_THUMBNAILS_H_INCLUDED
+#define APP_UI_CEL_THUMBNAILS_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/mutex.h"
+#include "base/thread.h"
+#include "base/unique_ptr.h"
+#include "doc/object.h"
+#include "gfx/point.h"
+#include "gfx/size.h"
+
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace doc {
+  class Cel;
+  class Image;
+}
+
+namespace she {
+  class Surface;
+}
+
+namespace app {
+  class Document;
+
+  // Renders scaled down previews of the cels of a document in a
+  // background thread (so the Timeline can show thumbnails without
+  // rendering them in its onPaint()). Rendered thumbnails are cached
+  // by cel data and discarded (least recently used first) when they
+  // use more than kMaxMemory bytes.
+  //
+  // All member functions must be called from the GUI thread.
+  class CelThumbnails {
+  public:
+    enum { kMaxMemory = 16*1024*1024 };
+
+    CelThumbnails(Document* document);
+    ~CelThumbnails();
+
+    Document* document() const { return m_document; }
+
+    // Returns the latest rendered thumbnail of the given cel with
+    // the given size, or nullptr if it's not rendered yet. The
+    // thumbnail can be outdated (e.g. the cel image was modified)
+    // until a new one is rendered. The returned surface is valid
+    // until the next checkRenderedThumbnails() call.
+    she::Surface* thumbnail(const doc::Cel* cel, const gfx::Size& size);
+
+    // Replaces the list of cels to render with the given ones (in
+    // order of priority). Cels with up-to-date thumbnails are
+    // skipped. The document must be locked to read it.
+    void setVisibleCels(const std::vector<doc::Cel*>& cels, const gfx::Size& size);
+
+    // Moves the thumbnails rendered by the background thread to the
+    // cache. Adds the IDs of the cel data that have new thumbnails
+    // in "celDataIds".
+    void checkRenderedThumbnails(std::vector<doc::ObjectId>& celDataIds);
+
+    // Returns true if there are thumbnails to be rendered or to be
+    // collected with checkRenderedThumbnails().
+    bool isRendering() const;
+
+  private:
+    // Everything that changes the thumbnail of a cel.
+    struct Key {
+      doc::ObjectId imageId;
+      doc::ObjectVersion imageVersion;
+      doc::ObjectId paletteId;
+      doc::ObjectVersion paletteVersion;
+      gfx::Point position;
+      gfx::Size spriteSize;
+      gfx::Size size;
+      bool background;
+
+      bool operator==(const Key& other) const;
+      bool operator!=(const Key& other) const { return !operator==(other); }
+    };
+
+    struct Request {
+      doc::ObjectId celDataId;
+      Key key;
+    };
+
+    struct Rendered {
+      doc::ObjectId celDataId;
+      Key key;
+      doc::Image* image;
+    };
+
+    struct Entry {
+      Key key;
+      she::Surface* surface;
+      std::list<doc::ObjectId>::iterator lru;
+    };
+
+    Key makeKey(const doc::Cel* cel, const gfx::Size& size) const;
+    void startThread();
+    void renderThread();
+    doc::Image* renderThumbnail(const Request& request);
+
+    Document* m_document;
+
+    // Used only from the GUI thread. m_lru has the cel data IDs of
+    // m_entries, most recently used first.
+    std::map<doc::ObjectId, Entry> m_entries;
+    std::list<doc::ObjectId> m_lru;
+    std::size_t m_memory;
+
+    mutable base::mutex m_mutex;
+    std::deque<Request> m_requests;
+    std::vector<Rendered> m_rendered;
+    bool m_threadDone;
+    bool m_stop;
+    base::UniquePtr<base::thread> m_thread;
+
+    DISABLE_COPYING(CelThumbnails);
+  };
+
+} // namespace app
+
+#endif
@@ -11,6 +11,14 @@
 
 #include "app/ui/color_selector.h"
 
+#include "base/unique_ptr.h"
+#include "doc/conversion_she.h"
+#include "doc/image.h"
+#include "gfx/hsv.h"
+#include "gfx/rgb.h"
+#include "she/surface.h"
+#include "she/system.h"
+#include "ui/graphics.h"
 #include "ui/message.h"
 #include "ui/size_hint_event.h"
 #include "ui/theme.h"
@@ -24,9 +32,17 @@ using namespace ui;
 ColorSelector::ColorSelector()
   : Widget(kGenericWidget)
   , m_lockColor(false)
+  , m_gradient(nullptr)
+  , m_gradientKey(0.0)
 {
 }
 
+ColorSelector::~ColorSelector()
+{
+  if (m_gradient)
+    m_gradient->dispose();
+}
+
 void ColorSelector::selectColor(const app::Color& color)
 {
   if (m_lockColor)
@@ -79,4 +95,42 @@ bool ColorSelector::onProcessMessage(ui::Message* msg)
   return Widget::onProcessMessage(msg);
 }
 
+void ColorSelector::paintGradient(ui::Graphics* g, const gfx::Rect& rc, double key)
+{
+  if (rc.isEmpty())
+    return;
+
+  if (!m_gradient ||
+      m_gradient->width() != rc.w ||
+      m_gradient->height() != rc.h ||
+      m_gradientKey != key) {
+    if (m_gradient &&
+        (m_gradient->width() != rc.w ||
+         m_gradient->height() != rc.h)) {
+      m_gradient->dispose();
+      m_gradient = nullptr;
+    }
+    if (!m_gradient)
+      m_gradient = she::instance()->createRgbaSurface(rc.w, rc.h);
+
+    base::UniquePtr<doc::Image> image(
+      doc::Image::create(doc::IMAGE_RGB, rc.w, rc.h));
+    onRenderGradient(image, rc);
+    doc::convert_image_to_surface(image, nullptr, m_gradient,
+                                  0, 0, 0, 0, rc.w, rc.h);
+    m_gradientKey = key;
+  }
+
+  g->blit(m_gradient, 0, 0, rc.x, rc.y, rc.w, rc.h);
+}
+
+// static
+doc::color_t ColorSelector::hsvToImageColor(double hue, double sat, double val)
+{
+  gfx::Rgb rgb(gfx::Hsv(MID(0.0, hue, 360.0),
+                        MID(0.0, sat, 100.0) / 100.0,
+                        MID(0.0, val, 100.0) / 100.0));
+  return doc::rgba(rgb.red(), rgb.green(), rgb.blue(), 255);
+}
+
 } // namespace app
@@ -12,15 +12,25 @@
 #include "app/color.h"
 #include "app/ui/color_source.h"
 #include "base/signal.h"
+#include "doc/color.h"
 #include "ui/mouse_buttons.h"
 #include "ui/widget.h"
 
+namespace doc {
+  class Image;
+}
+
+namespace she {
+  class Surface;
+}
+
 namespace app {
 
   class ColorSelector : public ui::Widget
                       , public IColorSource {
   public:
     ColorSelector();
+    ~ColorSelector();
 
     void selectColor(const app::Color& color);
 
@@ -31,12 +41,31 @@ namespace app {
     void onSizeHint(ui::SizeHintEvent& ev) override;
     bool onProcessMessage(ui::Message* msg) override;
 
+    // Paints the gradient of the selector in "rc". The gradient is
+    // rendered with onRenderGradient() in an off-screen surface, which
+    // is reused while the size of "rc" and the given "key" (the
+    // parameters used to render the gradient, e.g. the hue of the
+    // selected color) don't change.
+    void paintGradient(ui::Graphics* g, const gfx::Rect& rc, double key);
+
+    // Renders the gradient in the given RGB image. "rc" are the
+    // bounds of the image in client coordinates.
+    virtual void onRenderGradient(doc::Image* image, const gfx::Rect& rc) = 0;
+
+    // Converts the given HSV values (with saturation and value in the
+    // [0,100] range) to an opaque RGB image color.
+    static doc::color_t hsvToImageColor(double hue, double sat, double val);
+
     app::Color m_color;
 
     // Internal flag used to lock the modification of m_color.
     // E.g. When the user picks a color harmony, we don't want to
     // change the main color.
     bool m_lockColor;
+
+  private:
+    she::Surface* m_gradient;
+    double m_gradientKey;
   };
 
 } // namespace app
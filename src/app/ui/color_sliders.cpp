@@ -14,6 +14,11 @@
 #include "app/ui/skin/skin_slider_property.h"
 #include "app/ui/skin/skin_theme.h"
 #include "base/bind.h"
+#include "base/unique_ptr.h"
+#include "doc/conversion_she.h"
+#include "doc/image.h"
+#include "she/surface.h"
+#include "she/system.h"
 #include "ui/box.h"
 #include "ui/entry.h"
 #include "ui/graphics.h"
@@ -22,6 +27,7 @@
 #include "ui/slider.h"
 #include "ui/theme.h"
 
+#include <algorithm>
 #include <climits>
 
 namespace app {
@@ -38,47 +44,95 @@ namespace {
   public:
     ColorSliderBgPainter(ColorSliders::Channel channel)
       : m_channel(channel)
+      , m_surface(nullptr)
+      , m_valid(false)
     { }
 
+    ~ColorSliderBgPainter() {
+      if (m_surface)
+        m_surface->dispose();
+    }
+
     void setColor(const app::Color& color) {
-      m_color = color;
+      if (m_color != color) {
+        m_color = color;
+        m_valid = false;
+      }
     }
 
     void paint(Slider* slider, Graphics* g, const gfx::Rect& rc) {
-      gfx::Color color = gfx::ColorNone;
-      int w = MAX(rc.w-1, 1);
-
-      for (int x=0; x <= w; ++x) {
-        switch (m_channel) {
-          case ColorSliders::Red:
-            color = gfx::rgba(255 * x / w, m_color.getGreen(), m_color.getBlue());
-            break;
-          case ColorSliders::Green:
-            color = gfx::rgba(m_color.getRed(), 255 * x / w, m_color.getBlue());
-            break;
-          case ColorSliders::Blue:
-            color = gfx::rgba(m_color.getRed(), m_color.getGreen(), 255 * x / w);
-            break;
-          case ColorSliders::Hue:
-            color = color_utils::color_for_ui(app::Color::fromHsv(360 * x / w, m_color.getSaturation(), m_color.getValue()));
-            break;
-          case ColorSliders::Saturation:
-            color = color_utils::color_for_ui(app::Color::fromHsv(m_color.getHue(), 100 * x / w, m_color.getValue()));
-            break;
-          case ColorSliders::Value:
-            color = color_utils::color_for_ui(app::Color::fromHsv(m_color.getHue(), m_color.getSaturation(), 100 * x / w));
-            break;
-          case ColorSliders::Gray:
-            color = color_utils::color_for_ui(app::Color::fromGray(255 * x / w));
-            break;
-        }
-        g->drawVLine(color, rc.x+x, rc.y, rc.h);
+      // Nothing to draw for the alpha channel
+      if (m_channel == ColorSliders::Alpha || rc.isEmpty())
+        return;
+
+      if (!m_surface ||
+          m_surface->width() != rc.w ||
+          m_surface->height() != rc.h) {
+        if (m_surface)
+          m_surface->dispose();
+        m_surface = she::instance()->createRgbaSurface(rc.w, rc.h);
+        m_valid = false;
+      }
+
+      // The gradient is rendered again only when the color or the
+      // slider size changes.
+      if (!m_valid) {
+        renderGradient(rc.w, rc.h);
+        m_valid = true;
       }
+
+      g->blit(m_surface, 0, 0, rc.x, rc.y, rc.w, rc.h);
     }
 
   private:
+    gfx::Color getColor(int x, int w) const {
+      switch (m_channel) {
+        case ColorSliders::Red:
+          return gfx::rgba(255 * x / w, m_color.getGreen(), m_color.getBlue());
+        case ColorSliders::Green:
+          return gfx::rgba(m_color.getRed(), 255 * x / w, m_color.getBlue());
+        case ColorSliders::Blue:
+          return gfx::rgba(m_color.getRed(), m_color.getGreen(), 255 * x / w);
+        case ColorSliders::Hue:
+          return color_utils::color_for_ui(app::Color::fromHsv(360 * x / w, m_color.getSaturation(), m_color.getValue()));
+        case ColorSliders::Saturation:
+          return color_utils::color_for_ui(app::Color::fromHsv(m_color.getHue(), 100 * x / w, m_color.getValue()));
+        case ColorSliders::Value:
+          return color_utils::color_for_ui(app::Color::fromHsv(m_color.getHue(), m_color.getSaturation(), 100 * x / w));
+        case ColorSliders::Gray:
+          return color_utils::color_for_ui(app::Color::fromGray(255 * x / w));
+      }
+      return gfx::ColorNone;
+    }
+
+    // All rows of the gradient are equal, so the first row is
+    // calculated and copied to the other ones.
+    void renderGradient(int width, int height) {
+      base::UniquePtr<doc::Image> image(
+        doc::Image::create(doc::IMAGE_RGB, width, height));
+      int w = MAX(width-1, 1);
+
+      doc::RgbTraits::address_t row =
+        (doc::RgbTraits::address_t)image->getPixelAddress(0, 0);
+      for (int x=0; x<width; ++x) {
+        gfx::Color color = getColor(x, w);
+        row[x] = doc::rgba(gfx::getr(color), gfx::getg(color),
+                           gfx::getb(color), gfx::geta(color));
+      }
+
+      for (int y=1; y<height; ++y) {
+        std::copy(row, row+width,
+                  (doc::RgbTraits::address_t)image->getPixelAddress(0, y));
+      }
+
+      doc::convert_image_to_surface(image, nullptr, m_surface,
+                                    0, 0, 0, 0, width, height);
+    }
+
     ColorSliders::Channel m_channel;
     app::Color m_color;
+    she::Surface* m_surface;
+    bool m_valid;
   };
 
 }
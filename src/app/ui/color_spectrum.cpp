@@ -11,9 +11,9 @@
 
 #include "app/ui/color_spectrum.h"
 
-#include "app/color_utils.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/status_bar.h"
+#include "doc/image.h"
 #include "she/surface.h"
 #include "ui/graphics.h"
 #include "ui/message.h"
@@ -78,36 +78,7 @@ void ColorSpectrum::onPaint(ui::PaintEvent& ev)
   if (rc.isEmpty())
     return;
 
-  int vmid = (align() & HORIZONTAL ? rc.h/2 : rc.w/2);
-  vmid = MAX(1, vmid);
-
-  for (int y=0; y<rc.h; ++y) {
-    for (int x=0; x<rc.w; ++x) {
-      int u, v, umax;
-      if (align() & HORIZONTAL) {
-        u = x;
-        v = y;
-        umax = MAX(1, rc.w-1);
-      }
-      else {
-        u = y;
-        v = x;
-        umax = MAX(1, rc.h-1);
-      }
-
-      double hue = 360.0 * u / umax;
-      double sat = (v < vmid ? 100.0 * v / vmid : 100.0);
-      double val = (v < vmid ? 100.0 : 100.0-(100.0 * (v-vmid) / vmid));
-
-      gfx::Color color = color_utils::color_for_ui(
-        app::Color::fromHsv(
-          MID(0.0, hue, 360.0),
-          MID(0.0, sat, 100.0),
-          MID(0.0, val, 100.0)));
-
-      g->putPixel(color, rc.x+x, rc.y+y);
-    }
-  }
+  paintGradient(g, rc, align());
 
   if (m_color.getType() != app::Color::MaskType) {
     double hue = m_color.getHue();
@@ -126,6 +97,30 @@ void ColorSpectrum::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void ColorSpectrum::onRenderGradient(doc::Image* image, const gfx::Rect& rc)
+{
+  const bool horizontal = ((align() & HORIZONTAL) ? true: false);
+  int vmid = (horizontal ? rc.h/2 : rc.w/2);
+  vmid = MAX(1, vmid);
+  int umax = MAX(1, (horizontal ? rc.w: rc.h)-1);
+
+  for (int y=0; y<rc.h; ++y) {
+    doc::RgbTraits::address_t dst =
+      (doc::RgbTraits::address_t)image->getPixelAddress(0, y);
+
+    for (int x=0; x<rc.w; ++x, ++dst) {
+      int u = (horizontal ? x: y);
+      int v = (horizontal ? y: x);
+
+      double hue = 360.0 * u / umax;
+      double sat = (v < vmid ? 100.0 * v / vmid : 100.0);
+      double val = (v < vmid ? 100.0 : 100.0-(100.0 * (v-vmid) / vmid));
+
+      *dst = hsvToImageColor(hue, sat, val);
+    }
+  }
+}
+
 bool ColorSpectrum::onProcessMessage(ui::Message* msg)
 {
   switch (msg->type()) {
@@ -24,6 +24,7 @@ namespace app {
   protected:
     void onPaint(ui::PaintEvent& ev) override;
     bool onProcessMessage(ui::Message* msg) override;
+    void onRenderGradient(doc::Image* image, const gfx::Rect& rc) override;
   };
 
 } // namespace app
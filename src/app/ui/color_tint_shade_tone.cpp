@@ -11,9 +11,9 @@
 
 #include "app/ui/color_tint_shade_tone.h"
 
-#include "app/color_utils.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/status_bar.h"
+#include "doc/image.h"
 #include "she/surface.h"
 #include "ui/graphics.h"
 #include "ui/message.h"
@@ -22,6 +22,8 @@
 #include "ui/resize_event.h"
 #include "ui/system.h"
 
+#include <algorithm>
+
 namespace app {
 
 using namespace app::skin;
@@ -84,37 +86,9 @@ void ColorTintShadeTone::onPaint(ui::PaintEvent& ev)
     return;
 
   double hue = m_color.getHue();
-  int umax, vmax;
   int huebar = getHueBarSize();
-  umax = MAX(1, rc.w-1);
-  vmax = MAX(1, rc.h-1-huebar);
-
-  for (int y=0; y<rc.h-huebar; ++y) {
-    for (int x=0; x<rc.w; ++x) {
-      double sat = (100.0 * x / umax);
-      double val = (100.0 - 100.0 * y / vmax);
 
-      gfx::Color color = color_utils::color_for_ui(
-        app::Color::fromHsv(
-          hue,
-          MID(0.0, sat, 100.0),
-          MID(0.0, val, 100.0)));
-
-      g->putPixel(color, rc.x+x, rc.y+y);
-    }
-  }
-
-  if (huebar > 0) {
-    for (int y=rc.h-huebar; y<rc.h; ++y) {
-      for (int x=0; x<rc.w; ++x) {
-        gfx::Color color = color_utils::color_for_ui(
-          app::Color::fromHsv(
-            (360.0 * x / rc.w), 100.0, 100.0));
-
-        g->putPixel(color, rc.x+x, rc.y+y);
-      }
-    }
-  }
+  paintGradient(g, rc, hue);
 
   if (m_color.getType() != app::Color::MaskType) {
     double sat = m_color.getSaturation();
@@ -141,6 +115,37 @@ void ColorTintShadeTone::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void ColorTintShadeTone::onRenderGradient(doc::Image* image, const gfx::Rect& rc)
+{
+  double hue = m_color.getHue();
+  int huebar = getHueBarSize();
+  int umax = MAX(1, rc.w-1);
+  int vmax = MAX(1, rc.h-1-huebar);
+
+  for (int y=0; y<rc.h-huebar; ++y) {
+    doc::RgbTraits::address_t dst =
+      (doc::RgbTraits::address_t)image->getPixelAddress(0, y);
+    double val = (100.0 - 100.0 * y / vmax);
+
+    for (int x=0; x<rc.w; ++x, ++dst) {
+      double sat = (100.0 * x / umax);
+      *dst = hsvToImageColor(hue, sat, val);
+    }
+  }
+
+  if (huebar > 0) {
+    // All rows of the hue bar are equal
+    doc::RgbTraits::address_t first =
+      (doc::RgbTraits::address_t)image->getPixelAddress(0, rc.h-huebar);
+    for (int x=0; x<rc.w; ++x)
+      first[x] = hsvToImageColor(360.0 * x / rc.w, 100.0, 100.0);
+
+    for (int y=rc.h-huebar+1; y<rc.h; ++y)
+      std::copy(first, first+rc.w,
+                (doc::RgbTraits::address_t)image->getPixelAddress(0, y));
+  }
+}
+
 bool ColorTintShadeTone::onProcessMessage(ui::Message* msg)
 {
   switch (msg->type()) {
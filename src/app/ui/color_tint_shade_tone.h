@@ -23,6 +23,7 @@ namespace app {
   protected:
     void onPaint(ui::PaintEvent& ev) override;
     bool onProcessMessage(ui::Message* msg) override;
+    void onRenderGradient(doc::Image* image, const gfx::Rect& rc) override;
 
   private:
     bool inHueBarArea(const gfx::Point& pos) const;
@@ -11,7 +11,6 @@
 
 #include "app/ui/color_wheel.h"
 
-#include "app/color_utils.h"
 #include "app/pref/preferences.h"
 #include "app/ui/skin/button_icon_impl.h"
 #include "app/ui/skin/skin_theme.h"
@@ -19,6 +18,7 @@
 #include "base/bind.h"
 #include "base/pi.h"
 #include "base/scoped_value.h"
+#include "doc/image.h"
 #include "filters/color_curve.h"
 #include "she/surface.h"
 #include "ui/graphics.h"
@@ -81,11 +81,41 @@ app::Color ColorWheel::getColorInClientPos(const gfx::Point& pos)
 {
   m_harmonyPicked = false;
 
+  app::Color color = getColorInWheel(pos);
+  if (color.getType() != app::Color::MaskType)
+    return color;
+
+  // Pick harmonies
+  if (m_color.getAlpha() > 0) {
+    const gfx::Rect& rc = m_clientBounds;
+    int n = getHarmonies();
+    int boxsize = MIN(rc.w/10, rc.h/10);
+
+    for (int i=0; i<n; ++i) {
+      app::Color color = getColorInHarmony(i);
+
+      if (gfx::Rect(rc.x+rc.w-(n-i)*boxsize,
+                    rc.y+rc.h-boxsize,
+                    boxsize, boxsize).contains(pos)) {
+        m_harmonyPicked = true;
+
+        color = app::Color::fromHsv(convertHueAngle(int(color.getHue()), 1),
+                                    color.getSaturation(),
+                                    color.getValue());
+        return color;
+      }
+    }
+  }
+
+  return app::Color::fromMask();
+}
+
+app::Color ColorWheel::getColorInWheel(const gfx::Point& pos) const
+{
   int u = (pos.x - (m_wheelBounds.x+m_wheelBounds.w/2));
   int v = (pos.y - (m_wheelBounds.y+m_wheelBounds.h/2));
   double d = std::sqrt(u*u + v*v);
 
-  // Pick from the wheel
   if (d < m_wheelRadius+2*guiscale()) {
     double a = std::atan2(-v, u);
 
@@ -117,28 +147,6 @@ app::Color ColorWheel::getColorInClientPos(const gfx::Point& pos)
       100);
   }
 
-  // Pick harmonies
-  if (m_color.getAlpha() > 0) {
-    const gfx::Rect& rc = m_clientBounds;
-    int n = getHarmonies();
-    int boxsize = MIN(rc.w/10, rc.h/10);
-
-    for (int i=0; i<n; ++i) {
-      app::Color color = getColorInHarmony(i);
-
-      if (gfx::Rect(rc.x+rc.w-(n-i)*boxsize,
-                    rc.y+rc.h-boxsize,
-                    boxsize, boxsize).contains(pos)) {
-        m_harmonyPicked = true;
-
-        color = app::Color::fromHsv(convertHueAngle(int(color.getHue()), 1),
-                                    color.getSaturation(),
-                                    color.getValue());
-        return color;
-      }
-    }
-  }
-
   return app::Color::fromMask();
 }
 
@@ -215,22 +223,8 @@ void ColorWheel::onPaint(ui::PaintEvent& ev)
 
   const gfx::Rect& rc = m_clientBounds;
 
-  for (int y=rc.y; y<rc.y+rc.h; ++y) {
-    for (int x=rc.x; x<rc.x+rc.w; ++x) {
-      app::Color appColor =
-        ColorWheel::getColorInClientPos(gfx::Point(x, y));
-
-      gfx::Color color;
-      if (appColor.getType() != app::Color::MaskType) {
-        color = color_utils::color_for_ui(appColor);
-      }
-      else {
-        color = theme->colors.editorFace();
-      }
-
-      g->putPixel(color, x, y);
-    }
-  }
+  // The gradient depends on the color model and the discrete flag
+  paintGradient(g, rc, int(m_colorModel)*2 + (m_discrete ? 1: 0));
 
   if (m_color.getAlpha() > 0) {
     int n = getHarmonies();
@@ -265,6 +259,28 @@ void ColorWheel::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void ColorWheel::onRenderGradient(doc::Image* image, const gfx::Rect& rc)
+{
+  SkinTheme* theme = static_cast<SkinTheme*>(this->theme());
+  gfx::Color face = theme->colors.editorFace();
+  doc::color_t bg = doc::rgba(gfx::getr(face), gfx::getg(face), gfx::getb(face), 255);
+
+  for (int y=0; y<rc.h; ++y) {
+    doc::RgbTraits::address_t dst =
+      (doc::RgbTraits::address_t)image->getPixelAddress(0, y);
+
+    for (int x=0; x<rc.w; ++x, ++dst) {
+      app::Color color = getColorInWheel(gfx::Point(rc.x+x, rc.y+y));
+      if (color.getType() != app::Color::MaskType)
+        *dst = hsvToImageColor(color.getHue(),
+                               color.getSaturation(),
+                               color.getValue());
+      else
+        *dst = bg;
+    }
+  }
+}
+
 bool ColorWheel::onProcessMessage(ui::Message* msg)
 {
   switch (msg->type()) {
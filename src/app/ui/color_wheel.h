@@ -46,9 +46,11 @@ namespace app {
 
   private:
     app::Color getColorInClientPos(const gfx::Point& pos);
+    app::Color getColorInWheel(const gfx::Point& pos) const;
     void onResize(ui::ResizeEvent& ev) override;
     void onPaint(ui::PaintEvent& ev) override;
     bool onProcessMessage(ui::Message* msg) override;
+    void onRenderGradient(doc::Image* image, const gfx::Rect& rc) override;
     void onOptions();
     int getHarmonies() const;
     app::Color getColorInHarmony(int i) const;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -56,6 +56,7 @@ ConfigureTimelinePopup::ConfigureTimelinePopup()
   m_box->currentLayer()->Click.connect(base::Bind<void>(&ConfigureTimelinePopup::onCurrentLayerChange, this));
   m_box->behind()->Click.connect(base::Bind<void>(&ConfigureTimelinePopup::onPositionChange, this));
   m_box->infront()->Click.connect(base::Bind<void>(&ConfigureTimelinePopup::onPositionChange, this));
+  m_box->thumbnails()->Click.connect(base::Bind<void>(&ConfigureTimelinePopup::onThumbnailsChange, this));
 }
 
 app::Document* ConfigureTimelinePopup::doc()
@@ -103,6 +104,8 @@ void ConfigureTimelinePopup::updateWidgetsFromCurrentSettings()
       m_box->infront()->setSelected(true);
       break;
   }
+
+  m_box->thumbnails()->setSelected(docPref.thumbnails.enabled());
 }
 
 bool ConfigureTimelinePopup::onProcessMessage(ui::Message* msg)
@@ -175,4 +178,10 @@ void ConfigureTimelinePopup::onPositionChange()
                                render::OnionskinPosition::INFRONT);
 }
 
+void ConfigureTimelinePopup::onThumbnailsChange()
+{
+  docPref().thumbnails.enabled(m_box->thumbnails()->isSelected());
+  App::instance()->timeline()->invalidate();
+}
+
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -40,6 +40,7 @@ namespace app {
     void onLoopTagChange();
     void onCurrentLayerChange();
     void onPositionChange();
+    void onThumbnailsChange();
 
   private:
     void updateWidgetsFromCurrentSettings();
@@ -212,6 +212,7 @@ void BrushPreview::show(const gfx::Point& screenPos)
           loop,
           brushBounds.x-origBrushBounds.x,
           brushBounds.y-origBrushBounds.y);
+        loop->getPointShape()->flushPointShape(loop);
       }
     }
 
@@ -37,6 +37,7 @@
 #include "app/ui/editor/moving_pixels_state.h"
 #include "app/ui/editor/pixels_movement.h"
 #include "app/ui/editor/play_state.h"
+#include "app/ui/editor/playback_prefetcher.h"
 #include "app/ui/editor/standby_state.h"
 #include "app/ui/main_window.h"
 #include "app/ui/skin/skin_theme.h"
@@ -168,6 +169,7 @@ Editor::Editor(Document* document, EditorFlags flags)
   , m_flags(flags)
   , m_secondaryButton(false)
   , m_aniSpeed(1.0)
+  , m_prefetcher(nullptr)
 {
   // Add the first state into the history.
   m_statesHistory.push(m_state);
@@ -437,6 +439,18 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
   if (rc.isEmpty())
     return;
 
+  // Use the frame rendered in background by the playback
+  if (m_prefetcher) {
+    ExtraCelRef extraCel = m_document->extraCel();
+    if ((!extraCel || extraCel->type() == render::ExtraType::NONE) &&
+        m_prefetcher->drawFrame(g, m_frame, rc, dest_x, dest_y)) {
+      m_brushPreview.invalidateRegion(
+        gfx::Region(
+          gfx::Rect(dest_x, dest_y, rc.w, rc.h)));
+      return;
+    }
+  }
+
   // Generate the rendered image
   if (!m_renderBuffer)
     m_renderBuffer.reset(new doc::ImageBuffer());
@@ -470,30 +484,9 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
     m_renderEngine.setupBackground(m_document, rendered->pixelFormat());
     m_renderEngine.disableOnionskin();
 
-    if ((m_flags & kShowOnionskin) == kShowOnionskin) {
-      if (m_docPref.onionskin.active()) {
-        OnionskinOptions opts(
-          (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
-           render::OnionskinType::MERGE:
-           (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
-            render::OnionskinType::RED_BLUE_TINT:
-            render::OnionskinType::NONE)));
-
-        opts.position(m_docPref.onionskin.position());
-        opts.prevFrames(m_docPref.onionskin.prevFrames());
-        opts.nextFrames(m_docPref.onionskin.nextFrames());
-        opts.opacityBase(m_docPref.onionskin.opacityBase());
-        opts.opacityStep(m_docPref.onionskin.opacityStep());
-        opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
-
-        FrameTag* tag = nullptr;
-        if (m_docPref.onionskin.loopTag())
-          tag = m_sprite->frameTags().innerTag(m_frame);
-        opts.loopTag(tag);
-
-        m_renderEngine.setOnionskin(opts);
-      }
-    }
+    OnionskinOptions opts(render::OnionskinType::NONE);
+    if (getOnionskinOptions(m_frame, opts))
+      m_renderEngine.setOnionskin(opts);
 
     ExtraCelRef extraCel = m_document->extraCel();
     if (extraCel && extraCel->type() != render::ExtraType::NONE) {
@@ -544,6 +537,33 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
   }
 }
 
+bool Editor::getOnionskinOptions(frame_t frame, render::OnionskinOptions& opts)
+{
+  if ((m_flags & kShowOnionskin) != kShowOnionskin ||
+      !m_docPref.onionskin.active())
+    return false;
+
+  opts.type(
+    (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
+     render::OnionskinType::MERGE:
+     (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
+      render::OnionskinType::RED_BLUE_TINT:
+      render::OnionskinType::NONE)));
+
+  opts.position(m_docPref.onionskin.position());
+  opts.prevFrames(m_docPref.onionskin.prevFrames());
+  opts.nextFrames(m_docPref.onionskin.nextFrames());
+  opts.opacityBase(m_docPref.onionskin.opacityBase());
+  opts.opacityStep(m_docPref.onionskin.opacityStep());
+  opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
+
+  FrameTag* tag = nullptr;
+  if (m_docPref.onionskin.loopTag())
+    tag = m_sprite->frameTags().innerTag(frame);
+  opts.loopTag(tag);
+  return true;
+}
+
 void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
 {
   gfx::Rect rc = _rc;
@@ -1361,6 +1381,10 @@ void Editor::onPaint(ui::PaintEvent& ev)
       else {
         m_antsTimer.stop();
       }
+
+      // Show that the playback is dropping frames
+      if (m_prefetcher && m_prefetcher->isBehind())
+        drawPlaybackBehindIndicator(g);
     }
     catch (const LockedDocumentException&) {
       // The sprite is locked to be read, so we can draw an opaque
@@ -1371,6 +1395,18 @@ void Editor::onPaint(ui::PaintEvent& ev)
   }
 }
 
+void Editor::drawPlaybackBehindIndicator(ui::Graphics* g)
+{
+  View* view = View::getView(this);
+  if (!view)
+    return;
+
+  gfx::Rect vp = view->viewportBounds().offset(-bounds().origin());
+  int size = 6*guiscale();
+  g->fillRect(gfx::rgba(255, 0, 0),
+              gfx::Rect(vp.x2()-2*size, vp.y+size, size, size));
+}
+
 void Editor::onInvalidateRegion(const gfx::Region& region)
 {
   Widget::onInvalidateRegion(region);
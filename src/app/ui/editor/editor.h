@@ -51,6 +51,7 @@ namespace app {
   class DocumentView;
   class EditorCustomizationDelegate;
   class PixelsMovement;
+  class PlaybackPrefetcher;
 
   namespace tools {
     class Ink;
@@ -212,6 +213,14 @@ namespace app {
     double getAnimationSpeedMultiplier() const;
     void setAnimationSpeedMultiplier(double speed);
 
+    // Frames rendered in background by the PlayState (it's not owned
+    // by the editor).
+    void setPlaybackPrefetcher(PlaybackPrefetcher* prefetcher) { m_prefetcher = prefetcher; }
+
+    // Returns false if the onionskin is disabled, or true and fills
+    // "opts" with the onionskin options to render the given frame.
+    bool getOnionskinOptions(frame_t frame, render::OnionskinOptions& opts);
+
     // Functions to be used in EditorState::onSetCursor()
     void showMouseCursor(ui::CursorType cursorType);
     void showBrushPreview(const gfx::Point& pos);
@@ -259,6 +268,7 @@ namespace app {
     // You should setup the clip of the screen before calling this
     // routine.
     void drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& rc, int dx, int dy);
+    void drawPlaybackBehindIndicator(ui::Graphics* g);
 
     gfx::Point calcExtraPadding(const render::Zoom& zoom);
 
@@ -328,6 +338,8 @@ namespace app {
     // Animation speed multiplier.
     double m_aniSpeed;
 
+    PlaybackPrefetcher* m_prefetcher;
+
     static doc::ImageBufferPtr m_renderBuffer;
 
     // The render engine must be shared between all editors so when a
@@ -44,6 +44,11 @@
 
 namespace app {
 
+// Time (in milliseconds) that the mouse must be stopped to start
+// rendering the RotSprite version of the transformation. It's also
+// used to check if the background job has finished.
+static const int kRotSpriteDelay = 100;
+
 template<typename T>
 static inline const base::Vector2d<double> point2Vector(const gfx::PointT<T>& pt) {
   return base::Vector2d<double>(pt.x, pt.y);
@@ -68,6 +73,9 @@ PixelsMovement::PixelsMovement(
   , m_originalImage(Image::createCopy(moveThis))
   , m_opaque(false)
   , m_maskColor(m_sprite->transparentColor())
+  , m_draftExtraImage(false)
+  , m_extraImageId(0)
+  , m_rotSpriteTimer(kRotSpriteDelay)
 {
   Transformation transform(mask->bounds());
   set_pivot_from_preferences(transform);
@@ -87,6 +95,7 @@ PixelsMovement::PixelsMovement(
   m_rotAlgoConn =
     Preferences::instance().selection.rotationAlgorithm.AfterChange.connect(
       base::Bind<void>(&PixelsMovement::onRotationAlgorithmChange, this));
+  m_rotSpriteTimer.Tick.connect(&PixelsMovement::onRotSpriteTimerTick, this);
 
   // The extra cel must be null, because if it's not null, it means
   // that someone else is using it (e.g. the editor brush preview),
@@ -126,6 +135,8 @@ PixelsMovement::PixelsMovement(
 
 PixelsMovement::~PixelsMovement()
 {
+  stopRotSpriteJob();
+
   delete m_originalImage;
   delete m_initialMask;
   delete m_currentMask;
@@ -486,6 +497,10 @@ void PixelsMovement::stampImage()
 
   {
     ContextWriter writer(m_reader, 1000);
+
+    // The stamped image must be the final one (not the preview)
+    redrawDraftExtraImage();
+
     {
       // Expand the canvas to paste the image in the fully visible
       // portion of sprite.
@@ -576,6 +591,7 @@ void PixelsMovement::dropImage()
 void PixelsMovement::discardImage(bool commit)
 {
   m_isDragging = false;
+  stopRotSpriteJob();
 
   // Deselect the mask (here we don't stamp the image)
   m_transaction.execute(new cmd::DeselectMask(m_document));
@@ -636,9 +652,111 @@ void PixelsMovement::redrawExtraImage()
   m_extraCel->setBlendMode(static_cast<LayerImage*>(m_layer)->blendMode());
   m_document->setExtraCel(m_extraCel);
 
+  // RotSprite is too slow to be used in each mouse movement, so
+  // while the user is dragging the handles we display the fast
+  // algorithm, and the RotSprite version is rendered in background
+  // when the mouse stops.
+  m_draftExtraImage =
+    (m_isDragging &&
+     rotationAlgorithm(m_originalImage) == tools::RotationAlgorithm::ROTSPRITE);
+  ++m_extraImageId;
+
+  // The job for the previous image isn't needed anymore
+  if (m_rotSpriteJob)
+    m_rotSpriteJob->cancel();
+
+  if (m_draftExtraImage || m_rotSpriteJob)
+    m_rotSpriteTimer.start();
+
   // Draw the transformed pixels in the extra-cel which is the chunk
   // of pixels that the user is moving.
-  drawImage(m_extraCel->image(), bounds.origin(), true);
+  drawImage(m_extraCel->image(), bounds.origin(), true, m_draftExtraImage);
+}
+
+// Replaces the fast preview in the extra cel with the final image
+// (without waiting the background job).
+void PixelsMovement::redrawDraftExtraImage()
+{
+  if (!m_draftExtraImage)
+    return;
+
+  stopRotSpriteJob();
+
+  const Cel* cel = m_extraCel->cel();
+  Image* image = m_extraCel->image();
+  drawImage(image, cel->position(), true);
+
+  m_document->notifySpritePixelsModified(
+    m_sprite, gfx::Region(gfx::Rect(cel->position(), image->size())),
+    m_site.frame());
+}
+
+void PixelsMovement::onRotSpriteTimerTick()
+{
+  if (m_rotSpriteJob) {
+    if (!m_rotSpriteJob->isDone())
+      return;
+
+    if (m_rotSpriteJob->id() == m_extraImageId &&
+        !m_rotSpriteJob->isCanceled()) {
+      try {
+        ContextWriter writer(m_reader, 250);
+        const Image* result = m_rotSpriteJob->image();
+        if (result) {
+          const Cel* cel = m_extraCel->cel();
+          m_extraCel->image()->copy(result, gfx::Clip(result->bounds()));
+          m_document->notifySpritePixelsModified(
+            m_sprite, gfx::Region(gfx::Rect(cel->position(), result->size())),
+            m_site.frame());
+        }
+        else {
+          StatusBar::instance()->showTip(1000,
+            "Not enough memory for RotSprite");
+        }
+        m_draftExtraImage = false;
+      }
+      catch (const LockedDocumentException&) {
+        // Try again in the next tick
+        return;
+      }
+    }
+
+    m_rotSpriteJob.reset(nullptr);
+  }
+
+  if (m_draftExtraImage)
+    startRotSpriteJob();
+  else
+    m_rotSpriteTimer.stop();
+}
+
+void PixelsMovement::startRotSpriteJob()
+{
+  ASSERT(!m_rotSpriteJob);
+
+  const Cel* cel = m_extraCel->cel();
+  const Image* image = m_extraCel->image();
+  base::UniquePtr<Image> dst(
+    Image::create(image->pixelFormat(), image->width(), image->height()));
+
+  // The background (original layer) is rendered here because the
+  // background thread cannot access the document.
+  prepareImage(dst, cel->position(), true);
+
+  Transformation::Corners corners;
+  m_currentData.transformBox(corners);
+
+  m_rotSpriteJob.reset(
+    new RotSpriteJob(m_extraImageId, dst.release(),
+                     m_originalImage, m_initialMask->bitmap(),
+                     corners, cel->position()));
+}
+
+void PixelsMovement::stopRotSpriteJob()
+{
+  m_rotSpriteTimer.stop();
+  m_rotSpriteJob.reset(nullptr);  // Waits the background thread
+  m_draftExtraImage = false;
 }
 
 void PixelsMovement::redrawCurrentMask()
@@ -646,7 +764,24 @@ void PixelsMovement::redrawCurrentMask()
   drawMask(m_currentMask, true);
 }
 
-void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer)
+void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer,
+                               bool draft)
+{
+  ASSERT(dst);
+
+  prepareImage(dst, pt, renderOriginalLayer);
+
+  Transformation::Corners corners;
+  m_currentData.transformBox(corners);
+
+  drawParallelogram(dst, m_originalImage, m_initialMask, corners, pt,
+                    (draft ? tools::RotationAlgorithm::FAST:
+                             rotationAlgorithm(m_originalImage)));
+}
+
+// Clears "dst" (or renders the original layer on it), and sets the
+// mask color of m_originalImage to draw it over "dst".
+void PixelsMovement::prepareImage(doc::Image* dst, const gfx::Point& pt, bool renderOriginalLayer)
 {
   ASSERT(dst);
 
@@ -677,8 +812,6 @@ void PixelsMovement::drawImage(doc::Image* dst, const gfx::Point& pt, bool rende
       maskColor = 0;
   }
   m_originalImage->setMaskColor(maskColor);
-
-  drawParallelogram(dst, m_originalImage, m_initialMask, corners, pt);
 }
 
 void PixelsMovement::drawMask(doc::Mask* mask, bool shrink)
@@ -694,7 +827,8 @@ void PixelsMovement::drawMask(doc::Mask* mask, bool shrink)
   drawParallelogram(mask->bitmap(),
                     m_initialMask->bitmap(),
                     nullptr,
-                    corners, bounds.origin());
+                    corners, bounds.origin(),
+                    rotationAlgorithm(m_initialMask->bitmap()));
   if (shrink)
     mask->unfreeze();
 }
@@ -702,18 +836,9 @@ void PixelsMovement::drawMask(doc::Mask* mask, bool shrink)
 void PixelsMovement::drawParallelogram(
   doc::Image* dst, const doc::Image* src, const doc::Mask* mask,
   const Transformation::Corners& corners,
-  const gfx::Point& leftTop)
+  const gfx::Point& leftTop,
+  tools::RotationAlgorithm rotAlgo)
 {
-  tools::RotationAlgorithm rotAlgo = Preferences::instance().selection.rotationAlgorithm();
-
-  // If the angle and the scale weren't modified, we should use the
-  // fast rotation algorithm, as it's pixel-perfect match with the
-  // original selection when just a translation is applied.
-  if (m_currentData.angle() == 0.0 &&
-      gfx::Rect(m_currentData.bounds()).size() == src->size()) {
-    rotAlgo = tools::RotationAlgorithm::FAST;
-  }
-
 retry:;      // In case that we don't have enough memory for RotSprite
              // we can try with the fast algorithm anyway.
 
@@ -757,6 +882,19 @@ retry:;      // In case that we don't have enough memory for RotSprite
   }
 }
 
+tools::RotationAlgorithm PixelsMovement::rotationAlgorithm(const doc::Image* src) const
+{
+  // If the angle and the scale weren't modified, we should use the
+  // fast rotation algorithm, as it's pixel-perfect match with the
+  // original selection when just a translation is applied.
+  if (m_currentData.angle() == 0.0 &&
+      gfx::Rect(m_currentData.bounds()).size() == src->size()) {
+    return tools::RotationAlgorithm::FAST;
+  }
+
+  return Preferences::instance().selection.rotationAlgorithm();
+}
+
 void PixelsMovement::onPivotChange()
 {
   set_pivot_from_preferences(m_currentData);
@@ -11,13 +11,17 @@
 
 #include "app/context_access.h"
 #include "app/extra_cel.h"
+#include "app/tools/rotation_algorithm.h"
 #include "app/transaction.h"
 #include "app/ui/editor/handle_type.h"
+#include "app/ui/editor/rotsprite_job.h"
 #include "base/connection.h"
 #include "base/shared_ptr.h"
+#include "base/unique_ptr.h"
 #include "doc/algorithm/flip_type.h"
 #include "doc/site.h"
 #include "gfx/size.h"
+#include "ui/timer.h"
 
 namespace doc {
   class Image;
@@ -99,13 +103,21 @@ namespace app {
   private:
     void onPivotChange();
     void onRotationAlgorithmChange();
+    void onRotSpriteTimerTick();
     void redrawExtraImage();
     void redrawCurrentMask();
-    void drawImage(doc::Image* dst, const gfx::Point& pos, bool renderOriginalLayer);
+    void prepareImage(doc::Image* dst, const gfx::Point& pos, bool renderOriginalLayer);
+    void drawImage(doc::Image* dst, const gfx::Point& pos, bool renderOriginalLayer,
+                   bool draft = false);
     void drawMask(doc::Mask* dst, bool shrink);
     void drawParallelogram(doc::Image* dst, const doc::Image* src, const doc::Mask* mask,
       const Transformation::Corners& corners,
-      const gfx::Point& leftTop);
+      const gfx::Point& leftTop,
+      tools::RotationAlgorithm rotAlgo);
+    tools::RotationAlgorithm rotationAlgorithm(const doc::Image* src) const;
+    void startRotSpriteJob();
+    void stopRotSpriteJob();
+    void redrawDraftExtraImage();
     void updateDocumentMask();
 
     const ContextReader m_reader;
@@ -130,6 +142,16 @@ namespace app {
     base::ScopedConnection m_pivotPosConn;
     base::ScopedConnection m_rotAlgoConn;
     ExtraCelRef m_extraCel;
+
+    // True if the extra cel contains a fast preview of a RotSprite
+    // transformation (displayed while the user drags the handles).
+    // The RotSprite version is rendered by m_rotSpriteJob when the
+    // mouse stops, and m_extraImageId identifies the extra cel
+    // content that the job is rendering.
+    bool m_draftExtraImage;
+    int m_extraImageId;
+    ui::Timer m_rotSpriteTimer;
+    base::UniquePtr<RotSpriteJob> m_rotSpriteJob;
   };
 
   inline PixelsMovement::MoveModifier& operator|=(PixelsMovement::MoveModifier& a,
@@ -16,6 +16,7 @@
 #include "app/loop_tag.h"
 #include "app/pref/preferences.h"
 #include "app/ui/editor/editor.h"
+#include "app/ui/editor/playback_prefetcher.h"
 #include "app/ui/editor/scrolling_state.h"
 #include "app/ui_context.h"
 #include "doc/frame_tag.h"
@@ -24,6 +25,9 @@
 #include "ui/message.h"
 #include "ui/system.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace ui;
@@ -44,6 +48,10 @@ PlayState::PlayState(bool playOnce)
     &PlayState::onBeforeCommandExecution, this);
 }
 
+PlayState::~PlayState()
+{
+}
+
 void PlayState::onEnterState(Editor* editor)
 {
   StateWithWheelBehavior::onEnterState(editor);
@@ -77,6 +85,8 @@ void PlayState::onEnterState(Editor* editor)
   // running.
   if (!m_playTimer.isRunning())
     m_playTimer.start();
+
+  updatePrefetcher();
 }
 
 EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* newState)
@@ -88,6 +98,7 @@ EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* ne
     // We don't stop the timer if we are going to the ScrollingState
     // (we keep playing the animation).
     m_playTimer.stop();
+    destroyPrefetcher();
   }
   return KeepState;
 }
@@ -174,8 +185,10 @@ void PlayState::onPlaybackTick()
         atEnd = (frame == sprite->lastFrame());
       }
       if (atEnd) {
+        // Here this state is popped from the editor (and deleted),
+        // so we cannot access members anymore.
         m_editor->stop();
-        break;
+        return;
       }
     }
 
@@ -188,6 +201,11 @@ void PlayState::onPlaybackTick()
     m_editor->invalidate();
   }
 
+  // We can be in the ScrollingState (the prefetcher is updated when
+  // we come back to this state)
+  if (m_editor->isPlaying())
+    updatePrefetcher();
+
   m_curFrameTick = base::current_tick();
 }
 
@@ -227,4 +245,53 @@ double PlayState::getNextFrameTime()
     / m_editor->getAnimationSpeedMultiplier(); // The "speed multiplier" is a "duration divider"
 }
 
+// Starts rendering the next frames (from the active frame of the
+// editor) in a background thread. If the zoom or the scroll of the
+// editor changed, the old rendered frames are discarded.
+void PlayState::updatePrefetcher()
+{
+  gfx::Rect visibleBounds = m_editor->getVisibleSpriteBounds();
+  if (visibleBounds.isEmpty()) {
+    destroyPrefetcher();
+    return;
+  }
+
+  if (!m_prefetcher ||
+      !m_prefetcher->isValidFor(m_editor->zoom(), visibleBounds)) {
+    destroyPrefetcher();
+    m_prefetcher.reset(new PlaybackPrefetcher(m_editor, visibleBounds));
+    m_editor->setPlaybackPrefetcher(m_prefetcher);
+  }
+
+  // Same sequence of frames that onPlaybackTick() will follow
+  doc::Sprite* sprite = m_editor->sprite();
+  doc::FrameTag* tag = get_animation_tag(sprite, m_refFrame);
+  bool pingPongForward = m_pingPongForward;
+  doc::frame_t frame = m_editor->frame();
+
+  std::vector<doc::frame_t> frames;
+  frames.push_back(frame);
+  while (frames.size() < PlaybackPrefetcher::kFrames) {
+    frame = calculate_next_frame(
+      sprite, frame, frame_t(1), tag,
+      pingPongForward);
+
+    // Short loops
+    if (std::find(frames.begin(), frames.end(), frame) != frames.end())
+      break;
+
+    frames.push_back(frame);
+  }
+
+  m_prefetcher->setNextFrames(frames);
+}
+
+void PlayState::destroyPrefetcher()
+{
+  if (m_prefetcher) {
+    m_editor->setPlaybackPrefetcher(nullptr);
+    m_prefetcher.reset();
+  }
+}
+
 } // namespace app
@@ -12,16 +12,19 @@
 #include "app/ui/editor/state_with_wheel_behavior.h"
 #include "base/connection.h"
 #include "base/time.h"
+#include "base/unique_ptr.h"
 #include "doc/frame.h"
 #include "ui/timer.h"
 
 namespace app {
 
   class CommandExecutionEvent;
+  class PlaybackPrefetcher;
 
   class PlayState : public StateWithWheelBehavior {
   public:
     PlayState(bool playOnce);
+    ~PlayState();
 
     void onEnterState(Editor* editor) override;
     LeaveAction onLeaveState(Editor* editor, EditorState* newState) override;
@@ -38,6 +41,8 @@ namespace app {
     void onBeforeCommandExecution(CommandExecutionEvent& ev);
 
     double getNextFrameTime();
+    void updatePrefetcher();
+    void destroyPrefetcher();
 
     Editor* m_editor;
     bool m_playOnce;
@@ -53,6 +58,9 @@ namespace app {
     doc::frame_t m_refFrame;
 
     base::ScopedConnection m_ctxConn;
+
+    // Renders the next frames in a background thread.
+    base::UniquePtr<PlaybackPrefetcher> m_prefetcher;
   };
 
 } // namespace app
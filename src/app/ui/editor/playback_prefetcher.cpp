@@ -0,0 +1,243 @@
+// Aseprite
+// Copyright (C) 2001-2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/playback_prefetcher.h"
+
+#include "app/document.h"
+#include "app/ui/editor/editor.h"
+#include "base/bind.h"
+#include "base/scoped_lock.h"
+#include "doc/conversion_she.h"
+#include "doc/frame_tag.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+#include "she/surface.h"
+#include "she/system.h"
+#include "ui/graphics.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace app {
+
+// Number of frames that the editor shows the "behind" indicator after
+// a frame that wasn't ready in time.
+static const int kBehindFrames = 8;
+
+PlaybackPrefetcher::PlaybackPrefetcher(Editor* editor, const gfx::Rect& spriteBounds)
+  : m_document(editor->document())
+  , m_sprite(editor->sprite())
+  , m_zoom(editor->zoom())
+  , m_spriteBounds(spriteBounds)
+  , m_bounds(m_zoom.apply(spriteBounds))
+  , m_onionskinOpts(render::OnionskinType::NONE)
+  , m_lastDrawnFrame(editor->frame()) // The current frame isn't prefetched
+  , m_behind(0)
+  , m_done(false)
+{
+  // Render options are taken from the GUI thread (preferences)
+  m_render.setupBackground(m_document, doc::IMAGE_RGB);
+  m_onionskin = editor->getOnionskinOptions(editor->frame(), m_onionskinOpts);
+  m_onionskinLoopTag = editor->docPref().onionskin.loopTag();
+
+  for (Slot& slot : m_slots) {
+    slot.frame = -1;
+    slot.state = SlotState::Empty;
+    slot.image = doc::Image::create(
+      doc::IMAGE_RGB,
+      std::max(1, m_bounds.w),
+      std::max(1, m_bounds.h));
+    slot.surface = she::instance()->createRgbaSurface(
+      slot.image->width(),
+      slot.image->height());
+    slot.converted = false;
+  }
+
+  m_thread.reset(new base::thread(
+      base::Bind<void>(&PlaybackPrefetcher::prefetchThread, this)));
+}
+
+PlaybackPrefetcher::~PlaybackPrefetcher()
+{
+  {
+    base::scoped_lock lock(m_mutex);
+    m_done = true;
+  }
+  m_wakeUp.notify_all();
+  m_thread->join();
+
+  for (Slot& slot : m_slots) {
+    delete slot.image;
+    slot.surface->dispose();
+  }
+}
+
+bool PlaybackPrefetcher::isValidFor(const render::Zoom& zoom, const gfx::Rect& spriteBounds) const
+{
+  return (m_zoom == zoom && m_spriteBounds.contains(spriteBounds));
+}
+
+void PlaybackPrefetcher::setNextFrames(const std::vector<doc::frame_t>& frames)
+{
+  {
+    base::scoped_lock lock(m_mutex);
+    m_nextFrames = frames;
+
+    // Discard frames that aren't needed anymore (the frame that is
+    // being rendered is discarded by the background thread itself).
+    for (Slot& slot : m_slots) {
+      if (slot.state == SlotState::Ready &&
+          std::find(frames.begin(), frames.end(), slot.frame) == frames.end()) {
+        slot.state = SlotState::Empty;
+      }
+    }
+  }
+  m_wakeUp.notify_one();
+}
+
+bool PlaybackPrefetcher::drawFrame(ui::Graphics* g, doc::frame_t frame,
+                                   const gfx::Rect& rc, int dest_x, int dest_y)
+{
+  Slot* ready = nullptr;
+  if (m_bounds.contains(rc)) {
+    base::scoped_lock lock(m_mutex);
+    for (Slot& slot : m_slots) {
+      if (slot.state == SlotState::Ready && slot.frame == frame) {
+        ready = &slot;
+        break;
+      }
+    }
+  }
+
+  // Count hits/misses only one time per displayed frame (the same
+  // frame can be drawn several times, e.g. in tiled mode).
+  if (m_lastDrawnFrame != frame) {
+    m_lastDrawnFrame = frame;
+    if (!ready)
+      m_behind = kBehindFrames;
+    else if (m_behind > 0)
+      --m_behind;
+  }
+
+  if (!ready)
+    return false;
+
+  // The image of a ready slot is not modified until the frame is
+  // removed with setNextFrames() (from this same GUI thread).
+  if (!ready->converted) {
+    convert_image_to_surface(ready->image, nullptr, ready->surface,
+                             0, 0, 0, 0, m_bounds.w, m_bounds.h);
+    ready->converted = true;
+  }
+
+  g->blit(ready->surface,
+          rc.x - m_bounds.x,
+          rc.y - m_bounds.y,
+          dest_x, dest_y, rc.w, rc.h);
+  return true;
+}
+
+void PlaybackPrefetcher::prefetchThread()
+{
+  while (true) {
+    doc::frame_t frame = -1;
+    Slot* slot = nullptr;
+    {
+      base::scoped_lock lock(m_mutex);
+
+      // Wait until there is a frame to render (and a free slot)
+      while (!m_done && !(slot = nextSlot(frame)))
+        m_wakeUp.wait(m_mutex);
+
+      if (m_done)
+        break;
+    }
+
+    bool ok = renderFrame(frame, slot->image);
+    {
+      base::scoped_lock lock(m_mutex);
+      if (ok && std::find(m_nextFrames.begin(),
+                          m_nextFrames.end(), frame) != m_nextFrames.end())
+        slot->state = SlotState::Ready;
+      else
+        slot->state = SlotState::Empty;
+
+      // The document is locked, try again later
+      if (!ok && !m_done)
+        m_wakeUp.wait_for(m_mutex, std::chrono::milliseconds(5));
+    }
+  }
+}
+
+// Returns a free slot to render the first frame of m_nextFrames that
+// isn't rendered yet (or nullptr if there is nothing to do). It must
+// be called with m_mutex locked.
+PlaybackPrefetcher::Slot* PlaybackPrefetcher::nextSlot(doc::frame_t& frame)
+{
+  frame = -1;
+  for (doc::frame_t f : m_nextFrames) {
+    bool found = false;
+    for (const Slot& s : m_slots) {
+      if (s.state != SlotState::Empty && s.frame == f) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      frame = f;
+      break;
+    }
+  }
+
+  if (frame >= 0) {
+    for (Slot& s : m_slots) {
+      if (s.state == SlotState::Empty) {
+        s.frame = frame;
+        s.state = SlotState::Rendering;
+        s.converted = false;
+        return &s;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool PlaybackPrefetcher::renderFrame(doc::frame_t frame, doc::Image* image)
+{
+  if (m_bounds.isEmpty())
+    return false;
+
+  if (!m_document->lock(Document::ReadLock, 0))
+    return false;
+
+  try {
+    if (m_onionskin) {
+      render::OnionskinOptions opts = m_onionskinOpts;
+      if (m_onionskinLoopTag)
+        opts.loopTag(m_sprite->frameTags().innerTag(frame));
+      m_render.setOnionskin(opts);
+    }
+    else
+      m_render.disableOnionskin();
+
+    m_render.renderSprite(image, m_sprite, frame,
+                          gfx::Clip(0, 0, m_bounds), m_zoom);
+  }
+  catch (const std::exception&) {
+    m_document->unlock();
+    return false;
+  }
+
+  m_document->unlock();
+  return true;
+}
+
+} // namespace app
@@ -0,0 +1,127 @@
+// Aseprite
+// Copyright (C) 2001-2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_UI_EDITOR_PLAYBACK_PREFETCHER_H_INCLUDED
+#define APP_UI_EDITOR_PLAYBACK_PREFETCHER_H_INCLUDED
+#pragma once
+
+#include "app/app_render.h"
+#include "base/disable_copying.h"
+#include "base/mutex.h"
+#include "base/thread.h"
+#include "base/unique_ptr.h"
+#include "doc/frame.h"
+#include "gfx/rect.h"
+#include "render/render.h"
+#include "render/zoom.h"
+
+#include <condition_variable>
+#include <vector>
+
+namespace doc {
+  class Image;
+  class Sprite;
+}
+
+namespace she {
+  class Surface;
+}
+
+namespace ui {
+  class Graphics;
+}
+
+namespace app {
+  class Document;
+  class Editor;
+
+  // Renders the next frames of the animation in a background thread
+  // while PlayState displays the current one. Frames are rendered
+  // with the zoom of the editor in doc::Image objects, and converted
+  // to surfaces in the GUI thread when they are displayed (surfaces
+  // cannot be used from other threads).
+  class PlaybackPrefetcher {
+  public:
+    // Number of frames that can be rendered in advance (including
+    // the displayed one).
+    enum { kFrames = 4 };
+
+    // Prefetches the "spriteBounds" area of the editor sprite. It
+    // must be created from the GUI thread.
+    PlaybackPrefetcher(Editor* editor, const gfx::Rect& spriteBounds);
+    ~PlaybackPrefetcher();
+
+    // Returns true if the rendered frames can be used to display the
+    // given area with the given zoom.
+    bool isValidFor(const render::Zoom& zoom, const gfx::Rect& spriteBounds) const;
+
+    // Sets the frames to render (in the order that they will be
+    // displayed). Rendered frames that aren't in the list are
+    // discarded.
+    void setNextFrames(const std::vector<doc::frame_t>& frames);
+
+    // Draws the "rc" area (in zoomed sprite coordinates) of the given
+    // frame in "g". Returns false if the frame isn't ready yet (so
+    // it must be rendered by the editor).
+    bool drawFrame(ui::Graphics* g, doc::frame_t frame,
+                   const gfx::Rect& rc, int dest_x, int dest_y);
+
+    // Returns true if some of the latest displayed frames weren't
+    // ready in time.
+    bool isBehind() const { return (m_behind > 0); }
+
+  private:
+    enum class SlotState { Empty, Rendering, Ready };
+
+    struct Slot {
+      doc::frame_t frame;
+      SlotState state;
+      // Rendered by the background thread.
+      doc::Image* image;
+      // Used only from the GUI thread. "converted" is true if the
+      // surface already contains the image of a ready slot.
+      she::Surface* surface;
+      bool converted;
+    };
+
+    void prefetchThread();
+    Slot* nextSlot(doc::frame_t& frame);
+    bool renderFrame(doc::frame_t frame, doc::Image* image);
+
+    Document* m_document;
+    doc::Sprite* m_sprite;
+    render::Zoom m_zoom;
+    gfx::Rect m_spriteBounds;
+    gfx::Rect m_bounds;               // m_spriteBounds with zoom
+
+    // Used only from the background thread.
+    AppRender m_render;
+    bool m_onionskin;
+    bool m_onionskinLoopTag;
+    render::OnionskinOptions m_onionskinOpts;
+
+    // Used only from the GUI thread. m_behind is the number of
+    // frames to display (after a missed frame) until isBehind()
+    // returns false again.
+    doc::frame_t m_lastDrawnFrame;
+    int m_behind;
+
+    // Protected by m_mutex. m_wakeUp is notified when there are new
+    // frames to render or the thread must finish (m_done).
+    mutable base::mutex m_mutex;
+    std::condition_variable_any m_wakeUp;
+    std::vector<doc::frame_t> m_nextFrames;
+    Slot m_slots[kFrames];
+    bool m_done;
+    base::UniquePtr<base::thread> m_thread;
+
+    DISABLE_COPYING(PlaybackPrefetcher);
+  };
+
+} // namespace app
+
+#endif
@@ -0,0 +1,110 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/rotsprite_job.h"
+
+#include "base/bind.h"
+#include "base/scoped_lock.h"
+#include "doc/algorithm/rotsprite.h"
+#include "doc/image.h"
+
+#include <new>
+
+namespace app {
+
+RotSpriteJob::RotSpriteJob(int id,
+                           doc::Image* dst,
+                           const doc::Image* src,
+                           const doc::Image* mask,
+                           const Transformation::Corners& corners,
+                           const gfx::Point& leftTop)
+  : m_id(id)
+  , m_dst(dst)
+  // The copies share the pixels with the original images (until the
+  // originals are modified from the GUI thread)
+  , m_src(doc::Image::createCopy(src))
+  , m_mask(mask ? doc::Image::createCopy(mask): nullptr)
+  , m_canceled(false)
+  , m_done(false)
+  , m_ok(false)
+{
+  m_corners[0] = int(corners.leftTop().x-leftTop.x);
+  m_corners[1] = int(corners.leftTop().y-leftTop.y);
+  m_corners[2] = int(corners.rightTop().x-leftTop.x);
+  m_corners[3] = int(corners.rightTop().y-leftTop.y);
+  m_corners[4] = int(corners.rightBottom().x-leftTop.x);
+  m_corners[5] = int(corners.rightBottom().y-leftTop.y);
+  m_corners[6] = int(corners.leftBottom().x-leftTop.x);
+  m_corners[7] = int(corners.leftBottom().y-leftTop.y);
+
+  m_thread.reset(new base::thread(
+      base::Bind<void>(&RotSpriteJob::transformThread, this)));
+}
+
+RotSpriteJob::~RotSpriteJob()
+{
+  cancel();
+  m_thread->join();
+}
+
+void RotSpriteJob::cancel()
+{
+  base::scoped_lock lock(m_mutex);
+  m_canceled = true;
+}
+
+bool RotSpriteJob::isCanceled() const
+{
+  base::scoped_lock lock(m_mutex);
+  return m_canceled;
+}
+
+bool RotSpriteJob::isDone() const
+{
+  base::scoped_lock lock(m_mutex);
+  return m_done;
+}
+
+const doc::Image* RotSpriteJob::image() const
+{
+  base::scoped_lock lock(m_mutex);
+  ASSERT(m_done);
+  if (m_done && m_ok && !m_canceled)
+    return m_dst.get();
+  else
+    return nullptr;
+}
+
+void RotSpriteJob::transformThread()
+{
+  bool ok = false;
+
+  if (!isCanceled()) {
+    try {
+      doc::algorithm::rotsprite_image(
+        m_dst, m_src, m_mask,
+        m_corners[0], m_corners[1],
+        m_corners[2], m_corners[3],
+        m_corners[4], m_corners[5],
+        m_corners[6], m_corners[7]);
+      ok = true;
+    }
+    catch (const std::bad_alloc&) {
+      // The GUI thread will use the fast algorithm
+    }
+  }
+
+  base::scoped_lock lock(m_mutex);
+  m_ok = ok;
+  m_done = true;
+}
+
+} // namespace app
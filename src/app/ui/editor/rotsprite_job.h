@@ -0,0 +1,78 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_UI_EDITOR_ROTSPRITE_JOB_H_INCLUDED
+#define APP_UI_EDITOR_ROTSPRITE_JOB_H_INCLUDED
+#pragma once
+
+#include "app/transformation.h"
+#include "base/disable_copying.h"
+#include "base/mutex.h"
+#include "base/thread.h"
+#include "base/unique_ptr.h"
+#include "gfx/point.h"
+
+namespace doc {
+  class Image;
+}
+
+namespace app {
+
+  // Transforms an image with the RotSprite algorithm in a background
+  // thread. PixelsMovement uses it to replace the fast preview that
+  // is displayed while the user drags the transformation handles.
+  class RotSpriteJob {
+  public:
+    // Takes the ownership of "dst" (the background where "src" is
+    // drawn, generally the original layer). "src" and "mask" are
+    // copied, so they can be modified after this call.
+    RotSpriteJob(int id,
+                 doc::Image* dst,
+                 const doc::Image* src,
+                 const doc::Image* mask,
+                 const Transformation::Corners& corners,
+                 const gfx::Point& leftTop);
+
+    // Waits the background thread.
+    ~RotSpriteJob();
+
+    int id() const { return m_id; }
+
+    // The thread cannot be interrupted in the middle of the
+    // algorithm, a canceled job just doesn't render anything if it
+    // wasn't started yet, and its result must be discarded.
+    void cancel();
+    bool isCanceled() const;
+
+    bool isDone() const;
+
+    // Returns the transformed image, or nullptr if the job was
+    // canceled or there wasn't enough memory. It can be called only
+    // when isDone() is true.
+    const doc::Image* image() const;
+
+  private:
+    void transformThread();
+
+    int m_id;
+    base::UniquePtr<doc::Image> m_dst;
+    base::UniquePtr<doc::Image> m_src;
+    base::UniquePtr<doc::Image> m_mask;
+    int m_corners[8];
+
+    mutable base::mutex m_mutex;
+    bool m_canceled;
+    bool m_done;
+    bool m_ok;
+    base::UniquePtr<base::thread> m_thread;
+
+    DISABLE_COPYING(RotSpriteJob);
+  };
+
+} // namespace app
+
+#endif
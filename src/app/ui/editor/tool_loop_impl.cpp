@@ -49,6 +49,10 @@
 #include "render/render.h"
 #include "ui/ui.h"
 
+#include <algorithm>
+#include <climits>
+#include <vector>
+
 namespace app {
 
 using namespace ui;
@@ -272,6 +276,12 @@ class ToolLoopImpl : public ToolLoopBase {
   ExpandCelCanvas* m_expandCelCanvas;
   Image* m_floodfillSrcImage;
 
+  // Horizontal extent of the pixels painted in each row of the
+  // destination canvas by the last trace, so invalidateDstImage()
+  // can restore just those pixels (for TracePolicy::Last tools).
+  std::vector<std::pair<int, int> > m_tracedRows;
+  int m_tracedY1, m_tracedY2;
+
 public:
   ToolLoopImpl(Editor* editor,
                Layer* layer,
@@ -296,6 +306,8 @@ public:
                                             ModifyDocument))
     , m_expandCelCanvas(nullptr)
     , m_floodfillSrcImage(nullptr)
+    , m_tracedY1(INT_MAX)
+    , m_tracedY2(INT_MIN)
   {
     ASSERT(m_context->activeDocument() == m_editor->document());
 
@@ -445,7 +457,17 @@ public:
     m_expandCelCanvas->validateDestCanvas(rgn);
   }
   void invalidateDstImage() override {
-    m_expandCelCanvas->invalidateDestCanvas();
+    // Only pixels painted by the last trace are different from the
+    // source, the rest of the valid destination region can be kept.
+    for (int y=m_tracedY1; y<=m_tracedY2; ++y) {
+      auto& row = m_tracedRows[y];
+      if (row.first <= row.second) {
+        m_expandCelCanvas->restoreDestCanvasHline(row.first, y, row.second);
+        row = std::make_pair(INT_MAX, INT_MIN);
+      }
+    }
+    m_tracedY1 = INT_MAX;
+    m_tracedY2 = INT_MIN;
   }
   void invalidateDstImage(const gfx::Region& rgn) override {
     m_expandCelCanvas->invalidateDestCanvas(rgn);
@@ -453,6 +475,23 @@ public:
   void copyValidDstToSrcImage(const gfx::Region& rgn) override {
     m_expandCelCanvas->copyValidDestToSourceCanvas(rgn);
   }
+  void onInkHline(int x1, int y, int x2) override {
+    if (m_tracePolicy != tools::TracePolicy::Last)
+      return;
+
+    if (m_tracedRows.empty())
+      m_tracedRows.resize(getDstImage()->height(),
+                          std::make_pair(INT_MAX, INT_MIN));
+
+    if (y < 0 || y >= int(m_tracedRows.size()))
+      return;
+
+    auto& row = m_tracedRows[y];
+    row.first = std::min(row.first, x1);
+    row.second = std::max(row.second, x2);
+    m_tracedY1 = std::min(m_tracedY1, y);
+    m_tracedY2 = std::max(m_tracedY2, y);
+  }
 
   bool useMask() override { return m_useMask; }
   Mask* getMask() override { return m_mask; }
@@ -591,6 +630,7 @@ public:
   void invalidateDstImage() override { }
   void invalidateDstImage(const gfx::Region& rgn) override { }
   void copyValidDstToSrcImage(const gfx::Region& rgn) override { }
+  void onInkHline(int x1, int y, int x2) override { }
 
   bool useMask() override { return false; }
   Mask* getMask() override { return nullptr; }
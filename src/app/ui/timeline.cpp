@@ -29,6 +29,7 @@
 #include "app/modules/gui.h"
 #include "app/transaction.h"
 #include "app/ui/app_menuitem.h"
+#include "app/ui/cel_thumbnails.h"
 #include "app/ui/configure_timeline_popup.h"
 #include "app/ui/document_view.h"
 #include "app/ui/editor/editor.h"
@@ -68,6 +69,9 @@
 // Height of the layers.
 #define LAYSIZE         THUMBSIZE
 
+// Size of the cel thumbnails (the area inside the cel box).
+#define CELTHUMBSIZE    (THUMBSIZE-1*guiscale())
+
 // Space between icons and other information in the layer.
 #define ICONSEP         (2*guiscale())
 
@@ -132,6 +136,7 @@ Timeline::Timeline()
   , m_confPopup(NULL)
   , m_clipboard_timer(100, this)
   , m_offset_count(0)
+  , m_thumbnailsTimer(50, this)
   , m_scroll(false)
   , m_fromTimeline(false)
 {
@@ -158,6 +163,7 @@ Timeline::Timeline()
 Timeline::~Timeline()
 {
   m_clipboard_timer.stop();
+  m_thumbnailsTimer.stop();
 
   detachDocument();
   m_context->documents().removeObserver(this);
@@ -200,6 +206,13 @@ void Timeline::updateUsingEditor(Editor* editor)
 
   m_document = static_cast<app::Document*>(site.document());
   m_sprite = site.sprite();
+
+  // Thumbnails are kept while the same document is used (e.g. when
+  // the active editor changes).
+  if (m_thumbnails && m_thumbnails->document() != m_document) {
+    m_thumbnailsTimer.stop();
+    m_thumbnails.reset();
+  }
   m_layer = site.layer();
   m_frame = site.frame();
   m_state = STATE_STANDBY;
@@ -328,6 +341,9 @@ bool Timeline::onProcessMessage(Message* msg)
 
         invalidate();
       }
+      else if (static_cast<TimerMessage*>(msg)->timer() == &m_thumbnailsTimer) {
+        checkCelThumbnails();
+      }
       break;
 
     case kMouseDownMessage: {
@@ -934,6 +950,9 @@ void Timeline::onPaint(ui::PaintEvent& ev)
     getDrawableLayers(g, &first_layer, &last_layer);
     getDrawableFrames(g, &first_frame, &last_frame);
 
+    if (docPref().thumbnails.enabled())
+      requestCelThumbnails(first_layer, last_layer, first_frame, last_frame);
+
     drawTop(g);
 
     // Draw the header for layers.
@@ -1069,6 +1088,12 @@ void Timeline::onRemoveDocument(doc::Document* document)
 {
   if (document == m_document)
     detachDocument();
+
+  // Stop rendering thumbnails before the document is deleted
+  if (m_thumbnails && m_thumbnails->document() == document) {
+    m_thumbnailsTimer.stop();
+    m_thumbnails.reset();
+  }
 }
 
 void Timeline::onGeneralUpdate(DocumentEvent& ev)
@@ -1517,13 +1542,76 @@ void Timeline::drawCel(ui::Graphics* g, LayerIndex layerIndex, frame_t frame, Ce
     else
       style = styles.timelineKeyframe();
   }
-  drawPart(g, bounds, NULL, style, is_active, is_hover);
+
+  // The thumbnail of the cel (if it's already rendered) is drawn
+  // instead of the keyframe icon.
+  she::Surface* thumbnail = nullptr;
+  if (cel && m_thumbnails && docPref().thumbnails.enabled())
+    thumbnail = m_thumbnails->thumbnail(cel, gfx::Size(CELTHUMBSIZE, CELTHUMBSIZE));
+
+  if (thumbnail)
+    g->drawRgbaSurface(thumbnail, bounds.x+1*guiscale(), bounds.y+1*guiscale());
+  else
+    drawPart(g, bounds, NULL, style, is_active, is_hover);
 
   // Draw decorators to link the activeCel with its links.
   if (data->activeIt != data->end)
     drawCelLinkDecorators(g, bounds, cel, frame, is_active, is_hover, data);
 }
 
+void Timeline::requestCelThumbnails(LayerIndex first_layer, LayerIndex last_layer,
+                                    frame_t first_frame, frame_t last_frame)
+{
+  if (!m_thumbnails)
+    m_thumbnails.reset(new CelThumbnails(m_document));
+
+  // Only visible cels are rendered (the active layer first)
+  std::vector<Cel*> cels;
+  m_thumbnailCells.clear();
+  for (int pass=0; pass<2; ++pass) {
+    for (LayerIndex layer=last_layer; layer>=first_layer; --layer) {
+      LayerImage* layerPtr = static_cast<LayerImage*>(m_layers[layer]);
+      if ((pass == 0) != (layerPtr == m_layer))
+        continue;
+
+      CelIterator it = layerPtr->findFirstCelIteratorAfter(first_frame-1);
+      CelIterator end = layerPtr->getCelEnd();
+      for (; it != end && (*it)->frame() <= last_frame; ++it) {
+        Cel* cel = *it;
+        cels.push_back(cel);
+        m_thumbnailCells.insert(
+          std::make_pair(cel->data()->id(), Hit(PART_CEL, layer, cel->frame())));
+      }
+    }
+  }
+
+  m_thumbnails->setVisibleCels(cels, gfx::Size(CELTHUMBSIZE, CELTHUMBSIZE));
+
+  if (m_thumbnails->isRendering() && !m_thumbnailsTimer.isRunning())
+    m_thumbnailsTimer.start();
+}
+
+void Timeline::checkCelThumbnails()
+{
+  if (!m_thumbnails) {
+    m_thumbnailsTimer.stop();
+    return;
+  }
+
+  std::vector<ObjectId> celDataIds;
+  m_thumbnails->checkRenderedThumbnails(celDataIds);
+
+  // Repaint only the cells with new thumbnails
+  for (ObjectId id : celDataIds) {
+    auto range = m_thumbnailCells.equal_range(id);
+    for (auto it=range.first; it!=range.second; ++it)
+      invalidateHit(it->second);
+  }
+
+  if (!m_thumbnails->isRendering())
+    m_thumbnailsTimer.stop();
+}
+
 void Timeline::drawCelLinkDecorators(ui::Graphics* g, const gfx::Rect& bounds,
                                      Cel* cel, frame_t frame, bool is_active, bool is_hover,
                                      DrawCelData* data)
@@ -1568,7 +1656,15 @@ void Timeline::drawFrameTags(ui::Graphics* g)
       clientBounds().w,
       theme->dimensions.timelineTagsAreaHeight()));
 
+  frame_t first_frame, last_frame;
+  getDrawableFrames(g, &first_frame, &last_frame);
+
   for (FrameTag* frameTag : m_sprite->frameTags()) {
+    // Tags are sorted by their first frame, so the next ones aren't
+    // visible either.
+    if (frameTag->fromFrame() > last_frame)
+      break;
+
     gfx::Rect bounds1 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), frameTag->fromFrame()));
     gfx::Rect bounds2 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), frameTag->toFrame()));
     gfx::Rect bounds = bounds1.createUnion(bounds2);
@@ -15,6 +15,7 @@
 #include "app/ui/editor/editor_observer.h"
 #include "app/ui/input_chain_element.h"
 #include "base/connection.h"
+#include "base/unique_ptr.h"
 #include "doc/document_observer.h"
 #include "doc/documents_observer.h"
 #include "doc/frame.h"
@@ -24,6 +25,7 @@
 #include "ui/timer.h"
 #include "ui/widget.h"
 
+#include <map>
 #include <vector>
 
 namespace doc {
@@ -46,6 +48,7 @@ namespace app {
 
   using namespace doc;
 
+  class CelThumbnails;
   class CommandExecutionEvent;
   class ConfigureTimelinePopup;
   class Context;
@@ -203,6 +206,9 @@ namespace app {
     void drawHeaderFrame(ui::Graphics* g, frame_t frame);
     void drawLayer(ui::Graphics* g, LayerIndex layerIdx);
     void drawCel(ui::Graphics* g, LayerIndex layerIdx, frame_t frame, Cel* cel, DrawCelData* data);
+    void requestCelThumbnails(LayerIndex first_layer, LayerIndex last_layer,
+                              frame_t first_frame, frame_t last_frame);
+    void checkCelThumbnails();
     void drawCelLinkDecorators(ui::Graphics* g, const gfx::Rect& bounds,
                                Cel* cel, frame_t frame, bool is_active, bool is_hover,
                                DrawCelData* data);
@@ -285,6 +291,13 @@ namespace app {
     ui::Timer m_clipboard_timer;
     int m_offset_count;
 
+    // Thumbnails of the cels (rendered in a background thread) and
+    // the visible cells of each cel data (to repaint them when their
+    // thumbnails are rendered).
+    base::UniquePtr<CelThumbnails> m_thumbnails;
+    std::multimap<ObjectId, Hit> m_thumbnailCells;
+    ui::Timer m_thumbnailsTimer;
+
     bool m_scroll;   // True if the drag-and-drop operation is a scroll operation.
     bool m_copy;     // True if the drag-and-drop operation is a copy.
     bool m_fromTimeline;
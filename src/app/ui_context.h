@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -29,7 +29,7 @@ namespace app {
 
     DocumentView* activeView() const;
     void setActiveView(DocumentView* documentView);
-    void setActiveDocument(Document* document);
+    void setActiveDocument(Document* document) override;
 
     DocumentView* getFirstDocumentView(doc::Document* document) const;
     DocumentViews getAllDocumentViews(doc::Document* document) const;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2001-2015  David Capello
+// Copyright (C) 2001-2016  David Capello
 //
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License version 2 as
@@ -28,18 +28,30 @@ Cel* create_cel_copy(const Cel* srcCel,
 {
   const Image* celImage = srcCel->image();
 
-  base::UniquePtr<Cel> dstCel(
-    new Cel(dstFrame,
-            ImageRef(Image::create(dstSprite->pixelFormat(),
-                                   celImage->width(),
-                                   celImage->height()))));
-
   // If both images are indexed but with different palette, we can
   // convert the source cel to RGB first.
-  if (dstSprite->pixelFormat() == IMAGE_INDEXED &&
-      celImage->pixelFormat() == IMAGE_INDEXED &&
-      srcCel->sprite()->palette(srcCel->frame())->countDiff(
-        dstSprite->palette(dstFrame), nullptr, nullptr)) {
+  bool differentPalettes =
+    (dstSprite->pixelFormat() == IMAGE_INDEXED &&
+     celImage->pixelFormat() == IMAGE_INDEXED &&
+     srcCel->sprite()->palette(srcCel->frame())->countDiff(
+       dstSprite->palette(dstFrame), nullptr, nullptr));
+
+  base::UniquePtr<Cel> dstCel;
+
+  // Same pixel format, we can share the pixels with the source image
+  // (they will be copied when the new cel is modified).
+  if (dstSprite->pixelFormat() == celImage->pixelFormat() &&
+      !differentPalettes) {
+    dstCel.reset(new Cel(dstFrame, ImageRef(Image::createCopy(celImage))));
+  }
+  else {
+    dstCel.reset(new Cel(dstFrame,
+                         ImageRef(Image::create(dstSprite->pixelFormat(),
+                                                celImage->width(),
+                                                celImage->height()))));
+  }
+
+  if (differentPalettes) {
     ImageRef tmpImage(Image::create(IMAGE_RGB, celImage->width(), celImage->height()));
     tmpImage->clear(0);
 
@@ -63,7 +75,7 @@ Cel* create_cel_copy(const Cel* srcCel,
       srcCel->layer()->isBackground(),
       dstSprite->transparentColor());
   }
-  else {
+  else if (dstSprite->pixelFormat() != celImage->pixelFormat()) {
     render::composite_image(
       dstCel->image(),
       celImage,
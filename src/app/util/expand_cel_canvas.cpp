@@ -29,6 +29,8 @@
 #include "doc/site.h"
 #include "doc/sprite.h"
 
+#include <vector>
+
 namespace {
 
 // We cannot have two ExpandCelCanvas instances at the same time
@@ -118,6 +120,9 @@ ExpandCelCanvas::ExpandCelCanvas(
   // draw this cel).
   m_cel->setPosition(m_bounds.x, m_bounds.y);
 
+  m_validSrcTiles.reset(m_bounds.size());
+  m_validDstTiles.reset(m_bounds.size());
+
   if (m_celCreated) {
     getDestCanvas();
     m_cel->data()->setImage(m_dstImage);
@@ -183,28 +188,29 @@ void ExpandCelCanvas::commit()
 
     ASSERT(m_cel->image() == m_celImage.get());
 
-    gfx::Region* regionToPatch = &m_validDstRegion;
-    gfx::Region reduced;
+    gfx::Region regionToPatch;
 
     if (m_canCompareSrcVsDst) {
-      ASSERT(gfx::Region().createSubtraction(m_validDstRegion, m_validSrcRegion).isEmpty());
-
-      for (gfx::Rect rc : m_validDstRegion) {
-        if (algorithm::shrink_bounds2(getSourceCanvas(),
-                                      getDestCanvas(), rc, rc)) {
-          reduced |= gfx::Region(rc);
-        }
-      }
-
-      regionToPatch = &reduced;
+      // Patch only the modified area of each valid tile
+      std::vector<gfx::Rect> rects;
+      m_validDstTiles.forEachMarkedTile(
+        [this, &rects](int u, int v, gfx::Rect rc) {
+          ASSERT(m_validSrcTiles.get(u, v));
+          if (algorithm::shrink_bounds2(getSourceCanvas(),
+                                        getDestCanvas(), rc, rc))
+            rects.push_back(rc);
+        });
+      create_region_from_rects(rects, regionToPatch);
     }
+    else
+      m_validDstTiles.toRegion(regionToPatch);
 
     if (m_layer->isBackground()) {
       m_transaction.execute(
         new cmd::CopyRegion(
           m_cel->image(),
           m_dstImage.get(),
-          *regionToPatch,
+          regionToPatch,
           m_bounds.origin()));
     }
     else {
@@ -212,7 +218,7 @@ void ExpandCelCanvas::commit()
         new cmd::PatchCel(
           m_cel,
           m_dstImage.get(),
-          *regionToPatch,
+          regionToPatch,
           m_bounds.origin()));
     }
   }
@@ -270,40 +276,110 @@ void ExpandCelCanvas::validateSourceCanvas(const gfx::Region& rgn)
 {
   getSourceCanvas();
 
-  gfx::Region rgnToValidate(rgn);
-  rgnToValidate.offset(-m_bounds.origin());
-  rgnToValidate.createSubtraction(rgnToValidate, m_validSrcRegion);
-  rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_srcImage->bounds()));
+  for (gfx::Rect rc : rgn) {
+    rc.offset(-m_bounds.origin());
+    m_validSrcTiles.forEachTile(
+      rc, false,
+      [this](int u, int v, const gfx::Rect& tile) {
+        validateSourceTile(tile);
+        m_validSrcTiles.set(u, v, true);
+      });
+  }
+}
+
+void ExpandCelCanvas::validateDestCanvas(const gfx::Region& rgn)
+{
+  if ((m_flags & NeedsSource) == NeedsSource)
+    validateSourceCanvas(rgn);
+
+  getDestCanvas();
+
+  for (gfx::Rect rc : rgn) {
+    rc.offset(-m_bounds.origin());
+    m_validDstTiles.forEachTile(
+      rc, false,
+      [this](int u, int v, const gfx::Rect& tile) {
+        copySourceToDest(tile);
+        m_validDstTiles.set(u, v, true);
+      });
+  }
+}
+
+void ExpandCelCanvas::invalidateDestCanvas()
+{
+  m_validDstTiles.clear();
+}
+
+void ExpandCelCanvas::invalidateDestCanvas(const gfx::Region& rgn)
+{
+  // Invalid tiles will be restored completely when they are
+  // validated again, so here we restore just the given region of
+  // the valid tiles (we cannot invalidate the whole tile because it
+  // can contain modified pixels outside the region).
+  for (gfx::Rect rc : rgn) {
+    rc.offset(-m_bounds.origin());
+    restoreDestRect(rc);
+  }
+}
 
+void ExpandCelCanvas::restoreDestCanvasHline(int x1, int y, int x2)
+{
+  restoreDestRect(gfx::Rect(x1, y, x2-x1+1, 1));
+}
+
+void ExpandCelCanvas::copyValidDestToSourceCanvas(const gfx::Region& rgn)
+{
+  for (gfx::Rect rc : rgn) {
+    rc.offset(-m_bounds.origin());
+    m_validDstTiles.forEachTile(
+      rc, true,
+      [this, &rc](int u, int v, const gfx::Rect& tile) {
+        if (!m_validSrcTiles.get(u, v))
+          return;
+
+        gfx::Rect area = rc.createIntersection(tile);
+        m_srcImage->copy(m_dstImage.get(),
+          gfx::Clip(area.x, area.y, area.x, area.y, area.w, area.h));
+      });
+  }
+
+  // We cannot compare src vs dst in this case (e.g. on tools like
+  // spray and jumble that updated the source image form the modified
+  // destination).
+  m_canCompareSrcVsDst = false;
+}
+
+// Copies the original cel pixels in the given rectangle of the
+// source canvas (rc is relative to the canvas).
+void ExpandCelCanvas::validateSourceTile(const gfx::Rect& rc)
+{
   if (m_celImage) {
-    gfx::Region rgnToClear;
-    rgnToClear.createSubtraction(rgnToValidate,
-      gfx::Region(m_celImage->bounds()
-        .offset(m_origCelPos)
-        .offset(-m_bounds.origin())));
-    for (const auto& rc : rgnToClear)
+    gfx::Rect celBounds = m_celImage->bounds()
+      .offset(m_origCelPos)
+      .offset(-m_bounds.origin());
+    gfx::Rect area = rc.createIntersection(celBounds);
+
+    if (area != rc)
       fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
 
-    for (const auto& rc : rgnToValidate)
+    if (!area.isEmpty())
       m_srcImage->copy(m_celImage.get(),
-        gfx::Clip(rc.x, rc.y,
-          rc.x+m_bounds.x-m_origCelPos.x,
-          rc.y+m_bounds.y-m_origCelPos.y, rc.w, rc.h));
+        gfx::Clip(area.x, area.y,
+          area.x+m_bounds.x-m_origCelPos.x,
+          area.y+m_bounds.y-m_origCelPos.y, area.w, area.h));
   }
   else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
+    fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
   }
-
-  m_validSrcRegion.createUnion(m_validSrcRegion, rgnToValidate);
 }
 
-void ExpandCelCanvas::validateDestCanvas(const gfx::Region& rgn)
+// Copies the original pixels (from the source canvas or from the
+// cel) in the given rectangle of the destination canvas.
+void ExpandCelCanvas::copySourceToDest(const gfx::Rect& rc)
 {
   Image* src;
   int src_x, src_y;
   if ((m_flags & NeedsSource) == NeedsSource) {
-    validateSourceCanvas(rgn);
     src = m_srcImage.get();
     src_x = m_bounds.x;
     src_y = m_bounds.y;
@@ -314,62 +390,35 @@ void ExpandCelCanvas::validateDestCanvas(const gfx::Region& rgn)
     src_y = m_origCelPos.y;
   }
 
-  getDestCanvas();
-
-  gfx::Region rgnToValidate(rgn);
-  rgnToValidate.offset(-m_bounds.origin());
-  rgnToValidate.createSubtraction(rgnToValidate, m_validDstRegion);
-  rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_dstImage->bounds()));
-
   if (src) {
-    gfx::Region rgnToClear;
-    rgnToClear.createSubtraction(rgnToValidate,
-      gfx::Region(src->bounds()
-        .offset(src_x, src_y)
-        .offset(-m_bounds.origin())));
-    for (const auto& rc : rgnToClear)
+    gfx::Rect srcBounds = src->bounds()
+      .offset(src_x, src_y)
+      .offset(-m_bounds.origin());
+    gfx::Rect area = rc.createIntersection(srcBounds);
+
+    if (area != rc)
       fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
 
-    for (const auto& rc : rgnToValidate)
+    if (!area.isEmpty())
       m_dstImage->copy(src,
-        gfx::Clip(rc.x, rc.y,
-          rc.x+m_bounds.x-src_x,
-          rc.y+m_bounds.y-src_y, rc.w, rc.h));
+        gfx::Clip(area.x, area.y,
+          area.x+m_bounds.x-src_x,
+          area.y+m_bounds.y-src_y, area.w, area.h));
   }
   else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
+    fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
   }
-
-  m_validDstRegion.createUnion(m_validDstRegion, rgnToValidate);
-}
-
-void ExpandCelCanvas::invalidateDestCanvas()
-{
-  m_validDstRegion.clear();
 }
 
-void ExpandCelCanvas::invalidateDestCanvas(const gfx::Region& rgn)
+// Restores the original pixels in the valid tiles of the
+// destination canvas that intersect the given rectangle.
+void ExpandCelCanvas::restoreDestRect(const gfx::Rect& rc)
 {
-  gfx::Region rgnToInvalidate(rgn);
-  rgnToInvalidate.offset(-m_bounds.origin());
-  m_validDstRegion.createSubtraction(m_validDstRegion, rgnToInvalidate);
-}
-
-void ExpandCelCanvas::copyValidDestToSourceCanvas(const gfx::Region& rgn)
-{
-  gfx::Region rgn2(rgn);
-  rgn2.offset(-m_bounds.origin());
-  rgn2.createIntersection(rgn2, m_validSrcRegion);
-  rgn2.createIntersection(rgn2, m_validDstRegion);
-  for (const auto& rc : rgn2)
-    m_srcImage->copy(m_dstImage.get(),
-      gfx::Clip(rc.x, rc.y, rc.x, rc.y, rc.w, rc.h));
-
-  // We cannot compare src vs dst in this case (e.g. on tools like
-  // spray and jumble that updated the source image form the modified
-  // destination).
-  m_canCompareSrcVsDst = false;
+  m_validDstTiles.forEachTile(
+    rc, true,
+    [this, &rc](int u, int v, const gfx::Rect& tile) {
+      copySourceToDest(rc.createIntersection(tile));
+    });
 }
 
 gfx::Rect ExpandCelCanvas::getTrimDstImageBounds() const
@@ -9,6 +9,7 @@
 #define APP_UTIL_EXPAND_CEL_CANVAS_H_INCLUDED
 #pragma once
 
+#include "app/util/tile_bitmap.h"
 #include "doc/frame.h"
 #include "doc/image_ref.h"
 #include "filters/tiled_mode.h"
@@ -68,9 +69,17 @@ namespace app {
     void invalidateDestCanvas(const gfx::Region& rgn);
     void copyValidDestToSourceCanvas(const gfx::Region& rgn);
 
+    // Restores the original pixels of the given scanline (in canvas
+    // coordinates) in the destination canvas. It's used to undo
+    // changes in pixels that were validated previously.
+    void restoreDestCanvasHline(int x1, int y, int x2);
+
     const Cel* getCel() const { return m_cel; }
 
   private:
+    void validateSourceTile(const gfx::Rect& rc);
+    void copySourceToDest(const gfx::Rect& rc);
+    void restoreDestRect(const gfx::Rect& rc);
     gfx::Rect getTrimDstImageBounds() const;
     ImageRef trimDstImage(const gfx::Rect& bounds) const;
 
@@ -89,8 +98,11 @@ namespace app {
     bool m_closed;
     bool m_committed;
     Transaction& m_transaction;
-    gfx::Region m_validSrcRegion;
-    gfx::Region m_validDstRegion;
+
+    // Tiles of the source/destination canvas that contain valid
+    // pixels (copied from the original cel).
+    TileBitmap m_validSrcTiles;
+    TileBitmap m_validDstTiles;
 
     // True if we can compare src image with dst image to patch the
     // cel. This is false when dst is copied to the src, so we cannot
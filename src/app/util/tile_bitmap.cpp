@@ -0,0 +1,116 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/util/tile_bitmap.h"
+
+#include "base/debug.h"
+#include "gfx/region.h"
+
+#include <algorithm>
+
+namespace app {
+
+TileBitmap::TileBitmap(const gfx::Size& size, int tileSize)
+  : m_tileSize(tileSize)
+{
+  ASSERT(tileSize > 0);
+  reset(size);
+}
+
+void TileBitmap::reset(const gfx::Size& size)
+{
+  m_size = size;
+  m_cols = (size.w + m_tileSize - 1) / m_tileSize;
+  m_rows = (size.h + m_tileSize - 1) / m_tileSize;
+  m_count = 0;
+  m_bits.assign(m_cols*m_rows, false);
+}
+
+void TileBitmap::clear()
+{
+  if (m_count > 0) {
+    std::fill(m_bits.begin(), m_bits.end(), false);
+    m_count = 0;
+  }
+}
+
+gfx::Rect TileBitmap::tileBounds(int u, int v) const
+{
+  ASSERT(u >= 0 && u < m_cols);
+  ASSERT(v >= 0 && v < m_rows);
+
+  gfx::Rect rc(u*m_tileSize, v*m_tileSize, m_tileSize, m_tileSize);
+  rc.w = std::min(rc.w, m_size.w - rc.x);
+  rc.h = std::min(rc.h, m_size.h - rc.y);
+  return rc;
+}
+
+gfx::Rect TileBitmap::tilesInRect(const gfx::Rect& rc) const
+{
+  gfx::Rect bounds = rc.createIntersection(gfx::Rect(m_size));
+  if (bounds.isEmpty())
+    return gfx::Rect();
+
+  int u1 = bounds.x / m_tileSize;
+  int v1 = bounds.y / m_tileSize;
+  int u2 = (bounds.x2()-1) / m_tileSize;
+  int v2 = (bounds.y2()-1) / m_tileSize;
+  return gfx::Rect(u1, v1, u2-u1+1, v2-v1+1);
+}
+
+void TileBitmap::toRegion(gfx::Region& region) const
+{
+  // Consecutive marked tiles of each row are joined in one rectangle
+  std::vector<gfx::Rect> rects;
+  for (int v=0; v<m_rows; ++v) {
+    for (int u=0; u<m_cols; ) {
+      if (!get(u, v)) {
+        ++u;
+        continue;
+      }
+      int u2 = u+1;
+      while (u2 < m_cols && get(u2, v))
+        ++u2;
+      rects.push_back(tileBounds(u, v).createUnion(tileBounds(u2-1, v)));
+      u = u2;
+    }
+  }
+  create_region_from_rects(rects, region);
+}
+
+void create_region_from_rects(const std::vector<gfx::Rect>& rects,
+                              gfx::Region& region)
+{
+  std::vector<gfx::Region> regions;
+  regions.reserve(rects.size());
+  for (const auto& rc : rects)
+    if (!rc.isEmpty())
+      regions.push_back(gfx::Region(rc));
+
+  if (regions.empty()) {
+    region.clear();
+    return;
+  }
+
+  while (regions.size() > 1) {
+    std::size_t j = 0;
+    for (std::size_t i=0; i<regions.size(); i+=2, ++j) {
+      if (i+1 < regions.size())
+        regions[j].createUnion(regions[i], regions[i+1]);
+      else
+        regions[j] = regions[i];
+    }
+    regions.resize(j);
+  }
+  region = regions[0];
+}
+
+} // namespace app
@@ -0,0 +1,108 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifndef APP_UTIL_TILE_BITMAP_H_INCLUDED
+#define APP_UTIL_TILE_BITMAP_H_INCLUDED
+#pragma once
+
+#include "gfx/point.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <vector>
+
+namespace gfx {
+  class Region;
+}
+
+namespace app {
+
+  // One bit for each tile of a fixed grid which covers an image of
+  // the given size. It's used to know which parts of an image are
+  // valid/modified, marking/checking tiles in O(1) instead of
+  // operating with gfx::Region (which gets fragmented in thousands of
+  // rectangles on long strokes).
+  class TileBitmap {
+  public:
+    static const int kDefaultTileSize = 32;
+
+    TileBitmap(const gfx::Size& size = gfx::Size(0, 0),
+               int tileSize = kDefaultTileSize);
+
+    // Resizes the grid to cover an image of the given size (all
+    // tiles are unmarked).
+    void reset(const gfx::Size& size);
+
+    // Unmarks all tiles.
+    void clear();
+
+    bool isEmpty() const { return m_count == 0; }
+    int tileSize() const { return m_tileSize; }
+
+    // Size of the grid (in tiles).
+    int cols() const { return m_cols; }
+    int rows() const { return m_rows; }
+
+    bool get(int u, int v) const {
+      return m_bits[v*m_cols+u];
+    }
+
+    void set(int u, int v, bool state) {
+      if (m_bits[v*m_cols+u] != state) {
+        m_bits[v*m_cols+u] = state;
+        m_count += (state ? 1: -1);
+      }
+    }
+
+    // Bounds in pixels of the given tile (clipped to the image).
+    gfx::Rect tileBounds(int u, int v) const;
+
+    // Range of tiles (in tile units) that intersect the given
+    // rectangle (in pixels).
+    gfx::Rect tilesInRect(const gfx::Rect& rc) const;
+
+    // Calls f(u, v, tileBounds) for each tile that intersects the
+    // given rectangle with the given state (marked or unmarked).
+    template<typename Func>
+    void forEachTile(const gfx::Rect& rc, bool state, Func f) const {
+      gfx::Rect tiles = tilesInRect(rc);
+      for (int v=tiles.y; v<tiles.y2(); ++v)
+        for (int u=tiles.x; u<tiles.x2(); ++u)
+          if (get(u, v) == state)
+            f(u, v, tileBounds(u, v));
+    }
+
+    // Calls f(u, v, tileBounds) for each marked tile.
+    template<typename Func>
+    void forEachMarkedTile(Func f) const {
+      if (m_count == 0)
+        return;
+      for (int v=0; v<m_rows; ++v)
+        for (int u=0; u<m_cols; ++u)
+          if (get(u, v))
+            f(u, v, tileBounds(u, v));
+    }
+
+    // Creates a region with the bounds of all marked tiles.
+    void toRegion(gfx::Region& region) const;
+
+  private:
+    gfx::Size m_size;
+    int m_tileSize;
+    int m_cols, m_rows;
+    int m_count;
+    std::vector<bool> m_bits;
+  };
+
+  // Creates a region from a set of rectangles, merging them in pairs
+  // (to avoid O(n^2) unions of a big region with small rectangles).
+  void create_region_from_rects(const std::vector<gfx::Rect>& rects,
+                                gfx::Region& region);
+
+} // namespace app
+
+#endif
@@ -0,0 +1,116 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "app/util/tile_bitmap.h"
+#include "gfx/region.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace app;
+
+static const gfx::Size kCanvasSize(2048, 2048);
+static const int kStrokePoints = 10000;
+
+// Freehand stroke with 10,000 mouse positions (a smooth random walk
+// generated with a fixed seed, similar to a recorded stroke).
+static const std::vector<gfx::Point>& recorded_stroke()
+{
+  static std::vector<gfx::Point> stroke;
+  if (stroke.empty()) {
+    std::srand(10000);
+    double x = kCanvasSize.w/2, y = kCanvasSize.h/2, angle = 0.0;
+    for (int i=0; i<kStrokePoints; ++i) {
+      angle += (std::rand() % 61 - 30) * 3.14159 / 180.0;
+      double nx = x + 4.0 * std::cos(angle);
+      double ny = y + 4.0 * std::sin(angle);
+
+      // Bounce on canvas edges
+      if (nx < 0 || ny < 0 || nx >= kCanvasSize.w || ny >= kCanvasSize.h)
+        angle += 3.14159;
+      else {
+        x = nx;
+        y = ny;
+      }
+      stroke.push_back(gfx::Point(int(x), int(y)));
+    }
+  }
+  return stroke;
+}
+
+// Area modified by each segment of the stroke (like the
+// ToolLoopManager dirty area of each loop step).
+static gfx::Rect segment_bounds(const gfx::Point& a, const gfx::Point& b,
+                                int brushSize)
+{
+  gfx::Rect rc = gfx::Rect(a, gfx::Size(1, 1)).createUnion(gfx::Rect(b, gfx::Size(1, 1)));
+  return rc.enlarge(brushSize/2);
+}
+
+// Valid area tracked with gfx::Region (like the old
+// ExpandCelCanvas::validateDestCanvas() and commit())
+static void BM_ValidRegion(benchmark::State& state)
+{
+  const int brushSize = state.range(0);
+  const auto& stroke = recorded_stroke();
+  const gfx::Rect bounds(kCanvasSize);
+  const gfx::Region canvas(bounds);
+
+  while (state.KeepRunning()) {
+    gfx::Region valid;
+    for (std::size_t i=1; i<stroke.size(); ++i) {
+      gfx::Region rgn(segment_bounds(stroke[i-1], stroke[i], brushSize));
+      rgn.createSubtraction(rgn, valid);
+      rgn.createIntersection(rgn, canvas);
+      valid.createUnion(valid, rgn);
+    }
+
+    int area = 0;
+    for (const auto& rc : valid)
+      area += rc.w*rc.h;
+    benchmark::DoNotOptimize(area);
+  }
+}
+
+// Valid area tracked with TileBitmap (ExpandCelCanvas implementation)
+static void BM_ValidTiles(benchmark::State& state)
+{
+  const int brushSize = state.range(0);
+  const auto& stroke = recorded_stroke();
+
+  while (state.KeepRunning()) {
+    TileBitmap valid(kCanvasSize);
+    for (std::size_t i=1; i<stroke.size(); ++i) {
+      valid.forEachTile(
+        segment_bounds(stroke[i-1], stroke[i], brushSize), false,
+        [&valid](int u, int v, const gfx::Rect& tile) {
+          valid.set(u, v, true);
+        });
+    }
+
+    gfx::Region rgn;
+    valid.toRegion(rgn);
+    benchmark::DoNotOptimize(rgn.size());
+  }
+}
+
+BENCHMARK(BM_ValidRegion)
+  ->Arg(1)->Arg(8)->Arg(64)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ValidTiles)
+  ->Arg(1)->Arg(8)->Arg(64)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
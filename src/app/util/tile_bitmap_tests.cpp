@@ -0,0 +1,85 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#include "tests/test.h"
+
+#include "app/util/tile_bitmap.h"
+#include "gfx/region.h"
+
+#include <cstdlib>
+
+using namespace app;
+
+TEST(TileBitmap, Grid)
+{
+  TileBitmap tiles(gfx::Size(70, 33), 32);
+  EXPECT_EQ(3, tiles.cols());
+  EXPECT_EQ(2, tiles.rows());
+  EXPECT_TRUE(tiles.isEmpty());
+
+  EXPECT_EQ(gfx::Rect(0, 0, 32, 32), tiles.tileBounds(0, 0));
+  EXPECT_EQ(gfx::Rect(64, 0, 6, 32), tiles.tileBounds(2, 0));
+  EXPECT_EQ(gfx::Rect(64, 32, 6, 1), tiles.tileBounds(2, 1));
+
+  EXPECT_EQ(gfx::Rect(0, 0, 1, 1), tiles.tilesInRect(gfx::Rect(0, 0, 32, 32)));
+  EXPECT_EQ(gfx::Rect(0, 0, 2, 2), tiles.tilesInRect(gfx::Rect(-5, -5, 38, 38)));
+  EXPECT_EQ(gfx::Rect(1, 0, 2, 2), tiles.tilesInRect(gfx::Rect(40, 10, 100, 100)));
+  EXPECT_TRUE(tiles.tilesInRect(gfx::Rect(70, 0, 10, 10)).isEmpty());
+}
+
+TEST(TileBitmap, MarkTiles)
+{
+  TileBitmap tiles(gfx::Size(100, 100), 10);
+
+  int n = 0;
+  tiles.forEachTile(gfx::Rect(15, 15, 20, 10), false,
+                    [&](int u, int v, const gfx::Rect& rc) {
+                      EXPECT_EQ(gfx::Rect(u*10, v*10, 10, 10), rc);
+                      tiles.set(u, v, true);
+                      ++n;
+                    });
+  EXPECT_EQ(3*2, n);
+  EXPECT_FALSE(tiles.isEmpty());
+  EXPECT_TRUE(tiles.get(1, 1));
+  EXPECT_TRUE(tiles.get(3, 2));
+  EXPECT_FALSE(tiles.get(4, 2));
+
+  // Only unmarked tiles are iterated
+  n = 0;
+  tiles.forEachTile(gfx::Rect(0, 0, 100, 100), false,
+                    [&](int u, int v, const gfx::Rect& rc) { ++n; });
+  EXPECT_EQ(100-6, n);
+
+  gfx::Region rgn;
+  tiles.toRegion(rgn);
+  EXPECT_EQ(gfx::Rect(10, 10, 30, 20), rgn.bounds());
+  EXPECT_EQ(1, rgn.size());
+
+  tiles.clear();
+  EXPECT_TRUE(tiles.isEmpty());
+  EXPECT_FALSE(tiles.get(1, 1));
+}
+
+TEST(TileBitmap, RegionFromRects)
+{
+  std::srand(1);
+  for (int i=0; i<20; ++i) {
+    std::vector<gfx::Rect> rects;
+    gfx::Region expected;
+    for (int j=0; j<i*5; ++j) {
+      gfx::Rect rc(std::rand()%100, std::rand()%100,
+                   std::rand()%20, std::rand()%20);
+      rects.push_back(rc);
+      expected |= gfx::Region(rc);
+    }
+
+    gfx::Region rgn;
+    create_region_from_rects(rects, rgn);
+    EXPECT_TRUE(gfx::Region().createSubtraction(rgn, expected).isEmpty());
+    EXPECT_TRUE(gfx::Region().createSubtraction(expected, rgn).isEmpty());
+  }
+}
@@ -0,0 +1,67 @@
+// Aseprite Base Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef BASE_BITS_H_INCLUDED
+#define BASE_BITS_H_INCLUDED
+#pragma once
+
+#include "base/ints.h"
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+namespace base {
+
+  // Returns the number of 1 bits.
+  inline int count_bits(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return int((v * 0x0101010101010101ull) >> 56);
+#endif
+  }
+
+  // Returns the index of the lowest 1 bit (v must be != 0).
+  inline int lowest_bit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return int(i);
+#else
+    int i = 0;
+    while (!(v & 1)) {
+      v >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  // Returns the index of the highest 1 bit (v must be != 0).
+  inline int highest_bit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return int(i);
+#else
+    int i = 63;
+    while (!(v & (uint64_t(1) << i)))
+      --i;
+    return i;
+#endif
+  }
+
+} // namespace base
+
+#endif
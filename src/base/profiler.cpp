@@ -0,0 +1,161 @@
+// Aseprite Base Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/profiler.h"
+
+#include "base/fstream_path.h"
+#include "base/mutex.h"
+#include "base/scoped_lock.h"
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+namespace base {
+namespace profiler {
+
+namespace details {
+  std::atomic<bool> enabled(false);
+}
+
+namespace {
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Event {
+    char phase;                 // 'X' = complete event, 'C' = counter
+    const char* category;
+    const char* name;
+    int tid;
+    int64_t start;
+    int64_t duration;
+    double value;
+    std::string detail;
+  };
+
+  std::atomic<int64_t> start_time(0);
+  std::atomic<int> next_tid(1);
+  base::mutex events_mutex;
+  std::vector<Event> events;
+
+  // Small sequential IDs are easier to read in the trace viewer than
+  // native thread handles.
+  int current_tid()
+  {
+    static thread_local int tid = next_tid++;
+    return tid;
+  }
+
+  void add(Event&& ev)
+  {
+    scoped_lock lock(events_mutex);
+    events.push_back(std::move(ev));
+  }
+
+  void write_json_string(std::ostream& os, const char* s)
+  {
+    os << '"';
+    for (; *s; ++s) {
+      switch (*s) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+          if (*s >= 0 && *s < 32)
+            os << ' ';
+          else
+            os << *s;
+          break;
+      }
+    }
+    os << '"';
+  }
+
+} // anonymous namespace
+
+void start()
+{
+  {
+    scoped_lock lock(events_mutex);
+    events.clear();
+  }
+  start_time = std::chrono::duration_cast<std::chrono::microseconds>(
+    Clock::now().time_since_epoch()).count();
+  details::enabled = true;
+}
+
+void stop()
+{
+  details::enabled = false;
+}
+
+int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    Clock::now().time_since_epoch()).count() - start_time;
+}
+
+void add_event(const char* category, const char* name,
+               int64_t start, int64_t duration,
+               const std::string& detail)
+{
+  add(Event{ 'X', category, name, current_tid(), start, duration, 0.0, detail });
+}
+
+void add_counter(const char* category, const char* name, double value)
+{
+  if (!is_enabled())
+    return;
+
+  add(Event{ 'C', category, name, current_tid(), now(), 0, value, std::string() });
+}
+
+bool save_chrome_trace(const std::string& filename)
+{
+  std::ofstream f(FSTREAM_PATH(filename), std::ios::binary);
+  if (!f)
+    return false;
+
+  scoped_lock lock(events_mutex);
+
+  f << "{\"traceEvents\":[";
+  for (std::size_t i=0; i<events.size(); ++i) {
+    const Event& ev = events[i];
+
+    f << (i > 0 ? ",\n": "\n") << "{\"name\":";
+    write_json_string(f, ev.name);
+    f << ",\"cat\":";
+    write_json_string(f, ev.category);
+    f << ",\"ph\":\"" << ev.phase << "\""
+      << ",\"pid\":1"
+      << ",\"tid\":" << ev.tid
+      << ",\"ts\":" << ev.start;
+
+    if (ev.phase == 'X') {
+      f << ",\"dur\":" << ev.duration;
+      if (!ev.detail.empty()) {
+        f << ",\"args\":{\"detail\":";
+        write_json_string(f, ev.detail.c_str());
+        f << "}";
+      }
+    }
+    else {
+      f << ",\"args\":{\"value\":" << ev.value << "}";
+    }
+    f << "}";
+  }
+  f << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  return f.good();
+}
+
+} // namespace profiler
+} // namespace base
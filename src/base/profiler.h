@@ -0,0 +1,97 @@
+// Aseprite Base Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef BASE_PROFILER_H_INCLUDED
+#define BASE_PROFILER_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/ints.h"
+
+#include <atomic>
+#include <string>
+
+namespace base {
+namespace profiler {
+
+  namespace details {
+    extern std::atomic<bool> enabled;
+  }
+
+  // Returns true if the profiler is recording events. When it's
+  // disabled (the default) ScopedTimer and add_counter() only check
+  // this flag.
+  inline bool is_enabled() {
+    return details::enabled.load(std::memory_order_relaxed);
+  }
+
+  // Starts recording events (previous events are discarded).
+  void start();
+
+  // Stops recording events (recorded events are kept so they can be
+  // saved with save_chrome_trace()).
+  void stop();
+
+  // Microseconds elapsed since start() was called.
+  int64_t now();
+
+  // Records a complete event (with its start time and duration in
+  // microseconds) for the current thread. "name" and "category"
+  // must be string literals (only the pointers are stored).
+  void add_event(const char* category, const char* name,
+                 int64_t start, int64_t duration,
+                 const std::string& detail = std::string());
+
+  // Records the value of a counter in the current time.
+  void add_counter(const char* category, const char* name, double value);
+
+  // Saves all recorded events in the Chrome Trace Event format
+  // (JSON), so it can be opened with chrome://tracing. Returns false
+  // if the file cannot be written.
+  bool save_chrome_trace(const std::string& filename);
+
+  // Measures the time elapsed between its construction and
+  // destruction. E.g.
+  //
+  //   base::profiler::ScopedTimer timer("file", "FileOp::operate", filename);
+  //
+  class ScopedTimer {
+  public:
+    ScopedTimer(const char* category, const char* name)
+      : m_category(category)
+      , m_name(name)
+      , m_start(is_enabled() ? now(): -1) {
+    }
+
+    // "detail" is saved as an argument of the event (e.g. the
+    // filename being loaded).
+    ScopedTimer(const char* category, const char* name,
+                const std::string& detail)
+      : m_category(category)
+      , m_name(name)
+      , m_start(is_enabled() ? now(): -1) {
+      if (m_start >= 0)
+        m_detail = detail;
+    }
+
+    ~ScopedTimer() {
+      if (m_start >= 0 && is_enabled())
+        add_event(m_category, m_name, m_start, now() - m_start, m_detail);
+    }
+
+  private:
+    const char* m_category;
+    const char* m_name;
+    int64_t m_start;
+    std::string m_detail;
+
+    DISABLE_COPYING(ScopedTimer);
+  };
+
+} // namespace profiler
+} // namespace base
+
+#endif
@@ -0,0 +1,84 @@
+// Aseprite Base Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/fs.h"
+#include "base/profiler.h"
+#include "base/thread.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace base;
+
+static const char* kFilename = "profiler_tests.json";
+
+static std::string read_trace()
+{
+  EXPECT_TRUE(profiler::save_chrome_trace(kFilename));
+  std::ifstream f(kFilename);
+  std::string content((std::istreambuf_iterator<char>(f)),
+                      std::istreambuf_iterator<char>());
+  f.close();
+  delete_file(kFilename);
+  return content;
+}
+
+static void timed_function()
+{
+  profiler::ScopedTimer timer("test", "timed_function", "a \"quoted\" detail");
+}
+
+TEST(Profiler, DisabledByDefault)
+{
+  EXPECT_FALSE(profiler::is_enabled());
+  timed_function();
+  profiler::add_counter("test", "counter", 1.0);
+
+  std::string trace = read_trace();
+  EXPECT_EQ(std::string::npos, trace.find("timed_function"));
+  EXPECT_EQ(std::string::npos, trace.find("counter"));
+}
+
+TEST(Profiler, RecordEvents)
+{
+  profiler::start();
+  EXPECT_TRUE(profiler::is_enabled());
+
+  timed_function();
+  thread t(&timed_function);
+  t.join();
+  profiler::add_counter("test", "counter", 32.0);
+
+  profiler::stop();
+  EXPECT_FALSE(profiler::is_enabled());
+
+  // Events after stop() are ignored
+  profiler::add_counter("test", "ignored_counter", 1.0);
+
+  std::string trace = read_trace();
+  EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"timed_function\",\"cat\":\"test\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+  EXPECT_NE(std::string::npos, trace.find("\"args\":{\"detail\":\"a \\\"quoted\\\" detail\"}"));
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"counter\",\"cat\":\"test\",\"ph\":\"C\""));
+  EXPECT_NE(std::string::npos, trace.find("\"args\":{\"value\":32}"));
+  EXPECT_EQ(std::string::npos, trace.find("ignored_counter"));
+
+  // start() discards old events
+  profiler::start();
+  profiler::stop();
+  trace = read_trace();
+  EXPECT_EQ(std::string::npos, trace.find("timed_function"));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
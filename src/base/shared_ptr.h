@@ -1,5 +1,5 @@
 // Aseprite Base Library
-// Copyright (c) 2001-2013, 2015 David Capello
+// Copyright (c) 2001-2013, 2015, 2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -10,9 +10,14 @@
 
 #include "base/debug.h"
 
+#include <atomic>
+
 namespace base {
 
-// This class counts references for a SharedPtr.
+// This class counts references for a SharedPtr. The counter is
+// atomic, so copies of the same SharedPtr can be created and
+// destroyed from different threads (e.g. images that share a
+// copy-on-write pixels buffer).
 class SharedPtrRefCounterBase {
 public:
   SharedPtrRefCounterBase() : m_count(0) { }
@@ -23,8 +28,7 @@ public:
   }
 
   void release() {
-    --m_count;
-    if (m_count == 0)
+    if (--m_count == 0)
       delete this;
   }
 
@@ -33,7 +37,7 @@ public:
   }
 
 private:
-  long m_count;         // Number of references.
+  std::atomic<long> m_count; // Number of references.
 };
 
 // Default deleter used by shared pointer (it calls "delete"
@@ -1,5 +1,5 @@
 // Aseprite Base Library
-// Copyright (c) 2001-2013, 2015 David Capello
+// Copyright (c) 2001-2013, 2015, 2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -7,6 +7,9 @@
 #include <gtest/gtest.h>
 
 #include "base/shared_ptr.h"
+#include "base/thread.h"
+
+#include <vector>
 
 using namespace base;
 
@@ -165,6 +168,33 @@ TEST(SharedPtr, CustomDeleter)
   EXPECT_EQ(true, flag);
 }
 
+static void copy_many_times(SharedPtr<int>* ptr)
+{
+  for (int i=0; i<100000; ++i) {
+    SharedPtr<int> copy(*ptr);
+    SharedPtr<int> other;
+    other = copy;
+  }
+}
+
+TEST(SharedPtr, CopiesFromSeveralThreads)
+{
+  bool flag = false;
+  {
+    SharedPtr<int> a(new int(5), CustomDeleter(&flag));
+    std::vector<thread*> threads;
+    for (int i=0; i<4; ++i)
+      threads.push_back(new thread(&copy_many_times, &a));
+    for (thread* t : threads) {
+      t->join();
+      delete t;
+    }
+    EXPECT_EQ(1, a.use_count());
+    EXPECT_FALSE(flag);
+  }
+  EXPECT_TRUE(flag);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -68,6 +68,11 @@ TEST(Thread, TwoArgs)
   EXPECT_TRUE(flag);
 }
 
+TEST(Thread, HardwareConcurrency)
+{
+  EXPECT_GE(thread::hardware_concurrency(), 1);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
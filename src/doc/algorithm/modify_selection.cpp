@@ -0,0 +1,239 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/modify_selection.h"
+
+#include "base/unique_ptr.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/primitives_fast.h"
+#include "gfx/rect.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace doc {
+namespace algorithm {
+
+namespace {
+
+inline bool get_bit(const uint8_t* row, int x)
+{
+  return (row[x >> 3] & (1 << (x & 7))) != 0;
+}
+
+inline void set_bit(uint8_t* row, int x)
+{
+  row[x >> 3] |= (1 << (x & 7));
+}
+
+// Returns in reach[dx] the half-height of the brush column at the
+// horizontal distance "dx" from its center, i.e. the pixel (dx, dy)
+// (relative to the brush center) is in the brush if
+// |dy| <= reach[|dx|]. The circle is generated with fill_ellipse(),
+// which gives a symmetric and convex shape, so each column is a
+// vertical span centered in the brush, and reach[] decreases with
+// the distance.
+void calculate_brush_reach(int radius, BrushType brush,
+                           std::vector<int>& reach)
+{
+  reach.resize(radius+1);
+
+  if (brush != kCircleBrushType) {
+    std::fill(reach.begin(), reach.end(), radius);
+    return;
+  }
+
+  const int size = 2*radius+1;
+  base::UniquePtr<Image> kernel(Image::create(IMAGE_BITMAP, size, size));
+  clear_image(kernel, 0);
+  fill_ellipse(kernel, 0, 0, size-1, size-1, 1);
+
+  for (int dx=0; dx<=radius; ++dx) {
+    int y = 0;
+    while (y < radius && !get_pixel_fast<BitmapTraits>(kernel, radius+dx, y))
+      ++y;
+    reach[dx] = radius - y;
+
+    ASSERT(dx == 0 || reach[dx] <= reach[dx-1]);
+  }
+}
+
+// Calculates the horizontal distance from each pixel of the
+// [x0, x0+dist.size()) range of the "y" row to the nearest set pixel
+// of the same row. Set pixels are 1s (or 0s and pixels outside the
+// image if "inverted" is true). Distances greater than "radius" are
+// equal to radius+1.
+void calculate_row_distance(const Image* src, bool inverted,
+                            int x0, int y, int radius,
+                            std::vector<int>& dist)
+{
+  const int far = radius+1;
+  const int w = int(dist.size());
+
+  if (y < 0 || y >= src->height()) {
+    std::fill(dist.begin(), dist.end(), (inverted ? 0: far));
+    return;
+  }
+
+  const uint8_t* row = src->getPixelAddress(0, y);
+  const int srcW = src->width();
+  const int x1 = x0 - radius;
+  const int x2 = x0 + w + radius;
+
+#define IS_SET(x)                                               \
+  ((x) >= 0 && (x) < srcW ? get_bit(row, (x)) != inverted: inverted)
+
+  // Nearest set pixel to the left
+  int d = far;
+  for (int x=x1; x<x0+w; ++x) {
+    if (IS_SET(x))
+      d = 0;
+    else if (d < far)
+      ++d;
+    if (x >= x0)
+      dist[x-x0] = d;
+  }
+
+  // Nearest set pixel to the right
+  d = far;
+  for (int x=x2-1; x>=x0; --x) {
+    if (IS_SET(x))
+      d = 0;
+    else if (d < far)
+      ++d;
+    if (x < x0+w && d < dist[x-x0])
+      dist[x-x0] = d;
+  }
+
+#undef IS_SET
+}
+
+// Sets to 1 the pixels of the "area" (in "src" coordinates, "dst" is
+// an image with the same size of "area") that are near (inside the
+// brush) to some set pixel of "src".
+//
+// For each column of "area" we keep the range of rows covered by the
+// set pixels of the rows processed so far: a "src" row "y" covers
+// the rows [y-reach[d], y+reach[d]], where "d" is the horizontal
+// distance from the column to the nearest set pixel of the row
+// "y". Rows above are processed in a first pass, and rows below in
+// a second pass.
+void dilate(const Image* src, bool inverted,
+            int radius, const std::vector<int>& reach,
+            const gfx::Rect& area, Image* dst)
+{
+  ASSERT(dst->width() == area.w);
+  ASSERT(dst->height() == area.h);
+
+  const int far = radius+1;
+  std::vector<int> dist(area.w);
+  std::vector<int> limit(area.w);
+
+  // Covered rows by set pixels above (or in the same row)
+  std::fill(limit.begin(), limit.end(), std::numeric_limits<int>::min());
+  for (int y=area.y-radius; y<area.y2(); ++y) {
+    calculate_row_distance(src, inverted, area.x, y, radius, dist);
+    for (int i=0; i<area.w; ++i) {
+      if (dist[i] < far)
+        limit[i] = std::max(limit[i], y+reach[dist[i]]);
+    }
+
+    if (y >= area.y) {
+      uint8_t* row = dst->getPixelAddress(0, y-area.y);
+      for (int i=0; i<area.w; ++i)
+        if (limit[i] >= y)
+          set_bit(row, i);
+    }
+  }
+
+  // Covered rows by set pixels below
+  std::fill(limit.begin(), limit.end(), std::numeric_limits<int>::max());
+  for (int y=area.y2()-1+radius; y>=area.y; --y) {
+    calculate_row_distance(src, inverted, area.x, y, radius, dist);
+    for (int i=0; i<area.w; ++i) {
+      if (dist[i] < far)
+        limit[i] = std::min(limit[i], y-reach[dist[i]]);
+    }
+
+    if (y < area.y2()) {
+      uint8_t* row = dst->getPixelAddress(0, y-area.y);
+      for (int i=0; i<area.w; ++i)
+        if (limit[i] <= y)
+          set_bit(row, i);
+    }
+  }
+}
+
+} // anonymous namespace
+
+void modify_selection(SelectionModifier modifier,
+                      const Image* src,
+                      Image* dst,
+                      const gfx::Point& dstPos,
+                      int radius,
+                      BrushType brush)
+{
+  ASSERT(src->pixelFormat() == IMAGE_BITMAP);
+  ASSERT(dst->pixelFormat() == IMAGE_BITMAP);
+  ASSERT(radius >= 0);
+
+  std::vector<int> reach;
+  calculate_brush_reach(radius, brush, reach);
+
+  // Expand: the dilation of "src" is the result. Contract/Border:
+  // pixels of "src" that are (or not) near to some 0 pixel (the
+  // erosion is the complement of the dilation of the complement).
+  gfx::Rect area = src->bounds();
+  if (modifier == SelectionModifier::Expand)
+    area.enlarge(radius);
+
+  base::UniquePtr<Image> dilated(Image::create(IMAGE_BITMAP, area.w, area.h));
+  clear_image(dilated, 0);
+  dilate(src, (modifier != SelectionModifier::Expand),
+         radius, reach, area, dilated);
+
+  // Add the result to "dst"
+  const gfx::Rect dstArea =
+    gfx::Rect(area).offset(dstPos).createIntersection(dst->bounds());
+
+  for (int y=dstArea.y; y<dstArea.y2(); ++y) {
+    const int v = y - dstPos.y - area.y;
+    const uint8_t* dilatedRow = dilated->getPixelAddress(0, v);
+    const uint8_t* srcRow =
+      (modifier != SelectionModifier::Expand ? src->getPixelAddress(0, v): nullptr);
+    uint8_t* dstRow = dst->getPixelAddress(0, y);
+
+    for (int x=dstArea.x; x<dstArea.x2(); ++x) {
+      const int u = x - dstPos.x - area.x;
+      bool c;
+      switch (modifier) {
+        case SelectionModifier::Border:
+          c = get_bit(srcRow, u) && get_bit(dilatedRow, u);
+          break;
+        case SelectionModifier::Expand:
+          c = get_bit(dilatedRow, u);
+          break;
+        case SelectionModifier::Contract:
+          c = get_bit(srcRow, u) && !get_bit(dilatedRow, u);
+          break;
+        default:
+          c = false;
+          break;
+      }
+      if (c)
+        set_bit(dstRow, x);
+    }
+  }
+}
+
+} // namespace algorithm
+} // namespace doc
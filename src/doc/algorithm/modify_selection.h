@@ -0,0 +1,42 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_ALGORITHM_MODIFY_SELECTION_H_INCLUDED
+#define DOC_ALGORITHM_MODIFY_SELECTION_H_INCLUDED
+#pragma once
+
+#include "doc/brush_type.h"
+#include "gfx/point.h"
+
+namespace doc {
+  class Image;
+
+  namespace algorithm {
+
+    enum class SelectionModifier {
+      Border,                   // Pixels of "src" near to its edges
+      Expand,                   // Dilation
+      Contract,                 // Erosion
+    };
+
+    // Applies the morphological operator "modifier" to the "src"
+    // bitmap (IMAGE_BITMAP) using a circle or square brush of the
+    // given radius. Pixels outside "src" are considered 0. The
+    // result is added (OR'ed) to "dst", where the "src" pixel (x, y)
+    // is the "dst" pixel (x+dstPos.x, y+dstPos.y). It takes
+    // O((w+2*radius)*(h+2*radius)) time for both brush types (the
+    // time doesn't depend on the brush area).
+    void modify_selection(SelectionModifier modifier,
+                          const Image* src,
+                          Image* dst,
+                          const gfx::Point& dstPos,
+                          int radius,
+                          BrushType brush);
+
+  } // namespace algorithm
+} // namespace doc
+
+#endif
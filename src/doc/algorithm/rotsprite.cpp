@@ -166,12 +166,6 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
   int x1, int y1, int x2, int y2,
   int x3, int y3, int x4, int y4)
 {
-  static ImageBufferPtr buf[3]; // TODO non-thread safe
-
-  for (int i=0; i<3; ++i)
-    if (!buf[i])
-      buf[i].reset(new ImageBuffer(1));
-
   int xmin = MIN(x1, MIN(x2, MIN(x3, x4)));
   int xmax = MAX(x1, MAX(x2, MAX(x3, x4)));
   int ymin = MIN(y1, MIN(y2, MIN(y3, y4)));
@@ -183,9 +177,9 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
     return;
 
   int scale = 8;
-  base::UniquePtr<Image> bmp_copy(Image::create(bmp->pixelFormat(), rot_width*scale, rot_height*scale, buf[0]));
-  base::UniquePtr<Image> tmp_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[1]));
-  base::UniquePtr<Image> spr_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[2]));
+  base::UniquePtr<Image> bmp_copy(Image::create(bmp->pixelFormat(), rot_width*scale, rot_height*scale));
+  base::UniquePtr<Image> tmp_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale));
+  base::UniquePtr<Image> spr_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale));
   base::UniquePtr<Image> msk_copy;
 
   color_t maskColor = spr->maskColor();
@@ -202,10 +196,10 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
     image_scale2x(tmp_copy, spr_copy, spr->width()*(1<<i), spr->height()*(1<<i));
     spr_copy->copy(tmp_copy, gfx::Clip(tmp_copy->bounds()));
   }
+  tmp_copy.reset(nullptr);
 
   if (mask) {
-    // Same ImageBuffer than tmp_copy
-    msk_copy.reset(Image::create(IMAGE_BITMAP, mask->width()*scale, mask->height()*scale, buf[1]));
+    msk_copy.reset(Image::create(IMAGE_BITMAP, mask->width()*scale, mask->height()*scale));
     clear_image(msk_copy, 0);
     scale_image(msk_copy, mask,
                 0, 0, msk_copy->width(), msk_copy->height(),
@@ -14,186 +14,262 @@
 #include "doc/image_impl.h"
 #include "doc/primitives_fast.h"
 
+#include <algorithm>
+
 namespace doc {
 namespace algorithm {
 
 namespace {
 
+// Number of pixels compared in each step of the row scanners. The
+// inner loop of each block doesn't contain branches, so the compiler
+// can vectorize it (compare several pixels with one instruction).
+const int kBlockSize = 16;
+
 template<typename ImageTraits>
-bool is_same_pixel(color_t pixel1, color_t pixel2)
-{
-  static_assert(false && sizeof(ImageTraits), "No is_same_pixel impl");
-  return false;
-}
+inline typename ImageTraits::pixel_t alpha_mask() { return 0; }
 
 template<>
-bool is_same_pixel<RgbTraits>(color_t pixel1, color_t pixel2)
-{
-  return (rgba_geta(pixel1) == 0 && rgba_geta(pixel2) == 0) || (pixel1 == pixel2);
-}
+inline RgbTraits::pixel_t alpha_mask<RgbTraits>() { return rgba_a_mask; }
 
 template<>
-bool is_same_pixel<GrayscaleTraits>(color_t pixel1, color_t pixel2)
-{
-  return (graya_geta(pixel1) == 0 && graya_geta(pixel2) == 0) || (pixel1 == pixel2);
-}
+inline GrayscaleTraits::pixel_t alpha_mask<GrayscaleTraits>() { return graya_a_mask; }
 
-template<>
-bool is_same_pixel<IndexedTraits>(color_t pixel1, color_t pixel2)
-{
-  return pixel1 == pixel2;
-}
+// Compares each pixel of an image with a reference pixel. In RGB and
+// grayscale images all transparent pixels are considered equal, so
+// if the reference pixel is transparent we only compare the alpha
+// channel (a masked comparison).
+template<typename ImageTraits>
+class RefPixelDiff {
+public:
+  typedef typename ImageTraits::pixel_t pixel_t;
+
+  RefPixelDiff(const Image* image, color_t refpixel)
+    : m_image(image)
+    , m_mask(~pixel_t(0))
+    , m_row(nullptr) {
+    const pixel_t amask = alpha_mask<ImageTraits>();
+    if (amask && (pixel_t(refpixel) & amask) == 0)
+      m_mask = amask;
+    m_ref = (pixel_t(refpixel) & m_mask);
+
+    // If the reference pixel is not a valid value for this pixel
+    // format, no pixel can be equal to it.
+    m_canMatch = (m_mask == amask || pixel_t(refpixel) == refpixel);
+  }
+
+  bool canMatch() const { return m_canMatch; }
+
+  void setRow(int y) {
+    m_row = (const pixel_t*)get_pixel_address_fast<ImageTraits>(m_image, 0, y);
+  }
+
+  pixel_t operator()(int x) const {
+    return (m_row[x] & m_mask) ^ m_ref;
+  }
 
+private:
+  const Image* m_image;
+  pixel_t m_mask;
+  pixel_t m_ref;
+  bool m_canMatch;
+  const pixel_t* m_row;
+};
+
+// Bitmaps are compared pixel by pixel (there are 8 pixels per byte).
 template<>
-bool is_same_pixel<BitmapTraits>(color_t pixel1, color_t pixel2)
-{
-  return pixel1 == pixel2;
-}
+class RefPixelDiff<BitmapTraits> {
+public:
+  typedef BitmapTraits::pixel_t pixel_t;
+
+  RefPixelDiff(const Image* image, color_t refpixel)
+    : m_image(image)
+    , m_ref(refpixel)
+    , m_refpixel(refpixel)
+    , m_y(0) {
+  }
+
+  bool canMatch() const { return (m_ref == m_refpixel); }
+  void setRow(int y) { m_y = y; }
 
+  pixel_t operator()(int x) const {
+    return get_pixel_fast<BitmapTraits>(m_image, x, m_y) ^ m_ref;
+  }
+
+private:
+  const Image* m_image;
+  pixel_t m_ref;
+  color_t m_refpixel;
+  int m_y;
+};
+
+// Compares two images pixel by pixel.
 template<typename ImageTraits>
-bool shrink_bounds_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
-{
-  bool shrink;
-  int u, v;
-
-  // Shrink left side
-  for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-    shrink = true;
-    for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-      if (!is_same_pixel<ImageTraits>(
-            get_pixel_fast<ImageTraits>(image, u, v), refpixel)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
-      break;
-    ++bounds.x;
-    --bounds.w;
-  }
-
-  // Shrink right side
-  for (u=bounds.x+bounds.w-1; u>=bounds.x; --u) {
-    shrink = true;
-    for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-      if (!is_same_pixel<ImageTraits>(
-            get_pixel_fast<ImageTraits>(image, u, v), refpixel)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
-      break;
-    --bounds.w;
+class ImagesDiff {
+public:
+  typedef typename ImageTraits::pixel_t pixel_t;
+
+  ImagesDiff(const Image* a, const Image* b)
+    : m_a(a), m_b(b)
+    , m_rowA(nullptr)
+    , m_rowB(nullptr) {
   }
 
-  // Shrink top side
-  for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-    shrink = true;
-    for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-      if (!is_same_pixel<ImageTraits>(
-            get_pixel_fast<ImageTraits>(image, u, v), refpixel)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
-      break;
-    ++bounds.y;
-    --bounds.h;
+  void setRow(int y) {
+    m_rowA = (const pixel_t*)get_pixel_address_fast<ImageTraits>(m_a, 0, y);
+    m_rowB = (const pixel_t*)get_pixel_address_fast<ImageTraits>(m_b, 0, y);
   }
 
-  // Shrink bottom side
-  for (v=bounds.y+bounds.h-1; v>=bounds.y; --v) {
-    shrink = true;
-    for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-      if (!is_same_pixel<ImageTraits>(
-            get_pixel_fast<ImageTraits>(image, u, v), refpixel)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
-      break;
-    --bounds.h;
+  pixel_t operator()(int x) const {
+    return m_rowA[x] ^ m_rowB[x];
   }
 
-  return (!bounds.isEmpty());
-}
+private:
+  const Image* m_a;
+  const Image* m_b;
+  const pixel_t* m_rowA;
+  const pixel_t* m_rowB;
+};
 
-template<typename ImageTraits>
-bool shrink_bounds_templ2(const Image* a, const Image* b, gfx::Rect& bounds)
+template<>
+class ImagesDiff<BitmapTraits> {
+public:
+  typedef BitmapTraits::pixel_t pixel_t;
+
+  ImagesDiff(const Image* a, const Image* b)
+    : m_a(a), m_b(b), m_y(0) {
+  }
+
+  void setRow(int y) { m_y = y; }
+
+  pixel_t operator()(int x) const {
+    return (get_pixel_fast<BitmapTraits>(m_a, x, m_y) ^
+            get_pixel_fast<BitmapTraits>(m_b, x, m_y));
+  }
+
+private:
+  const Image* m_a;
+  const Image* m_b;
+  int m_y;
+};
+
+// Returns the first "x" in [x1, x2) of the current row of "diff"
+// where there is a different pixel, or x2 if all pixels are equal.
+template<typename Diff>
+int first_diff_in_row(const Diff& diff, int x1, int x2)
 {
-  bool shrink;
-  int u, v;
-
-  // Shrink left side
-  for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-    shrink = true;
-    for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-      if (get_pixel_fast<ImageTraits>(a, u, v) !=
-          get_pixel_fast<ImageTraits>(b, u, v)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
+  int x = x1;
+  for (; x+kBlockSize <= x2; x += kBlockSize) {
+    typename Diff::pixel_t d = 0;
+    for (int i=0; i<kBlockSize; ++i)
+      d |= diff(x+i);
+    if (d)
       break;
-    ++bounds.x;
-    --bounds.w;
-  }
-
-  // Shrink right side
-  for (u=bounds.x+bounds.w-1; u>=bounds.x; --u) {
-    shrink = true;
-    for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-      if (get_pixel_fast<ImageTraits>(a, u, v) !=
-          get_pixel_fast<ImageTraits>(b, u, v)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
+  }
+  for (; x<x2; ++x)
+    if (diff(x))
+      return x;
+  return x2;
+}
+
+// Returns the last "x" in [x1, x2) of the current row of "diff"
+// where there is a different pixel, or x1-1 if all pixels are equal.
+template<typename Diff>
+int last_diff_in_row(const Diff& diff, int x1, int x2)
+{
+  int x = x2;
+  for (; x-kBlockSize >= x1; x -= kBlockSize) {
+    typename Diff::pixel_t d = 0;
+    for (int i=1; i<=kBlockSize; ++i)
+      d |= diff(x-i);
+    if (d)
       break;
-    --bounds.w;
   }
+  for (--x; x>=x1; --x)
+    if (diff(x))
+      return x;
+  return x1-1;
+}
+
+// Calculates the bounding box of all different pixels inside
+// "bounds" scanning the image row by row (instead of column by
+// column, which is cache-unfriendly). Rows between the first and the
+// last different rows are scanned only outside the current
+// left/right limits, so each pixel is visited once at most.
+template<typename Diff>
+bool shrink_bounds_by_rows(Diff& diff, gfx::Rect& bounds)
+{
+  const int x1 = bounds.x;
+  const int x2 = bounds.x+bounds.w;
+  const int y1 = bounds.y;
+  const int y2 = bounds.y+bounds.h;
+  int left = x2, right = x1-1;
+  int top, bottom;
 
   // Shrink top side
-  for (v=bounds.y; v<bounds.y+bounds.h; ++v) {
-    shrink = true;
-    for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-      if (get_pixel_fast<ImageTraits>(a, u, v) !=
-          get_pixel_fast<ImageTraits>(b, u, v)) {
-        shrink = false;
-        break;
-      }
-    }
-    if (!shrink)
+  for (top=y1; top<y2; ++top) {
+    diff.setRow(top);
+    left = first_diff_in_row(diff, x1, x2);
+    if (left < x2) {
+      right = last_diff_in_row(diff, left+1, x2);
       break;
-    ++bounds.y;
-    --bounds.h;
+    }
+  }
+
+  // Everything is equal
+  if (top == y2) {
+    bounds = gfx::Rect(x2, y2, 0, 0);
+    return false;
   }
 
   // Shrink bottom side
-  for (v=bounds.y+bounds.h-1; v>=bounds.y; --v) {
-    shrink = true;
-    for (u=bounds.x; u<bounds.x+bounds.w; ++u) {
-      if (get_pixel_fast<ImageTraits>(a, u, v) !=
-          get_pixel_fast<ImageTraits>(b, u, v)) {
-        shrink = false;
-        break;
-      }
+  for (bottom=y2-1; bottom>top; --bottom) {
+    diff.setRow(bottom);
+    int u = first_diff_in_row(diff, x1, x2);
+    if (u < x2) {
+      left = std::min(left, u);
+      right = std::max(right, last_diff_in_row(diff, u, x2));
+      break;
     }
-    if (!shrink)
+  }
+
+  // Shrink left and right sides checking only the pixels outside
+  // [left, right] of the remaining rows
+  for (int v=top+1; v<bottom; ++v) {
+    if (left == x1 && right == x2-1)
       break;
-    --bounds.h;
+
+    diff.setRow(v);
+    if (left > x1)
+      left = first_diff_in_row(diff, x1, left);
+    if (right < x2-1)
+      right = std::max(right, last_diff_in_row(diff, right+1, x2));
   }
 
+  bounds = gfx::Rect(left, top, right-left+1, bottom-top+1);
   return (!bounds.isEmpty());
 }
 
+template<typename ImageTraits>
+bool shrink_bounds_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
+{
+  RefPixelDiff<ImageTraits> diff(image, refpixel);
+
+  if (!diff.canMatch())
+    return (!bounds.isEmpty());
+
+  return shrink_bounds_by_rows(diff, bounds);
+}
+
+template<typename ImageTraits>
+bool shrink_bounds_templ2(const Image* a, const Image* b, gfx::Rect& bounds)
+{
+  ImagesDiff<ImageTraits> diff(a, b);
+  return shrink_bounds_by_rows(diff, bounds);
 }
 
+} // anonymous namespace
+
 bool shrink_bounds(const Image* image,
                    const gfx::Rect& start_bounds,
                    gfx::Rect& bounds,
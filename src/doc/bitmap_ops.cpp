@@ -0,0 +1,262 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/bitmap_ops.h"
+
+#include "doc/image.h"
+#include "gfx/clip.h"
+#include "gfx/rect.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace doc {
+
+namespace {
+
+// Bits [0, n) set to 1
+inline bitmap_word_t low_bits(int n)
+{
+  return (n >= 64 ? ~bitmap_word_t(0): (bitmap_word_t(1) << n) - 1);
+}
+
+// Reads the first "n" bytes (max 8) of "p" as a word. The byte order
+// is always the same (the first byte are the bits 0-7), compilers
+// generate just one load for n >= 8 in little endian platforms.
+inline bitmap_word_t load_word(const uint8_t* p, int n)
+{
+  if (n >= 8) {
+    return
+      (bitmap_word_t(p[0])      ) | (bitmap_word_t(p[1]) <<  8) |
+      (bitmap_word_t(p[2]) << 16) | (bitmap_word_t(p[3]) << 24) |
+      (bitmap_word_t(p[4]) << 32) | (bitmap_word_t(p[5]) << 40) |
+      (bitmap_word_t(p[6]) << 48) | (bitmap_word_t(p[7]) << 56);
+  }
+
+  bitmap_word_t v = 0;
+  for (int i=0; i<n; ++i)
+    v |= bitmap_word_t(p[i]) << (8*i);
+  return v;
+}
+
+inline void store_word(uint8_t* p, int n, bitmap_word_t v)
+{
+  n = std::min(n, 8);
+  for (int i=0; i<n; ++i)
+    p[i] = uint8_t(v >> (8*i));
+}
+
+inline int row_bytes(const Image* bitmap)
+{
+  return (bitmap->width()+7) / 8;
+}
+
+// Returns the pixels [x, x+64) of the given row (0 <= x < w).
+inline bitmap_word_t get_row_word(const uint8_t* row, int w, int x)
+{
+  const int nbytes = (w+7) / 8;
+  const int b = (x >> 3);
+  const int s = (x & 7);
+
+  bitmap_word_t v = load_word(row+b, nbytes-b) >> s;
+  if (s && b+8 < nbytes)
+    v |= bitmap_word_t(row[b+8]) << (64-s);
+
+  // Bits after the end of the row can contain garbage
+  if (w-x < 64)
+    v &= low_bits(w-x);
+  return v;
+}
+
+} // anonymous namespace
+
+bitmap_word_t get_bitmap_word(const Image* bitmap, int x, int y)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int w = bitmap->width();
+  if (y < 0 || y >= bitmap->height() || x >= w || x <= -64)
+    return 0;
+
+  if (x < 0)
+    return get_bitmap_word(bitmap, 0, y) << (-x);
+
+  return get_row_word(bitmap->getPixelAddress(0, y), w, x);
+}
+
+void put_bitmap_word(Image* bitmap, int x, int y,
+                     bitmap_word_t word,
+                     bitmap_word_t mask)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int w = bitmap->width();
+  if (y < 0 || y >= bitmap->height() || x >= w || x <= -64)
+    return;
+
+  if (x < 0) {
+    word >>= -x;
+    mask >>= -x;
+    x = 0;
+  }
+  if (w-x < 64)
+    mask &= low_bits(w-x);
+  if (!mask)
+    return;
+
+  uint8_t* row = bitmap->getPixelAddress(0, y);
+  const int nbytes = row_bytes(bitmap);
+  const int b = (x >> 3);
+  const int s = (x & 7);
+
+  // First 8 bytes
+  bitmap_word_t m = (mask << s);
+  bitmap_word_t v = load_word(row+b, nbytes-b);
+  v = (v & ~m) | ((word << s) & m);
+  store_word(row+b, nbytes-b, v);
+
+  // Remaining bits in the 9th byte
+  if (s && b+8 < nbytes) {
+    uint8_t m2 = uint8_t(mask >> (64-s));
+    row[b+8] = uint8_t((row[b+8] & ~m2) | (uint8_t(word >> (64-s)) & m2));
+  }
+}
+
+int count_bitmap_pixels(const Image* bitmap)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int w = bitmap->width();
+  const int h = bitmap->height();
+  int count = 0;
+
+  for (int y=0; y<h; ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    for (int x=0; x<w; x+=64)
+      count += base::count_bits(get_row_word(row, w, x));
+  }
+  return count;
+}
+
+bool is_bitmap_full(const Image* bitmap)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int w = bitmap->width();
+  const int h = bitmap->height();
+
+  for (int y=0; y<h; ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    for (int x=0; x<w; x+=64) {
+      if (get_row_word(row, w, x) != low_bits(w-x))
+        return false;
+    }
+  }
+  return true;
+}
+
+void invert_bitmap(Image* bitmap)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int nbytes = row_bytes(bitmap);
+  const int h = bitmap->height();
+
+  // The padding bits of the last byte are inverted too (they are
+  // ignored anyway)
+  for (int y=0; y<h; ++y) {
+    uint8_t* row = bitmap->getPixelAddress(0, y);
+    for (int i=0; i<nbytes; ++i)
+      row[i] = ~row[i];
+  }
+}
+
+void fill_bitmap_rect(Image* bitmap, const gfx::Rect& rc, int value)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const gfx::Rect bounds = rc.createIntersection(bitmap->bounds());
+  if (bounds.isEmpty())
+    return;
+
+  const bitmap_word_t word = (value ? ~bitmap_word_t(0): 0);
+  for (int y=bounds.y; y<bounds.y2(); ++y) {
+    for (int x=bounds.x; x<bounds.x2(); x+=64)
+      put_bitmap_word(bitmap, x, y, word, low_bits(bounds.x2()-x));
+  }
+}
+
+void copy_bitmap(Image* dst, const Image* src, gfx::Clip area)
+{
+  ASSERT(dst->pixelFormat() == IMAGE_BITMAP);
+  ASSERT(src->pixelFormat() == IMAGE_BITMAP);
+
+  if (!area.clip(dst->width(), dst->height(), src->width(), src->height()))
+    return;
+
+  for (int v=0; v<area.size.h; ++v) {
+    for (int u=0; u<area.size.w; u+=64) {
+      put_bitmap_word(dst, area.dst.x+u, area.dst.y+v,
+                      get_bitmap_word(src, area.src.x+u, area.src.y+v),
+                      low_bits(area.size.w-u));
+    }
+  }
+}
+
+bool shrink_bitmap_bounds(const Image* bitmap, gfx::Rect& bounds)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
+
+  const int w = bitmap->width();
+  const int h = bitmap->height();
+  const int nwords = (w+63) / 64;
+
+  // OR of all rows (to get the left/right sides), the top/bottom
+  // sides are the first and last rows with some bit.
+  std::vector<bitmap_word_t> columns(nwords, 0);
+  int y1 = -1, y2 = -1;
+
+  for (int y=0; y<h; ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    bitmap_word_t any = 0;
+    for (int i=0; i<nwords; ++i) {
+      bitmap_word_t word = get_row_word(row, w, i*64);
+      columns[i] |= word;
+      any |= word;
+    }
+    if (any) {
+      if (y1 < 0)
+        y1 = y;
+      y2 = y;
+    }
+  }
+
+  if (y1 < 0)
+    return false;
+
+  int x1 = 0, x2 = 0;
+  for (int i=0; i<nwords; ++i) {
+    if (columns[i]) {
+      x1 = i*64 + base::lowest_bit(columns[i]);
+      break;
+    }
+  }
+  for (int i=nwords-1; i>=0; --i) {
+    if (columns[i]) {
+      x2 = i*64 + base::highest_bit(columns[i]);
+      break;
+    }
+  }
+
+  bounds = gfx::Rect(x1, y1, x2-x1+1, y2-y1+1);
+  return true;
+}
+
+} // namespace doc
@@ -0,0 +1,92 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_BITMAP_OPS_H_INCLUDED
+#define DOC_BITMAP_OPS_H_INCLUDED
+#pragma once
+
+#include "base/bits.h"
+#include "base/ints.h"
+#include "doc/image.h"
+#include "gfx/clip.h"
+#include "gfx/rect.h"
+
+namespace doc {
+
+  // Functions to process IMAGE_BITMAP images (e.g. masks) 64 pixels
+  // at a time. A word contains 64 consecutive pixels of a row: the
+  // first pixel is the bit 0 and the last one is the bit 63.
+  typedef uint64_t bitmap_word_t;
+
+  // Returns the pixels [x, x+64) of the "y" row. Pixels outside the
+  // image are 0. "x" doesn't need to be a multiple of 8 or 64.
+  bitmap_word_t get_bitmap_word(const Image* bitmap, int x, int y);
+
+  // Replaces the pixels [x, x+64) of the "y" row that are 1 in
+  // "mask" with the bits of "word". Pixels outside the image are
+  // ignored.
+  void put_bitmap_word(Image* bitmap, int x, int y,
+                       bitmap_word_t word,
+                       bitmap_word_t mask = ~bitmap_word_t(0));
+
+  // Returns the number of 1s in the bitmap.
+  int count_bitmap_pixels(const Image* bitmap);
+
+  // Returns true if all the pixels of the bitmap are 1.
+  bool is_bitmap_full(const Image* bitmap);
+
+  void invert_bitmap(Image* bitmap);
+
+  // Fills the given rectangle (it's clipped to the bitmap bounds).
+  void fill_bitmap_rect(Image* bitmap, const gfx::Rect& rc, int value);
+
+  // Copies "src" in "dst" (the same as Image::copy() but 64 pixels
+  // at a time).
+  void copy_bitmap(Image* dst, const Image* src, gfx::Clip area);
+
+  // Returns in "bounds" the smallest rectangle that contains all the
+  // 1s of the bitmap. Returns false if the bitmap is empty.
+  bool shrink_bitmap_bounds(const Image* bitmap, gfx::Rect& bounds);
+
+  // Finds the runs of consecutive 1s in "word" (which contains the
+  // bits [x, x+64) of a sequence of bits) calling func(x1, x2) for
+  // each run [x1, x2). "start" keeps the start of the current run
+  // (or -1) between calls, so runs can continue in the next word.
+  // After the last word, if start >= 0, the last run must be
+  // finished by the caller.
+  template<typename Func>
+  inline void scan_bit_runs(bitmap_word_t word, int x, int& start, Func& func) {
+    int pos = 0;
+    while (pos < 64) {
+      bitmap_word_t bits = (start < 0 ? word: ~word) & (~bitmap_word_t(0) << pos);
+      if (!bits)
+        break;
+
+      int bit = base::lowest_bit(bits);
+      if (start < 0)
+        start = x + bit;
+      else {
+        func(start, x + bit);
+        start = -1;
+      }
+      pos = bit + 1;
+    }
+  }
+
+  // Calls func(x1, x2) for each run [x1, x2) of 1s in the "y" row.
+  template<typename Func>
+  inline void for_each_bitmap_run(const Image* bitmap, int y, Func func) {
+    const int w = bitmap->width();
+    int start = -1;
+    for (int x=0; x<w; x+=64)
+      scan_bit_runs(get_bitmap_word(bitmap, x, y), x, start, func);
+    if (start >= 0)
+      func(start, w);
+  }
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,234 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/unique_ptr.h"
+#include "doc/bitmap_ops.h"
+#include "doc/image.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+#include "gfx/clip.h"
+#include "gfx/rect.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace base;
+using namespace doc;
+
+static const int kWidths[] = { 1, 7, 8, 9, 63, 64, 65, 130 };
+
+static Image* random_bitmap(int w, int h, int density)
+{
+  Image* image = Image::create(IMAGE_BITMAP, w, h);
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(image, x, y, (std::rand() % 100) < density ? 1: 0);
+  return image;
+}
+
+static void expect_equal_bitmaps(const Image* a, const Image* b)
+{
+  ASSERT_EQ(a->width(), b->width());
+  ASSERT_EQ(a->height(), b->height());
+  for (int y=0; y<a->height(); ++y)
+    for (int x=0; x<a->width(); ++x)
+      ASSERT_EQ(get_pixel(a, x, y), get_pixel(b, x, y)) << x << "," << y;
+}
+
+TEST(BitmapOps, GetPutWords)
+{
+  std::srand(1);
+  for (int w : kWidths) {
+    UniquePtr<Image> a(random_bitmap(w, 3, 50));
+    for (int x=-70; x<w+5; ++x) {
+      bitmap_word_t word = get_bitmap_word(a, x, 1);
+      for (int i=0; i<64; ++i) {
+        int u = x+i;
+        int expected = (u >= 0 && u < w ? get_pixel(a, u, 1): 0);
+        ASSERT_EQ(expected, int((word >> i) & 1)) << w << " " << x << " " << i;
+      }
+
+      UniquePtr<Image> b(Image::createCopy(a));
+      UniquePtr<Image> c(Image::createCopy(a));
+      bitmap_word_t newWord = (bitmap_word_t(std::rand()) << 32) | std::rand();
+      bitmap_word_t mask = (bitmap_word_t(std::rand()) << 32) | std::rand();
+      put_bitmap_word(b, x, 1, newWord, mask);
+      for (int i=0; i<64; ++i) {
+        int u = x+i;
+        if (u >= 0 && u < w && ((mask >> i) & 1))
+          put_pixel(c, u, 1, (newWord >> i) & 1);
+      }
+      expect_equal_bitmaps(c, b);
+    }
+  }
+}
+
+TEST(BitmapOps, CountFullAndInvert)
+{
+  std::srand(2);
+  for (int w : kWidths) {
+    UniquePtr<Image> a(random_bitmap(w, 5, 30));
+    int count = 0;
+    for (int y=0; y<a->height(); ++y)
+      for (int x=0; x<a->width(); ++x)
+        count += get_pixel(a, x, y);
+    EXPECT_EQ(count, count_bitmap_pixels(a));
+
+    UniquePtr<Image> b(Image::createCopy(a));
+    invert_bitmap(b);
+    for (int y=0; y<a->height(); ++y)
+      for (int x=0; x<a->width(); ++x)
+        ASSERT_EQ(1-get_pixel(a, x, y), get_pixel(b, x, y));
+    EXPECT_EQ(w*5 - count, count_bitmap_pixels(b));
+
+    // clear() fills the padding bits too, they must be ignored
+    a->clear(1);
+    EXPECT_TRUE(is_bitmap_full(a));
+    EXPECT_EQ(w*5, count_bitmap_pixels(a));
+    put_pixel(a, w-1, 4, 0);
+    EXPECT_FALSE(is_bitmap_full(a));
+    EXPECT_EQ(w*5-1, count_bitmap_pixels(a));
+  }
+}
+
+TEST(BitmapOps, FillRect)
+{
+  std::srand(3);
+  for (int w : kWidths) {
+    for (int i=0; i<50; ++i) {
+      UniquePtr<Image> a(random_bitmap(w, 4, 50));
+      UniquePtr<Image> b(Image::createCopy(a));
+      gfx::Rect rc(std::rand() % (w+20) - 10, std::rand() % 6 - 1,
+                   std::rand() % (w+10), std::rand() % 4);
+      int value = std::rand() % 2;
+
+      fill_bitmap_rect(a, rc, value);
+      for (int y=rc.y; y<rc.y2(); ++y)
+        for (int x=rc.x; x<rc.x2(); ++x)
+          if (x >= 0 && y >= 0 && x < w && y < 4)
+            put_pixel(b, x, y, value);
+      expect_equal_bitmaps(b, a);
+    }
+  }
+}
+
+TEST(BitmapOps, Copy)
+{
+  std::srand(4);
+  for (int w : kWidths) {
+    for (int i=0; i<50; ++i) {
+      UniquePtr<Image> src(random_bitmap(w, 4, 50));
+      UniquePtr<Image> a(random_bitmap(w+3, 5, 50));
+      UniquePtr<Image> b(Image::createCopy(a));
+      gfx::Clip area(std::rand() % (w+6) - 3, std::rand() % 4 - 1,
+                     std::rand() % (w+4) - 2, std::rand() % 3 - 1,
+                     std::rand() % (w+2), std::rand() % 5);
+
+      copy_bitmap(a, src, area);
+      if (area.clip(b->width(), b->height(),
+                    src->width(), src->height())) {
+        for (int y=0; y<area.size.h; ++y)
+          for (int x=0; x<area.size.w; ++x)
+            put_pixel(b, area.dst.x+x, area.dst.y+y,
+                      get_pixel(src, area.src.x+x, area.src.y+y));
+      }
+      expect_equal_bitmaps(b, a);
+    }
+  }
+}
+
+TEST(BitmapOps, ShrinkBounds)
+{
+  std::srand(5);
+  for (int w : kWidths) {
+    UniquePtr<Image> a(Image::create(IMAGE_BITMAP, w, 6));
+    a->clear(0);
+
+    gfx::Rect bounds;
+    EXPECT_FALSE(shrink_bitmap_bounds(a, bounds));
+
+    for (int i=0; i<20; ++i) {
+      a->clear(0);
+      gfx::Rect expected;
+      for (int j=0; j<1+i%3; ++j) {
+        gfx::Point pt(std::rand() % w, std::rand() % 6);
+        put_pixel(a, pt.x, pt.y, 1);
+        expected |= gfx::Rect(pt, gfx::Size(1, 1));
+      }
+      EXPECT_TRUE(shrink_bitmap_bounds(a, bounds));
+      EXPECT_EQ(expected, bounds);
+    }
+  }
+}
+
+TEST(BitmapOps, Runs)
+{
+  std::srand(6);
+  for (int w : kWidths) {
+    for (int density : { 10, 50, 90, 100 }) {
+      UniquePtr<Image> a(random_bitmap(w, 3, density));
+      for (int y=0; y<a->height(); ++y) {
+        std::vector<int> expected, runs;
+        for (int x=0; x<w; ) {
+          if (get_pixel(a, x, y)) {
+            int x2 = x;
+            while (x2 < w && get_pixel(a, x2, y))
+              ++x2;
+            expected.push_back(x);
+            expected.push_back(x2);
+            x = x2;
+          }
+          else
+            ++x;
+        }
+        for_each_bitmap_run(a, y, [&runs](int x1, int x2) {
+            runs.push_back(x1);
+            runs.push_back(x2);
+          });
+        EXPECT_EQ(expected, runs);
+      }
+    }
+  }
+}
+
+TEST(BitmapOps, MaskOps)
+{
+  Mask mask;
+  mask.replace(gfx::Rect(3, 4, 70, 10));
+  EXPECT_TRUE(mask.isRectangular());
+
+  mask.subtract(gfx::Rect(3, 4, 70, 2));
+  mask.subtract(gfx::Rect(3, 4, 5, 10));
+  EXPECT_EQ(gfx::Rect(8, 6, 65, 8), mask.bounds());
+  EXPECT_TRUE(mask.isRectangular());
+
+  mask.subtract(gfx::Rect(20, 8, 2, 2));
+  EXPECT_FALSE(mask.isRectangular());
+  EXPECT_EQ(gfx::Rect(8, 6, 65, 8), mask.bounds());
+  EXPECT_EQ(65*8-4, count_bitmap_pixels(mask.bitmap()));
+
+  mask.add(gfx::Rect(100, 20, 1, 1));
+  EXPECT_EQ(gfx::Rect(8, 6, 93, 15), mask.bounds());
+
+  mask.subtract(gfx::Rect(0, 0, 90, 20));
+  EXPECT_EQ(gfx::Rect(100, 20, 1, 1), mask.bounds());
+  EXPECT_TRUE(mask.isRectangular());
+
+  mask.subtract(gfx::Rect(100, 20, 1, 1));
+  EXPECT_TRUE(mask.isEmpty());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -63,6 +63,10 @@ namespace doc {
     void setParentLayer(LayerImage* layer);
 
   private:
+    // Changes the frame of a cel that is already in a layer. Only
+    // LayerImage can use it, as it must keep its list of cels sorted
+    // by frame.
+    void setFrameInLayer(frame_t frame) { m_frame = frame; }
     void fixupImage();
 
     LayerImage* m_layer;
@@ -71,6 +75,8 @@ namespace doc {
 
     Cel();
     DISABLE_COPYING(Cel);
+
+    friend class LayerImage;
   };
 
 } // namespace doc
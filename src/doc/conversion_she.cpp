@@ -19,6 +19,7 @@
 #include "she/surface.h"
 #include "she/surface_format.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace doc {
@@ -91,6 +92,177 @@ void convert_image_to_surface_templ(const Image* image, she::Surface* dst,
   }
 }
 
+// Surface colors for each possible 8-bit value of the source image
+// (palette entries for indexed images, gray levels and alpha levels
+// for grayscale images), so each pixel is converted with a lookup.
+// Gray and alpha levels can be combined with an OR because each
+// channel of the surface color is calculated independently.
+class SurfaceColorTable {
+public:
+  // Table for indexed images.
+  SurfaceColorTable(const Palette* palette, const she::SurfaceFormatData* fd) {
+    for (int i=0; i<256; ++i) {
+      m_colors[i] = convert_color_to_surface<IndexedTraits, she::kRgbaSurfaceFormat>(i, palette, fd);
+      m_alphas[i] = 0;
+    }
+  }
+
+  // Tables for grayscale images.
+  SurfaceColorTable(const she::SurfaceFormatData* fd) {
+    for (int i=0; i<256; ++i) {
+      m_colors[i] = convert_color_to_surface<GrayscaleTraits, she::kRgbaSurfaceFormat>(graya(i, 0), nullptr, fd);
+      m_alphas[i] = convert_color_to_surface<GrayscaleTraits, she::kRgbaSurfaceFormat>(graya(0, i), nullptr, fd);
+    }
+  }
+
+  uint32_t indexed(IndexedTraits::pixel_t c) const {
+    return m_colors[c];
+  }
+
+  uint32_t grayscale(GrayscaleTraits::pixel_t c) const {
+    return m_colors[graya_getv(c)] | m_alphas[graya_geta(c)];
+  }
+
+private:
+  uint32_t m_colors[256];
+  uint32_t m_alphas[256];
+};
+
+// Row kernels to convert "w" pixels of one row of the source image
+// to 32bpp surface pixels. They use plain pointers (without the
+// LockImageBits iterator) so the compiler can vectorize them.
+
+void convert_rgb_row_to_rgba(const RgbTraits::pixel_t* src, uint32_t* dst, int w)
+{
+  std::copy(src, src+w, dst);
+}
+
+void convert_rgb_row_to_bgra(const RgbTraits::pixel_t* src, uint32_t* dst, int w)
+{
+  for (int u=0; u<w; ++u) {
+    uint32_t c = src[u];
+    dst[u] = ((c & 0xff00ff00) |
+              ((c & 0x000000ff) << 16) |
+              ((c & 0x00ff0000) >> 16));
+  }
+}
+
+void convert_rgb_row_to_surface(const RgbTraits::pixel_t* src, uint32_t* dst, int w,
+                                const she::SurfaceFormatData* fd)
+{
+  // Local copies of the format so they aren't loaded for each pixel
+  const uint32_t rshift = fd->redShift;
+  const uint32_t gshift = fd->greenShift;
+  const uint32_t bshift = fd->blueShift;
+  const uint32_t ashift = fd->alphaShift;
+  const uint32_t rmask = fd->redMask;
+  const uint32_t gmask = fd->greenMask;
+  const uint32_t bmask = fd->blueMask;
+  const uint32_t amask = fd->alphaMask;
+
+  for (int u=0; u<w; ++u) {
+    uint32_t c = src[u];
+    dst[u] =
+      ((((c >> rgba_r_shift) & 0xff) << rshift) & rmask) |
+      ((((c >> rgba_g_shift) & 0xff) << gshift) & gmask) |
+      ((((c >> rgba_b_shift) & 0xff) << bshift) & bmask) |
+      ((((c >> rgba_a_shift) & 0xff) << ashift) & amask);
+  }
+}
+
+void convert_grayscale_row_to_surface(const GrayscaleTraits::pixel_t* src, uint32_t* dst, int w,
+                                      const SurfaceColorTable& table)
+{
+  for (int u=0; u<w; ++u)
+    dst[u] = table.grayscale(src[u]);
+}
+
+void convert_indexed_row_to_surface(const IndexedTraits::pixel_t* src, uint32_t* dst, int w,
+                                    const SurfaceColorTable& table)
+{
+  for (int u=0; u<w; ++u)
+    dst[u] = table.indexed(src[u]);
+}
+
+// Returns true if the surface format is 32bpp with the same layout
+// as RgbTraits pixels (so rows can be copied directly).
+bool is_rgba_surface(const she::SurfaceFormatData* fd)
+{
+  return (fd->bitsPerPixel == 32 &&
+          fd->redShift == rgba_r_shift && fd->redMask == rgba_r_mask &&
+          fd->greenShift == rgba_g_shift && fd->greenMask == rgba_g_mask &&
+          fd->blueShift == rgba_b_shift && fd->blueMask == rgba_b_mask &&
+          fd->alphaShift == rgba_a_shift && fd->alphaMask == rgba_a_mask);
+}
+
+// Returns true if the surface format is 32bpp with red and blue
+// swapped (the native format of some back-ends).
+bool is_bgra_surface(const she::SurfaceFormatData* fd)
+{
+  return (fd->bitsPerPixel == 32 &&
+          fd->redShift == rgba_b_shift && fd->redMask == rgba_b_mask &&
+          fd->greenShift == rgba_g_shift && fd->greenMask == rgba_g_mask &&
+          fd->blueShift == rgba_r_shift && fd->blueMask == rgba_r_mask &&
+          fd->alphaShift == rgba_a_shift && fd->alphaMask == rgba_a_mask);
+}
+
+// Converts the image to a 32bpp surface row by row. Returns false if
+// there is no specialized kernel for the given image/surface format
+// (and the generic templated conversion must be used).
+bool convert_image_to_32bpp_surface(const Image* image, she::Surface* dst,
+  int src_x, int src_y, int dst_x, int dst_y, int w, int h, const Palette* palette, const she::SurfaceFormatData* fd)
+{
+  if (fd->bitsPerPixel != 32)
+    return false;
+
+  switch (image->pixelFormat()) {
+
+    case IMAGE_RGB: {
+      void (*convert_row)(const RgbTraits::pixel_t*, uint32_t*, int) = nullptr;
+      if (is_rgba_surface(fd))
+        convert_row = &convert_rgb_row_to_rgba;
+      else if (is_bgra_surface(fd))
+        convert_row = &convert_rgb_row_to_bgra;
+
+      for (int v=0; v<h; ++v) {
+        const RgbTraits::pixel_t* src = (const RgbTraits::pixel_t*)image->getPixelAddress(src_x, src_y+v);
+        uint32_t* dst_address = (uint32_t*)dst->getData(dst_x, dst_y+v);
+        if (convert_row)
+          convert_row(src, dst_address, w);
+        else
+          convert_rgb_row_to_surface(src, dst_address, w, fd);
+      }
+      return true;
+    }
+
+    case IMAGE_GRAYSCALE: {
+      SurfaceColorTable table(fd);
+      for (int v=0; v<h; ++v) {
+        convert_grayscale_row_to_surface(
+          (const GrayscaleTraits::pixel_t*)image->getPixelAddress(src_x, src_y+v),
+          (uint32_t*)dst->getData(dst_x, dst_y+v), w, table);
+      }
+      return true;
+    }
+
+    case IMAGE_INDEXED: {
+      SurfaceColorTable table(palette, fd);
+      for (int v=0; v<h; ++v) {
+        convert_indexed_row_to_surface(
+          (const IndexedTraits::pixel_t*)image->getPixelAddress(src_x, src_y+v),
+          (uint32_t*)dst->getData(dst_x, dst_y+v), w, table);
+      }
+      return true;
+    }
+
+    default:
+      // Bitmap images use the generic conversion
+      break;
+  }
+
+  return false;
+}
+
 struct Address24bpp
 {
   uint8_t* m_ptr;
@@ -159,6 +331,9 @@ void convert_image_to_surface(const Image* image, const Palette* palette,
   she::SurfaceFormatData fd;
   surface->getFormat(&fd);
 
+  if (convert_image_to_32bpp_surface(image, surface, src_x, src_y, dst_x, dst_y, w, h, palette, &fd))
+    return;
+
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB:
@@ -0,0 +1,57 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/unique_ptr.h"
+#include "doc/conversion_she.h"
+#include "doc/image.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/test_surface.h"
+
+using namespace doc;
+
+// 4K resolution
+static const int kWidth = 3840;
+static const int kHeight = 2160;
+
+// Arguments: image pixel format, red shift of the surface (0 = RGBA,
+// 16 = BGRA)
+static void BM_ConvertImageToSurface(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int rshift = state.range(1);
+
+  base::UniquePtr<Image> image(Image::create(pixelFormat, kWidth, kHeight));
+  clear_image(image, (pixelFormat == IMAGE_RGB ? rgba(128, 64, 32, 255): 3));
+
+  Palette palette(frame_t(0), 256);
+  for (int i=0; i<256; ++i)
+    palette.setEntry(i, rgba(i, i, i, 255));
+
+  TestSurface surface(kWidth, kHeight,
+                      make_32bpp_surface_format(rshift, 8, 16-rshift, 24));
+
+  while (state.KeepRunning())
+    convert_image_to_surface(image, &palette, &surface,
+                             0, 0, 0, 0, kWidth, kHeight);
+
+  state.SetItemsProcessed(state.iterations() * kWidth * kHeight);
+}
+
+BENCHMARK(BM_ConvertImageToSurface)
+  ->Args({ IMAGE_RGB, 0 })
+  ->Args({ IMAGE_RGB, 16 })
+  ->Args({ IMAGE_GRAYSCALE, 16 })
+  ->Args({ IMAGE_INDEXED, 16 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
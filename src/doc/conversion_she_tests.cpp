@@ -0,0 +1,112 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/unique_ptr.h"
+#include "doc/conversion_she.h"
+#include "doc/image_impl.h"
+#include "doc/palette.h"
+#include "doc/test_surface.h"
+
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+
+// Expected surface pixel (the original per-pixel formula)
+static uint32_t to_surface(int r, int g, int b, int a, const she::SurfaceFormatData& fd)
+{
+  return
+    ((r << fd.redShift  ) & fd.redMask  ) |
+    ((g << fd.greenShift) & fd.greenMask) |
+    ((b << fd.blueShift ) & fd.blueMask ) |
+    ((a << fd.alphaShift) & fd.alphaMask);
+}
+
+static she::SurfaceFormatData surface_formats[] = {
+  make_32bpp_surface_format(0, 8, 16, 24),  // RGBA (memory copy)
+  make_32bpp_surface_format(16, 8, 0, 24),  // BGRA (red/blue swap)
+  make_32bpp_surface_format(24, 16, 8, 0),  // Generic
+};
+
+template<typename ImageTraits>
+static Image* create_random_image(int w, int h)
+{
+  Image* image = Image::create(ImageTraits::pixel_format, w, h);
+  std::srand(w*h);
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel_fast<ImageTraits>(image, x, y, std::rand() & ImageTraits::max_value);
+  return image;
+}
+
+TEST(ConvertImageToSurface, Rgb)
+{
+  UniquePtr<Image> image(create_random_image<RgbTraits>(37, 11));
+
+  for (const auto& fd : surface_formats) {
+    TestSurface surface(40, 16, fd);
+    convert_image_to_surface(image, nullptr, &surface, 1, 2, 3, 4, 30, 9);
+
+    for (int y=0; y<9; ++y)
+      for (int x=0; x<30; ++x) {
+        color_t c = get_pixel_fast<RgbTraits>(image, x+1, y+2);
+        ASSERT_EQ(to_surface(rgba_getr(c), rgba_getg(c), rgba_getb(c), rgba_geta(c), fd),
+                  surface.getRawPixel(x+3, y+4));
+      }
+  }
+}
+
+TEST(ConvertImageToSurface, Grayscale)
+{
+  UniquePtr<Image> image(create_random_image<GrayscaleTraits>(37, 11));
+
+  for (const auto& fd : surface_formats) {
+    TestSurface surface(37, 11, fd);
+    convert_image_to_surface(image, nullptr, &surface, 0, 0, 0, 0, 37, 11);
+
+    for (int y=0; y<11; ++y)
+      for (int x=0; x<37; ++x) {
+        color_t c = get_pixel_fast<GrayscaleTraits>(image, x, y);
+        int v = graya_getv(c);
+        ASSERT_EQ(to_surface(v, v, v, graya_geta(c), fd),
+                  surface.getRawPixel(x, y));
+      }
+  }
+}
+
+TEST(ConvertImageToSurface, Indexed)
+{
+  UniquePtr<Image> image(create_random_image<IndexedTraits>(37, 11));
+
+  // Indexes out of the palette are converted to transparent black
+  Palette palette(frame_t(0), 200);
+  for (int i=0; i<palette.size(); ++i)
+    palette.setEntry(i, rgba(i, 255-i, i/2, 255));
+
+  for (const auto& fd : surface_formats) {
+    TestSurface surface(37, 11, fd);
+    convert_image_to_surface(image, &palette, &surface, 0, 0, 0, 0, 37, 11);
+
+    for (int y=0; y<11; ++y)
+      for (int x=0; x<37; ++x) {
+        color_t c = palette.getEntry(get_pixel_fast<IndexedTraits>(image, x, y));
+        ASSERT_EQ(to_surface(rgba_getr(c), rgba_getg(c), rgba_getb(c), rgba_geta(c), fd),
+                  surface.getRawPixel(x, y));
+      }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
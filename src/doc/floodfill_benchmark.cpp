@@ -0,0 +1,76 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/unique_ptr.h"
+#include "doc/algorithm/floodfill.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+
+static void count_hline(int x1, int y, int x2, void* data)
+{
+  *((int*)data) += x2-x1+1;
+}
+
+// Creates a maze-like image: a flat background with random walls so
+// the filled area isn't a simple rectangle.
+static Image* create_image(PixelFormat pixelFormat, int w, int h)
+{
+  const color_t bg = (pixelFormat == IMAGE_RGB ? rgba(255, 255, 255, 255): 1);
+  const color_t fg = (pixelFormat == IMAGE_RGB ? rgba(0, 0, 0, 255): 2);
+
+  Image* image = Image::create(pixelFormat, w, h);
+  clear_image(image, bg);
+  std::srand(w*h);
+  for (int i=0; i<w*h/256; ++i) {
+    int x = std::rand()%w;
+    int y = std::rand()%h;
+    if (std::rand()%2)
+      fill_rect(image, x, y, x+std::rand()%32, y, fg);
+    else
+      fill_rect(image, x, y, x, y+std::rand()%32, fg);
+  }
+  put_pixel(image, 0, 0, bg);
+  return image;
+}
+
+// Args: pixel format, image size, contiguous fill
+static void BM_FloodFill(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+  const bool contiguous = (state.range(2) != 0);
+
+  UniquePtr<Image> image(create_image(pixelFormat, w, h));
+  int pixels = 0;
+
+  while (state.KeepRunning()) {
+    pixels = 0;
+    algorithm::floodfill(image, nullptr, 0, 0, image->bounds(),
+                         0, contiguous, &pixels, count_hline);
+  }
+  state.SetItemsProcessed(state.iterations() * pixels);
+}
+
+BENCHMARK(BM_FloodFill)
+  ->Args({ IMAGE_RGB, 256, true })
+  ->Args({ IMAGE_RGB, 1024, true })
+  ->Args({ IMAGE_RGB, 1024, false })
+  ->Args({ IMAGE_INDEXED, 1024, true })
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -39,6 +39,8 @@ void FrameTags::add(FrameTag* tag)
   }
   m_tags.insert(it, tag);
   tag->setOwner(this);
+
+  updateRanges();
 }
 
 void FrameTags::remove(FrameTag* tag)
@@ -49,6 +51,8 @@ void FrameTags::remove(FrameTag* tag)
     m_tags.erase(it);
 
   tag->setOwner(nullptr);
+
+  updateRanges();
 }
 
 FrameTag* FrameTags::getByName(const std::string& name) const
@@ -62,8 +66,10 @@ FrameTag* FrameTags::getByName(const std::string& name) const
 
 FrameTag* FrameTags::getById(ObjectId id) const
 {
-  for (FrameTag* tag : *this) {
-    if (tag->id() == id)
+  Object* obj = get_object(id);
+  if (obj && obj->type() == ObjectType::FrameTag) {
+    FrameTag* tag = static_cast<FrameTag*>(obj);
+    if (tag->owner() == this)
       return tag;
   }
   return nullptr;
@@ -71,32 +77,61 @@ FrameTag* FrameTags::getById(ObjectId id) const
 
 FrameTag* FrameTags::innerTag(frame_t frame) const
 {
-  const FrameTag* found = nullptr;
-  for (const FrameTag* tag : *this) {
-    if (frame >= tag->fromFrame() &&
-        frame <= tag->toFrame()) {
-      if (!found ||
-          (tag->toFrame() - tag->fromFrame()) < (found->toFrame() - found->fromFrame())) {
-        found = tag;
-      }
-    }
-  }
-  return const_cast<FrameTag*>(found);
+  const Range* range = findRange(frame);
+  return (range ? range->inner: nullptr);
 }
 
 FrameTag* FrameTags::outerTag(frame_t frame) const
 {
-  const FrameTag* found = nullptr;
-  for (const FrameTag* tag : *this) {
-    if (frame >= tag->fromFrame() &&
-        frame <= tag->toFrame()) {
-      if (!found ||
-          (tag->toFrame() - tag->fromFrame()) > (found->toFrame() - found->fromFrame())) {
-        found = tag;
-      }
+  const Range* range = findRange(frame);
+  return (range ? range->outer: nullptr);
+}
+
+// Splits the frames in ranges where tags start or end, and
+// calculates the inner/outer tags of each range. Tags are visited in
+// order, so the first tag wins if two tags have the same length.
+void FrameTags::updateRanges()
+{
+  std::vector<frame_t> frames;
+  for (const FrameTag* tag : m_tags) {
+    frames.push_back(tag->fromFrame());
+    frames.push_back(tag->toFrame()+1);
+  }
+  std::sort(frames.begin(), frames.end());
+  frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+
+  m_ranges.clear();
+  for (frame_t frame : frames)
+    m_ranges.push_back(Range{ frame, nullptr, nullptr });
+
+  for (FrameTag* tag : m_tags) {
+    frame_t length = tag->toFrame() - tag->fromFrame();
+    auto it = std::lower_bound(
+      m_ranges.begin(), m_ranges.end(), tag->fromFrame(),
+      [](const Range& range, frame_t f) {
+        return range.fromFrame < f;
+      });
+
+    for (; it != m_ranges.end() && it->fromFrame <= tag->toFrame(); ++it) {
+      if (!it->inner ||
+          length < (it->inner->toFrame() - it->inner->fromFrame()))
+        it->inner = tag;
+      if (!it->outer ||
+          length > (it->outer->toFrame() - it->outer->fromFrame()))
+        it->outer = tag;
     }
   }
-  return const_cast<FrameTag*>(found);
+}
+
+const FrameTags::Range* FrameTags::findRange(frame_t frame) const
+{
+  auto it = std::upper_bound(
+    m_ranges.begin(), m_ranges.end(), frame,
+    [](frame_t f, const Range& range) {
+      return f < range.fromFrame;
+    });
+
+  return (it != m_ranges.begin() ? &*(it-1): nullptr);
 }
 
 } // namespace doc
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -46,12 +46,27 @@ namespace doc {
     std::size_t size() const { return m_tags.size(); }
     bool empty() const { return m_tags.empty(); }
 
+    // Returns the smallest/largest tag that contains the given frame
+    // (or nullptr if there is no tag in that frame). These functions
+    // are O(log n) as they use the m_ranges index.
     FrameTag* innerTag(frame_t frame) const;
     FrameTag* outerTag(frame_t frame) const;
 
   private:
+    // Frames from "fromFrame" to the "fromFrame" of the next range
+    // are inside the same set of tags.
+    struct Range {
+      frame_t fromFrame;
+      FrameTag* inner;
+      FrameTag* outer;
+    };
+
+    void updateRanges();
+    const Range* findRange(frame_t frame) const;
+
     Sprite* m_sprite;
     List m_tags;
+    std::vector<Range> m_ranges;
 
     DISABLE_COPYING(FrameTags);
   };
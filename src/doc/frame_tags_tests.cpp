@@ -0,0 +1,104 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/frame_tag.h"
+#include "doc/frame_tags.h"
+
+#include <cstdlib>
+
+using namespace doc;
+
+// Linear search of the smallest (inner) or largest (outer) tag
+static FrameTag* find_tag(const FrameTags& tags, frame_t frame, bool inner)
+{
+  FrameTag* found = nullptr;
+  for (FrameTag* tag : tags) {
+    if (frame >= tag->fromFrame() &&
+        frame <= tag->toFrame()) {
+      frame_t length = tag->toFrame() - tag->fromFrame();
+      frame_t foundLength = (found ? found->toFrame() - found->fromFrame(): 0);
+      if (!found ||
+          (inner && length < foundLength) ||
+          (!inner && length > foundLength))
+        found = tag;
+    }
+  }
+  return found;
+}
+
+//    0 1 2 3 4 5 6 7 8 9
+// a  [-------------]
+// b      [---]
+// c        [-------]
+// d                    [-]
+TEST(FrameTags, InnerAndOuterTags)
+{
+  FrameTags tags(nullptr);
+  FrameTag* a = new FrameTag(0, 6);
+  FrameTag* b = new FrameTag(2, 3);
+  FrameTag* c = new FrameTag(3, 6);
+  FrameTag* d = new FrameTag(9, 9);
+  tags.add(c);
+  tags.add(d);
+  tags.add(a);
+  tags.add(b);
+
+  EXPECT_EQ(a, tags.innerTag(0));
+  EXPECT_EQ(b, tags.innerTag(2));
+  EXPECT_EQ(b, tags.innerTag(3));
+  EXPECT_EQ(c, tags.innerTag(4));
+  EXPECT_EQ(c, tags.innerTag(6));
+  EXPECT_EQ(nullptr, tags.innerTag(7));
+  EXPECT_EQ(d, tags.innerTag(9));
+  EXPECT_EQ(nullptr, tags.innerTag(10));
+  EXPECT_EQ(nullptr, tags.innerTag(-1));
+
+  EXPECT_EQ(a, tags.outerTag(3));
+  EXPECT_EQ(a, tags.outerTag(6));
+  EXPECT_EQ(nullptr, tags.outerTag(8));
+  EXPECT_EQ(d, tags.outerTag(9));
+
+  // Ranges are updated when a tag is moved or removed
+  b->setFrameRange(7, 8);
+  EXPECT_EQ(c, tags.innerTag(3));
+  EXPECT_EQ(b, tags.innerTag(7));
+  EXPECT_EQ(b, tags.outerTag(8));
+
+  tags.remove(c);
+  EXPECT_EQ(a, tags.innerTag(4));
+  delete c;
+
+  EXPECT_EQ(a, tags.getById(a->id()));
+  EXPECT_EQ(b, tags.getById(b->id()));
+  EXPECT_EQ(nullptr, tags.getById(NullId));
+}
+
+TEST(FrameTags, SameResultsAsLinearSearch)
+{
+  std::srand(1);
+  FrameTags tags(nullptr);
+  for (int i=0; i<64; ++i) {
+    frame_t from = std::rand() % 100;
+    tags.add(new FrameTag(from, from + std::rand() % 20));
+  }
+
+  for (frame_t frame=-1; frame<130; ++frame) {
+    EXPECT_EQ(find_tag(tags, frame, true), tags.innerTag(frame));
+    EXPECT_EQ(find_tag(tags, frame, false), tags.outerTag(frame));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
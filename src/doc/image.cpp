@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -19,6 +19,24 @@
 
 namespace doc {
 
+namespace {
+
+template<typename ImageTraits>
+Image* create_copy_templ(const Image* image, const ImageBufferPtr& buffer)
+{
+  const ImageImpl<ImageTraits>* src =
+    static_cast<const ImageImpl<ImageTraits>*>(image);
+
+  // Share the pixels with the copy (copy-on-write)
+  if (!buffer && src->canShareBuffer())
+    return new ImageImpl<ImageTraits>(*src);
+
+  return crop_image(image, 0, 0, image->width(), image->height(),
+                    image->maskColor(), buffer);
+}
+
+} // anonymous namespace
+
 Image::Image(PixelFormat format, int width, int height)
   : Object(ObjectType::Image)
   , m_format(format)
@@ -64,8 +82,13 @@ Image* Image::create(PixelFormat format, int width, int height,
 Image* Image::createCopy(const Image* image, const ImageBufferPtr& buffer)
 {
   ASSERT(image);
-  return crop_image(image, 0, 0, image->width(), image->height(),
-    image->maskColor(), buffer);
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:       return create_copy_templ<RgbTraits>(image, buffer);
+    case IMAGE_GRAYSCALE: return create_copy_templ<GrayscaleTraits>(image, buffer);
+    case IMAGE_INDEXED:   return create_copy_templ<IndexedTraits>(image, buffer);
+    case IMAGE_BITMAP:    return create_copy_templ<BitmapTraits>(image, buffer);
+  }
+  return NULL;
 }
 
 } // namespace doc
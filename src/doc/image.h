@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -52,6 +52,8 @@ namespace doc {
 
     template<typename ImageTraits>
     ImageBits<ImageTraits> lockBits(LockType lockType, const gfx::Rect& bounds) {
+      if (lockType != ReadLock)
+        detachBuffer();
       return ImageBits<ImageTraits>(this, bounds);
     }
 
@@ -65,10 +67,27 @@ namespace doc {
       // Do nothing
     }
 
+    // Images created with createCopy() share the pixels buffer with
+    // the original image until one of them is modified
+    // (copy-on-write). This function gives to this image its own copy
+    // of the pixels (if they are shared). It's called automatically
+    // from all functions that can modify pixels (the non-const
+    // getPixelAddress(), lockBits() for writing, putPixel(), etc.).
+    //
+    // Images that share a buffer can be used (and modified) from
+    // different threads: the buffer reference counter is atomic. But
+    // the same Image cannot be modified in one thread while it's
+    // used from another one.
+    virtual void detachBuffer() = 0;
+
     // Warning: These functions doesn't have (and shouldn't have)
     // bounds checks. Use the primitives defined in doc/primitives.h
     // in case that you need bounds check.
-    virtual uint8_t* getPixelAddress(int x, int y) const = 0;
+    //
+    // The const version of getPixelAddress() must be used only to
+    // read pixels, the non-const one detaches the pixels buffer.
+    virtual const uint8_t* getPixelAddress(int x, int y) const = 0;
+    virtual uint8_t* getPixelAddress(int x, int y) = 0;
     virtual color_t getPixel(int x, int y) const = 0;
     virtual void putPixel(int x, int y, color_t color) = 0;
     virtual void clear(color_t color) = 0;
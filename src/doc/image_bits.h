@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2014 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -18,6 +18,7 @@ namespace doc {
   class ImageBits {
   public:
     typedef typename ImageTraits::address_t address_t;
+    typedef typename ImageTraits::const_address_t const_address_t;
     typedef ImageIterator<ImageTraits> iterator;
     typedef ImageConstIterator<ImageTraits> const_iterator;
 
@@ -86,8 +87,51 @@ namespace doc {
       return it;
     }
 
+    // Row access. It's faster than iterators (which check the end of
+    // the row for each pixel) and the pixels of a row can be
+    // processed with plain pointers (so loops can be vectorized).
+    //
+    // "y" is relative to bounds().y, and the returned address is the
+    // one of the first pixel of the row (at bounds().x). It's not
+    // available for BitmapTraits (pixels are packed in bits).
+    address_t row(int y) const {
+      static_assert(ImageTraits::pixels_per_byte <= 1,
+                    "Row access is not available for images with several pixels per byte");
+      ASSERT(y >= 0 && y < m_bounds.h);
+      // The const getPixelAddress() is used because it doesn't detach
+      // the buffer (it was already detached in Image::lockBits() if
+      // the image was locked for writing).
+      return (address_t)static_cast<const Image*>(m_image)
+        ->getPixelAddress(m_bounds.x, m_bounds.y+y);
+    }
+
+    // Returns true if the rows of the locked area are consecutive in
+    // memory (e.g. the area contains full rows of the image), so all
+    // the pixels can be processed as one span of pixels starting at
+    // row(0).
+    bool isContiguous() const {
+      return (m_bounds.h <= 1 ||
+              row(m_bounds.h-1) == row(0) + (m_bounds.h-1)*m_bounds.w);
+    }
+
+    // Calls "f(address, n)" for each span of "n" consecutive pixels
+    // of the locked area (only once for the whole area if it's
+    // contiguous, or once per row).
+    template<typename Func>
+    void forEachSpan(Func f) const {
+      if (m_bounds.isEmpty())
+        return;
+
+      if (isContiguous())
+        f(row(0), m_bounds.w*m_bounds.h);
+      else {
+        for (int y=0; y<m_bounds.h; ++y)
+          f(row(y), m_bounds.w);
+      }
+    }
+
     Image* image() const { return m_image; }
-    const gfx::Rect& bounds() { return m_bounds; }
+    const gfx::Rect& bounds() const { return m_bounds; }
 
     Image* image() { return m_image; }
 
@@ -109,6 +153,8 @@ namespace doc {
     typedef ImageBits<ImageTraits> Bits;
     typedef typename Bits::iterator iterator;
     typedef typename Bits::const_iterator const_iterator;
+    typedef typename Bits::address_t address_t;
+    typedef typename Bits::const_address_t const_address_t;
 
     explicit LockImageBits(const Image* image)
       : m_bits(image->lockBits<ImageTraits>(Image::ReadLock, image->bounds())) {
@@ -118,6 +164,16 @@ namespace doc {
       : m_bits(image->lockBits<ImageTraits>(Image::ReadLock, bounds)) {
     }
 
+    // Non-const images are locked for writing (so shared pixels are
+    // detached, see Image::detachBuffer()).
+    explicit LockImageBits(Image* image)
+      : m_bits(image->lockBits<ImageTraits>(Image::ReadWriteLock, image->bounds())) {
+    }
+
+    LockImageBits(Image* image, const gfx::Rect& bounds)
+      : m_bits(image->lockBits<ImageTraits>(Image::ReadWriteLock, bounds)) {
+    }
+
     LockImageBits(Image* image, Image::LockType lockType)
       : m_bits(image->lockBits<ImageTraits>(lockType, image->bounds())) {
     }
@@ -141,6 +197,24 @@ namespace doc {
     const_iterator begin_area(const gfx::Rect& area) const { return m_bits.begin_area(area); }
     const_iterator end_area(const gfx::Rect& area) const { return m_bits.end_area(area); }
 
+    // Rows and spans of pixels (see ImageBits::row()).
+    address_t row(int y) { return m_bits.row(y); }
+    const_address_t row(int y) const { return m_bits.row(y); }
+    bool isContiguous() const { return m_bits.isContiguous(); }
+
+    template<typename Func>
+    void forEachSpan(Func f) {
+      m_bits.forEachSpan(f);
+    }
+
+    template<typename Func>
+    void forEachSpan(Func f) const {
+      m_bits.forEachSpan(
+        [&f](address_t address, int n) {
+          f(const_address_t(address), n);
+        });
+    }
+
     const Image* image() const { return m_bits.image(); }
     const gfx::Rect& bounds() const { return m_bits.bounds(); }
 
@@ -0,0 +1,100 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/unique_ptr.h"
+#include "doc/image_impl.h"
+#include "doc/primitives.h"
+
+using namespace doc;
+
+// Args: image width, image height, locked area inset (0 = whole
+// image, contiguous)
+static void create_image(benchmark::State& state,
+                         base::UniquePtr<Image>& image, gfx::Rect& bounds)
+{
+  image.reset(Image::create(IMAGE_RGB, state.range(0), state.range(1)));
+  clear_image(image, rgba(1, 2, 3, 4));
+
+  bounds = image->bounds();
+  bounds.shrink(state.range(2));
+}
+
+static void BM_LockImageBitsIterator(benchmark::State& state)
+{
+  base::UniquePtr<Image> image;
+  gfx::Rect bounds;
+  create_image(state, image, bounds);
+
+  while (state.KeepRunning()) {
+    LockImageBits<RgbTraits> bits(image, bounds);
+    for (auto it=bits.begin(), end=bits.end(); it!=end; ++it)
+      *it = (*it) ^ 0x00ffffff;
+  }
+  state.SetItemsProcessed(state.iterations() * bounds.w * bounds.h);
+}
+
+static void BM_LockImageBitsRows(benchmark::State& state)
+{
+  base::UniquePtr<Image> image;
+  gfx::Rect bounds;
+  create_image(state, image, bounds);
+
+  while (state.KeepRunning()) {
+    LockImageBits<RgbTraits> bits(image, bounds);
+    for (int y=0; y<bounds.h; ++y) {
+      RgbTraits::address_t it = bits.row(y);
+      for (int x=0; x<bounds.w; ++x, ++it)
+        *it = (*it) ^ 0x00ffffff;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * bounds.w * bounds.h);
+}
+
+static void BM_LockImageBitsSpans(benchmark::State& state)
+{
+  base::UniquePtr<Image> image;
+  gfx::Rect bounds;
+  create_image(state, image, bounds);
+
+  while (state.KeepRunning()) {
+    LockImageBits<RgbTraits> bits(image, bounds);
+    bits.forEachSpan(
+      [](RgbTraits::address_t it, int n) {
+        for (; n > 0; --n, ++it)
+          *it = (*it) ^ 0x00ffffff;
+      });
+  }
+  state.SetItemsProcessed(state.iterations() * bounds.w * bounds.h);
+}
+
+BENCHMARK(BM_LockImageBitsIterator)
+  ->Args({ 256, 256, 0 })
+  ->Args({ 1024, 1024, 0 })
+  ->Args({ 1024, 1024, 1 })
+  ->Args({ 16, 16384, 0 })
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_LockImageBitsRows)
+  ->Args({ 256, 256, 0 })
+  ->Args({ 1024, 1024, 0 })
+  ->Args({ 1024, 1024, 1 })
+  ->Args({ 16, 16384, 0 })
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_LockImageBitsSpans)
+  ->Args({ 256, 256, 0 })
+  ->Args({ 1024, 1024, 0 })
+  ->Args({ 1024, 1024, 1 })
+  ->Args({ 16, 16384, 0 })
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,352 @@
+// Aseprite Document Library
+// Copyright (c) 2001-2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_buffer.h"
+
+#include "base/debug.h"
+#include "base/mutex.h"
+#include "base/scoped_lock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace doc {
+
+namespace {
+
+// Smaller blocks are allocated with this size (2^kMinBlockBits).
+const int kMinBlockBits = 8;
+const std::size_t kMinBlockSize = (std::size_t(1) << kMinBlockBits);
+
+// Bigger blocks are not pooled, they are returned to the system
+// directly (2^kMaxBlockBits = 64 MB).
+const int kMaxBlockBits = 26;
+const std::size_t kMaxPooledBlockSize = (std::size_t(1) << kMaxBlockBits);
+
+// Each power of two is divided in these number of size classes, so
+// we waste 25% of each block at most.
+const int kSubclasses = 4;
+const int kSizeClasses = (kMaxBlockBits - kMinBlockBits) * kSubclasses + 1;
+
+// Maximum number of free bytes kept in the global pool and in the
+// cache of each thread.
+const std::size_t kMaxGlobalPoolBytes = 128*1024*1024;
+const std::size_t kMaxThreadCacheBytes = 16*1024*1024;
+
+std::atomic<std::size_t> live_bytes(0);
+std::atomic<std::size_t> pooled_bytes(0);
+std::atomic<std::size_t> requests(0);
+std::atomic<std::size_t> hits(0);
+
+// Returns the size class for a block of "size" bytes, and the real
+// size of the block in "blockSize". Returns -1 if the block must not
+// be pooled.
+int size_class(std::size_t size, std::size_t& blockSize)
+{
+  if (size <= kMinBlockSize) {
+    blockSize = kMinBlockSize;
+    return 0;
+  }
+
+  if (size > kMaxPooledBlockSize) {
+    blockSize = size;
+    return -1;
+  }
+
+  int bits = kMinBlockBits;
+  while ((std::size_t(1) << (bits+1)) <= size-1)
+    ++bits;
+
+  std::size_t base = (std::size_t(1) << bits);
+  std::size_t step = base / kSubclasses;
+  std::size_t sub = (size-1-base) / step;
+
+  blockSize = base + (sub+1)*step;
+  return int((bits-kMinBlockBits)*kSubclasses + sub + 1);
+}
+
+// Allocates a zero-filled block of memory aligned to
+// ImageBuffer::alignment. The original pointer is stored just before
+// the returned address.
+uint8_t* allocate_block(std::size_t size)
+{
+  void* raw = std::calloc(size + sizeof(void*) + ImageBuffer::alignment, 1);
+  if (!raw)
+    throw std::bad_alloc();
+
+  uintptr_t addr = uintptr_t(raw) + sizeof(void*) + ImageBuffer::alignment - 1;
+  addr &= ~uintptr_t(ImageBuffer::alignment - 1);
+
+  ((void**)addr)[-1] = raw;
+  return (uint8_t*)addr;
+}
+
+void free_block(uint8_t* block)
+{
+  std::free(((void**)block)[-1]);
+}
+
+// A set of free blocks grouped by size class.
+class FreeBlocks {
+public:
+  FreeBlocks(std::size_t maxBytes)
+    : m_bytes(0)
+    , m_maxBytes(maxBytes) {
+  }
+
+  uint8_t* pop(int sizeClass, std::size_t blockSize) {
+    std::vector<uint8_t*>& blocks = m_blocks[sizeClass];
+    if (blocks.empty())
+      return nullptr;
+
+    uint8_t* block = blocks.back();
+    blocks.pop_back();
+    m_bytes -= blockSize;
+    pooled_bytes -= blockSize;
+    return block;
+  }
+
+  bool push(int sizeClass, std::size_t blockSize, uint8_t* block) {
+    if (m_bytes + blockSize > m_maxBytes)
+      return false;
+
+    m_blocks[sizeClass].push_back(block);
+    m_bytes += blockSize;
+    pooled_bytes += blockSize;
+    return true;
+  }
+
+  // Calls "func(sizeClass, blockSize, block)" for each block and
+  // removes all of them.
+  template<typename Func>
+  void clear(Func func) {
+    for (int i=0; i<kSizeClasses; ++i) {
+      std::vector<uint8_t*>& blocks = m_blocks[i];
+      if (blocks.empty())
+        continue;
+
+      const std::size_t blockSize = block_size(i);
+      for (uint8_t* block : blocks) {
+        m_bytes -= blockSize;
+        pooled_bytes -= blockSize;
+        func(i, blockSize, block);
+      }
+      blocks.clear();
+    }
+  }
+
+private:
+  static std::size_t block_size(int sizeClass) {
+    if (sizeClass == 0)
+      return kMinBlockSize;
+
+    int bits = kMinBlockBits + (sizeClass-1) / kSubclasses;
+    std::size_t base = (std::size_t(1) << bits);
+    return base + ((sizeClass-1) % kSubclasses + 1) * (base / kSubclasses);
+  }
+
+  std::vector<uint8_t*> m_blocks[kSizeClasses];
+  std::size_t m_bytes;
+  std::size_t m_maxBytes;
+};
+
+// The global pool shared by all threads.
+class GlobalPool {
+public:
+  GlobalPool() : m_blocks(kMaxGlobalPoolBytes) { }
+
+  uint8_t* pop(int sizeClass, std::size_t blockSize) {
+    base::scoped_lock lock(m_mutex);
+    return m_blocks.pop(sizeClass, blockSize);
+  }
+
+  bool push(int sizeClass, std::size_t blockSize, uint8_t* block) {
+    base::scoped_lock lock(m_mutex);
+    return m_blocks.push(sizeClass, blockSize, block);
+  }
+
+  void releaseMemory() {
+    base::scoped_lock lock(m_mutex);
+    m_blocks.clear([](int, std::size_t, uint8_t* block){
+        free_block(block);
+      });
+  }
+
+private:
+  base::mutex m_mutex;
+  FreeBlocks m_blocks;
+};
+
+GlobalPool& global_pool()
+{
+  // The pool is never destroyed as image buffers can be released
+  // from the destructors of static objects.
+  static GlobalPool* pool = new GlobalPool;
+  return *pool;
+}
+
+// Free blocks of the current thread (used without locks).
+class ThreadCache {
+public:
+  ThreadCache() : m_blocks(kMaxThreadCacheBytes) { }
+
+  uint8_t* pop(int sizeClass, std::size_t blockSize) {
+    return m_blocks.pop(sizeClass, blockSize);
+  }
+
+  bool push(int sizeClass, std::size_t blockSize, uint8_t* block) {
+    return m_blocks.push(sizeClass, blockSize, block);
+  }
+
+  // Moves all blocks to the global pool.
+  void flush() {
+    m_blocks.clear([](int sizeClass, std::size_t blockSize, uint8_t* block){
+        if (!global_pool().push(sizeClass, blockSize, block))
+          free_block(block);
+      });
+  }
+
+private:
+  FreeBlocks m_blocks;
+};
+
+// The cache is created the first time a thread uses it, and it's
+// destroyed when the thread finishes. After that (e.g. buffers
+// released by static objects at exit) blocks go to the global pool.
+thread_local ThreadCache* thread_cache_ptr = nullptr;
+thread_local bool thread_cache_destroyed = false;
+
+struct ThreadCacheOwner {
+  ~ThreadCacheOwner() {
+    if (thread_cache_ptr) {
+      thread_cache_ptr->flush();
+      delete thread_cache_ptr;
+      thread_cache_ptr = nullptr;
+    }
+    thread_cache_destroyed = true;
+  }
+};
+
+thread_local ThreadCacheOwner thread_cache_owner;
+
+ThreadCache* thread_cache()
+{
+  if (!thread_cache_ptr && !thread_cache_destroyed) {
+    (void)&thread_cache_owner; // Register the owner destructor for this thread
+    thread_cache_ptr = new ThreadCache;
+  }
+  return thread_cache_ptr;
+}
+
+uint8_t* alloc_buffer(std::size_t size, std::size_t& capacity)
+{
+  ++requests;
+
+  uint8_t* block = nullptr;
+  int sizeClass = size_class(size, capacity);
+  if (sizeClass >= 0) {
+    ThreadCache* cache = thread_cache();
+    if (cache)
+      block = cache->pop(sizeClass, capacity);
+    if (!block)
+      block = global_pool().pop(sizeClass, capacity);
+
+    if (block) {
+      ++hits;
+      std::memset(block, 0, size);
+    }
+  }
+
+  if (!block)
+    block = allocate_block(capacity);
+
+  live_bytes += capacity;
+  return block;
+}
+
+void free_buffer(uint8_t* block, std::size_t capacity)
+{
+  live_bytes -= capacity;
+
+  std::size_t blockSize;
+  int sizeClass = size_class(capacity, blockSize);
+  if (sizeClass >= 0) {
+    ASSERT(blockSize == capacity);
+
+    ThreadCache* cache = thread_cache();
+    if (cache && cache->push(sizeClass, blockSize, block))
+      return;
+    if (global_pool().push(sizeClass, blockSize, block))
+      return;
+  }
+
+  free_block(block);
+}
+
+} // anonymous namespace
+
+ImageBuffer::ImageBuffer(std::size_t size)
+  : m_buffer(nullptr)
+  , m_size(size)
+  , m_capacity(0)
+{
+  m_buffer = alloc_buffer(size, m_capacity);
+}
+
+ImageBuffer::~ImageBuffer()
+{
+  free_buffer(m_buffer, m_capacity);
+}
+
+void ImageBuffer::resizeIfNecessary(std::size_t size)
+{
+  if (size <= m_size)
+    return;
+
+  if (size > m_capacity) {
+    std::size_t newCapacity;
+    uint8_t* newBuffer = alloc_buffer(size, newCapacity);
+    std::copy(m_buffer, m_buffer+m_size, newBuffer);
+    free_buffer(m_buffer, m_capacity);
+
+    m_buffer = newBuffer;
+    m_capacity = newCapacity;
+  }
+  else
+    std::fill(m_buffer+m_size, m_buffer+size, 0);
+
+  m_size = size;
+}
+
+// static
+ImageBufferStats ImageBuffer::stats()
+{
+  ImageBufferStats stats;
+  stats.liveBytes = live_bytes;
+  stats.pooledBytes = pooled_bytes;
+  stats.requests = requests;
+  stats.hits = hits;
+  return stats;
+}
+
+// static
+void ImageBuffer::releasePooledMemory()
+{
+  if (ThreadCache* cache = thread_cache())
+    cache->flush();
+  global_pool().releaseMemory();
+}
+
+} // namespace doc
@@ -8,29 +8,61 @@
 #define DOC_IMAGE_BUFFER_H_INCLUDED
 #pragma once
 
+#include "base/disable_copying.h"
 #include "base/ints.h"
 #include "base/shared_ptr.h"
 
-#include <vector>
 #include <cstddef>
 
 namespace doc {
 
+  // Statistics of the memory used by all image buffers.
+  struct ImageBufferStats {
+    std::size_t liveBytes;      // Bytes used by existent buffers
+    std::size_t pooledBytes;    // Bytes of free blocks ready to be reused
+    std::size_t requests;       // Number of allocated buffers
+    std::size_t hits;           // Buffers that reused a pooled block
+
+    double hitRate() const {
+      return (requests > 0 ? double(hits) / double(requests): 0.0);
+    }
+  };
+
+  // A block of memory to store pixels. Blocks are allocated from a
+  // pool (grouped by size classes) so the memory of short-lived
+  // images (temporary images to render, to apply filters, etc.) is
+  // reused without going to the system allocator each time. The pool
+  // is thread-safe, and each thread keeps a small cache of free
+  // blocks to avoid locking the pool in the most common cases.
   class ImageBuffer {
   public:
-    ImageBuffer(std::size_t size = 1) : m_buffer(size) {
-    }
+    // Alignment of the buffer() address (so SIMD instructions can
+    // be used to process the pixels).
+    enum { alignment = 64 };
 
-    std::size_t size() const { return m_buffer.size(); }
-    uint8_t* buffer() { return &m_buffer[0]; }
+    // The buffer is filled with zeros (as a std::vector<uint8_t>).
+    ImageBuffer(std::size_t size = 1);
+    ~ImageBuffer();
 
-    void resizeIfNecessary(std::size_t size) {
-      if (size > m_buffer.size())
-        m_buffer.resize(size);
-    }
+    std::size_t size() const { return m_size; }
+    uint8_t* buffer() { return m_buffer; }
+
+    // Makes the buffer bigger (if it's necessary) keeping its content
+    // and filling the new space with zeros.
+    void resizeIfNecessary(std::size_t size);
+
+    static ImageBufferStats stats();
+
+    // Returns all pooled memory of the global pool and of the
+    // calling thread to the system.
+    static void releasePooledMemory();
 
   private:
-    std::vector<uint8_t> m_buffer;
+    uint8_t* m_buffer;
+    std::size_t m_size;
+    std::size_t m_capacity;
+
+    DISABLE_COPYING(ImageBuffer);
   };
 
   typedef base::SharedPtr<ImageBuffer> ImageBufferPtr;
@@ -0,0 +1,135 @@
+// Aseprite Document Library
+// Copyright (c) 2001-2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/unique_ptr.h"
+#include "doc/image.h"
+#include "doc/image_buffer.h"
+
+#include <cstring>
+#include <thread>
+
+using namespace base;
+using namespace doc;
+
+static bool is_aligned(const void* ptr)
+{
+  return ((uintptr_t)ptr % ImageBuffer::alignment) == 0;
+}
+
+static bool is_zero(const uint8_t* p, std::size_t size)
+{
+  for (std::size_t i=0; i<size; ++i)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+TEST(ImageBuffer, Alignment)
+{
+  for (std::size_t size : { 1, 3, 255, 256, 257, 1000, 4096, 100000 }) {
+    ImageBuffer buf(size);
+    EXPECT_EQ(size, buf.size());
+    EXPECT_TRUE(is_aligned(buf.buffer()));
+  }
+}
+
+TEST(ImageBuffer, ReusedBlocksAreZeroFilled)
+{
+  ImageBuffer::releasePooledMemory();
+  {
+    ImageBuffer buf(5000);
+    std::memset(buf.buffer(), 0xff, buf.size());
+  }
+
+  ImageBufferStats before = ImageBuffer::stats();
+  ImageBuffer buf(4900);
+  ImageBufferStats after = ImageBuffer::stats();
+
+  EXPECT_EQ(before.requests+1, after.requests);
+  EXPECT_EQ(before.hits+1, after.hits);
+  EXPECT_TRUE(is_zero(buf.buffer(), buf.size()));
+}
+
+TEST(ImageBuffer, ResizeKeepsContent)
+{
+  ImageBuffer buf(10);
+  for (int i=0; i<10; ++i)
+    buf.buffer()[i] = i+1;
+
+  // Inside the same block
+  buf.resizeIfNecessary(20);
+  EXPECT_EQ(20, buf.size());
+
+  // A new block
+  buf.resizeIfNecessary(10000);
+  EXPECT_EQ(10000, buf.size());
+  EXPECT_TRUE(is_aligned(buf.buffer()));
+
+  for (int i=0; i<10; ++i)
+    EXPECT_EQ(i+1, buf.buffer()[i]);
+  EXPECT_TRUE(is_zero(buf.buffer()+10, buf.size()-10));
+
+  // Smaller sizes don't modify the buffer
+  buf.resizeIfNecessary(5);
+  EXPECT_EQ(10000, buf.size());
+}
+
+TEST(ImageBuffer, Stats)
+{
+  ImageBuffer::releasePooledMemory();
+  ImageBufferStats stats = ImageBuffer::stats();
+  EXPECT_EQ(0, stats.pooledBytes);
+
+  std::size_t liveBytes = stats.liveBytes;
+  {
+    ImageBuffer buf(100000);
+    stats = ImageBuffer::stats();
+    EXPECT_LE(liveBytes+100000, stats.liveBytes);
+  }
+
+  stats = ImageBuffer::stats();
+  EXPECT_EQ(liveBytes, stats.liveBytes);
+  EXPECT_LE(100000, stats.pooledBytes);
+
+  ImageBuffer::releasePooledMemory();
+  EXPECT_EQ(0, ImageBuffer::stats().pooledBytes);
+}
+
+TEST(ImageBuffer, BlocksFromOtherThreads)
+{
+  ImageBuffer::releasePooledMemory();
+
+  // The cache of the thread is moved to the global pool when the
+  // thread finishes.
+  std::thread thread([]{
+      ImageBuffer buf(30000);
+    });
+  thread.join();
+
+  ImageBufferStats before = ImageBuffer::stats();
+  ImageBuffer buf(30000);
+  EXPECT_EQ(before.hits+1, ImageBuffer::stats().hits);
+}
+
+TEST(ImageBuffer, AlignedPixels)
+{
+  for (PixelFormat pixelFormat : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    UniquePtr<Image> image(Image::create(pixelFormat, 17, 9));
+    EXPECT_TRUE(is_aligned(image->getPixelAddress(0, 0)));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
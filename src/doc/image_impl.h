@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include "doc/bitmap_ops.h"
 #include "doc/blend_funcs.h"
 #include "doc/image.h"
 #include "doc/image_bits.h"
@@ -32,6 +33,12 @@ namespace doc {
     address_t m_bits;
     address_t* m_rows;
 
+    // True if m_buffer was allocated by this image (or by the image
+    // that we've copied). Only these buffers are shared between
+    // copies of the image (copy-on-write), buffers given by the user
+    // in the constructor are never shared nor detached.
+    bool m_cow;
+
     inline address_t getBitsAddress() {
       return m_bits;
     }
@@ -50,20 +57,17 @@ namespace doc {
       return m_rows[y];
     }
 
-  public:
-    inline address_t address(int x, int y) const {
-      return (address_t)(m_rows[y] + x / (Traits::pixels_per_byte == 0 ? 1 : Traits::pixels_per_byte));
-    }
-
-    ImageImpl(int width, int height,
-              const ImageBufferPtr& buffer)
-      : Image(static_cast<PixelFormat>(Traits::pixel_format), width, height)
-      , m_buffer(buffer)
-    {
-      std::size_t for_rows = sizeof(address_t) * height;
-      std::size_t rowstride_bytes = Traits::getRowStrideBytes(width);
-      std::size_t required_size = for_rows + rowstride_bytes*height;
-
+    // Allocates a new buffer for this image (if "buffer" is nullptr)
+    // and fills the table of rows (which is at the beginning of the
+    // buffer). Pixels start at an address aligned to
+    // ImageBuffer::alignment.
+    void initBuffer(const ImageBufferPtr& buffer) {
+      std::size_t for_rows = sizeof(address_t) * height();
+      for_rows = (for_rows + ImageBuffer::alignment - 1) & ~std::size_t(ImageBuffer::alignment - 1);
+      std::size_t rowstride_bytes = Traits::getRowStrideBytes(width());
+      std::size_t required_size = for_rows + rowstride_bytes*height();
+
+      m_buffer = buffer;
       if (!m_buffer)
         m_buffer.reset(new ImageBuffer(required_size));
       else
@@ -73,13 +77,84 @@ namespace doc {
       m_bits = (address_t)(m_buffer->buffer() + for_rows);
 
       address_t addr = m_bits;
-      for (int y=0; y<height; ++y) {
+      for (int y=0; y<height(); ++y) {
         m_rows[y] = addr;
         addr = (address_t)(((uint8_t*)addr) + rowstride_bytes);
       }
     }
 
-    uint8_t* getPixelAddress(int x, int y) const override {
+    bool isSharedBuffer() const {
+      return (m_cow && !m_buffer.unique());
+    }
+
+    // Copies the shared pixels to a new buffer for this image. The old
+    // buffer is kept by the other images that were sharing it.
+    void copyBuffer() {
+      ImageBufferPtr oldBuffer = m_buffer;
+      const uint8_t* oldBits = (const uint8_t*)m_bits;
+      std::size_t size = Traits::getRowStrideBytes(width()) * height();
+
+      initBuffer(ImageBufferPtr());
+      std::copy(oldBits, oldBits + size, (uint8_t*)m_bits);
+    }
+
+    // Address of a pixel without detaching the buffer (it must be
+    // detached before writing through the returned address).
+    inline address_t sharedAddress(int x, int y) const {
+      return (address_t)(m_rows[y] + x / (Traits::pixels_per_byte == 0 ? 1 : Traits::pixels_per_byte));
+    }
+
+  public:
+    inline const_address_t address(int x, int y) const {
+      return sharedAddress(x, y);
+    }
+
+    // Same as address() but it detaches the buffer, so the returned
+    // address can be used to modify the pixel.
+    inline address_t address(int x, int y) {
+      if (isSharedBuffer())
+        copyBuffer();
+      return sharedAddress(x, y);
+    }
+
+    ImageImpl(int width, int height,
+              const ImageBufferPtr& buffer)
+      : Image(static_cast<PixelFormat>(Traits::pixel_format), width, height)
+      , m_cow(!buffer)
+    {
+      initBuffer(buffer);
+    }
+
+    // Creates a copy of the given image sharing its pixels buffer
+    // (the buffer will be copied when one of the images is modified).
+    ImageImpl(const ImageImpl& other)
+      : Image(static_cast<PixelFormat>(Traits::pixel_format), other.width(), other.height())
+      , m_buffer(other.m_buffer)
+      , m_bits(other.m_bits)
+      , m_rows(other.m_rows)
+      , m_cow(true)
+    {
+      ASSERT(other.m_cow);
+      setMaskColor(other.maskColor());
+    }
+
+    bool canShareBuffer() const {
+      return m_cow;
+    }
+
+    void detachBuffer() override {
+      if (isSharedBuffer())
+        copyBuffer();
+    }
+
+    const uint8_t* getPixelAddress(int x, int y) const override {
+      ASSERT(x >= 0 && x < width());
+      ASSERT(y >= 0 && y < height());
+
+      return (const uint8_t*)address(x, y);
+    }
+
+    uint8_t* getPixelAddress(int x, int y) override {
       ASSERT(x >= 0 && x < width());
       ASSERT(y >= 0 && y < height());
 
@@ -104,28 +179,36 @@ namespace doc {
       int w = width();
       int h = height();
 
+      // All pixels will be replaced, so we don't need to copy the
+      // shared ones.
+      if (isSharedBuffer())
+        initBuffer(ImageBufferPtr());
+
       // Fill the first line
-      address_t first = address(0, 0);
+      address_t first = sharedAddress(0, 0);
       std::fill(first, first+w, color);
 
       // Copy the first line into all other lines
       for (int y=1; y<h; ++y)
-        std::copy(first, first+w, address(0, y));
+        std::copy(first, first+w, sharedAddress(0, y));
     }
 
     void copy(const Image* _src, gfx::Clip area) override {
       const ImageImpl<Traits>* src = (const ImageImpl<Traits>*)_src;
-      address_t src_address;
+      const_address_t src_address;
       address_t dst_address;
 
       if (!area.clip(width(), height(), src->width(), src->height()))
         return;
 
+      // Detach the buffer once (instead of checking it on each row)
+      detachBuffer();
+
       for (int end_y=area.dst.y+area.size.h;
            area.dst.y<end_y;
            ++area.dst.y, ++area.src.y) {
         src_address = src->address(area.src.x, area.src.y);
-        dst_address = address(area.dst.x, area.dst.y);
+        dst_address = sharedAddress(area.dst.x, area.dst.y);
 
         std::copy(src_address,
                   src_address + area.size.w,
@@ -143,14 +226,14 @@ namespace doc {
     }
 
     void fillRect(int x1, int y1, int x2, int y2, color_t color) override {
-      // Fill the first line
+      // Fill the first line (it detaches the buffer)
       ImageImpl<Traits>::drawHLine(x1, y1, x2, color);
 
       // Copy all other lines
-      address_t first = address(x1, y1);
+      const_address_t first = sharedAddress(x1, y1);
       int w = x2 - x1 + 1;
       for (int y=y1; y<=y2; ++y)
-        std::copy(first, first+w, address(x1, y));
+        std::copy(first, first+w, sharedAddress(x1, y));
     }
 
     void blendRect(int x1, int y1, int x2, int y2, color_t color, int opacity) override {
@@ -219,6 +302,9 @@ namespace doc {
 
   template<>
   inline void ImageImpl<IndexedTraits>::clear(color_t color) {
+    if (isSharedBuffer())
+      initBuffer(ImageBufferPtr());
+
     std::fill(m_bits,
               m_bits + width()*height(),
               color);
@@ -226,6 +312,9 @@ namespace doc {
 
   template<>
   inline void ImageImpl<BitmapTraits>::clear(color_t color) {
+    if (isSharedBuffer())
+      initBuffer(ImageBufferPtr());
+
     std::fill(m_bits,
               m_bits + BitmapTraits::getRowStrideBytes(width()) * height(),
               (color ? 0xff: 0x00));
@@ -245,6 +334,9 @@ namespace doc {
     ASSERT(x >= 0 && x < width());
     ASSERT(y >= 0 && y < height());
 
+    if (isSharedBuffer())
+      copyBuffer();
+
     std::div_t d = std::div(x, 8);
     if (color)
       (*(m_rows[y] + d.quot)) |= (1 << d.rem);
@@ -252,10 +344,14 @@ namespace doc {
       (*(m_rows[y] + d.quot)) &= ~(1 << d.rem);
   }
 
+  template<>
+  inline void ImageImpl<BitmapTraits>::drawHLine(int x1, int y, int x2, color_t color) {
+    fill_bitmap_rect(this, gfx::Rect(x1, y, x2-x1+1, 1), color);
+  }
+
   template<>
   inline void ImageImpl<BitmapTraits>::fillRect(int x1, int y1, int x2, int y2, color_t color) {
-    for (int y=y1; y<=y2; ++y)
-      ImageImpl<BitmapTraits>::drawHLine(x1, y, x2, color);
+    fill_bitmap_rect(this, gfx::Rect(x1, y1, x2-x1+1, y2-y1+1), color);
   }
 
   template<>
@@ -272,10 +368,9 @@ namespace doc {
     }
   }
 
-  void copy_bitmaps(Image* dst, const Image* src, gfx::Clip area);
   template<>
   inline void ImageImpl<BitmapTraits>::copy(const Image* src, gfx::Clip area) {
-    copy_bitmaps(this, src, area);
+    copy_bitmap(this, src, area);
   }
 
 } // namespace doc
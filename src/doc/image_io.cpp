@@ -18,6 +18,7 @@
 #include "zlib.h"
 
 #include <iostream>
+#include <vector>
 
 namespace doc {
 
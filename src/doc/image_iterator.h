@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -49,9 +49,12 @@ namespace doc {
     {
     }
 
+    // Iterators that can modify pixels are created only from
+    // ImageBits locked for writing (so the pixels buffer of the image
+    // is already detached, see Image::lockBits()).
     ImageIteratorT(const Image* image, const gfx::Rect& bounds, int x, int y) :
       m_image(const_cast<Image*>(image)),
-      m_ptr(get_pixel_address_fast<ImageTraits>(image, x, y)),
+      m_ptr((PointerType)get_pixel_address_fast<ImageTraits>(image, x, y)),
       m_x(x),
       m_y(y),
       m_xbegin(bounds.x),
@@ -105,7 +108,7 @@ namespace doc {
         ++m_y;
 
         if (m_y < m_image->height())
-          m_ptr = get_pixel_address_fast<ImageTraits>(m_image, m_x, m_y);
+          m_ptr = (PointerType)get_pixel_address_fast<ImageTraits>(m_image, m_x, m_y);
       }
 
       return *this;
@@ -288,7 +291,7 @@ namespace doc {
 
     ImageIteratorT(const Image* image, const gfx::Rect& bounds, int x, int y) :
       m_image(const_cast<Image*>(image)),
-      m_ptr(get_pixel_address_fast<BitmapTraits>(image, x, y)),
+      m_ptr((PointerType)get_pixel_address_fast<BitmapTraits>(image, x, y)),
       m_x(x),
       m_y(y),
       m_subPixel(x % 8),
@@ -342,7 +345,7 @@ namespace doc {
         ++m_y;
 
         if (m_y < m_image->height())
-          m_ptr = get_pixel_address_fast<BitmapTraits>(m_image, m_x, m_y);
+          m_ptr = (PointerType)get_pixel_address_fast<BitmapTraits>(m_image, m_x, m_y);
         else
           ++m_ptr;
       }
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -10,10 +10,13 @@
 
 #include <gtest/gtest.h>
 
+#include "base/thread.h"
 #include "base/unique_ptr.h"
 #include "doc/image_impl.h"
 #include "doc/primitives.h"
 
+#include <vector>
+
 using namespace base;
 using namespace doc;
 
@@ -215,6 +218,196 @@ TYPED_TEST(ImageAllTypes, FillRect)
   }
 }
 
+TYPED_TEST(ImageAllTypes, CopyOnWrite)
+{
+  typedef TypeParam ImageTraits;
+
+  UniquePtr<Image> a(Image::create(ImageTraits::pixel_format, 17, 9));
+  clear_image(a, 0);
+  put_pixel(a, 3, 4, 1);
+
+  // The copy shares the pixels with the original image
+  UniquePtr<Image> b(Image::createCopy(a));
+  const Image* constA = a;
+  const Image* constB = b;
+  EXPECT_EQ(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+  EXPECT_EQ(1, get_pixel(b, 3, 4));
+  EXPECT_EQ(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+
+  // Modifying the copy detaches its pixels
+  put_pixel(b, 5, 6, 1);
+  EXPECT_NE(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+  EXPECT_EQ(0, get_pixel(a, 5, 6));
+  EXPECT_EQ(1, get_pixel(b, 5, 6));
+  EXPECT_EQ(1, get_pixel(b, 3, 4));
+
+  // Write through locked bits
+  UniquePtr<Image> c(Image::createCopy(a));
+  {
+    LockImageBits<ImageTraits> bits(c.get(), Image::WriteLock);
+    for (auto it=bits.begin(), end=bits.end(); it!=end; ++it)
+      *it = 1;
+  }
+  EXPECT_EQ(0, get_pixel(a, 0, 0));
+  EXPECT_EQ(1, get_pixel(c, 0, 0));
+
+  // Modifying the original image doesn't change the copy
+  UniquePtr<Image> d(Image::createCopy(a));
+  a->clear(1);
+  EXPECT_EQ(1, get_pixel(a, 0, 0));
+  EXPECT_EQ(0, get_pixel(d, 0, 0));
+  EXPECT_EQ(1, get_pixel(d, 3, 4));
+  EXPECT_EQ(0, count_diff_between_images(a, c));
+}
+
+// Row access isn't available for BitmapTraits
+template<typename T>
+class ImageRowTypes : public testing::Test {
+protected:
+  ImageRowTypes() { }
+};
+
+typedef testing::Types<RgbTraits, GrayscaleTraits, IndexedTraits> ImageRowTraits;
+TYPED_TEST_CASE(ImageRowTypes, ImageRowTraits);
+
+TYPED_TEST(ImageRowTypes, RowsAndSpans)
+{
+  typedef TypeParam ImageTraits;
+  const int w = 13;
+  const int h = 7;
+
+  UniquePtr<Image> image(Image::create(ImageTraits::pixel_format, w, h));
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(image, x, y, (std::rand() % ImageTraits::max_value));
+
+  std::vector<gfx::Rect> areas;
+  areas.push_back(image->bounds());
+  areas.push_back(gfx::Rect(0, 2, w, 3));
+  areas.push_back(gfx::Rect(2, 3, 5, 1));
+  areas.push_back(gfx::Rect(1, 1, w-2, h-2));
+
+  for (const gfx::Rect& bounds : areas) {
+    SCOPED_TRACE(bounds.x);
+    SCOPED_TRACE(bounds.w);
+
+    const LockImageBits<ImageTraits> bits((const Image*)image, bounds);
+
+    // Only areas with full rows (or only one row) are contiguous
+    EXPECT_EQ(bounds.w == w || bounds.h == 1, bits.isContiguous());
+
+    // Rows and spans must visit the same pixels as iterators
+    typename LockImageBits<ImageTraits>::const_iterator it = bits.begin();
+    for (int y=0; y<bounds.h; ++y) {
+      typename ImageTraits::const_address_t row = bits.row(y);
+      for (int x=0; x<bounds.w; ++x, ++it)
+        ASSERT_EQ(*it, row[x]);
+    }
+
+    std::vector<color_t> pixels;
+    int nspans = 0;
+    bits.forEachSpan(
+      [&pixels, &nspans](typename ImageTraits::const_address_t span, int n) {
+        pixels.insert(pixels.end(), span, span+n);
+        ++nspans;
+      });
+    EXPECT_EQ(bits.isContiguous() ? 1: bounds.h, nspans);
+    ASSERT_EQ(bounds.w*bounds.h, int(pixels.size()));
+
+    it = bits.begin();
+    for (color_t c : pixels) {
+      ASSERT_EQ(*it, c);
+      ++it;
+    }
+    EXPECT_TRUE(it == bits.end());
+  }
+
+  // Write through spans (pixels outside the area must not change)
+  UniquePtr<Image> original(Image::createCopy(image));
+  {
+    LockImageBits<ImageTraits> bits(image, gfx::Rect(1, 1, w-2, h-2));
+    bits.forEachSpan(
+      [](typename ImageTraits::address_t span, int n) {
+        std::fill(span, span+n, 1);
+      });
+  }
+  for (int y=0; y<h; ++y) {
+    for (int x=0; x<w; ++x) {
+      if (gfx::Rect(1, 1, w-2, h-2).contains(gfx::Point(x, y))) {
+        ASSERT_EQ(1, get_pixel(image, x, y));
+      }
+      else {
+        ASSERT_EQ(get_pixel(original, x, y), get_pixel(image, x, y));
+      }
+    }
+  }
+}
+
+TYPED_TEST(ImageRowTypes, ReadRowsDontDetach)
+{
+  typedef TypeParam ImageTraits;
+
+  UniquePtr<Image> a(Image::create(ImageTraits::pixel_format, 4, 4));
+  clear_image(a, 0);
+  UniquePtr<Image> b(Image::createCopy(a));
+  const Image* constA = a;
+  const Image* constB = b;
+
+  {
+    const LockImageBits<ImageTraits> bits(constB);
+    EXPECT_EQ((typename ImageTraits::const_address_t)constA->getPixelAddress(0, 0),
+              bits.row(0));
+  }
+  EXPECT_EQ(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+
+  {
+    LockImageBits<ImageTraits> bits(b.get(), Image::WriteLock);
+    bits.row(0)[0] = 1;
+  }
+  EXPECT_NE(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+  EXPECT_EQ(0, get_pixel(a, 0, 0));
+  EXPECT_EQ(1, get_pixel(b, 0, 0));
+}
+
+TEST(Image, CopyWithUserBuffer)
+{
+  ImageBufferPtr buffer(new ImageBuffer);
+  UniquePtr<Image> a(Image::create(IMAGE_RGB, 8, 8, buffer));
+  clear_image(a, rgba(255, 0, 0, 255));
+
+  // Images with user buffers are copied immediately
+  UniquePtr<Image> b(Image::createCopy(a));
+  const Image* constA = a;
+  const Image* constB = b;
+  EXPECT_NE(constA->getPixelAddress(0, 0), constB->getPixelAddress(0, 0));
+  EXPECT_EQ(0, count_diff_between_images(a, b));
+}
+
+static void modify_copies(const Image* image, color_t color)
+{
+  for (int i=0; i<1000; ++i) {
+    UniquePtr<Image> copy(Image::createCopy(image));
+    put_pixel(copy, 0, 0, color);
+    EXPECT_EQ(color, get_pixel(copy, 0, 0));
+  }
+}
+
+TEST(Image, CopyOnWriteFromSeveralThreads)
+{
+  UniquePtr<Image> a(Image::create(IMAGE_RGB, 8, 8));
+  clear_image(a, rgba(255, 0, 0, 255));
+
+  std::vector<thread*> threads;
+  for (int i=0; i<4; ++i)
+    threads.push_back(new thread(&modify_copies, a.get(), rgba(0, i, 0, 255)));
+  for (thread* t : threads) {
+    t->join();
+    delete t;
+  }
+
+  EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(a, 0, 0));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
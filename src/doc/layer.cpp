@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -263,6 +263,27 @@ void LayerImage::displaceFrames(frame_t fromThis, frame_t delta)
   }
 }
 
+void LayerImage::permuteFrames(frame_t first, const std::vector<frame_t>& newFrames)
+{
+  // Only cels inside the permuted range change their frame, so we
+  // re-sort that part of the list (instead of removing/adding each
+  // cel as moveCel() does). The list is unsorted until the
+  // std::sort() below.
+  CelIterator begin = findFirstCelIteratorAfter(first-1);
+  CelIterator end = findFirstCelIteratorAfter(first+frame_t(newFrames.size())-1);
+
+  for (CelIterator it=begin; it!=end; ++it) {
+    Cel* cel = *it;
+    ASSERT(cel->frame() >= first && cel->frame()-first < int(newFrames.size()));
+    cel->setFrameInLayer(newFrames[cel->frame()-first]);
+  }
+
+  std::sort(begin, end,
+            [](const Cel* a, const Cel* b) -> bool {
+              return a->frame() < b->frame();
+            });
+}
+
 //////////////////////////////////////////////////////////////////////
 // LayerFolder class
 
@@ -353,4 +374,10 @@ void LayerFolder::displaceFrames(frame_t fromThis, frame_t delta)
     layer->displaceFrames(fromThis, delta);
 }
 
+void LayerFolder::permuteFrames(frame_t first, const std::vector<frame_t>& newFrames)
+{
+  for (Layer* layer : m_layers)
+    layer->permuteFrames(first, newFrames);
+}
+
 } // namespace doc
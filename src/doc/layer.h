@@ -97,6 +97,7 @@ namespace doc {
     virtual Cel* cel(frame_t frame) const;
     virtual void getCels(CelList& cels) const = 0;
     virtual void displaceFrames(frame_t fromThis, frame_t delta) = 0;
+    virtual void permuteFrames(frame_t first, const std::vector<frame_t>& newFrames) = 0;
 
   private:
     std::string m_name;           // layer name
@@ -131,6 +132,7 @@ namespace doc {
     Cel* cel(frame_t frame) const override;
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void permuteFrames(frame_t first, const std::vector<frame_t>& newFrames) override;
 
     Cel* getLastCel() const;
     CelConstIterator findCelIterator(frame_t frame) const;
@@ -179,6 +181,7 @@ namespace doc {
 
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void permuteFrames(frame_t first, const std::vector<frame_t>& newFrames) override;
 
   private:
     void destroyAllLayers();
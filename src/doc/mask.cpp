@@ -12,13 +12,46 @@
 
 #include "base/base.h"
 #include "base/memory.h"
+#include "doc/bitmap_ops.h"
 #include "doc/image_impl.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
 namespace doc {
 
+namespace {
+
+// Fills each row of the "dst" bitmap with the result of "pred" for
+// each pixel of the same row of "src" (64 pixels at a time).
+template<typename ImageTraits, typename Pred>
+void bitmap_from_pixels(Image* dst, const Image* src, Pred pred)
+{
+  typedef typename ImageTraits::pixel_t pixel_t;
+
+  const int w = src->width();
+  const int h = src->height();
+
+  for (int y=0; y<h; ++y) {
+    const pixel_t* src_address = (const pixel_t*)src->getPixelAddress(0, y);
+
+    for (int x=0; x<w; x+=64) {
+      const int n = std::min(64, w-x);
+      bitmap_word_t word = 0;
+
+      for (int i=0; i<n; ++i, ++src_address) {
+        if (pred(*src_address))
+          word |= (bitmap_word_t(1) << i);
+      }
+
+      put_bitmap_word(dst, x, y, word);
+    }
+  }
+}
+
+} // anonymous namespace
+
 Mask::Mask()
   : Object(ObjectType::Mask)
 {
@@ -74,15 +107,7 @@ bool Mask::isRectangular() const
   if (!m_bitmap)
     return false;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
-
-  for (; it != end; ++it) {
-    if (*it == 0)
-      return false;
-  }
-
-  return true;
+  return is_bitmap_full(m_bitmap.get());
 }
 
 void Mask::copyFrom(const Mask* sourceMask)
@@ -115,12 +140,7 @@ void Mask::invert()
   if (!m_bitmap)
     return;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
-
-  for (; it != end; ++it)
-    *it = (*it ? 0: 1);
-
+  invert_bitmap(m_bitmap.get());
   shrink();
 }
 
@@ -137,11 +157,8 @@ void Mask::add(const gfx::Rect& bounds)
   if (m_freeze_count == 0)
     reserve(bounds);
 
-  fill_rect(m_bitmap.get(),
-    bounds.x-m_bounds.x,
-    bounds.y-m_bounds.y,
-    bounds.x-m_bounds.x+bounds.w-1,
-    bounds.y-m_bounds.y+bounds.h-1, 1);
+  fill_bitmap_rect(m_bitmap.get(),
+                   gfx::Rect(bounds).offset(-m_bounds.origin()), 1);
 }
 
 void Mask::subtract(const gfx::Rect& bounds)
@@ -149,11 +166,8 @@ void Mask::subtract(const gfx::Rect& bounds)
   if (!m_bitmap)
     return;
 
-  fill_rect(m_bitmap.get(),
-    bounds.x-m_bounds.x,
-    bounds.y-m_bounds.y,
-    bounds.x-m_bounds.x+bounds.w-1,
-    bounds.y-m_bounds.y+bounds.h-1, 0);
+  fill_bitmap_rect(m_bitmap.get(),
+                   gfx::Rect(bounds).offset(-m_bounds.origin()), 0);
 
   shrink();
 }
@@ -190,95 +204,52 @@ void Mask::byColor(const Image *src, int color, int fuzziness)
   switch (src->pixelFormat()) {
 
     case IMAGE_RGB: {
-      const LockImageBits<RgbTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<RgbTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_r, src_g, src_b, src_a;
-      int dst_r, dst_g, dst_b, dst_a;
-      color_t c;
-
-      dst_r = rgba_getr(color);
-      dst_g = rgba_getg(color);
-      dst_b = rgba_getb(color);
-      dst_a = rgba_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_r = rgba_getr(c);
-        src_g = rgba_getg(c);
-        src_b = rgba_getb(c);
-        src_a = rgba_geta(c);
-
-        if (!((src_r >= dst_r-fuzziness) && (src_r <= dst_r+fuzziness) &&
-              (src_g >= dst_g-fuzziness) && (src_g <= dst_g+fuzziness) &&
-              (src_b >= dst_b-fuzziness) && (src_b <= dst_b+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const int dst_r = rgba_getr(color);
+      const int dst_g = rgba_getg(color);
+      const int dst_b = rgba_getb(color);
+      const int dst_a = rgba_geta(color);
+
+      bitmap_from_pixels<RgbTraits>(
+        dst, src,
+        [=](color_t c) -> bool {
+          const int src_r = rgba_getr(c);
+          const int src_g = rgba_getg(c);
+          const int src_b = rgba_getb(c);
+          const int src_a = rgba_geta(c);
+
+          return ((src_r >= dst_r-fuzziness) && (src_r <= dst_r+fuzziness) &&
+                  (src_g >= dst_g-fuzziness) && (src_g <= dst_g+fuzziness) &&
+                  (src_b >= dst_b-fuzziness) && (src_b <= dst_b+fuzziness) &&
+                  (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness));
+        });
       break;
     }
 
     case IMAGE_GRAYSCALE: {
-      const LockImageBits<GrayscaleTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<GrayscaleTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_k, src_a;
-      int dst_k, dst_a;
-      color_t c;
-
-      dst_k = graya_getv(color);
-      dst_a = graya_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_k = graya_getv(c);
-        src_a = graya_geta(c);
-
-        if (!((src_k >= dst_k-fuzziness) && (src_k <= dst_k+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const int dst_k = graya_getv(color);
+      const int dst_a = graya_geta(color);
+
+      bitmap_from_pixels<GrayscaleTraits>(
+        dst, src,
+        [=](color_t c) -> bool {
+          const int src_k = graya_getv(c);
+          const int src_a = graya_geta(c);
+
+          return ((src_k >= dst_k-fuzziness) && (src_k <= dst_k+fuzziness) &&
+                  (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness));
+        });
       break;
     }
 
     case IMAGE_INDEXED: {
-      const LockImageBits<IndexedTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<IndexedTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      color_t c, min, max;
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        if (color > fuzziness)
-          min = color-fuzziness;
-        else
-          min = 0;
-        max = color + fuzziness;
-
-        if (!((c >= min) && (c <= max)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+      const color_t min = (color > fuzziness ? color-fuzziness: 0);
+      const color_t max = color + fuzziness;
+
+      bitmap_from_pixels<IndexedTraits>(
+        dst, src,
+        [=](color_t c) -> bool {
+          return ((c >= min) && (c <= max));
+        });
       break;
     }
   }
@@ -381,58 +352,16 @@ void Mask::shrink()
   if (m_freeze_count > 0)
     return;
 
-#define SHRINK_SIDE(u_begin, u_op, u_final, u_add,                      \
-                    v_begin, v_op, v_final, v_add, U, V, var)           \
-  {                                                                     \
-    for (u = u_begin; u u_op u_final; u u_add) {                        \
-      for (v = v_begin; v v_op v_final; v v_add) {                      \
-        if (get_pixel_fast<BitmapTraits>(m_bitmap.get(), U, V))         \
-          break;                                                        \
-      }                                                                 \
-      if (v == v_final)                                                 \
-        var;                                                            \
-      else                                                              \
-        break;                                                          \
-    }                                                                   \
-  }
-
-  int u, v, x1, y1, x2, y2;
-
-  x1 = m_bounds.x;
-  y1 = m_bounds.y;
-  x2 = m_bounds.x+m_bounds.w-1;
-  y2 = m_bounds.y+m_bounds.h-1;
-
-  SHRINK_SIDE(0, <, m_bounds.w, ++,
-              0, <, m_bounds.h, ++, u, v, x1++);
-
-  SHRINK_SIDE(0, <, m_bounds.h, ++,
-              0, <, m_bounds.w, ++, v, u, y1++);
-
-  SHRINK_SIDE(m_bounds.w-1, >, 0, --,
-              0, <, m_bounds.h, ++, u, v, x2--);
-
-  SHRINK_SIDE(m_bounds.h-1, >, 0, --,
-              0, <, m_bounds.w, ++, v, u, y2--);
-
-  if ((x1 > x2) || (y1 > y2)) {
+  gfx::Rect newBounds;
+  if (!m_bitmap ||
+      !shrink_bitmap_bounds(m_bitmap.get(), newBounds)) {
     clear();
   }
-  else if ((x1 != m_bounds.x) || (x2 != m_bounds.x+m_bounds.w-1) ||
-           (y1 != m_bounds.y) || (y2 != m_bounds.y+m_bounds.h-1)) {
-    u = m_bounds.x;
-    v = m_bounds.y;
-
-    m_bounds.x = x1;
-    m_bounds.y = y1;
-    m_bounds.w = x2 - x1 + 1;
-    m_bounds.h = y2 - y1 + 1;
-
-    Image* image = crop_image(m_bitmap.get(), m_bounds.x-u, m_bounds.y-v, m_bounds.w, m_bounds.h, 0);
+  else if (newBounds != m_bitmap->bounds()) {
+    Image* image = crop_image(m_bitmap.get(), newBounds, 0);
     m_bitmap.reset(image);
+    m_bounds = newBounds.offset(m_bounds.origin());
   }
-
-#undef SHRINK_SIDE
 }
 
 } // namespace doc
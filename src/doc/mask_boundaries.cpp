@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -10,19 +10,46 @@
 
 #include "doc/mask_boundaries.h"
 
-#include "doc/image_impl.h"
+#include "doc/bitmap_ops.h"
+#include "doc/image.h"
+
+#include <algorithm>
 
 namespace doc {
 
+static inline bool get_bit(const std::vector<bitmap_word_t>& words, int x)
+{
+  return ((words[x >> 6] >> (x & 63)) & 1) ? true: false;
+}
+
+// Returns the index of the first 1 bit from "x", or -1 if there is
+// no more 1s.
+static inline int find_next_bit(const std::vector<bitmap_word_t>& words, int x)
+{
+  int i = (x >> 6);
+  if (i >= int(words.size()))
+    return -1;
+
+  bitmap_word_t bits = words[i] & (~bitmap_word_t(0) << (x & 63));
+  while (!bits) {
+    if (++i == int(words.size()))
+      return -1;
+    bits = words[i];
+  }
+  return i*64 + base::lowest_bit(bits);
+}
+
 MaskBoundaries::MaskBoundaries(const Image* bitmap)
 {
   int x, y, w = bitmap->width(), h = bitmap->height();
 
-  const LockImageBits<BitmapTraits> bits(bitmap);
-  auto it = bits.begin();       // Current pixel iterator
-#if _DEBUG
-  auto prevIt = bits.begin();   // Previous row iterator (same X pos)
-#endif
+  // Pixels of the current and previous rows (64 pixels per word).
+  // There are w+1 vertices in each row (the last one is outside the
+  // bitmap, so its pixel is 0).
+  const int nwords = (w+1+63) / 64;
+  std::vector<bitmap_word_t> rowWords(nwords, 0);
+  std::vector<bitmap_word_t> prevRowWords(nwords, 0);
+  std::vector<bitmap_word_t> changes(nwords);
 
   // Vertical segments being expanded from the previous row.
   std::vector<int> vertSegs(w+1, -1);
@@ -54,13 +81,33 @@ MaskBoundaries::MaskBoundaries(const Image* bitmap)
   }
 
   for (y=0; y<=h; ++y) {
-    bool prevColor = false;         // Previous color (X-1) same Y row
     horzSeg = -1;
 
-    for (x=0; x<=w; ++x) {
-      bool color = (x < w && y < h && *it ? true: false);
+    std::swap(rowWords, prevRowWords);
+    for (int i=0; i<nwords; ++i)
+      rowWords[i] = (y < h ? get_bitmap_word(bitmap, i*64, y): 0);
+
+    // Vertices where the four adjacent pixels are equal are inside
+    // (or outside) the boundaries, there are no segments to start,
+    // expand, or stop there, so we can skip them.
+    for (int i=0; i<nwords; ++i) {
+      bitmap_word_t left = (rowWords[i] << 1);
+      bitmap_word_t prevLeft = (prevRowWords[i] << 1);
+      if (i > 0) {
+        left |= (rowWords[i-1] >> 63);
+        prevLeft |= (prevRowWords[i-1] >> 63);
+      }
+      changes[i] =
+        (rowWords[i] ^ prevRowWords[i]) |
+        (left ^ prevLeft) |
+        (rowWords[i] ^ left);
+    }
+
+    for (x=find_next_bit(changes, 0); x >= 0; x=find_next_bit(changes, x+1)) {
+      bool color = get_bit(rowWords, x);
+      bool prevColor = (x > 0 && get_bit(rowWords, x-1)); // Previous color (X-1) same Y row
 #if _DEBUG
-      bool prevRowColor = (x < w && y > 0 && *prevIt ? true: false);
+      bool prevRowColor = get_bit(prevRowWords, x);
 #endif
       Segment* hseg = (horzSeg >= 0 ? &m_segs[horzSeg]: nullptr);
       Segment* vseg = (vertSegs[x] >= 0 ? &m_segs[vertSegs[x]]: nullptr);
@@ -315,19 +362,8 @@ MaskBoundaries::MaskBoundaries(const Image* bitmap)
           }
         }
       }
-
-      prevColor = color;
-      if (x < w) {
-#if _DEBUG
-        if (y > 0) ++prevIt;
-#endif
-        if (y < h) ++it;
-      }
     }
   }
-
-  ASSERT(it == bits.end());
-  ASSERT(prevIt == bits.end());
 }
 
 void MaskBoundaries::offset(int x, int y)
@@ -0,0 +1,185 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/unique_ptr.h"
+#include "doc/algorithm/modify_selection.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+using namespace doc::algorithm;
+
+// Applies the modifier checking all pixels of the brush for each
+// pixel of the image.
+static void naive_modify_selection(SelectionModifier modifier,
+                                   const Image* src, Image* dst,
+                                   const gfx::Point& dstPos,
+                                   int radius, BrushType brush)
+{
+  const gfx::Rect srcBounds = src->bounds();
+  const int size = 2*radius+1;
+  UniquePtr<Image> kernel(Image::create(IMAGE_BITMAP, size, size));
+  clear_image(kernel, 0);
+  if (brush == kCircleBrushType)
+    fill_ellipse(kernel, 0, 0, size-1, size-1, 1);
+  else
+    fill_rect(kernel, 0, 0, size-1, size-1, 1);
+  put_pixel(kernel, radius, radius, 0);
+
+  int total = 0;
+  for (int v=0; v<size; ++v)
+    for (int u=0; u<size; ++u)
+      total += kernel->getPixel(u, v);
+
+  for (int y=-radius; y<srcBounds.h+radius; ++y) {
+    for (int x=-radius; x<srcBounds.w+radius; ++x) {
+      color_t c = (srcBounds.contains(x, y) ? src->getPixel(x, y): 0);
+
+      int accum = 0;
+      for (int v=0; v<size; ++v)
+        for (int u=0; u<size; ++u)
+          if (kernel->getPixel(u, v) &&
+              srcBounds.contains(x+u-radius, y+v-radius))
+            accum += src->getPixel(x-radius+u, y-radius+v);
+
+      switch (modifier) {
+        case SelectionModifier::Border: c = (c && accum < total); break;
+        case SelectionModifier::Expand: c = (c || accum > 0); break;
+        case SelectionModifier::Contract: c = (c && accum == total); break;
+      }
+      if (c)
+        put_pixel(dst, dstPos.x+x, dstPos.y+y, 1);
+    }
+  }
+}
+
+static void random_bitmap(Image* image, int density)
+{
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      put_pixel(image, x, y, (std::rand() % 100) < density ? 1: 0);
+}
+
+static void expect_same_as_naive(SelectionModifier modifier,
+                                 const Image* src,
+                                 const gfx::Size& dstSize,
+                                 const gfx::Point& dstPos,
+                                 int radius, BrushType brush)
+{
+  UniquePtr<Image> expected(Image::create(IMAGE_BITMAP, dstSize.w, dstSize.h));
+  UniquePtr<Image> result(Image::create(IMAGE_BITMAP, dstSize.w, dstSize.h));
+  clear_image(expected, 0);
+  clear_image(result, 0);
+
+  naive_modify_selection(modifier, src, expected, dstPos, radius, brush);
+  modify_selection(modifier, src, result, dstPos, radius, brush);
+
+  EXPECT_EQ(0, count_diff_between_images(expected, result))
+    << "modifier=" << int(modifier)
+    << " radius=" << radius
+    << " brush=" << brush
+    << " src=" << src->width() << "x" << src->height();
+}
+
+TEST(ModifySelection, SinglePixel)
+{
+  UniquePtr<Image> src(Image::create(IMAGE_BITMAP, 1, 1));
+  src->putPixel(0, 0, 1);
+
+  UniquePtr<Image> dst(Image::create(IMAGE_BITMAP, 5, 5));
+  clear_image(dst, 0);
+  modify_selection(SelectionModifier::Expand, src, dst,
+                   gfx::Point(2, 2), 2, kSquareBrushType);
+  for (int y=0; y<5; ++y)
+    for (int x=0; x<5; ++x)
+      EXPECT_EQ(1, get_pixel(dst, x, y));
+
+  clear_image(dst, 0);
+  modify_selection(SelectionModifier::Contract, src, dst,
+                   gfx::Point(2, 2), 1, kCircleBrushType);
+  EXPECT_EQ(0, get_pixel(dst, 2, 2));
+
+  clear_image(dst, 0);
+  modify_selection(SelectionModifier::Border, src, dst,
+                   gfx::Point(2, 2), 1, kCircleBrushType);
+  EXPECT_EQ(1, get_pixel(dst, 2, 2));
+}
+
+TEST(ModifySelection, SameAsNaive)
+{
+  std::srand(1);
+
+  const SelectionModifier modifiers[] = {
+    SelectionModifier::Border,
+    SelectionModifier::Expand,
+    SelectionModifier::Contract
+  };
+  const BrushType brushes[] = { kCircleBrushType, kSquareBrushType };
+  const int densities[] = { 2, 50, 97 };
+
+  for (int density : densities) {
+    for (int i=0; i<4; ++i) {
+      int w = 1 + std::rand() % 40;
+      int h = 1 + std::rand() % 40;
+      UniquePtr<Image> src(Image::create(IMAGE_BITMAP, w, h));
+      random_bitmap(src, density);
+
+      for (int radius=0; radius<=12; radius+=(radius < 4 ? 1: 4)) {
+        for (SelectionModifier modifier : modifiers) {
+          for (BrushType brush : brushes) {
+            // Destination bigger than the result
+            expect_same_as_naive(modifier, src,
+                                 gfx::Size(w+2*radius+8, h+2*radius+8),
+                                 gfx::Point(radius+3, radius+5),
+                                 radius, brush);
+
+            // Destination clipping the result
+            expect_same_as_naive(modifier, src,
+                                 gfx::Size(w/2+1, h/2+1),
+                                 gfx::Point(-w/3, -h/4),
+                                 radius, brush);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ModifySelection, BigRadius)
+{
+  std::srand(2);
+
+  UniquePtr<Image> src(Image::create(IMAGE_BITMAP, 30, 20));
+  random_bitmap(src, 90);
+
+  for (int radius : { 25 }) {
+    for (BrushType brush : { kCircleBrushType, kSquareBrushType }) {
+      for (SelectionModifier modifier : { SelectionModifier::Border,
+                                          SelectionModifier::Expand,
+                                          SelectionModifier::Contract }) {
+        expect_same_as_naive(modifier, src,
+                             gfx::Size(30+2*radius, 20+2*radius),
+                             gfx::Point(radius, radius),
+                             radius, brush);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -204,7 +204,7 @@ static uint32_t* col_diff_r;
 static uint32_t* col_diff_b;
 static uint32_t* col_diff_a;
 
-static void initBestfit()
+static bool initBestfit()
 {
   col_diff.resize(4*128, 0);
   col_diff_g = &col_diff[128*0];
@@ -219,6 +219,7 @@ static void initBestfit()
     col_diff_b[i] = col_diff_b[128-i] = k * 11 * 11;
     col_diff_a[i] = col_diff_a[128-i] = k * 8 * 8;
   }
+  return true;
 }
 
 int Palette::findBestfit(int r, int g, int b, int a, int mask_index) const
@@ -228,8 +229,10 @@ int Palette::findBestfit(int r, int g, int b, int a, int mask_index) const
   ASSERT(b >= 0 && b <= 255);
   ASSERT(a >= 0 && a <= 255);
 
-  if (col_diff.empty())
-    initBestfit();
+  // Initialized only one time (even if it's called from several
+  // threads at the same time)
+  static bool initialized = initBestfit();
+  (void)initialized;
 
   r >>= 3;
   g >>= 3;
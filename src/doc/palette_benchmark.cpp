@@ -0,0 +1,103 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "doc/color.h"
+#include "doc/palette.h"
+#include "doc/rgbmap.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace doc;
+
+static Palette* create_random_palette(int ncolors)
+{
+  Palette* palette = new Palette(frame_t(0), ncolors);
+  std::srand(ncolors);
+  for (int i=0; i<ncolors; ++i)
+    palette->setEntry(i, rgba(std::rand()%256, std::rand()%256,
+                              std::rand()%256, 255));
+  return palette;
+}
+
+static std::vector<color_t> create_random_colors(int n)
+{
+  std::vector<color_t> colors(n);
+  std::srand(n);
+  for (color_t& c : colors)
+    c = rgba(std::rand()%256, std::rand()%256, std::rand()%256,
+             (std::rand()%8) ? 255: 0);
+  return colors;
+}
+
+static void BM_FindBestfit(benchmark::State& state)
+{
+  const int ncolors = state.range(0);
+  Palette* palette = create_random_palette(ncolors);
+  std::vector<color_t> colors = create_random_colors(4096);
+
+  int i = 0;
+  while (state.KeepRunning()) {
+    color_t c = colors[i++ & 4095];
+    benchmark::DoNotOptimize(
+      palette->findBestfit(rgba_getr(c), rgba_getg(c),
+                           rgba_getb(c), rgba_geta(c), 0));
+  }
+  delete palette;
+}
+
+static void BM_RgbMapRegenerate(benchmark::State& state)
+{
+  const int ncolors = state.range(0);
+  Palette* palette = create_random_palette(ncolors);
+  RgbMap rgbmap;
+
+  while (state.KeepRunning())
+    rgbmap.regenerate(palette, 0);
+
+  delete palette;
+}
+
+// Maps the same set of colors again and again (so most of the time
+// the RgbMap entries are already calculated).
+static void BM_RgbMapMapColor(benchmark::State& state)
+{
+  const int ncolors = state.range(0);
+  Palette* palette = create_random_palette(ncolors);
+  std::vector<color_t> colors = create_random_colors(4096);
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette, 0);
+
+  int i = 0;
+  while (state.KeepRunning()) {
+    color_t c = colors[i++ & 4095];
+    benchmark::DoNotOptimize(
+      rgbmap.mapColor(rgba_getr(c), rgba_getg(c),
+                      rgba_getb(c), rgba_geta(c)));
+  }
+  delete palette;
+}
+
+BENCHMARK(BM_FindBestfit)
+  ->Arg(16)
+  ->Arg(256);
+
+BENCHMARK(BM_RgbMapRegenerate)
+  ->Arg(16)
+  ->Arg(256)
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_RgbMapMapColor)
+  ->Arg(16)
+  ->Arg(256);
+
+BENCHMARK_MAIN();
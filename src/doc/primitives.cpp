@@ -341,12 +341,11 @@ void remap_image(Image* image, const Remap& remap)
     return;
 
   LockImageBits<IndexedTraits> bits(image);
-  LockImageBits<IndexedTraits>::iterator
-    it = bits.begin(),
-    end = bits.end();
-
-  for (; it != end; ++it)
-    *it = remap[*it];
+  bits.forEachSpan(
+    [&remap](IndexedTraits::address_t it, int n) {
+      for (; n > 0; --n, ++it)
+        *it = remap[*it];
+    });
 }
 
 } // namespace doc
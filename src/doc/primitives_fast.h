@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -14,12 +14,14 @@ namespace doc {
   class Image;
   template<typename ImageTraits> class ImageImpl;
 
+  // The address can be used only to read pixels (the buffer is not
+  // detached, see Image::detachBuffer()).
   template<class Traits>
-  inline typename Traits::address_t get_pixel_address_fast(const Image* image, int x, int y) {
+  inline typename Traits::const_address_t get_pixel_address_fast(const Image* image, int x, int y) {
     ASSERT(x >= 0 && x < image->width());
     ASSERT(y >= 0 && y < image->height());
 
-    return (((ImageImpl<Traits>*)image)->address(x, y));
+    return (((const ImageImpl<Traits>*)image)->address(x, y));
   }
 
   template<class Traits>
@@ -27,7 +29,7 @@ namespace doc {
     ASSERT(x >= 0 && x < image->width());
     ASSERT(y >= 0 && y < image->height());
 
-    return *(((ImageImpl<Traits>*)image)->address(x, y));
+    return *(((const ImageImpl<Traits>*)image)->address(x, y));
   }
 
   template<class Traits>
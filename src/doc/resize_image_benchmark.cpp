@@ -0,0 +1,110 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/pi.h"
+#include "base/unique_ptr.h"
+#include "doc/algorithm/resize_image.h"
+#include "doc/algorithm/rotsprite.h"
+#include "doc/image.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+
+// Creates a sprite-like image: random blocks of color surrounded by
+// transparent pixels.
+static Image* create_image(PixelFormat pixelFormat, int w, int h)
+{
+  Image* image = Image::create(pixelFormat, w, h);
+  clear_image(image, 0);
+  std::srand(w*h);
+  for (int y=h/8; y<h-h/8; y+=4) {
+    for (int x=w/8; x<w-w/8; x+=4) {
+      color_t c = (pixelFormat == IMAGE_RGB ?
+                   rgba(std::rand()%256, std::rand()%256, std::rand()%256, 255):
+                   1+std::rand()%255);
+      fill_rect(image, x, y, x+3, y+3, c);
+    }
+  }
+  return image;
+}
+
+// Args: pixel format, resize method, source size (the image is
+// scaled to the double of its size)
+static void BM_ResizeImage(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const algorithm::ResizeMethod method = (algorithm::ResizeMethod)state.range(1);
+  const int w = state.range(2);
+  const int h = state.range(2);
+
+  UniquePtr<Image> src(create_image(pixelFormat, w, h));
+  UniquePtr<Image> dst(Image::create(pixelFormat, 2*w, 2*h));
+  UniquePtr<Palette> palette(new Palette(frame_t(0), 256));
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette, 0);
+
+  while (state.KeepRunning())
+    algorithm::resize_image(src, dst, method, palette, &rgbmap, 0);
+
+  state.SetItemsProcessed(state.iterations() * dst->width() * dst->height());
+}
+
+// Rotates the image 30 degrees around its center.
+static void BM_RotSprite(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+
+  UniquePtr<Image> src(create_image(pixelFormat, w, h));
+
+  const double angle = 30.0 * PI / 180.0;
+  const double c = std::cos(angle), s = std::sin(angle);
+  int corners[8];
+  const int pts[4][2] = { { -w/2, -h/2 }, { w/2, -h/2 }, { w/2, h/2 }, { -w/2, h/2 } };
+  const int size = int(std::ceil(w*(c+s)));
+  for (int i=0; i<4; ++i) {
+    corners[2*i  ] = size/2 + int(pts[i][0]*c - pts[i][1]*s);
+    corners[2*i+1] = size/2 + int(pts[i][0]*s + pts[i][1]*c);
+  }
+  UniquePtr<Image> dst(Image::create(pixelFormat, size, size));
+
+  while (state.KeepRunning()) {
+    clear_image(dst, 0);
+    algorithm::rotsprite_image(dst, src, nullptr,
+                               corners[0], corners[1], corners[2], corners[3],
+                               corners[4], corners[5], corners[6], corners[7]);
+  }
+  state.SetItemsProcessed(state.iterations() * w * h);
+}
+
+BENCHMARK(BM_ResizeImage)
+  ->Args({ IMAGE_RGB, algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR, 256 })
+  ->Args({ IMAGE_RGB, algorithm::RESIZE_METHOD_BILINEAR, 256 })
+  ->Args({ IMAGE_RGB, algorithm::RESIZE_METHOD_ROTSPRITE, 256 })
+  ->Args({ IMAGE_INDEXED, algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR, 256 })
+  ->Args({ IMAGE_INDEXED, algorithm::RESIZE_METHOD_BILINEAR, 256 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_RotSprite)
+  ->Args({ IMAGE_RGB, 64 })
+  ->Args({ IMAGE_RGB, 256 })
+  ->Args({ IMAGE_INDEXED, 256 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -42,6 +42,14 @@ namespace doc {
 
     int maskIndex() const { return m_maskIndex; }
 
+    // Number of entries in the map.
+    int size() const { return int(m_map.size()); }
+
+    // Calculates the entries in the [begin, end) range. When all
+    // entries are calculated, mapColor() doesn't modify the map
+    // anymore, so the same RgbMap can be used from several threads.
+    void generateEntries(int begin, int end);
+
   private:
     int generateEntry(int i, int r, int g, int b, int a) const;
 
@@ -0,0 +1,52 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/palette.h"
+#include "doc/rgbmap.h"
+
+#include <cstdlib>
+
+using namespace doc;
+
+TEST(RgbMap, GenerateEntries)
+{
+  Palette palette(frame_t(0), 32);
+  std::srand(1);
+  for (int i=0; i<palette.size(); ++i)
+    palette.setEntry(i, rgba(std::rand()%256, std::rand()%256,
+                             std::rand()%256, std::rand()%256));
+
+  for (int maskIndex : { -1, 0, 5 }) {
+    RgbMap lazy, full;
+    lazy.regenerate(&palette, maskIndex);
+    full.regenerate(&palette, maskIndex);
+    EXPECT_EQ(lazy.size(), full.size());
+
+    // Generate the whole map in two parts
+    full.generateEntries(0, full.size()/2);
+    full.generateEntries(full.size()/2, full.size());
+
+    for (int r=0; r<256; r+=5)
+      for (int g=0; g<256; g+=3)
+        for (int b=0; b<256; b+=7)
+          for (int a=0; a<256; a+=17)
+            ASSERT_EQ(lazy.mapColor(r, g, b, a),
+                      full.mapColor(r, g, b, a))
+              << r << " " << g << " " << b << " " << a << " " << maskIndex;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+// Aseprite Document Library
+// Copyright (c) 2001-2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/unique_ptr.h"
+#include "doc/algorithm/shrink_bounds.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+using namespace base;
+using namespace doc;
+
+// Trims an image with a small opaque rectangle in the middle (the
+// common case of a sprite frame with a lot of transparent space).
+static void BM_ShrinkBounds(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+
+  UniquePtr<Image> image(Image::create(pixelFormat, w, h));
+  clear_image(image, 0);
+  fill_rect(image, w/2-8, h/2-8, w/2+8, h/2+8,
+            (pixelFormat == IMAGE_RGB ? rgba(255, 0, 0, 255): 1));
+
+  gfx::Rect bounds;
+  while (state.KeepRunning()) {
+    algorithm::shrink_bounds(image, bounds, 0);
+    benchmark::DoNotOptimize(bounds);
+  }
+  state.SetBytesProcessed(state.iterations() * image->getRowStrideSize() * h);
+}
+
+// Compares two equal images except one pixel (like the filter
+// manager does to know the modified area of a filter).
+static void BM_ShrinkBounds2(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(1);
+
+  UniquePtr<Image> a(Image::create(pixelFormat, w, h));
+  UniquePtr<Image> b(Image::create(pixelFormat, w, h));
+  clear_image(a, 0);
+  clear_image(b, 0);
+  put_pixel(b, w/2, h/2, 1);
+
+  gfx::Rect bounds;
+  while (state.KeepRunning()) {
+    algorithm::shrink_bounds2(a, b, a->bounds(), bounds);
+    benchmark::DoNotOptimize(bounds);
+  }
+  state.SetBytesProcessed(state.iterations() * 2 * a->getRowStrideSize() * h);
+}
+
+BENCHMARK(BM_ShrinkBounds)
+  ->Args({ IMAGE_RGB, 256 })
+  ->Args({ IMAGE_RGB, 1024 })
+  ->Args({ IMAGE_RGB, 4096 })
+  ->Args({ IMAGE_GRAYSCALE, 1024 })
+  ->Args({ IMAGE_INDEXED, 1024 })
+  ->Args({ IMAGE_BITMAP, 1024 });
+
+BENCHMARK(BM_ShrinkBounds2)
+  ->Args({ IMAGE_RGB, 1024 })
+  ->Args({ IMAGE_RGB, 4096 })
+  ->Args({ IMAGE_INDEXED, 1024 });
+
+BENCHMARK_MAIN();
@@ -0,0 +1,161 @@
+// Aseprite Document Library
+// Copyright (c) 2001-2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/unique_ptr.h"
+#include "doc/algorithm/shrink_bounds.h"
+#include "doc/image_impl.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+
+template<typename T>
+class ShrinkBoundsAllTypes : public testing::Test {
+protected:
+  ShrinkBoundsAllTypes() { }
+};
+
+typedef testing::Types<RgbTraits, GrayscaleTraits, IndexedTraits, BitmapTraits> ImageAllTraits;
+TYPED_TEST_CASE(ShrinkBoundsAllTypes, ImageAllTraits);
+
+// Returns the bounding box of all pixels in "bounds" that are
+// different to "refpixel" (or transparent pixels in the case of a
+// transparent "refpixel").
+static gfx::Rect naive_bounds(const Image* image, const gfx::Rect& bounds, color_t refpixel)
+{
+  gfx::Rect result;
+  for (int y=bounds.y; y<bounds.y2(); ++y) {
+    for (int x=bounds.x; x<bounds.x2(); ++x) {
+      color_t c = get_pixel(image, x, y);
+      bool same = (c == refpixel);
+      switch (image->pixelFormat()) {
+        case IMAGE_RGB:
+          same |= (rgba_geta(c) == 0 && rgba_geta(refpixel) == 0);
+          break;
+        case IMAGE_GRAYSCALE:
+          same |= (graya_geta(c) == 0 && graya_geta(refpixel) == 0);
+          break;
+        default:
+          break;
+      }
+      if (!same)
+        result |= gfx::Rect(x, y, 1, 1);
+    }
+  }
+  return result;
+}
+
+TYPED_TEST(ShrinkBoundsAllTypes, EmptyImage)
+{
+  typedef TypeParam ImageTraits;
+
+  UniquePtr<Image> image(Image::create(ImageTraits::pixel_format, 37, 21));
+  clear_image(image, 0);
+
+  gfx::Rect bounds;
+  EXPECT_FALSE(algorithm::shrink_bounds(image, bounds, 0));
+  EXPECT_TRUE(bounds.isEmpty());
+}
+
+TYPED_TEST(ShrinkBoundsAllTypes, CompareWithNaiveImpl)
+{
+  typedef TypeParam ImageTraits;
+
+  int lengths[] = { 1, 7, 8, 9, 15, 16, 17, 33, 64, 65 };
+  int n = sizeof(lengths) / sizeof(lengths[0]);
+
+  std::srand(1);
+  for (int i=0; i<n; ++i) {
+    for (int j=0; j<n; ++j) {
+      int w = lengths[j];
+      int h = lengths[i];
+      UniquePtr<Image> image(Image::create(ImageTraits::pixel_format, w, h));
+
+      for (int k=0; k<4; ++k) {
+        color_t refpixel = (k < 2 ? 0: ImageTraits::max_value);
+        clear_image(image, refpixel);
+
+        // Put some random pixels
+        int count = std::rand() % 4;
+        for (int c=0; c<count; ++c)
+          put_pixel(image, std::rand() % w, std::rand() % h,
+                    std::rand() % ImageTraits::max_value);
+
+        gfx::Rect startBounds(std::rand() % w, std::rand() % h, w, h);
+        if (k % 2 == 0)
+          startBounds = image->bounds();
+        startBounds &= image->bounds();
+
+        gfx::Rect expected = naive_bounds(image, startBounds, refpixel);
+        gfx::Rect bounds;
+        bool result = algorithm::shrink_bounds(image, startBounds, bounds, refpixel);
+
+        EXPECT_EQ(!expected.isEmpty(), result);
+        if (result) {
+          EXPECT_EQ(expected, bounds);
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(ShrinkBoundsAllTypes, DiffBetweenImages)
+{
+  typedef TypeParam ImageTraits;
+
+  UniquePtr<Image> a(Image::create(ImageTraits::pixel_format, 70, 40));
+  UniquePtr<Image> b(Image::create(ImageTraits::pixel_format, 70, 40));
+  clear_image(a, 0);
+  clear_image(b, 0);
+
+  gfx::Rect bounds;
+  EXPECT_FALSE(algorithm::shrink_bounds2(a, b, a->bounds(), bounds));
+
+  put_pixel(b, 3, 30, 1);
+  put_pixel(b, 50, 2, 1);
+  put_pixel(b, 20, 10, 1);
+  EXPECT_TRUE(algorithm::shrink_bounds2(a, b, a->bounds(), bounds));
+  EXPECT_EQ(gfx::Rect(3, 2, 48, 29), bounds);
+
+  EXPECT_TRUE(algorithm::shrink_bounds2(a, b, gfx::Rect(10, 0, 60, 20), bounds));
+  EXPECT_EQ(gfx::Rect(20, 2, 31, 9), bounds);
+}
+
+TEST(ShrinkBounds, TransparentRgbPixels)
+{
+  UniquePtr<Image> image(Image::create(IMAGE_RGB, 32, 32));
+  clear_image(image, rgba(255, 0, 0, 0));
+
+  // All transparent pixels are equal
+  put_pixel(image, 4, 5, rgba(0, 255, 0, 0));
+
+  gfx::Rect bounds;
+  EXPECT_FALSE(algorithm::shrink_bounds(image, bounds, rgba(0, 0, 0, 0)));
+
+  put_pixel(image, 6, 7, rgba(0, 0, 255, 1));
+  EXPECT_TRUE(algorithm::shrink_bounds(image, bounds, rgba(0, 0, 0, 0)));
+  EXPECT_EQ(gfx::Rect(6, 7, 1, 1), bounds);
+
+  // An opaque reference pixel
+  clear_image(image, rgba(255, 255, 255, 255));
+  put_pixel(image, 20, 30, rgba(255, 255, 255, 254));
+  EXPECT_TRUE(algorithm::shrink_bounds(image, bounds, rgba(255, 255, 255, 255)));
+  EXPECT_EQ(gfx::Rect(20, 30, 1, 1), bounds);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -25,6 +25,7 @@
 #include "doc/remap.h"
 #include "doc/rgbmap.h"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -262,24 +263,19 @@ void Sprite::getLayersList(std::vector<Layer*>& layers) const
 //////////////////////////////////////////////////////////////////////
 // Palettes
 
+// Palettes are sorted by frame, the palette of a frame is the last
+// one that starts in the frame or before it.
 Palette* Sprite::palette(frame_t frame) const
 {
   ASSERT(frame >= 0);
 
-  Palette* found = NULL;
-
-  PalettesList::const_iterator end = m_palettes.end();
-  PalettesList::const_iterator it = m_palettes.begin();
-  for (; it != end; ++it) {
-    Palette* pal = *it;
-    if (frame < pal->frame())
-      break;
-
-    found = pal;
-    if (frame == pal->frame())
-      break;
-  }
+  auto it = std::upper_bound(
+    m_palettes.begin(), m_palettes.end(), frame,
+    [](frame_t f, const Palette* pal) {
+      return f < pal->frame();
+    });
 
+  Palette* found = (it != m_palettes.begin() ? *(it-1): NULL);
   ASSERT(found != NULL);
   return found;
 }
@@ -298,22 +294,11 @@ void Sprite::setPalette(const Palette* pal, bool truncate)
     pal->copyColorsTo(sprite_pal);
   }
   else {
-    Palette* other;
-
-    PalettesList::iterator end = m_palettes.end();
-    PalettesList::iterator it = m_palettes.begin();
-    for (; it != end; ++it) {
-      other = *it;
-
-      if (pal->frame() == other->frame()) {
-        pal->copyColorsTo(other);
-        return;
-      }
-      else if (pal->frame() < other->frame())
-        break;
-    }
-
-    m_palettes.insert(it, new Palette(*pal));
+    auto it = lowerBoundPalette(pal->frame());
+    if (it != m_palettes.end() && (*it)->frame() == pal->frame())
+      pal->copyColorsTo(*it);
+    else
+      m_palettes.insert(it, new Palette(*pal));
   }
 }
 
@@ -334,18 +319,23 @@ void Sprite::resetPalettes()
 
 void Sprite::deletePalette(frame_t frame)
 {
-  auto it = m_palettes.begin(), end = m_palettes.end();
-  for (; it != end; ++it) {
-    Palette* pal = *it;
-
-    if (pal->frame() == frame) {
-      delete pal;                   // delete palette
-      m_palettes.erase(it);
-      break;
-    }
+  auto it = lowerBoundPalette(frame);
+  if (it != m_palettes.end() && (*it)->frame() == frame) {
+    delete *it;                     // delete palette
+    m_palettes.erase(it);
   }
 }
 
+// Returns the first palette that starts in the given frame or after it.
+PalettesList::iterator Sprite::lowerBoundPalette(frame_t frame)
+{
+  return std::lower_bound(
+    m_palettes.begin(), m_palettes.end(), frame,
+    [](const Palette* pal, frame_t f) {
+      return pal->frame() < f;
+    });
+}
+
 RgbMap* Sprite::rgbMap(frame_t frame) const
 {
   return rgbMap(frame, backgroundLayer() ? RgbMapFor::OpaqueLayer:
@@ -391,6 +381,19 @@ void Sprite::removeFrame(frame_t frame)
   setTotalFrames(newTotal);
 }
 
+void Sprite::permuteFrames(frame_t first, const std::vector<frame_t>& newFrames)
+{
+  ASSERT(first >= 0);
+  ASSERT(first+frame_t(newFrames.size()) <= m_frames);
+
+  std::vector<int> frlens(m_frlens.begin()+first,
+                          m_frlens.begin()+first+newFrames.size());
+  for (std::size_t i=0; i<newFrames.size(); ++i)
+    m_frlens[newFrames[i]] = frlens[i];
+
+  folder()->permuteFrames(first, newFrames);
+}
+
 void Sprite::setTotalFrames(frame_t frames)
 {
   frames = MAX(frame_t(1), frames);
@@ -122,6 +122,11 @@ namespace doc {
     void removeFrame(frame_t frame);
     void setTotalFrames(frame_t frames);
 
+    // Moves each frame "first+i" (durations and cels) to the position
+    // "newFrames[i]". "newFrames" must be a permutation of the
+    // [first, first+newFrames.size()) range.
+    void permuteFrames(frame_t first, const std::vector<frame_t>& newFrames);
+
     int frameDuration(frame_t frame) const;
     void setFrameDuration(frame_t frame, int msecs);
     void setFrameRangeDuration(frame_t from, frame_t to, int msecs);
@@ -154,6 +159,8 @@ namespace doc {
     CelsRange uniqueCels(frame_t from, frame_t to) const;
 
   private:
+    PalettesList::iterator lowerBoundPalette(frame_t frame);
+
     Document* m_document;
     PixelFormat m_format;                  // pixel format
     int m_width;                           // image width (in pixels)
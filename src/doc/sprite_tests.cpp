@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -13,6 +13,7 @@
 #include "doc/cel.h"
 #include "doc/cels_range.h"
 #include "doc/layer.h"
+#include "doc/palette.h"
 #include "doc/pixel_format.h"
 #include "doc/sprite.h"
 
@@ -101,6 +102,115 @@ TEST(Sprite, CelsRange)
   EXPECT_EQ(2, i);
 }
 
+// lay1 = A B _ C D
+// lay2 = E _ F G _
+TEST(Sprite, PermuteFrames)
+{
+  Sprite* spr = new Sprite(IMAGE_RGB, 32, 32, 256);
+  spr->setTotalFrames(5);
+  for (frame_t fr=0; fr<5; ++fr)
+    spr->setFrameDuration(fr, 100+fr);
+
+  LayerImage* lay1 = new LayerImage(spr);
+  LayerImage* lay2 = new LayerImage(spr);
+  spr->folder()->addLayer(lay1);
+  spr->folder()->addLayer(lay2);
+
+  ImageRef img(Image::create(IMAGE_RGB, 32, 32));
+  Cel* celA = new Cel(frame_t(0), img); lay1->addCel(celA);
+  Cel* celB = new Cel(frame_t(1), img); lay1->addCel(celB);
+  Cel* celC = new Cel(frame_t(3), img); lay1->addCel(celC);
+  Cel* celD = new Cel(frame_t(4), img); lay1->addCel(celD);
+  Cel* celE = new Cel(frame_t(0), img); lay2->addCel(celE);
+  Cel* celF = new Cel(frame_t(2), img); lay2->addCel(celF);
+  Cel* celG = new Cel(frame_t(3), img); lay2->addCel(celG);
+
+  // Reverse frames 1-3
+  //   lay1 = A C _ B D
+  //   lay2 = E G F _ _
+  std::vector<frame_t> newFrames = { 3, 2, 1 };
+  spr->permuteFrames(1, newFrames);
+
+  EXPECT_EQ(100, spr->frameDuration(0));
+  EXPECT_EQ(103, spr->frameDuration(1));
+  EXPECT_EQ(102, spr->frameDuration(2));
+  EXPECT_EQ(101, spr->frameDuration(3));
+  EXPECT_EQ(104, spr->frameDuration(4));
+
+  EXPECT_EQ(celA, lay1->cel(0));
+  EXPECT_EQ(celC, lay1->cel(1));
+  EXPECT_EQ(nullptr, lay1->cel(2));
+  EXPECT_EQ(celB, lay1->cel(3));
+  EXPECT_EQ(celD, lay1->cel(4));
+  EXPECT_EQ(celE, lay2->cel(0));
+  EXPECT_EQ(celG, lay2->cel(1));
+  EXPECT_EQ(celF, lay2->cel(2));
+  EXPECT_EQ(nullptr, lay2->cel(3));
+  EXPECT_EQ(nullptr, lay2->cel(4));
+
+  // Move frames 0-1 after frame 4
+  //   lay1 = _ B D A C
+  //   lay2 = F _ _ E G
+  newFrames = { 3, 4, 0, 1, 2 };
+  spr->permuteFrames(0, newFrames);
+
+  EXPECT_EQ(102, spr->frameDuration(0));
+  EXPECT_EQ(101, spr->frameDuration(1));
+  EXPECT_EQ(104, spr->frameDuration(2));
+  EXPECT_EQ(100, spr->frameDuration(3));
+  EXPECT_EQ(103, spr->frameDuration(4));
+
+  CelList cels;
+  lay1->getCels(cels);
+  ASSERT_EQ(4, int(cels.size()));
+  EXPECT_EQ(celB, cels[0]); EXPECT_EQ(1, cels[0]->frame());
+  EXPECT_EQ(celD, cels[1]); EXPECT_EQ(2, cels[1]->frame());
+  EXPECT_EQ(celA, cels[2]); EXPECT_EQ(3, cels[2]->frame());
+  EXPECT_EQ(celC, cels[3]); EXPECT_EQ(4, cels[3]->frame());
+
+  cels.clear();
+  lay2->getCels(cels);
+  ASSERT_EQ(3, int(cels.size()));
+  EXPECT_EQ(celF, cels[0]); EXPECT_EQ(0, cels[0]->frame());
+  EXPECT_EQ(celE, cels[1]); EXPECT_EQ(3, cels[1]->frame());
+  EXPECT_EQ(celG, cels[2]); EXPECT_EQ(4, cels[2]->frame());
+
+  delete spr;
+}
+
+TEST(Sprite, PaletteOfEachFrame)
+{
+  Sprite* spr = new Sprite(IMAGE_INDEXED, 32, 32, 4);
+  spr->setTotalFrames(10);
+
+  for (frame_t fr : { 6, 2, 8 }) {
+    Palette pal(fr, 4);
+    pal.setEntry(0, rgba(fr, 0, 0, 255));
+    spr->setPalette(&pal, true);
+  }
+  ASSERT_EQ(4, int(spr->getPalettes().size()));
+
+  //           frame: 0  1  2  3  4  5  6  7  8  9
+  int palFrames[] = { 0, 0, 2, 2, 2, 2, 6, 6, 8, 8 };
+  for (frame_t fr=0; fr<10; ++fr)
+    EXPECT_EQ(palFrames[fr], spr->palette(fr)->frame());
+
+  // Replace the colors of an existing palette
+  Palette pal(frame_t(6), 4);
+  pal.setEntry(0, rgba(255, 255, 255, 255));
+  spr->setPalette(&pal, true);
+  ASSERT_EQ(4, int(spr->getPalettes().size()));
+  EXPECT_EQ(rgba(255, 255, 255, 255), spr->palette(7)->getEntry(0));
+
+  spr->deletePalette(6);
+  spr->deletePalette(5);        // There is no palette in frame 5
+  ASSERT_EQ(3, int(spr->getPalettes().size()));
+  EXPECT_EQ(2, spr->palette(7)->frame());
+  EXPECT_EQ(8, spr->palette(9)->frame());
+
+  delete spr;
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,99 @@
+// Aseprite Document Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_TEST_SURFACE_H_INCLUDED
+#define DOC_TEST_SURFACE_H_INCLUDED
+#pragma once
+
+#include "gfx/rect.h"
+#include "she/surface.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace doc {
+
+  // In-memory she::Surface to test and benchmark conversions to
+  // surfaces without a she back-end (only the functions used by
+  // convert_image_to_surface() are implemented).
+  class TestSurface : public she::Surface {
+  public:
+    TestSurface(int w, int h, const she::SurfaceFormatData& fd)
+      : m_w(w), m_h(h), m_fd(fd)
+      , m_data(w*h*((fd.bitsPerPixel+7)/8)) {
+    }
+
+    void dispose() override { delete this; }
+    int width() const override { return m_w; }
+    int height() const override { return m_h; }
+    bool isDirectToScreen() const override { return false; }
+
+    gfx::Rect getClipBounds() override { return gfx::Rect(0, 0, m_w, m_h); }
+    void setClipBounds(const gfx::Rect& rc) override { }
+    bool intersectClipRect(const gfx::Rect& rc) override { return true; }
+
+    void setDrawMode(she::DrawMode mode, int param) override { }
+
+    void lock() override { }
+    void unlock() override { }
+
+    void clear() override { std::fill(m_data.begin(), m_data.end(), 0); }
+
+    uint8_t* getData(int x, int y) const override {
+      int bpp = (m_fd.bitsPerPixel+7)/8;
+      return const_cast<uint8_t*>(&m_data[(y*m_w + x)*bpp]);
+    }
+
+    void getFormat(she::SurfaceFormatData* formatData) const override {
+      *formatData = m_fd;
+    }
+
+    uint32_t getRawPixel(int x, int y) const {
+      return *(const uint32_t*)getData(x, y);
+    }
+
+    gfx::Color getPixel(int x, int y) const override { return 0; }
+    void putPixel(gfx::Color color, int x, int y) override { }
+    void drawHLine(gfx::Color color, int x, int y, int w) override { }
+    void drawVLine(gfx::Color color, int x, int y, int h) override { }
+    void drawLine(gfx::Color color, const gfx::Point& a, const gfx::Point& b) override { }
+    void drawRect(gfx::Color color, const gfx::Rect& rc) override { }
+    void fillRect(gfx::Color color, const gfx::Rect& rc) override { }
+    void blitTo(she::Surface* dest, int srcx, int srcy, int dstx, int dsty, int width, int height) const override { }
+    void scrollTo(const gfx::Rect& rc, int dx, int dy) override { }
+    void drawSurface(const she::Surface* src, int dstx, int dsty) override { }
+    void drawRgbaSurface(const she::Surface* src, int dstx, int dsty) override { }
+    void drawColoredRgbaSurface(const she::Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clip) override { }
+    void drawChar(she::Font* font, gfx::Color fg, gfx::Color bg, int x, int y, int chr) override { }
+    void drawString(she::Font* font, gfx::Color fg, gfx::Color bg, int x, int y, const std::string& str) override { }
+    void applyScale(int scaleFactor) override { }
+    void* nativeHandle() override { return nullptr; }
+
+  private:
+    int m_w, m_h;
+    she::SurfaceFormatData m_fd;
+    std::vector<uint8_t> m_data;
+  };
+
+  inline she::SurfaceFormatData make_32bpp_surface_format(int rshift, int gshift,
+                                                          int bshift, int ashift) {
+    she::SurfaceFormatData fd;
+    fd.format = she::kRgbaSurfaceFormat;
+    fd.bitsPerPixel = 32;
+    fd.redShift = rshift;
+    fd.greenShift = gshift;
+    fd.blueShift = bshift;
+    fd.alphaShift = ashift;
+    fd.redMask = 0xff << rshift;
+    fd.greenMask = 0xff << gshift;
+    fd.blueMask = 0xff << bshift;
+    fd.alphaMask = 0xffu << ashift;
+    return fd;
+  }
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,195 @@
+// Aseprite
+// Copyright (C) 2016  David Capello
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "base/unique_ptr.h"
+#include "doc/image.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
+#include "filters/color_curve.h"
+#include "filters/color_curve_filter.h"
+#include "filters/convolution_matrix.h"
+#include "filters/convolution_matrix_filter.h"
+#include "filters/filter.h"
+#include "filters/filter_indexed_data.h"
+#include "filters/filter_manager.h"
+#include "filters/invert_color_filter.h"
+#include "filters/median_filter.h"
+#include "filters/replace_color_filter.h"
+
+#include <cstdlib>
+
+using namespace base;
+using namespace doc;
+using namespace filters;
+
+namespace {
+
+  enum FilterType {
+    kConvolutionMatrix,
+    kMedian,
+    kColorCurve,
+    kInvertColor,
+    kReplaceColor,
+  };
+
+  // Minimal FilterManager to apply a filter to a whole image row by
+  // row (without selection, like FilterManagerImpl does when the
+  // sprite doesn't have a mask).
+  class BenchmarkFilterManager : public FilterManager
+                               , public FilterIndexedData {
+  public:
+    BenchmarkFilterManager(const Image* src, Image* dst,
+                           Palette* palette, RgbMap* rgbmap)
+      : m_src(src), m_dst(dst)
+      , m_palette(palette), m_rgbmap(rgbmap)
+      , m_row(0) {
+    }
+
+    void applyToImage(Filter* filter) {
+      for (m_row=0; m_row<m_src->height(); ++m_row) {
+        switch (m_src->pixelFormat()) {
+          case IMAGE_RGB: filter->applyToRgba(this); break;
+          case IMAGE_GRAYSCALE: filter->applyToGrayscale(this); break;
+          case IMAGE_INDEXED: filter->applyToIndexed(this); break;
+        }
+      }
+    }
+
+    // FilterManager implementation
+    const void* getSourceAddress() override { return m_src->getPixelAddress(0, m_row); }
+    void* getDestinationAddress() override { return m_dst->getPixelAddress(0, m_row); }
+    int getWidth() override { return m_src->width(); }
+    Target getTarget() override { return TARGET_ALL_CHANNELS | TARGET_INDEX_CHANNEL; }
+    FilterIndexedData* getIndexedData() override { return this; }
+    bool skipPixel() override { return false; }
+    const Image* getSourceImage() override { return m_src; }
+    int x() override { return 0; }
+    int y() override { return m_row; }
+
+    // FilterIndexedData implementation
+    Palette* getPalette() override { return m_palette; }
+    RgbMap* getRgbMap() override { return m_rgbmap; }
+
+  private:
+    const Image* m_src;
+    Image* m_dst;
+    Palette* m_palette;
+    RgbMap* m_rgbmap;
+    int m_row;
+  };
+
+}
+
+static Filter* create_filter(FilterType type)
+{
+  switch (type) {
+
+    case kConvolutionMatrix: {
+      // 3x3 blur
+      base::SharedPtr<ConvolutionMatrix> matrix(new ConvolutionMatrix(3, 3));
+      for (int y=0; y<3; ++y)
+        for (int x=0; x<3; ++x)
+          matrix->value(x, y) = ConvolutionMatrix::Precision;
+      matrix->setDiv(9*ConvolutionMatrix::Precision);
+      ConvolutionMatrixFilter* filter = new ConvolutionMatrixFilter;
+      filter->setMatrix(matrix);
+      return filter;
+    }
+
+    case kMedian: {
+      MedianFilter* filter = new MedianFilter;
+      filter->setSize(3, 3);
+      return filter;
+    }
+
+    case kColorCurve: {
+      static ColorCurve curve(ColorCurve::Linear);
+      if (curve.begin() == curve.end()) {
+        curve.addPoint(gfx::Point(0, 0));
+        curve.addPoint(gfx::Point(64, 128));
+        curve.addPoint(gfx::Point(255, 255));
+      }
+      ColorCurveFilter* filter = new ColorCurveFilter;
+      filter->setCurve(&curve);
+      return filter;
+    }
+
+    case kInvertColor:
+      return new InvertColorFilter;
+
+    case kReplaceColor: {
+      ReplaceColorFilter* filter = new ReplaceColorFilter;
+      filter->setFrom(rgba(255, 0, 0, 255));
+      filter->setTo(rgba(0, 0, 255, 255));
+      filter->setTolerance(16);
+      return filter;
+    }
+  }
+  return nullptr;
+}
+
+static Image* create_image(PixelFormat pixelFormat, int w, int h)
+{
+  Image* image = Image::create(pixelFormat, w, h);
+  std::srand(w*h);
+  for (int y=0; y<h; y+=4) {
+    for (int x=0; x<w; x+=4) {
+      color_t c = (pixelFormat == IMAGE_RGB ?
+                   rgba(std::rand()%256, std::rand()%256, std::rand()%256, 255):
+                   std::rand()%256);
+      fill_rect(image, x, y, x+3, y+3, c);
+    }
+  }
+  return image;
+}
+
+// Args: filter type, pixel format, image size
+static void BM_Filter(benchmark::State& state)
+{
+  const FilterType filterType = (FilterType)state.range(0);
+  const PixelFormat pixelFormat = (PixelFormat)state.range(1);
+  const int w = state.range(2);
+  const int h = state.range(2);
+
+  UniquePtr<Image> src(create_image(pixelFormat, w, h));
+  UniquePtr<Image> dst(Image::create(pixelFormat, w, h));
+  UniquePtr<Palette> palette(new Palette(frame_t(0), 256));
+  for (int i=0; i<256; ++i)
+    palette->setEntry(i, rgba(i, 255-i, (i*7)&255, 255));
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette, 0);
+
+  UniquePtr<Filter> filter(create_filter(filterType));
+  BenchmarkFilterManager filterMgr(src, dst, palette, &rgbmap);
+
+  while (state.KeepRunning())
+    filterMgr.applyToImage(filter);
+
+  state.SetItemsProcessed(state.iterations() * w * h);
+  state.SetLabel(filter->getName());
+}
+
+BENCHMARK(BM_Filter)
+  ->Args({ kConvolutionMatrix, IMAGE_RGB, 512 })
+  ->Args({ kConvolutionMatrix, IMAGE_INDEXED, 512 })
+  ->Args({ kMedian, IMAGE_RGB, 512 })
+  ->Args({ kMedian, IMAGE_INDEXED, 512 })
+  ->Args({ kColorCurve, IMAGE_RGB, 512 })
+  ->Args({ kColorCurve, IMAGE_INDEXED, 512 })
+  ->Args({ kInvertColor, IMAGE_RGB, 512 })
+  ->Args({ kInvertColor, IMAGE_GRAYSCALE, 512 })
+  ->Args({ kReplaceColor, IMAGE_RGB, 512 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,185 @@
+// Aseprite Render Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/onionskin_cache.h"
+
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/sprite.h"
+
+#include <atomic>
+
+namespace render {
+
+// Maximum number of flattened frames of each cache, and memory used
+// by the flattened frames of all caches.
+static const std::size_t kMaxEntries = 32;
+static const std::size_t kMaxBytes = 128*1024*1024;
+
+static std::atomic<std::size_t> g_totalBytes(0);
+
+static std::size_t image_bytes(const Image* image)
+{
+  return image->getRowStrideSize() * image->height();
+}
+
+static void add_layer_to_key(const Layer* layer, frame_t frame,
+                             OnionskinCache::Key& key)
+{
+  key.push_back(layer->id());
+  key.push_back(uint32_t(layer->flags()));
+  if (!layer->isVisible())
+    return;
+
+  switch (layer->type()) {
+
+    case ObjectType::LayerImage: {
+      const LayerImage* imgLayer = static_cast<const LayerImage*>(layer);
+      key.push_back(imgLayer->opacity());
+
+      const Cel* cel = layer->cel(frame);
+      if (cel) {
+        const Image* image = cel->image();
+        key.push_back(cel->id());
+        key.push_back(cel->x());
+        key.push_back(cel->y());
+        key.push_back(cel->opacity());
+        key.push_back(image ? image->id(): 0);
+        key.push_back(image ? image->version(): 0);
+      }
+      else
+        key.push_back(0);
+      break;
+    }
+
+    case ObjectType::LayerFolder: {
+      LayerConstIterator it = static_cast<const LayerFolder*>(layer)->getLayerBegin();
+      LayerConstIterator end = static_cast<const LayerFolder*>(layer)->getLayerEnd();
+      for (; it != end; ++it)
+        add_layer_to_key(*it, frame, key);
+      break;
+    }
+  }
+}
+
+// Returns true if both keys are for the same layer/frame (maybe with
+// different versions).
+static bool same_frame(const OnionskinCache::Key& a,
+                       const OnionskinCache::Key& b)
+{
+  // Sprite ID, frame, withBackground
+  if (a[0] != b[0] || a[5] != b[5] || a[6] != b[6])
+    return false;
+
+  // Root layer ID (after the palette)
+  return (a.size() > 10 && b.size() > 10 && a[10] == b[10]);
+}
+
+OnionskinCache::OnionskinCache()
+  : m_useCounter(0)
+{
+}
+
+OnionskinCache::~OnionskinCache()
+{
+  clear();
+}
+
+// static
+void OnionskinCache::makeKey(const Layer* layer, frame_t frame,
+                             bool withBackground, Key& key)
+{
+  const Sprite* sprite = layer->sprite();
+  const Palette* pal = sprite->palette(frame);
+
+  key.clear();
+  key.push_back(sprite->id());
+  key.push_back(sprite->pixelFormat());
+  key.push_back(sprite->width());
+  key.push_back(sprite->height());
+  key.push_back(sprite->transparentColor());
+  key.push_back(frame);
+  key.push_back(withBackground ? 1: 0);
+
+  // Palette entries are modified without changing the palette
+  // version, but each change is counted in getModifications()
+  key.push_back(pal->id());
+  key.push_back(pal->version());
+  key.push_back(pal->getModifications());
+
+  add_layer_to_key(layer, frame, key);
+}
+
+ImageRef OnionskinCache::find(const Key& key)
+{
+  for (Entry& entry : m_entries) {
+    if (entry.key == key) {
+      entry.lastUse = ++m_useCounter;
+      return entry.image;
+    }
+  }
+  return ImageRef();
+}
+
+void OnionskinCache::add(const Key& key, const ImageRef& image)
+{
+  std::size_t imageBytes = image_bytes(image.get());
+  if (imageBytes > kMaxBytes)
+    return;
+
+  // Discard outdated images of this same frame
+  for (auto it=m_entries.begin(); it!=m_entries.end(); ) {
+    if (same_frame(it->key, key))
+      it = erase(it);
+    else
+      ++it;
+  }
+
+  // Discard the least recently used images
+  while (!m_entries.empty() &&
+         (m_entries.size() >= kMaxEntries ||
+          g_totalBytes + imageBytes > kMaxBytes)) {
+    auto lru = m_entries.begin();
+    for (auto it=m_entries.begin(), end=m_entries.end(); it!=end; ++it) {
+      if (it->lastUse < lru->lastUse)
+        lru = it;
+    }
+    erase(lru);
+  }
+
+  // The memory is used by other caches
+  if (g_totalBytes.fetch_add(imageBytes) + imageBytes > kMaxBytes) {
+    g_totalBytes -= imageBytes;
+    return;
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.image = image;
+  entry.lastUse = ++m_useCounter;
+  m_entries.push_back(entry);
+}
+
+void OnionskinCache::clear()
+{
+  for (const Entry& entry : m_entries)
+    g_totalBytes -= image_bytes(entry.image.get());
+  m_entries.clear();
+}
+
+std::vector<OnionskinCache::Entry>::iterator OnionskinCache::erase(std::vector<Entry>::iterator it)
+{
+  g_totalBytes -= image_bytes(it->image.get());
+  return m_entries.erase(it);
+}
+
+} // namespace render
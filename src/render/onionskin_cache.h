@@ -0,0 +1,78 @@
+// Aseprite Render Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_ONIONSKIN_CACHE_H_INCLUDED
+#define RENDER_ONIONSKIN_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/ints.h"
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace doc {
+  class Layer;
+}
+
+namespace render {
+  using namespace doc;
+
+  // Flattened images of the frames displayed as onionskin, so they
+  // aren't composited again on each repaint. Layers are flattened
+  // with the normal blend mode (as the onionskin overrides the blend
+  // mode of each layer), and the flattened frame is composited with
+  // the onionskin opacity/blend mode.
+  //
+  // Each image is identified by a key that contains the ID/version
+  // of all objects used to render the frame (layers, cels, images,
+  // palette, etc.), so the key changes when a cel of that frame is
+  // modified (e.g. cmd::CopyRegion increments the image version).
+  //
+  // The memory used by all the OnionskinCache instances together is
+  // limited (each Render has its own cache).
+  class OnionskinCache {
+  public:
+    typedef std::vector<uint32_t> Key;
+
+    OnionskinCache();
+    ~OnionskinCache();
+
+    // Fills "key" with the current state of the given layer (and its
+    // children) in the given frame.
+    static void makeKey(const Layer* layer, frame_t frame,
+                        bool withBackground, Key& key);
+
+    // Returns the cached image for the given key, or nullptr if it
+    // isn't in the cache (or it's outdated).
+    ImageRef find(const Key& key);
+
+    // Adds a new image in the cache. Old images are discarded if
+    // the cache is too big.
+    void add(const Key& key, const ImageRef& image);
+
+    void clear();
+
+  private:
+    struct Entry {
+      Key key;
+      ImageRef image;
+      std::size_t lastUse;
+    };
+
+    std::vector<Entry>::iterator erase(std::vector<Entry>::iterator it);
+
+    std::vector<Entry> m_entries;
+    std::size_t m_useCounter;
+
+    DISABLE_COPYING(OnionskinCache);
+  };
+
+} // namespace render
+
+#endif
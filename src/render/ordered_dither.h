@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2001-2015 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -152,19 +152,17 @@ namespace render {
                                  int u, int v,
                                  const doc::RgbMap* rgbmap,
                                  const doc::Palette* palette) {
-      const doc::LockImageBits<doc::RgbTraits> srcBits(srcImage);
-      doc::LockImageBits<doc::IndexedTraits> dstBits(dstImage);
-      auto srcIt = srcBits.begin();
-      auto dstIt = dstBits.begin();
+      ASSERT(srcImage->width() == dstImage->width());
+      ASSERT(srcImage->height() == dstImage->height());
+
       int w = srcImage->width();
       int h = srcImage->height();
 
       for (int y=0; y<h; ++y) {
-        for (int x=0; x<w; ++x, ++srcIt, ++dstIt) {
-          ASSERT(srcIt != srcBits.end());
-          ASSERT(dstIt != dstBits.end());
-          *dstIt = ditherRgbPixelToIndex(matrix, *srcIt, x+u, y+v, rgbmap, palette);
-        }
+        auto src = reinterpret_cast<doc::RgbTraits::const_address_t>(srcImage->getPixelAddress(0, y));
+        auto dst = reinterpret_cast<doc::IndexedTraits::address_t>(dstImage->getPixelAddress(0, y));
+        for (int x=0; x<w; ++x, ++src, ++dst)
+          *dst = ditherRgbPixelToIndex(matrix, *src, x+u, y+v, rgbmap, palette);
       }
     }
 
@@ -77,6 +77,38 @@ Palette* create_palette_from_sprite(
   return palette;
 }
 
+namespace {
+
+// Converts each pixel of "src" with "convert" saving the result in
+// "dst" (both images with the same size). Pixels are processed row
+// by row using raw pointers (or in one span if both images are
+// contiguous in memory).
+template<typename SrcTraits, typename DstTraits, typename Convert>
+void convert_rows(const Image* src, Image* dst, Convert convert)
+{
+  ASSERT(src->width() == dst->width());
+  ASSERT(src->height() == dst->height());
+
+  const LockImageBits<SrcTraits> srcBits(src);
+  LockImageBits<DstTraits> dstBits(dst);
+
+  int w = src->width();
+  int h = src->height();
+  if (srcBits.isContiguous() && dstBits.isContiguous()) {
+    w *= h;
+    h = 1;
+  }
+
+  for (int y=0; y<h; ++y) {
+    typename SrcTraits::const_address_t s = srcBits.row(y);
+    typename DstTraits::address_t d = dstBits.row(y);
+    for (int x=0; x<w; ++x, ++s, ++d)
+      *d = convert(*s);
+  }
+}
+
+} // anonymous namespace
+
 Image* convert_pixel_format(
   const Image* image,
   Image* new_image,
@@ -101,15 +133,11 @@ Image* convert_pixel_format(
     return new_image;
   }
 
-  color_t c;
-  int r, g, b, a;
+  const color_t old_mask_color = image->maskColor();
 
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB: {
-      const LockImageBits<RgbTraits> srcBits(image);
-      LockImageBits<RgbTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-
       switch (new_image->pixelFormat()) {
 
         // RGB -> RGB
@@ -118,81 +146,47 @@ Image* convert_pixel_format(
           break;
 
         // RGB -> Grayscale
-        case IMAGE_GRAYSCALE: {
-          LockImageBits<GrayscaleTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<GrayscaleTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<GrayscaleTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            g = 255 * Hsv(Rgb(rgba_getr(c),
-                              rgba_getg(c),
-                              rgba_getb(c))).valueInt() / 100;
-
-            *dst_it = graya(g, rgba_geta(c));
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_GRAYSCALE:
+          convert_rows<RgbTraits, GrayscaleTraits>(
+            image, new_image,
+            [](color_t c) -> color_t {
+              int g = 255 * Hsv(Rgb(rgba_getr(c),
+                                    rgba_getg(c),
+                                    rgba_getb(c))).valueInt() / 100;
+              return graya(g, rgba_geta(c));
+            });
           break;
-        }
 
         // RGB -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            r = rgba_getr(c);
-            g = rgba_getg(c);
-            b = rgba_getb(c);
-            a = rgba_geta(c);
-
-            if (a == 0)
-              *dst_it = new_mask_color;
-            else
-              *dst_it = rgbmap->mapColor(r, g, b, a);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_INDEXED:
+          convert_rows<RgbTraits, IndexedTraits>(
+            image, new_image,
+            [rgbmap, new_mask_color](color_t c) -> color_t {
+              int a = rgba_geta(c);
+              if (a == 0)
+                return new_mask_color;
+              else
+                return rgbmap->mapColor(rgba_getr(c),
+                                        rgba_getg(c),
+                                        rgba_getb(c), a);
+            });
           break;
-        }
       }
       break;
     }
 
     case IMAGE_GRAYSCALE: {
-      const LockImageBits<GrayscaleTraits> srcBits(image);
-      LockImageBits<GrayscaleTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-
       switch (new_image->pixelFormat()) {
 
         // Grayscale -> RGB
-        case IMAGE_RGB: {
-          LockImageBits<RgbTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<RgbTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<RgbTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            g = graya_getv(c);
-
-            *dst_it = rgba(g, g, g, graya_geta(c));
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_RGB:
+          convert_rows<GrayscaleTraits, RgbTraits>(
+            image, new_image,
+            [](color_t c) -> color_t {
+              int g = graya_getv(c);
+              return rgba(g, g, g, graya_geta(c));
+            });
           break;
-        }
 
         // Grayscale -> Grayscale
         case IMAGE_GRAYSCALE:
@@ -200,113 +194,68 @@ Image* convert_pixel_format(
           break;
 
         // Grayscale -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-            a = graya_geta(c);
-            c = graya_getv(c);
-
-            if (a == 0)
-              *dst_it = new_mask_color;
-            else
-              *dst_it = rgbmap->mapColor(c, c, c, a);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_INDEXED:
+          convert_rows<GrayscaleTraits, IndexedTraits>(
+            image, new_image,
+            [rgbmap, new_mask_color](color_t c) -> color_t {
+              int a = graya_geta(c);
+              int v = graya_getv(c);
+              if (a == 0)
+                return new_mask_color;
+              else
+                return rgbmap->mapColor(v, v, v, a);
+            });
           break;
-        }
       }
       break;
     }
 
     case IMAGE_INDEXED: {
-      const LockImageBits<IndexedTraits> srcBits(image);
-      LockImageBits<IndexedTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-
       switch (new_image->pixelFormat()) {
 
         // Indexed -> RGB
-        case IMAGE_RGB: {
-          LockImageBits<RgbTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<RgbTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<RgbTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            if (!is_background && c == image->maskColor())
-              *dst_it = rgba(0, 0, 0, 0);
-            else
-              *dst_it = palette->getEntry(c);
-          }
-          ASSERT(dst_it == dst_end);
+        case IMAGE_RGB:
+          convert_rows<IndexedTraits, RgbTraits>(
+            image, new_image,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == old_mask_color)
+                return rgba(0, 0, 0, 0);
+              else
+                return palette->getEntry(c);
+            });
           break;
-        }
 
         // Indexed -> Grayscale
-        case IMAGE_GRAYSCALE: {
-          LockImageBits<GrayscaleTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<GrayscaleTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<GrayscaleTraits>::iterator dst_end = dstBits.end();
-#endif
-
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
+        case IMAGE_GRAYSCALE:
+          convert_rows<IndexedTraits, GrayscaleTraits>(
+            image, new_image,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == old_mask_color)
+                return graya(0, 0);
 
-            if (!is_background && c == image->maskColor())
-              *dst_it = graya(0, 0);
-            else {
               c = palette->getEntry(c);
-              r = rgba_getr(c);
-              g = rgba_getg(c);
-              b = rgba_getb(c);
-              a = rgba_geta(c);
-
-              g = 255 * Hsv(Rgb(r, g, b)).valueInt() / 100;
-              *dst_it = graya(g, a);
-            }
-          }
-          ASSERT(dst_it == dst_end);
+              int g = 255 * Hsv(Rgb(rgba_getr(c),
+                                    rgba_getg(c),
+                                    rgba_getb(c))).valueInt() / 100;
+              return graya(g, rgba_geta(c));
+            });
           break;
-        }
 
         // Indexed -> Indexed
-        case IMAGE_INDEXED: {
-          LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
-          LockImageBits<IndexedTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-          LockImageBits<IndexedTraits>::iterator dst_end = dstBits.end();
-#endif
+        case IMAGE_INDEXED:
+          convert_rows<IndexedTraits, IndexedTraits>(
+            image, new_image,
+            [=](color_t c) -> color_t {
+              if (!is_background && c == old_mask_color)
+                return new_mask_color;
 
-          for (; src_it != src_end; ++src_it, ++dst_it) {
-            ASSERT(dst_it != dst_end);
-            c = *src_it;
-
-            if (!is_background && c == image->maskColor())
-              *dst_it = new_mask_color;
-            else {
               c = palette->getEntry(c);
-              r = rgba_getr(c);
-              g = rgba_getg(c);
-              b = rgba_getb(c);
-              a = rgba_geta(c);
-              *dst_it = rgbmap->mapColor(r, g, b, a);
-            }
-          }
-          ASSERT(dst_it == dst_end);
+              return rgbmap->mapColor(rgba_getr(c),
+                                      rgba_getg(c),
+                                      rgba_getb(c),
+                                      rgba_geta(c));
+            });
           break;
-        }
 
       }
       break;
@@ -322,46 +271,46 @@ Image* convert_pixel_format(
 
 void PaletteOptimizer::feedWithImage(Image* image, bool withAlpha)
 {
-  uint32_t color;
-
   ASSERT(image);
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB:
       {
         const LockImageBits<RgbTraits> bits(image);
-        LockImageBits<RgbTraits>::const_iterator it = bits.begin(), end = bits.end();
-
-        for (; it != end; ++it) {
-          color = *it;
-          if (rgba_geta(color) > 0) {
-            if (!withAlpha)
-              color |= rgba(0, 0, 0, 255);
-
-            m_histogram.addSamples(color, 1);
-          }
-        }
+        bits.forEachSpan(
+          [this, withAlpha](RgbTraits::const_address_t it, int n) {
+            for (; n > 0; --n, ++it) {
+              color_t color = *it;
+              if (rgba_geta(color) > 0) {
+                if (!withAlpha)
+                  color |= rgba(0, 0, 0, 255);
+
+                m_histogram.addSamples(color, 1);
+              }
+            }
+          });
       }
       break;
 
     case IMAGE_GRAYSCALE:
       {
-        const LockImageBits<RgbTraits> bits(image);
-        LockImageBits<RgbTraits>::const_iterator it = bits.begin(), end = bits.end();
-
-        for (; it != end; ++it) {
-          color = *it;
-
-          if (graya_geta(color) > 0) {
-            if (!withAlpha)
-              color = graya(graya_getv(color), 255);
-
-            m_histogram.addSamples(rgba(graya_getv(color),
-                                        graya_getv(color),
-                                        graya_getv(color),
-                                        graya_geta(color)), 1);
-          }
-        }
+        const LockImageBits<GrayscaleTraits> bits(image);
+        bits.forEachSpan(
+          [this, withAlpha](GrayscaleTraits::const_address_t it, int n) {
+            for (; n > 0; --n, ++it) {
+              color_t color = *it;
+
+              if (graya_geta(color) > 0) {
+                if (!withAlpha)
+                  color = graya(graya_getv(color), 255);
+
+                m_histogram.addSamples(rgba(graya_getv(color),
+                                            graya_getv(color),
+                                            graya_getv(color),
+                                            graya_geta(color)), 1);
+              }
+            }
+          });
       }
       break;
 
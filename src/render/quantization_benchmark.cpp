@@ -0,0 +1,100 @@
+// Aseprite Render Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "render/quantization.h"
+
+#include "base/unique_ptr.h"
+#include "doc/image.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/rgbmap.h"
+
+#include <cstdlib>
+
+using namespace doc;
+using namespace render;
+
+// Creates a RGB image with gradients and some noise (so there are
+// a lot of different colors to quantize).
+static Image* create_rgb_image(int w, int h)
+{
+  Image* image = Image::create(IMAGE_RGB, w, h);
+  std::srand(w*h);
+  for (int y=0; y<h; ++y) {
+    for (int x=0; x<w; ++x) {
+      int n = std::rand()%16;
+      put_pixel(image, x, y,
+                rgba((255*x/w + n) & 255,
+                     (255*y/h + n) & 255,
+                     (x^y) & 255,
+                     (x+y) % 64 ? 255: 0));
+    }
+  }
+  return image;
+}
+
+static Palette* create_optimized_palette(Image* image)
+{
+  Palette* palette = new Palette(frame_t(0), 256);
+  PaletteOptimizer optimizer;
+  optimizer.feedWithImage(image, true);
+  optimizer.calculate(palette, 0, nullptr);
+  return palette;
+}
+
+static void BM_PaletteOptimizer(benchmark::State& state)
+{
+  const int w = state.range(0);
+  const int h = state.range(0);
+  base::UniquePtr<Image> src(create_rgb_image(w, h));
+
+  while (state.KeepRunning()) {
+    base::UniquePtr<Palette> palette(create_optimized_palette(src));
+  }
+  state.SetItemsProcessed(state.iterations() * w * h);
+}
+
+// Args: destination pixel format, dithering method, image size
+static void BM_ConvertPixelFormat(benchmark::State& state)
+{
+  const PixelFormat pixelFormat = (PixelFormat)state.range(0);
+  const DitheringMethod ditheringMethod = (DitheringMethod)state.range(1);
+  const int w = state.range(2);
+  const int h = state.range(2);
+
+  base::UniquePtr<Image> src(create_rgb_image(w, h));
+  base::UniquePtr<Palette> palette(create_optimized_palette(src));
+  RgbMap rgbmap;
+  rgbmap.regenerate(palette, 0);
+
+  while (state.KeepRunning()) {
+    base::UniquePtr<Image> dst(
+      convert_pixel_format(src, nullptr, pixelFormat, ditheringMethod,
+                           &rgbmap, palette, false, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * w * h);
+}
+
+BENCHMARK(BM_PaletteOptimizer)
+  ->Arg(256)
+  ->Arg(1024)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ConvertPixelFormat)
+  ->Args({ IMAGE_INDEXED, int(DitheringMethod::NONE), 256 })
+  ->Args({ IMAGE_INDEXED, int(DitheringMethod::NONE), 1024 })
+  ->Args({ IMAGE_INDEXED, int(DitheringMethod::ORDERED), 256 })
+  ->Args({ IMAGE_INDEXED, int(DitheringMethod::ORDERED), 1024 })
+  ->Args({ IMAGE_GRAYSCALE, int(DitheringMethod::NONE), 1024 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -11,6 +11,7 @@
 #include "render/render.h"
 
 #include "base/base.h"
+#include "base/profiler.h"
 #include "doc/blend_internals.h"
 #include "doc/blend_mode.h"
 #include "doc/doc.h"
@@ -155,33 +156,21 @@ void composite_image_without_scale(
 
   gfx::Rect srcBounds = area.srcBounds();
   gfx::Rect dstBounds = area.dstBounds();
-  int bottom = area.dst.y+area.size.h-1;
 
   ASSERT(!srcBounds.isEmpty());
+  ASSERT(srcBounds.size() == dstBounds.size());
 
   // Lock all necessary bits
   const LockImageBits<SrcTraits> srcBits(src, srcBounds);
   LockImageBits<DstTraits> dstBits(dst, dstBounds);
-  typename LockImageBits<SrcTraits>::const_iterator src_it = srcBits.begin();
-  typename LockImageBits<SrcTraits>::const_iterator src_end = srcBits.end();
-  typename LockImageBits<DstTraits>::iterator dst_it, dst_end;
 
   // For each line to draw of the source image...
-  dstBounds.h = 1;
   for (int y=0; y<srcBounds.h; ++y) {
-    dst_it = dstBits.begin_area(dstBounds);
-    dst_end = dstBits.end_area(dstBounds);
-
-    for (int x=0; x<srcBounds.w; ++x) {
-      ASSERT(src_it >= srcBits.begin() && src_it < src_end);
-      ASSERT(dst_it >= dstBits.begin() && dst_it < dst_end);
-      *dst_it = blender(*dst_it, *src_it, opacity);
-      ++src_it;
-      ++dst_it;
-    }
+    typename SrcTraits::const_address_t src_address = srcBits.row(y);
+    typename DstTraits::address_t dst_address = dstBits.row(y);
 
-    if (++dstBounds.y > bottom)
-      break;
+    for (int x=0; x<srcBounds.w; ++x, ++src_address, ++dst_address)
+      *dst_address = blender(*dst_address, *src_address, opacity);
   }
 }
 
@@ -583,6 +572,8 @@ void Render::renderSprite(
   const gfx::Clip& area,
   Zoom zoom)
 {
+  base::profiler::ScopedTimer timer("render", "Render::renderSprite");
+
   m_sprite = sprite;
 
   CompositeImageFunc compositeImage =
@@ -723,20 +714,77 @@ void Render::renderOnionskin(
         else if (m_onionskin.type() == OnionskinType::RED_BLUE_TINT)
           blendMode = (frameOut < frame ? BlendMode::RED_TINT: BlendMode::BLUE_TINT);
 
-        renderLayer(
-          onionLayer, dstImage,
-          area, frameIn, zoom, compositeImage,
-          // Render background only for "in-front" onion skinning and
-          // when opacity is < 255
+        // Render background only for "in-front" onion skinning and
+        // when opacity is < 255
+        bool withBackground =
           (m_globalOpacity < 255 &&
-           m_onionskin.position() == OnionskinPosition::INFRONT),
-          true,
-          blendMode);
+           m_onionskin.position() == OnionskinPosition::INFRONT);
+
+        // Composite the flattened frame (from the cache if possible)
+        ImageRef flat;
+        if (dstImage->pixelFormat() == IMAGE_RGB)
+          flat = getOnionskinFrame(onionLayer, frameIn, withBackground);
+
+        if (flat) {
+          renderImage(
+            dstImage, flat.get(),
+            m_sprite->palette(frameIn), 0, 0, area,
+            get_image_composition(IMAGE_RGB, IMAGE_RGB, zoom),
+            m_globalOpacity, blendMode, zoom);
+        }
+        else {
+          renderLayer(
+            onionLayer, dstImage,
+            area, frameIn, zoom, compositeImage,
+            withBackground,
+            true,
+            blendMode);
+        }
       }
     }
   }
 }
 
+// Returns the flattened image (RGB and without zoom) of the given
+// layer in the given frame. Only modified frames are rendered again.
+ImageRef Render::getOnionskinFrame(
+  const Layer* layer,
+  frame_t frame,
+  bool withBackground)
+{
+  // Frames with a preview/extra image change on each repaint, so
+  // they are flattened but not cached.
+  bool cacheable =
+    (!(m_previewImage && m_selectedFrame == frame) &&
+     !(m_extraCel && m_currentFrame == frame));
+
+  ImageRef flat;
+  if (cacheable) {
+    OnionskinCache::makeKey(layer, frame, withBackground, m_onionskinKey);
+    flat = m_onionskinCache.find(m_onionskinKey);
+  }
+
+  if (!flat) {
+    flat.reset(Image::create(IMAGE_RGB, m_sprite->width(), m_sprite->height()));
+    clear_image(flat.get(), 0);
+
+    int oldGlobalOpacity = m_globalOpacity;
+    m_globalOpacity = 255;
+    renderLayer(
+      layer, flat.get(),
+      gfx::Clip(m_sprite->bounds()), frame, Zoom(1, 1),
+      get_image_composition(IMAGE_RGB, m_sprite->pixelFormat(), Zoom(1, 1)),
+      withBackground,
+      true,
+      BlendMode::NORMAL);
+    m_globalOpacity = oldGlobalOpacity;
+
+    if (cacheable)
+      m_onionskinCache.add(m_onionskinKey, flat);
+  }
+  return flat;
+}
+
 void Render::renderBackground(Image* image,
   const gfx::Clip& area,
   Zoom zoom)
@@ -16,6 +16,7 @@
 #include "gfx/point.h"
 #include "gfx/size.h"
 #include "render/extra_type.h"
+#include "render/onionskin_cache.h"
 #include "render/onionskin_position.h"
 #include "render/zoom.h"
 
@@ -179,6 +180,11 @@ namespace render {
       frame_t frame, Zoom zoom,
       CompositeImageFunc compositeImage);
 
+    ImageRef getOnionskinFrame(
+      const Layer* layer,
+      frame_t frame,
+      bool withBackground);
+
     void renderLayer(
       const Layer* layer,
       Image* image,
@@ -228,6 +234,8 @@ namespace render {
     gfx::Point m_previewPos;
     BlendMode m_previewBlendMode;
     OnionskinOptions m_onionskin;
+    OnionskinCache m_onionskinCache;
+    OnionskinCache::Key m_onionskinKey;
   };
 
   void composite_image(Image* dst,
@@ -0,0 +1,129 @@
+// Aseprite Render Library
+// Copyright (c) 2016 David Capello
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "render/render.h"
+
+#include "base/unique_ptr.h"
+#include "doc/cel.h"
+#include "doc/context.h"
+#include "doc/document.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "gfx/clip.h"
+
+#include <cstdlib>
+
+using namespace doc;
+using namespace render;
+
+// Fills the image with semi-transparent random blocks.
+static void fill_random_blocks(Image* image, int blockSize)
+{
+  for (int y=0; y<image->height(); y+=blockSize) {
+    for (int x=0; x<image->width(); x+=blockSize) {
+      color_t c = rgba(std::rand()%256, std::rand()%256, std::rand()%256,
+                       std::rand()%256);
+      fill_rect(image, x, y, x+blockSize-1, y+blockSize-1, c);
+    }
+  }
+}
+
+// Creates a RGB sprite with "nlayers" image layers (the first one is
+// the one created by Documents::add()).
+static Document* create_document(Context* ctx, int w, int h, int nlayers)
+{
+  Document* doc = ctx->documents().add(w, h, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+  std::srand(w*h*nlayers);
+
+  fill_random_blocks(sprite->folder()->getFirstLayer()->cel(0)->image(), 8);
+  for (int i=1; i<nlayers; ++i) {
+    LayerImage* layer = new LayerImage(sprite);
+    sprite->folder()->addLayer(layer);
+
+    ImageRef image(Image::create(IMAGE_RGB, w, h));
+    fill_random_blocks(image.get(), 8);
+    layer->addCel(new Cel(0, image));
+  }
+  return doc;
+}
+
+static void destroy_document(Document* doc)
+{
+  doc->close();
+  delete doc;
+}
+
+// Args: zoom numerator, zoom denominator, number of layers
+static void BM_RenderSprite(benchmark::State& state)
+{
+  const Zoom zoom(state.range(0), state.range(1));
+  const int nlayers = state.range(2);
+  const int w = 256;
+  const int h = 256;
+
+  Context ctx;
+  Document* doc = create_document(&ctx, w, h, nlayers);
+
+  const gfx::Rect zoomedBounds = zoom.apply(gfx::Rect(0, 0, w, h));
+  base::UniquePtr<Image> dst(
+    Image::create(IMAGE_RGB, zoomedBounds.w, zoomedBounds.h));
+
+  Render render;
+  render.setBgType(BgType::CHECKED);
+  while (state.KeepRunning()) {
+    render.renderSprite(dst, doc->sprite(), frame_t(0),
+                        gfx::Clip(zoomedBounds), zoom);
+  }
+  state.SetItemsProcessed(state.iterations() * zoomedBounds.w * zoomedBounds.h);
+
+  destroy_document(doc);
+}
+
+static void BM_CompositeImage(benchmark::State& state)
+{
+  const BlendMode blendMode = (BlendMode)state.range(0);
+  const int w = 512;
+  const int h = 512;
+
+  std::srand(w*h);
+  base::UniquePtr<Image> dst(Image::create(IMAGE_RGB, w, h));
+  base::UniquePtr<Image> src(Image::create(IMAGE_RGB, w, h));
+  base::UniquePtr<Palette> pal(new Palette(frame_t(0), 256));
+  fill_random_blocks(dst, 4);
+  fill_random_blocks(src, 3);
+
+  while (state.KeepRunning())
+    composite_image(dst, src, pal, 0, 0, 200, blendMode);
+
+  state.SetItemsProcessed(state.iterations() * w * h);
+  state.SetLabel(blend_mode_to_string(blendMode).c_str());
+}
+
+BENCHMARK(BM_RenderSprite)
+  ->Args({ 1, 1, 1 })
+  ->Args({ 1, 1, 8 })
+  ->Args({ 1, 1, 32 })
+  ->Args({ 1, 2, 8 })
+  ->Args({ 2, 1, 8 })
+  ->Args({ 8, 1, 1 })
+  ->Args({ 8, 1, 8 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_CompositeImage)
+  ->DenseRange(int(BlendMode::NORMAL), int(BlendMode::HSL_LUMINOSITY))
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
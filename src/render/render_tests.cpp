@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2001-2014 David Capello
+// Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -17,9 +17,11 @@
 #include "doc/context.h"
 #include "doc/document.h"
 #include "doc/image.h"
+#include "doc/blend_funcs.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
+#include "doc/sprite.h"
 
 using namespace doc;
 using namespace render;
@@ -214,6 +216,124 @@ TEST(Render, ZoomAndDstBounds)
     0, 0, 0, 0);
 }
 
+TEST(Render, OnionskinCache)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(2, 2, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+  LayerImage* layer = static_cast<LayerImage*>(sprite->layer(0));
+  sprite->setTotalFrames(frame_t(2));
+
+  Image* prev = layer->cel(0)->image();
+  clear_image(prev, rgba(255, 0, 0, 255));
+  put_pixel(prev, 1, 1, 0);
+
+  ImageRef cur(Image::create(IMAGE_RGB, 2, 2));
+  clear_image(cur.get(), 0);
+  put_pixel(cur.get(), 0, 0, rgba(0, 0, 255, 255));
+  layer->addCel(new Cel(frame_t(1), cur));
+
+  OnionskinOptions opts(OnionskinType::MERGE);
+  opts.prevFrames(1);
+  opts.opacityBase(255);
+
+  Render render;
+  render.setOnionskin(opts);
+
+  base::UniquePtr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    rgba(0, 0, 255, 255), rgba(255, 0, 0, 255),
+    rgba(255, 0, 0, 255), 0);
+
+  // Same result from the cached frame
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    rgba(0, 0, 255, 255), rgba(255, 0, 0, 255),
+    rgba(255, 0, 0, 255), 0);
+
+  // Modify the previous frame
+  put_pixel(prev, 1, 0, rgba(0, 255, 0, 255));
+  prev->incrementVersion();
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    rgba(0, 0, 255, 255), rgba(0, 255, 0, 255),
+    rgba(255, 0, 0, 255), 0);
+
+  // Move the cel of the previous frame
+  layer->cel(0)->setPosition(1, 0);
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    rgba(0, 0, 255, 255), rgba(255, 0, 0, 255),
+    0, rgba(255, 0, 0, 255));
+}
+
+// Overlapping layers (or layers with opacity) in an onionskin frame
+// are flattened with the normal blend mode and then composited with
+// the onionskin opacity. The flattened frame is reused until a cel
+// image changes its version.
+TEST(Render, OnionskinOverlappingLayers)
+{
+  Context ctx;
+  Document* doc = ctx.documents().add(2, 2, ColorMode::RGB);
+  Sprite* sprite = doc->sprite();
+  LayerImage* layer1 = static_cast<LayerImage*>(sprite->layer(0));
+  LayerImage* layer2 = new LayerImage(sprite);
+  sprite->folder()->addLayer(layer2);
+  sprite->setTotalFrames(frame_t(2));
+
+  clear_image(layer1->cel(0)->image(), rgba(255, 0, 0, 255));
+
+  ImageRef blue(Image::create(IMAGE_RGB, 1, 1));
+  clear_image(blue.get(), rgba(0, 0, 255, 255));
+  layer2->addCel(new Cel(frame_t(0), blue));
+
+  OnionskinOptions opts(OnionskinType::MERGE);
+  opts.prevFrames(1);
+  opts.opacityBase(128);
+
+  Render render;
+  render.setBgType(BgType::TRANSPARENT);
+  render.setOnionskin(opts);
+
+  color_t red = rgba_blender_normal(0, rgba(255, 0, 0, 255), 128);
+  color_t blue128 = rgba_blender_normal(0, rgba(0, 0, 255, 255), 128);
+
+  base::UniquePtr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    blue128, red,
+    red, red);
+
+  // Modify the image without changing its version, the cached frame
+  // is used
+  clear_image(blue.get(), rgba(0, 255, 0, 255));
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    blue128, red,
+    red, red);
+
+  // New version of the image
+  blue->incrementVersion();
+  color_t green128 = rgba_blender_normal(0, rgba(0, 255, 0, 255), 128);
+  render.renderSprite(dst, sprite, frame_t(1));
+  EXPECT_2X2_PIXELS(dst,
+    green128, red,
+    red, red);
+
+  // Layer with opacity
+  layer1->setVisible(false);
+  layer2->setOpacity(128);
+
+  color_t green64 = rgba_blender_normal(0, green128, 128);
+  for (int i=0; i<2; ++i) {
+    render.renderSprite(dst, sprite, frame_t(1));
+    EXPECT_2X2_PIXELS(dst,
+      green64, 0,
+      0, 0);
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);